@@ -0,0 +1,367 @@
+// CyCharm : Display-width and visual column engine
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "memory.h"
+#include "column.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLUMN_USE_SSE2
+#endif
+
+typedef struct ColumnRange {
+    unsigned int first;
+    unsigned int last;
+} ColumnRange;
+
+// Zero-width code points: combining marks (Mn, Me), Hangul medial/final jamo, format
+// characters, variation selectors and emoji skin-tone modifiers. Sorted for binary search.
+static const ColumnRange g_zeroWidthRanges[] = {
+    { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+    { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+    { 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 },
+    { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0711, 0x0711 }, { 0x0730, 0x074A },
+    { 0x07A6, 0x07B0 }, { 0x07EB, 0x07F3 }, { 0x0816, 0x0819 }, { 0x081B, 0x0823 },
+    { 0x0825, 0x0827 }, { 0x0829, 0x082D }, { 0x0859, 0x085B }, { 0x08D3, 0x08E1 },
+    { 0x08E3, 0x0902 }, { 0x093A, 0x093A }, { 0x093C, 0x093C }, { 0x0941, 0x0948 },
+    { 0x094D, 0x094D }, { 0x0951, 0x0957 }, { 0x0962, 0x0963 }, { 0x0981, 0x0981 },
+    { 0x09BC, 0x09BC }, { 0x09C1, 0x09C4 }, { 0x09CD, 0x09CD }, { 0x09E2, 0x09E3 },
+    { 0x0A01, 0x0A02 }, { 0x0A3C, 0x0A3C }, { 0x0A41, 0x0A51 }, { 0x0A70, 0x0A71 },
+    { 0x0A75, 0x0A75 }, { 0x0A81, 0x0A82 }, { 0x0ABC, 0x0ABC }, { 0x0AC1, 0x0AC8 },
+    { 0x0ACD, 0x0ACD }, { 0x0AE2, 0x0AE3 }, { 0x0B01, 0x0B01 }, { 0x0B3C, 0x0B3C },
+    { 0x0B3F, 0x0B3F }, { 0x0B41, 0x0B44 }, { 0x0B4D, 0x0B4D }, { 0x0B56, 0x0B56 },
+    { 0x0B62, 0x0B63 }, { 0x0B82, 0x0B82 }, { 0x0BC0, 0x0BC0 }, { 0x0BCD, 0x0BCD },
+    { 0x0C00, 0x0C00 }, { 0x0C3E, 0x0C40 }, { 0x0C46, 0x0C56 }, { 0x0C62, 0x0C63 },
+    { 0x0C81, 0x0C81 }, { 0x0CBC, 0x0CBC }, { 0x0CCC, 0x0CCD }, { 0x0CE2, 0x0CE3 },
+    { 0x0D00, 0x0D01 }, { 0x0D41, 0x0D44 }, { 0x0D4D, 0x0D4D }, { 0x0D62, 0x0D63 },
+    { 0x0DCA, 0x0DCA }, { 0x0DD2, 0x0DD6 }, { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A },
+    { 0x0E47, 0x0E4E }, { 0x0EB1, 0x0EB1 }, { 0x0EB4, 0x0EBC }, { 0x0EC8, 0x0ECD },
+    { 0x0F18, 0x0F19 }, { 0x0F35, 0x0F35 }, { 0x0F37, 0x0F37 }, { 0x0F39, 0x0F39 },
+    { 0x0F71, 0x0F7E }, { 0x0F80, 0x0F84 }, { 0x0F86, 0x0F87 }, { 0x0F8D, 0x0FBC },
+    { 0x0FC6, 0x0FC6 }, { 0x102D, 0x1030 }, { 0x1032, 0x1037 }, { 0x1039, 0x103A },
+    { 0x103D, 0x103E }, { 0x1058, 0x1059 }, { 0x105E, 0x1060 }, { 0x1071, 0x1074 },
+    { 0x1082, 0x1082 }, { 0x1085, 0x1086 }, { 0x108D, 0x108D }, { 0x109D, 0x109D },
+    { 0x1160, 0x11FF }, { 0x135D, 0x135F }, { 0x1712, 0x1714 }, { 0x1732, 0x1734 },
+    { 0x1752, 0x1753 }, { 0x1772, 0x1773 }, { 0x17B4, 0x17B5 }, { 0x17B7, 0x17BD },
+    { 0x17C6, 0x17C6 }, { 0x17C9, 0x17D3 }, { 0x17DD, 0x17DD }, { 0x180B, 0x180F },
+    { 0x1885, 0x1886 }, { 0x18A9, 0x18A9 }, { 0x1920, 0x1922 }, { 0x1927, 0x1928 },
+    { 0x1932, 0x1932 }, { 0x1939, 0x193B }, { 0x1A17, 0x1A18 }, { 0x1A1B, 0x1A1B },
+    { 0x1A56, 0x1A56 }, { 0x1A58, 0x1A60 }, { 0x1A62, 0x1A62 }, { 0x1A65, 0x1A6C },
+    { 0x1A73, 0x1A7F }, { 0x1AB0, 0x1AFF }, { 0x1B00, 0x1B03 }, { 0x1B34, 0x1B34 },
+    { 0x1B36, 0x1B3A }, { 0x1B3C, 0x1B3C }, { 0x1B42, 0x1B42 }, { 0x1B6B, 0x1B73 },
+    { 0x1B80, 0x1B81 }, { 0x1BA2, 0x1BA5 }, { 0x1BA8, 0x1BA9 }, { 0x1BAB, 0x1BAD },
+    { 0x1BE6, 0x1BE6 }, { 0x1BE8, 0x1BE9 }, { 0x1BED, 0x1BED }, { 0x1BEF, 0x1BF1 },
+    { 0x1C2C, 0x1C33 }, { 0x1C36, 0x1C37 }, { 0x1CD0, 0x1CD2 }, { 0x1CD4, 0x1CE0 },
+    { 0x1CE2, 0x1CE8 }, { 0x1CED, 0x1CED }, { 0x1CF4, 0x1CF4 }, { 0x1CF8, 0x1CF9 },
+    { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F }, { 0x202A, 0x202E }, { 0x2060, 0x2064 },
+    { 0x20D0, 0x20F0 }, { 0x2CEF, 0x2CF1 }, { 0x2D7F, 0x2D7F }, { 0x2DE0, 0x2DFF },
+    { 0x302A, 0x302D }, { 0x3099, 0x309A }, { 0xA66F, 0xA672 }, { 0xA674, 0xA67D },
+    { 0xA69E, 0xA69F }, { 0xA6F0, 0xA6F1 }, { 0xA802, 0xA802 }, { 0xA806, 0xA806 },
+    { 0xA80B, 0xA80B }, { 0xA825, 0xA826 }, { 0xA8C4, 0xA8C5 }, { 0xA8E0, 0xA8F1 },
+    { 0xA8FF, 0xA8FF }, { 0xA926, 0xA92D }, { 0xA947, 0xA951 }, { 0xA980, 0xA982 },
+    { 0xA9B3, 0xA9B3 }, { 0xA9B6, 0xA9B9 }, { 0xA9BC, 0xA9BD }, { 0xA9E5, 0xA9E5 },
+    { 0xAA29, 0xAA2E }, { 0xAA31, 0xAA32 }, { 0xAA35, 0xAA36 }, { 0xAA43, 0xAA43 },
+    { 0xAA4C, 0xAA4C }, { 0xAA7C, 0xAA7C }, { 0xAAB0, 0xAAB0 }, { 0xAAB2, 0xAAB4 },
+    { 0xAAB7, 0xAAB8 }, { 0xAABE, 0xAABF }, { 0xAAC1, 0xAAC1 }, { 0xAAEC, 0xAAED },
+    { 0xAAF6, 0xAAF6 }, { 0xABE5, 0xABE5 }, { 0xABE8, 0xABE8 }, { 0xABED, 0xABED },
+    { 0xD7B0, 0xD7FF }, { 0xFB1E, 0xFB1E }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F },
+    { 0xFEFF, 0xFEFF }, { 0x101FD, 0x101FD }, { 0x102E0, 0x102E0 }, { 0x10376, 0x1037A },
+    { 0x10A01, 0x10A0F }, { 0x10A38, 0x10A3F }, { 0x11001, 0x11001 }, { 0x11038, 0x11046 },
+    { 0x1107F, 0x11081 }, { 0x110B3, 0x110B6 }, { 0x110B9, 0x110BA }, { 0x11100, 0x11102 },
+    { 0x11127, 0x1112B }, { 0x1112D, 0x11134 }, { 0x1D167, 0x1D169 }, { 0x1D17B, 0x1D182 },
+    { 0x1D185, 0x1D18B }, { 0x1D1AA, 0x1D1AD }, { 0x1D242, 0x1D244 }, { 0x1E8D0, 0x1E8D6 },
+    { 0x1E944, 0x1E94A }, { 0x1F3FB, 0x1F3FF }, { 0xE0001, 0xE0001 }, { 0xE0020, 0xE007F },
+    { 0xE0100, 0xE01EF }
+};
+
+// East Asian Wide (W) and Fullwidth (F) code points, including wide emoji. Sorted for binary search.
+static const ColumnRange g_wideRanges[] = {
+    { 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC },
+    { 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 },
+    { 0x2648, 0x2653 }, { 0x267F, 0x267F }, { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 },
+    { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 }, { 0x26CE, 0x26CE },
+    { 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+    { 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B },
+    { 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 },
+    { 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF },
+    { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 }, { 0x2E80, 0x2E99 },
+    { 0x2E9B, 0x2EF3 }, { 0x2F00, 0x2FD5 }, { 0x2FF0, 0x2FFB }, { 0x3000, 0x303E },
+    { 0x3041, 0x3096 }, { 0x3099, 0x30FF }, { 0x3105, 0x312F }, { 0x3131, 0x318E },
+    { 0x3190, 0x31E3 }, { 0x31F0, 0x321E }, { 0x3220, 0x3247 }, { 0x3250, 0x4DBF },
+    { 0x4E00, 0xA48C }, { 0xA490, 0xA4C6 }, { 0xA960, 0xA97C }, { 0xAC00, 0xD7A3 },
+    { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 }, { 0xFE30, 0xFE52 }, { 0xFE54, 0xFE66 },
+    { 0xFE68, 0xFE6B }, { 0xFF01, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x16FE4 },
+    { 0x16FF0, 0x16FF1 }, { 0x17000, 0x187F7 }, { 0x18800, 0x18CD5 }, { 0x18D00, 0x18D08 },
+    { 0x1AFF0, 0x1AFF3 }, { 0x1AFF5, 0x1AFFB }, { 0x1AFFD, 0x1AFFE }, { 0x1B000, 0x1B122 },
+    { 0x1B150, 0x1B152 }, { 0x1B164, 0x1B167 }, { 0x1B170, 0x1B2FB }, { 0x1F004, 0x1F004 },
+    { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F202 },
+    { 0x1F210, 0x1F23B }, { 0x1F240, 0x1F248 }, { 0x1F250, 0x1F251 }, { 0x1F260, 0x1F265 },
+    { 0x1F300, 0x1F320 }, { 0x1F32D, 0x1F335 }, { 0x1F337, 0x1F37C }, { 0x1F37E, 0x1F393 },
+    { 0x1F3A0, 0x1F3CA }, { 0x1F3CF, 0x1F3D3 }, { 0x1F3E0, 0x1F3F0 }, { 0x1F3F4, 0x1F3F4 },
+    { 0x1F3F8, 0x1F43E }, { 0x1F440, 0x1F440 }, { 0x1F442, 0x1F4FC }, { 0x1F4FF, 0x1F53D },
+    { 0x1F54B, 0x1F54E }, { 0x1F550, 0x1F567 }, { 0x1F57A, 0x1F57A }, { 0x1F595, 0x1F596 },
+    { 0x1F5A4, 0x1F5A4 }, { 0x1F5FB, 0x1F64F }, { 0x1F680, 0x1F6C5 }, { 0x1F6CC, 0x1F6CC },
+    { 0x1F6D0, 0x1F6D2 }, { 0x1F6D5, 0x1F6D7 }, { 0x1F6DC, 0x1F6DF }, { 0x1F6EB, 0x1F6EC },
+    { 0x1F6F4, 0x1F6FC }, { 0x1F7E0, 0x1F7EB }, { 0x1F7F0, 0x1F7F0 }, { 0x1F90C, 0x1F93A },
+    { 0x1F93C, 0x1F945 }, { 0x1F947, 0x1F9FF }, { 0x1FA70, 0x1FA7C }, { 0x1FA80, 0x1FA88 },
+    { 0x1FA90, 0x1FABD }, { 0x1FABF, 0x1FAC5 }, { 0x1FACE, 0x1FADB }, { 0x1FAE0, 0x1FAE8 },
+    { 0x1FAF0, 0x1FAF8 }, { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD }
+};
+
+// Function to check whether a code point falls in one of the sorted ranges
+static BOOL ColumnInRanges(const ColumnRange* ranges, size_t count, unsigned int codePoint) {
+    if (codePoint < ranges[0].first || codePoint > ranges[count - 1].last) {
+        return FALSE;
+    }
+
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (codePoint > ranges[mid].last) {
+            low = mid + 1;
+        } else if (codePoint < ranges[mid].first) {
+            high = mid;
+        } else {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+int ColumnCodePointWidth(unsigned int codePoint) {
+    if (codePoint < 0x300) {
+        return 1;
+    }
+    if (ColumnInRanges(g_zeroWidthRanges, sizeof(g_zeroWidthRanges) / sizeof(g_zeroWidthRanges[0]), codePoint)) {
+        return 0;
+    }
+    if (ColumnInRanges(g_wideRanges, sizeof(g_wideRanges) / sizeof(g_wideRanges[0]), codePoint)) {
+        return 2;
+    }
+    return 1;
+}
+
+// Function to get the display width of the UTF-16 unit at an index, given the column it starts at
+// A surrogate pair's width is counted on its high half; a pictograph joined by ZWJ adds nothing
+size_t ColumnUnitWidth(const WCHAR* text, size_t length, size_t index, size_t column, int tabWidth) {
+    WCHAR ch = text[index];
+    if (ch == L'\t') {
+        return (size_t)tabWidth - column % (size_t)tabWidth;
+    }
+    if (ch < 0x300) {
+        return 1;
+    }
+
+    unsigned int codePoint = ch;
+    if (ch >= 0xD800 && ch <= 0xDBFF && index + 1 < length && text[index + 1] >= 0xDC00 && text[index + 1] <= 0xDFFF) {
+        codePoint = 0x10000 + (((unsigned int)ch - 0xD800) << 10) + ((unsigned int)text[index + 1] - 0xDC00);
+    } else if (ch >= 0xDC00 && ch <= 0xDFFF && index > 0 && text[index - 1] >= 0xD800 && text[index - 1] <= 0xDBFF) {
+        return 0;
+    }
+
+    // Emoji ZWJ sequences render as a single glyph
+    if (index > 0 && text[index - 1] == 0x200D && codePoint >= 0x2600) {
+        return 0;
+    }
+
+    return (size_t)ColumnCodePointWidth(codePoint);
+}
+
+BOOL ColumnIsSimpleLine(const WCHAR* text, size_t length) {
+    size_t i = 0;
+
+#ifdef COLUMN_USE_SSE2
+    // Eight UTF-16 units at a time: any unit >= 0x80 or equal to a tab disqualifies the line
+    const __m128i highBits = _mm_set1_epi16((short)0xFF80);
+    const __m128i tab = _mm_set1_epi16(L'\t');
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= length; i += 8) {
+        __m128i units = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i bad = _mm_or_si128(_mm_and_si128(units, highBits), _mm_cmpeq_epi16(units, tab));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(bad, zero)) != 0xFFFF) {
+            return FALSE;
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (text[i] >= 0x80 || text[i] == L'\t') {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// Function to walk forward from a known (offset, column) until the target column is reached
+// Stops at the start of a character the column falls inside, and keeps combining marks with their base
+static size_t ColumnWalkToColumn(const WCHAR* text, size_t length, size_t offset, size_t column, size_t target, int tabWidth) {
+    while (offset < length) {
+        size_t width = ColumnUnitWidth(text, length, offset, column, tabWidth);
+        if (width > 0 && column + width > target) {
+            break;
+        }
+        column += width;
+        offset++;
+    }
+    return offset;
+}
+
+size_t ColumnFromOffset(const WCHAR* text, size_t length, size_t offset, int tabWidth) {
+    if (offset > length) {
+        offset = length;
+    }
+
+    size_t column = 0;
+    for (size_t i = 0; i < offset; i++) {
+        column += ColumnUnitWidth(text, length, i, column, tabWidth);
+    }
+    return column;
+}
+
+size_t OffsetFromColumn(const WCHAR* text, size_t length, size_t column, int tabWidth) {
+    return ColumnWalkToColumn(text, length, 0, 0, column, tabWidth);
+}
+
+void ColumnCacheInit(ColumnCache* cache) {
+    ZeroMemory(cache, sizeof(ColumnCache));
+}
+
+// Function to release the text and checkpoints of one cache entry
+static void ColumnLineFree(ColumnLine* entry) {
+    MemFree(entry->text);
+    MemFree(entry->checkpoints);
+    entry->text = NULL;
+    entry->checkpoints = NULL;
+    entry->used = FALSE;
+}
+
+void ColumnCacheFree(ColumnCache* cache) {
+    for (int i = 0; i < COLUMN_CACHE_SIZE; i++) {
+        ColumnLineFree(&cache->lines[i]);
+    }
+}
+
+// Function to drop every entry if the text is not the generation the cache is in step with
+static void ColumnCacheSync(ColumnCache* cache, LONG generation) {
+    if (cache->generation != generation) {
+        ColumnCacheFree(cache);
+        cache->generation = generation;
+    }
+}
+
+ColumnLine* ColumnCacheLookup(ColumnCache* cache, LONG generation, size_t start, size_t length, int tabWidth) {
+    ColumnCacheSync(cache, generation);
+    for (int i = 0; i < COLUMN_CACHE_SIZE; i++) {
+        ColumnLine* entry = &cache->lines[i];
+        if (entry->used && entry->start == start && entry->length == length && entry->tabWidth == tabWidth) {
+            entry->lastUsed = ++cache->selections;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+ColumnLine* ColumnCacheStore(ColumnCache* cache, LONG generation, size_t start, int tabWidth, const WCHAR* text, size_t length) {
+    ColumnCacheSync(cache, generation);
+
+    // Reuse a free entry, or else the least recently used one
+    ColumnLine* entry = &cache->lines[0];
+    for (int i = 0; i < COLUMN_CACHE_SIZE && entry->used; i++) {
+        if (!cache->lines[i].used || cache->lines[i].lastUsed < entry->lastUsed) {
+            entry = &cache->lines[i];
+        }
+    }
+    ColumnLineFree(entry);
+
+    entry->start = start;
+    entry->tabWidth = tabWidth;
+    entry->length = length;
+    entry->lastUsed = ++cache->selections;
+    entry->simple = ColumnIsSimpleLine(text, length);
+
+    if (!entry->simple) {
+        size_t checkpointCount = length / COLUMN_CHECKPOINT_INTERVAL + 1;
+        entry->text = (WCHAR*)MemAlloc(MEM_CACHE, (length + 1) * sizeof(WCHAR));
+        entry->checkpoints = (size_t*)MemAlloc(MEM_CACHE, checkpointCount * sizeof(size_t));
+        if (entry->text == NULL || entry->checkpoints == NULL) {
+            ColumnLineFree(entry);
+            return NULL;
+        }
+
+        memcpy(entry->text, text, length * sizeof(WCHAR));
+        size_t column = 0;
+        for (size_t i = 0; i < length; i++) {
+            if (i % COLUMN_CHECKPOINT_INTERVAL == 0) {
+                entry->checkpoints[i / COLUMN_CHECKPOINT_INTERVAL] = column;
+            }
+            column += ColumnUnitWidth(text, length, i, column, tabWidth);
+        }
+        if (length % COLUMN_CHECKPOINT_INTERVAL == 0) {
+            entry->checkpoints[length / COLUMN_CHECKPOINT_INTERVAL] = column;
+        }
+    }
+
+    entry->used = TRUE;
+    return entry;
+}
+
+void ColumnCacheEdit(ColumnCache* cache, LONG generation, LONG newGeneration, size_t start, size_t oldEnd, size_t newEnd) {
+    if (cache->generation != generation) {
+        return;
+    }
+    cache->generation = newGeneration;
+
+    for (int i = 0; i < COLUMN_CACHE_SIZE; i++) {
+        ColumnLine* entry = &cache->lines[i];
+        if (!entry->used) {
+            continue;
+        }
+        if (entry->start > oldEnd) {
+            // Text after the edit is unchanged, only moved
+            entry->start = entry->start - oldEnd + newEnd;
+        } else if (entry->start + entry->length >= start) {
+            // Touching the edit at either end counts, as typing at the end of a line changes it
+            ColumnLineFree(entry);
+        }
+    }
+}
+
+size_t ColumnLineToColumn(const ColumnLine* entry, size_t offset) {
+    if (offset > entry->length) {
+        offset = entry->length;
+    }
+    if (entry->simple) {
+        return offset;
+    }
+
+    size_t index = offset / COLUMN_CHECKPOINT_INTERVAL * COLUMN_CHECKPOINT_INTERVAL;
+    size_t column = entry->checkpoints[index / COLUMN_CHECKPOINT_INTERVAL];
+    for (size_t i = index; i < offset; i++) {
+        column += ColumnUnitWidth(entry->text, entry->length, i, column, entry->tabWidth);
+    }
+    return column;
+}
+
+size_t ColumnLineToOffset(const ColumnLine* entry, size_t column) {
+    if (entry->simple) {
+        return column < entry->length ? column : entry->length;
+    }
+
+    // Find the last checkpoint at or before the column, then walk from there
+    size_t low = 0;
+    size_t high = entry->length / COLUMN_CHECKPOINT_INTERVAL + 1;
+    while (high - low > 1) {
+        size_t mid = (low + high) / 2;
+        if (entry->checkpoints[mid] <= column) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return ColumnWalkToColumn(entry->text, entry->length, low * COLUMN_CHECKPOINT_INTERVAL,
+        entry->checkpoints[low], column, entry->tabWidth);
+}
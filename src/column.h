@@ -0,0 +1,66 @@
+// CyCharm : Display-width and visual column engine
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_COLUMN_H
+#define CYCHARM_COLUMN_H
+
+#include <windows.h>
+
+// Visual column recorded every this many UTF-16 units, so a lookup scans at most this far
+#define COLUMN_CHECKPOINT_INTERVAL 32
+
+// Number of lines whose column maps are kept
+#define COLUMN_CACHE_SIZE 8
+
+// Display width of a code point: 0 (combining, zero-width), 1, or 2 (East Asian Wide/Fullwidth)
+int ColumnCodePointWidth(unsigned int codePoint);
+
+// Display width of the UTF-16 unit at an index, given the visual column it starts at: a surrogate pair's
+// width is carried by its high half, so the low half counts 0
+size_t ColumnUnitWidth(const WCHAR* text, size_t length, size_t index, size_t column, int tabWidth);
+
+// TRUE if the text is plain ASCII without tabs, so visual columns equal offsets
+BOOL ColumnIsSimpleLine(const WCHAR* text, size_t length);
+
+// Uncached mapping between an offset within a line and its 0-based visual column
+size_t ColumnFromOffset(const WCHAR* text, size_t length, size_t offset, int tabWidth);
+size_t OffsetFromColumn(const WCHAR* text, size_t length, size_t column, int tabWidth);
+
+// Column map of one line
+typedef struct ColumnLine {
+    size_t start;          // Offset of the line in the text
+    size_t length;
+    int tabWidth;
+    BOOL used;
+    BOOL simple;           // Plain ASCII without tabs: no text or checkpoints are kept
+    WCHAR* text;
+    size_t* checkpoints;   // Visual column at every COLUMN_CHECKPOINT_INTERVAL units
+    DWORD lastUsed;        // Selection it was last returned by, counted per cache
+} ColumnLine;
+
+typedef struct ColumnCache {
+    ColumnLine lines[COLUMN_CACHE_SIZE];
+    LONG generation;       // Text generation the entries are in step with
+    DWORD selections;      // Lookups and stores so far, so the last line used is never the oldest
+} ColumnCache;
+
+void ColumnCacheInit(ColumnCache* cache);
+void ColumnCacheFree(ColumnCache* cache);
+
+// Find the map of the line at start with the given length, or NULL
+// A generation other than the cache's means the text changed wholesale, and every entry is dropped
+ColumnLine* ColumnCacheLookup(ColumnCache* cache, LONG generation, size_t start, size_t length, int tabWidth);
+
+// Build and cache the map of a line, replacing the least recently used entry
+ColumnLine* ColumnCacheStore(ColumnCache* cache, LONG generation, size_t start, int tabWidth, const WCHAR* text, size_t length);
+
+// Bring the entries in step with one edit that took the text from generation to newGeneration by
+// replacing [start, oldEnd) with newEnd - start units: lines touching the edit are dropped and the
+// lines after it move with the text. Does nothing if the cache was not in step with generation.
+void ColumnCacheEdit(ColumnCache* cache, LONG generation, LONG newGeneration, size_t start, size_t oldEnd, size_t newEnd);
+
+// Cached mapping, O(1) per lookup once the line's map is built
+size_t ColumnLineToColumn(const ColumnLine* entry, size_t offset);
+size_t ColumnLineToOffset(const ColumnLine* entry, size_t column);
+
+#endif
@@ -0,0 +1,450 @@
+// CyCharm : Word completion index over the open documents
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory.h"
+#include "completion.h"
+
+#define COMPLETION_INITIAL_BUCKETS 1024
+
+// State for tokenizing a range chunk by chunk; a word can span chunks
+typedef struct CompletionScan {
+    CompletionIndex* index;
+    int delta;                      // +1 to add the words, -1 to remove them
+    WCHAR word[COMPLETION_MAX_WORD];
+    int length;
+    BOOL inWord;
+    BOOL skipWord;                  // Too long, or a number
+} CompletionScan;
+
+BOOL CompletionIsWordChar(WCHAR c) {
+    if (c < 0x80) {
+        return (c >= L'a' && c <= L'z') || (c >= L'A' && c <= L'Z') || (c >= L'0' && c <= L'9') || c == L'_';
+    }
+    return IsCharAlphaNumericW(c);
+}
+
+static WCHAR CompletionFold(WCHAR c) {
+    return c >= L'A' && c <= L'Z' ? (WCHAR)(c + (L'a' - L'A')) : c;
+}
+
+static unsigned int CompletionHash(const WCHAR* text, int length) {
+    unsigned int hash = 2166136261U;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ text[i]) * 16777619U;
+    }
+    return hash;
+}
+
+// Function to order entries ignoring ASCII case, then by exact text so the order is total
+static int CompletionCompare(const CompletionEntry* a, const CompletionEntry* b) {
+    int shorter = a->length < b->length ? a->length : b->length;
+    for (int i = 0; i < shorter; i++) {
+        WCHAR x = CompletionFold(a->text[i]);
+        WCHAR y = CompletionFold(b->text[i]);
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+    }
+    if (a->length != b->length) {
+        return a->length < b->length ? -1 : 1;
+    }
+    for (int i = 0; i < a->length; i++) {
+        if (a->text[i] != b->text[i]) {
+            return a->text[i] < b->text[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static int CompletionCompareEntries(const void* a, const void* b) {
+    return CompletionCompare(*(const CompletionEntry* const*)a, *(const CompletionEntry* const*)b);
+}
+
+// Function to compare an entry with a prefix ignoring ASCII case; 0 if the entry starts with it
+static int CompletionComparePrefix(const CompletionEntry* entry, const WCHAR* prefix, int length) {
+    for (int i = 0; i < length; i++) {
+        if (i == entry->length) {
+            return -1;
+        }
+        WCHAR x = CompletionFold(entry->text[i]);
+        WCHAR y = CompletionFold(prefix[i]);
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+void CompletionInit(CompletionIndex* index) {
+    ZeroMemory(index, sizeof(CompletionIndex));
+}
+
+void CompletionFree(CompletionIndex* index) {
+    for (size_t i = 0; i < index->bucketCount; i++) {
+        CompletionEntry* entry = index->buckets[i];
+        while (entry != NULL) {
+            CompletionEntry* next = entry->next;
+            MemFree(entry);
+            entry = next;
+        }
+    }
+    MemFree(index->buckets);
+    MemFree(index->sorted);
+    MemFree(index->blocks);
+    MemFree(index->pending);
+    CompletionInit(index);
+}
+
+// Function to double the hash table once it holds as many entries as buckets
+static BOOL CompletionGrowBuckets(CompletionIndex* index) {
+    size_t bucketCount = index->bucketCount > 0 ? index->bucketCount * 2 : COMPLETION_INITIAL_BUCKETS;
+    CompletionEntry** buckets = (CompletionEntry**)MemAlloc(MEM_INDEX, bucketCount * sizeof(CompletionEntry*));
+    if (buckets == NULL) {
+        return FALSE;
+    }
+    ZeroMemory(buckets, bucketCount * sizeof(CompletionEntry*));
+
+    for (size_t i = 0; i < index->bucketCount; i++) {
+        CompletionEntry* entry = index->buckets[i];
+        while (entry != NULL) {
+            CompletionEntry* next = entry->next;
+            size_t bucket = entry->hash & (bucketCount - 1);
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+    MemFree(index->buckets);
+    index->buckets = buckets;
+    index->bucketCount = bucketCount;
+    return TRUE;
+}
+
+// Function to make room for one more pointer in a growable array
+static BOOL CompletionReserve(CompletionEntry*** items, size_t* capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return TRUE;
+    }
+    size_t newCapacity = *capacity > 0 ? *capacity * 2 : 256;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    CompletionEntry** grown = (CompletionEntry**)MemRealloc(MEM_INDEX, *items, newCapacity * sizeof(CompletionEntry*));
+    if (grown == NULL) {
+        return FALSE;
+    }
+    *items = grown;
+    *capacity = newCapacity;
+    return TRUE;
+}
+
+static void CompletionUnlink(CompletionIndex* index, CompletionEntry* entry) {
+    CompletionEntry** link = &index->buckets[entry->hash & (index->bucketCount - 1)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    index->entryCount--;
+}
+
+// Function to count one occurrence of a word in or out
+static void CompletionUpdate(CompletionIndex* index, const WCHAR* word, int length, int delta) {
+    unsigned int hash = CompletionHash(word, length);
+    CompletionEntry* entry = NULL;
+    if (index->bucketCount > 0) {
+        entry = index->buckets[hash & (index->bucketCount - 1)];
+        while (entry != NULL && (entry->hash != hash || entry->length != length ||
+            memcmp(entry->text, word, length * sizeof(WCHAR)) != 0)) {
+            entry = entry->next;
+        }
+    }
+
+    if (delta < 0) {
+        if (entry != NULL && entry->count > 0 && --entry->count == 0) {
+            index->deadCount++;
+        }
+        return;
+    }
+
+    if (entry == NULL) {
+        if (index->entryCount >= index->bucketCount && !CompletionGrowBuckets(index)) {
+            return;
+        }
+        if (!CompletionReserve(&index->pending, &index->pendingCapacity, index->pendingCount + 1)) {
+            return;
+        }
+        entry = (CompletionEntry*)MemAlloc(MEM_INDEX, sizeof(CompletionEntry) + (size_t)length * sizeof(WCHAR));
+        if (entry == NULL) {
+            return;
+        }
+        ZeroMemory(entry, sizeof(CompletionEntry));
+        entry->hash = hash;
+        entry->position = COMPLETION_PENDING;
+        entry->length = length;
+        memcpy(entry->text, word, length * sizeof(WCHAR));
+
+        size_t bucket = hash & (index->bucketCount - 1);
+        entry->next = index->buckets[bucket];
+        index->buckets[bucket] = entry;
+        index->entryCount++;
+        index->pending[index->pendingCount++] = entry;
+    } else if (entry->count == 0) {
+        index->deadCount--;
+    }
+
+    entry->count++;
+    entry->lastAdded = index->tick;
+
+    // Keep the bounds of the entry's block above it
+    if (entry->position != COMPLETION_PENDING) {
+        CompletionBlock* block = &index->blocks[entry->position / COMPLETION_BLOCK_SIZE];
+        if (entry->count > block->maxCount) {
+            block->maxCount = entry->count;
+        }
+        block->maxLastAdded = index->tick;
+    }
+}
+
+static void CompletionEndWord(CompletionScan* scan) {
+    if (scan->inWord && !scan->skipWord && scan->length > COMPLETION_MIN_PREFIX) {
+        CompletionUpdate(scan->index, scan->word, scan->length, scan->delta);
+    }
+    scan->inWord = FALSE;
+}
+
+static BOOL CompletionScanChunk(const WCHAR* text, size_t length, size_t offset, void* context) {
+    CompletionScan* scan = (CompletionScan*)context;
+    for (size_t i = 0; i < length; i++) {
+        WCHAR c = text[i];
+        if (!CompletionIsWordChar(c)) {
+            if (scan->inWord) {
+                CompletionEndWord(scan);
+            }
+            continue;
+        }
+
+        if (!scan->inWord) {
+            scan->inWord = TRUE;
+            scan->length = 0;
+            scan->skipWord = c >= L'0' && c <= L'9';
+        }
+        if (scan->length < COMPLETION_MAX_WORD) {
+            scan->word[scan->length++] = c;
+        } else {
+            scan->skipWord = TRUE;
+        }
+    }
+    return TRUE;
+}
+
+// Function to widen a range to the whole words touching it
+// Widening stops a little past the longest indexed word; a word cut off there is too long to index anyway
+static void CompletionExpand(const Document* doc, size_t* start, size_t* end) {
+    size_t length = DocLength(doc);
+    if (*end > length) {
+        *end = length;
+    }
+    if (*start > *end) {
+        *start = *end;
+    }
+    for (int i = 0; i <= COMPLETION_MAX_WORD && *start > 0 && CompletionIsWordChar(DocCharAt(doc, *start - 1)); i++) {
+        (*start)--;
+    }
+    for (int i = 0; i <= COMPLETION_MAX_WORD && *end < length && CompletionIsWordChar(DocCharAt(doc, *end)); i++) {
+        (*end)++;
+    }
+}
+
+static void CompletionScanRange(CompletionIndex* index, const Document* doc, size_t start, size_t end, int delta) {
+    CompletionExpand(doc, &start, &end);
+    if (start >= end) {
+        return;
+    }
+
+    CompletionScan scan;
+    scan.index = index;
+    scan.delta = delta;
+    scan.length = 0;
+    scan.inWord = FALSE;
+    scan.skipWord = FALSE;
+    DocForEachChunk(doc, start, end, CompletionScanChunk, &scan);
+    CompletionEndWord(&scan);
+}
+
+void CompletionAddRange(CompletionIndex* index, const Document* doc, size_t start, size_t end) {
+    index->tick++;
+    CompletionScanRange(index, doc, start, end, 1);
+}
+
+void CompletionRemoveRange(CompletionIndex* index, const Document* doc, size_t start, size_t end) {
+    CompletionScanRange(index, doc, start, end, -1);
+}
+
+// Function to drop new words that are already gone again, so they never reach the sorted array
+static void CompletionPrunePending(CompletionIndex* index) {
+    size_t kept = 0;
+    for (size_t i = 0; i < index->pendingCount; i++) {
+        CompletionEntry* entry = index->pending[i];
+        if (entry->count == 0) {
+            CompletionUnlink(index, entry);
+            MemFree(entry);
+            index->deadCount--;
+        } else {
+            index->pending[kept++] = entry;
+        }
+    }
+    index->pendingCount = kept;
+}
+
+// Function to merge the pending words into the sorted array, dropping dead words on the way,
+// and rebuild the block bounds
+static BOOL CompletionMerge(CompletionIndex* index) {
+    size_t total = index->sortedCount + index->pendingCount;
+    size_t blockCount = (total + COMPLETION_BLOCK_SIZE - 1) / COMPLETION_BLOCK_SIZE;
+    if (!CompletionReserve(&index->sorted, &index->sortedCapacity, total)) {
+        return FALSE;
+    }
+    if (blockCount > index->blockCapacity) {
+        CompletionBlock* blocks = (CompletionBlock*)MemRealloc(MEM_INDEX, index->blocks, blockCount * sizeof(CompletionBlock));
+        if (blocks == NULL) {
+            return FALSE;
+        }
+        index->blocks = blocks;
+        index->blockCapacity = blockCount;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < index->sortedCount; i++) {
+        CompletionEntry* entry = index->sorted[i];
+        if (entry->count == 0) {
+            CompletionUnlink(index, entry);
+            MemFree(entry);
+            index->deadCount--;
+        } else {
+            index->sorted[kept++] = entry;
+        }
+    }
+    index->sortedCount = kept;
+
+    CompletionPrunePending(index);
+    size_t pendingCount = index->pendingCount;
+    qsort(index->pending, pendingCount, sizeof(CompletionEntry*), CompletionCompareEntries);
+
+    // Merge from the back so the sorted array can take the new words in place
+    size_t a = index->sortedCount;
+    size_t b = pendingCount;
+    size_t out = a + b;
+    while (b > 0) {
+        if (a > 0 && CompletionCompare(index->sorted[a - 1], index->pending[b - 1]) > 0) {
+            index->sorted[--out] = index->sorted[--a];
+        } else {
+            index->sorted[--out] = index->pending[--b];
+        }
+    }
+    index->sortedCount += pendingCount;
+    index->pendingCount = 0;
+
+    for (size_t i = 0; i < index->sortedCount; i++) {
+        CompletionEntry* entry = index->sorted[i];
+        CompletionBlock* block = &index->blocks[i / COMPLETION_BLOCK_SIZE];
+        if (i % COMPLETION_BLOCK_SIZE == 0) {
+            block->maxCount = 0;
+            block->maxLastAdded = 0;
+        }
+        entry->position = i;
+        if (entry->count > block->maxCount) {
+            block->maxCount = entry->count;
+        }
+        if (entry->lastAdded > block->maxLastAdded) {
+            block->maxLastAdded = entry->lastAdded;
+        }
+    }
+    return TRUE;
+}
+
+static double CompletionScore(const CompletionIndex* index, size_t count, unsigned long long lastAdded) {
+    unsigned long long age = index->tick - lastAdded;
+    return (double)count +
+        (double)COMPLETION_RECENT_BONUS * COMPLETION_RECENT_WINDOW / (double)(COMPLETION_RECENT_WINDOW + age);
+}
+
+// Function to keep a word among the best candidates so far, which are ordered by score
+static void CompletionOffer(const CompletionIndex* index, const CompletionEntry* entry,
+    CompletionCandidate* candidates, size_t* found, size_t maxCandidates) {
+    double score = CompletionScore(index, entry->count, entry->lastAdded);
+    size_t position = *found < maxCandidates ? (*found)++ : maxCandidates;
+    while (position > 0 && candidates[position - 1].score < score) {
+        if (position < maxCandidates) {
+            candidates[position] = candidates[position - 1];
+        }
+        position--;
+    }
+    if (position < maxCandidates) {
+        candidates[position].text = entry->text;
+        candidates[position].length = entry->length;
+        candidates[position].score = score;
+    }
+}
+
+size_t CompletionLookup(CompletionIndex* index, const WCHAR* prefix, int length,
+    CompletionCandidate* candidates, size_t maxCandidates) {
+    if (length <= 0 || maxCandidates == 0) {
+        return 0;
+    }
+
+    CompletionPrunePending(index);
+    if (index->pendingCount > COMPLETION_MERGE_THRESHOLD || index->deadCount > index->sortedCount / 4 + 64) {
+        CompletionMerge(index);
+    }
+
+    // The words starting with the prefix are a contiguous run of the sorted array
+    size_t low = 0;
+    size_t high = index->sortedCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (CompletionComparePrefix(index->sorted[middle], prefix, length) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    size_t first = low;
+    high = index->sortedCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (CompletionComparePrefix(index->sorted[middle], prefix, length) == 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    size_t last = low;
+
+    size_t found = 0;
+    for (size_t i = first; i < last; i++) {
+        // Skip the rest of a block once even its bounds cannot make the list
+        if (found == maxCandidates && (i == first || i % COMPLETION_BLOCK_SIZE == 0)) {
+            const CompletionBlock* block = &index->blocks[i / COMPLETION_BLOCK_SIZE];
+            if (CompletionScore(index, block->maxCount, block->maxLastAdded) <= candidates[maxCandidates - 1].score) {
+                i = (i / COMPLETION_BLOCK_SIZE + 1) * COMPLETION_BLOCK_SIZE - 1;
+                continue;
+            }
+        }
+
+        const CompletionEntry* entry = index->sorted[i];
+        if (entry->count > 0 && entry->length != length) {
+            CompletionOffer(index, entry, candidates, &found, maxCandidates);
+        }
+    }
+
+    for (size_t i = 0; i < index->pendingCount; i++) {
+        const CompletionEntry* entry = index->pending[i];
+        if (entry->length != length && CompletionComparePrefix(entry, prefix, length) == 0) {
+            CompletionOffer(index, entry, candidates, &found, maxCandidates);
+        }
+    }
+    return found;
+}
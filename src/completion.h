@@ -0,0 +1,91 @@
+// CyCharm : Word completion index over the open documents
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_COMPLETION_H
+#define CYCHARM_COMPLETION_H
+
+#include <windows.h>
+#include "document.h"
+
+// Words longer than this are never offered
+#define COMPLETION_MAX_WORD 64
+
+// Shortest prefix that opens the completion list
+#define COMPLETION_MIN_PREFIX 2
+
+// Candidates shown at once
+#define COMPLETION_MAX_CANDIDATES 8
+
+// A word added within this many edits ranks as if it appeared COMPLETION_RECENT_BONUS more times,
+// fading as later edits come in
+#define COMPLETION_RECENT_WINDOW 256
+#define COMPLETION_RECENT_BONUS 8
+
+// Sorted entries covered by each score bound
+#define COMPLETION_BLOCK_SIZE 64
+
+// New words held in the pending list before they are merged into the sorted array
+#define COMPLETION_MERGE_THRESHOLD 512
+
+// Position of an entry still waiting to be merged into the sorted array
+#define COMPLETION_PENDING ((size_t)-1)
+
+typedef struct CompletionEntry {
+    struct CompletionEntry* next;  // Next entry in the same hash bucket
+    unsigned int hash;
+    size_t count;                  // Occurrences across the indexed documents; 0 once every one is gone
+    unsigned long long lastAdded;  // Edit tick that last added an occurrence
+    size_t position;               // Index in the sorted array, or COMPLETION_PENDING
+    int length;
+    WCHAR text[1];                 // The word, allocated to length
+} CompletionEntry;
+
+// Upper bounds on the counts and edit ticks of a block of the sorted array, so a lookup can skip
+// blocks that cannot beat the candidates it already has. Raised as counts grow, rebuilt on merge.
+typedef struct CompletionBlock {
+    size_t maxCount;
+    unsigned long long maxLastAdded;
+} CompletionBlock;
+
+// Words are found by text through the hash table and by prefix through the sorted array.
+// New words wait in a short pending list that lookups scan directly, and are merged into the
+// sorted array in one pass once there are enough of them, so neither indexing a whole file nor
+// typing costs an insertion into the sorted array per word.
+typedef struct CompletionIndex {
+    CompletionEntry** buckets;
+    size_t bucketCount;
+    size_t entryCount;
+    CompletionEntry** sorted;      // Ordered case-insensitively, then by exact text
+    size_t sortedCount;
+    size_t sortedCapacity;
+    CompletionBlock* blocks;       // One per COMPLETION_BLOCK_SIZE sorted entries
+    size_t blockCapacity;
+    CompletionEntry** pending;
+    size_t pendingCount;
+    size_t pendingCapacity;
+    size_t deadCount;              // Entries with a count of 0, dropped at the next merge once there are enough
+    unsigned long long tick;
+} CompletionIndex;
+
+typedef struct CompletionCandidate {
+    const WCHAR* text;             // Valid until the index next changes
+    int length;
+    double score;
+} CompletionCandidate;
+
+void CompletionInit(CompletionIndex* index);
+void CompletionFree(CompletionIndex* index);
+
+BOOL CompletionIsWordChar(WCHAR c);
+
+// Index or unindex the words touching [start, end) of a document. Calling remove before an edit
+// and add after it, with end moved by the change in length, keeps the index exact.
+void CompletionAddRange(CompletionIndex* index, const Document* doc, size_t start, size_t end);
+void CompletionRemoveRange(CompletionIndex* index, const Document* doc, size_t start, size_t end);
+
+// Best words starting with a prefix (ignoring ASCII case), by frequency and recency
+// The prefix itself is never offered; returns the number of candidates
+size_t CompletionLookup(CompletionIndex* index, const WCHAR* prefix, int length,
+    CompletionCandidate* candidates, size_t maxCandidates);
+
+#endif
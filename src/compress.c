@@ -0,0 +1,192 @@
+// CyCharm : Fast block compression for cold document chunks
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "compress.h"
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+#define LZ_LAST_LITERALS 5  // The block always ends with at least this many literals
+#define LZ_MATCH_LIMIT 12   // No match starts within this many bytes of the end
+
+static unsigned int LzRead32(const unsigned char* p) {
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static unsigned int LzHash(unsigned int sequence) {
+    return (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+// Function to write the extension bytes of a literal or match length
+static unsigned char* LzWriteLength(unsigned char* out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (unsigned char)length;
+    return out;
+}
+
+size_t LzCompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t LzCompress(const void* source, size_t size, void* dest, size_t capacity) {
+    const unsigned char* in = (const unsigned char*)source;
+    const unsigned char* end = in + size;
+    const unsigned char* anchor = in;
+    unsigned char* out = (unsigned char*)dest;
+    unsigned char* outEnd = out + capacity;
+
+    // Position + 1 of the last sequence seen with each hash, 0 for none
+    unsigned int table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    if (size > LZ_MATCH_LIMIT) {
+        const unsigned char* matchLimit = end - LZ_MATCH_LIMIT;
+        const unsigned char* literalLimit = end - LZ_LAST_LITERALS;
+        const unsigned char* p = in;
+
+        while (p < matchLimit) {
+            unsigned int sequence = LzRead32(p);
+            unsigned int hash = LzHash(sequence);
+            unsigned int candidate = table[hash];
+            table[hash] = (unsigned int)(p - in) + 1;
+
+            if (candidate == 0 || (size_t)(p - in) + 1 - candidate > LZ_MAX_OFFSET ||
+                LzRead32(in + candidate - 1) != sequence) {
+                p++;
+                continue;
+            }
+
+            // Extend the match backwards into pending literals, then forwards
+            const unsigned char* match = in + candidate - 1;
+            while (p > anchor && match > in && p[-1] == match[-1]) {
+                p--;
+                match--;
+            }
+            const unsigned char* matchEnd = p + LZ_MIN_MATCH;
+            const unsigned char* reference = match + LZ_MIN_MATCH;
+            while (matchEnd < literalLimit && *matchEnd == *reference) {
+                matchEnd++;
+                reference++;
+            }
+
+            size_t literals = (size_t)(p - anchor);
+            size_t matchLength = (size_t)(matchEnd - p) - LZ_MIN_MATCH;
+            if ((size_t)(outEnd - out) < 1 + literals / 255 + 1 + literals + 2 + matchLength / 255 + 1) {
+                return 0;
+            }
+
+            // Sequence: token, literal length, literals, offset, match length
+            unsigned char* token = out++;
+            *token = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+            if (literals >= 15) {
+                out = LzWriteLength(out, literals - 15);
+            }
+            memcpy(out, anchor, literals);
+            out += literals;
+
+            size_t offset = (size_t)(p - match);
+            *out++ = (unsigned char)(offset & 0xFF);
+            *out++ = (unsigned char)(offset >> 8);
+
+            *token |= (unsigned char)(matchLength >= 15 ? 15 : matchLength);
+            if (matchLength >= 15) {
+                out = LzWriteLength(out, matchLength - 15);
+            }
+
+            p = matchEnd;
+            anchor = p;
+        }
+    }
+
+    // The final sequence carries the remaining literals and no match
+    size_t literals = (size_t)(end - anchor);
+    if ((size_t)(outEnd - out) < 1 + literals / 255 + 1 + literals) {
+        return 0;
+    }
+    unsigned char* token = out++;
+    *token = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15) {
+        out = LzWriteLength(out, literals - 15);
+    }
+    memcpy(out, anchor, literals);
+    out += literals;
+
+    return (size_t)(out - (unsigned char*)dest);
+}
+
+// Function to read the extension bytes of a literal or match length; FALSE if the block ends first
+static BOOL LzReadLength(const unsigned char** in, const unsigned char* inEnd, size_t* length) {
+    unsigned char byte;
+    do {
+        if (*in >= inEnd) {
+            return FALSE;
+        }
+        byte = *(*in)++;
+        *length += byte;
+    } while (byte == 255);
+    return TRUE;
+}
+
+BOOL LzDecompress(const void* source, size_t size, void* dest, size_t destSize) {
+    const unsigned char* in = (const unsigned char*)source;
+    const unsigned char* inEnd = in + size;
+    unsigned char* out = (unsigned char*)dest;
+    unsigned char* outEnd = out + destSize;
+
+    while (in < inEnd) {
+        unsigned int token = *in++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !LzReadLength(&in, inEnd, &literals)) {
+            return FALSE;
+        }
+        if (literals > (size_t)(inEnd - in) || literals > (size_t)(outEnd - out)) {
+            return FALSE;
+        }
+        memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+
+        if (in == inEnd) {
+            break; // The final sequence has no match
+        }
+
+        if (inEnd - in < 2) {
+            return FALSE;
+        }
+        size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (size_t)(out - (unsigned char*)dest)) {
+            return FALSE;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !LzReadLength(&in, inEnd, &matchLength)) {
+            return FALSE;
+        }
+        matchLength += LZ_MIN_MATCH;
+        if (matchLength > (size_t)(outEnd - out)) {
+            return FALSE;
+        }
+
+        // A match may overlap the bytes it produces (offset < length repeats a pattern)
+        const unsigned char* match = out - offset;
+        if (offset >= matchLength) {
+            memcpy(out, match, matchLength);
+        } else {
+            for (size_t i = 0; i < matchLength; i++) {
+                out[i] = match[i];
+            }
+        }
+        out += matchLength;
+    }
+
+    return out == outEnd;
+}
@@ -0,0 +1,20 @@
+// CyCharm : Fast block compression for cold document chunks
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_COMPRESS_H
+#define CYCHARM_COMPRESS_H
+
+#include <windows.h>
+
+// Blocks use the LZ4 block format: greedy matching on a hash of 4-byte sequences, favouring speed over ratio
+
+// Largest compressed size for an input of the given size
+size_t LzCompressBound(size_t size);
+
+// Compress a block; returns the compressed size, or 0 if it does not fit in capacity
+size_t LzCompress(const void* source, size_t size, void* dest, size_t capacity);
+
+// Decompress a block that must expand to exactly destSize bytes; FALSE if the block is malformed
+BOOL LzDecompress(const void* source, size_t size, void* dest, size_t destSize);
+
+#endif
@@ -0,0 +1,370 @@
+// CyCharm : Multiple cursors, block selection and batched cursor edits
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory.h"
+#include "column.h"
+#include "cursors.h"
+
+#define CURSOR_START(cursor) ((cursor).anchor < (cursor).caret ? (cursor).anchor : (cursor).caret)
+#define CURSOR_END(cursor) ((cursor).anchor < (cursor).caret ? (cursor).caret : (cursor).anchor)
+
+void CursorSetInit(CursorSet* set) {
+    set->items = NULL;
+    set->count = 0;
+    set->capacity = 0;
+    set->primary = 0;
+}
+
+void CursorSetFree(CursorSet* set) {
+    MemFree(set->items);
+    CursorSetInit(set);
+}
+
+void CursorSetClear(CursorSet* set) {
+    set->count = 0;
+    set->primary = 0;
+}
+
+BOOL CursorSetAdd(CursorSet* set, size_t anchor, size_t caret, BOOL primary) {
+    if (set->count == set->capacity) {
+        size_t capacity = set->capacity > 0 ? set->capacity * 2 : 16;
+        Cursor* items = (Cursor*)MemRealloc(MEM_INDEX, set->items, capacity * sizeof(Cursor));
+        if (items == NULL) {
+            return FALSE;
+        }
+        set->items = items;
+        set->capacity = capacity;
+    }
+
+    set->items[set->count].anchor = anchor;
+    set->items[set->count].caret = caret;
+    if (primary || set->count == 0) {
+        set->primary = set->count;
+    }
+    set->count++;
+    return TRUE;
+}
+
+static int CompareCursors(const void* a, const void* b) {
+    const Cursor* left = (const Cursor*)a;
+    const Cursor* right = (const Cursor*)b;
+    if (CURSOR_START(*left) != CURSOR_START(*right)) {
+        return CURSOR_START(*left) < CURSOR_START(*right) ? -1 : 1;
+    }
+    if (CURSOR_END(*left) != CURSOR_END(*right)) {
+        return CURSOR_END(*left) < CURSOR_END(*right) ? -1 : 1;
+    }
+    return 0;
+}
+
+void CursorSetNormalize(CursorSet* set) {
+    if (set->count == 0) {
+        return;
+    }
+
+    // Remember the primary cursor by value, since sorting moves it
+    Cursor primary = set->items[set->primary];
+    qsort(set->items, set->count, sizeof(Cursor), CompareCursors);
+
+    size_t kept = 0;
+    BOOL primaryFound = FALSE;
+    for (size_t i = 0; i < set->count; i++) {
+        Cursor cursor = set->items[i];
+        BOOL isPrimary = !primaryFound && cursor.anchor == primary.anchor && cursor.caret == primary.caret;
+
+        // Merge into the previous cursor if the selections overlap or both are the same caret
+        if (kept > 0) {
+            Cursor* previous = &set->items[kept - 1];
+            size_t previousEnd = CURSOR_END(*previous);
+            if (CURSOR_START(cursor) < previousEnd ||
+                (CURSOR_START(cursor) == previousEnd && CURSOR_START(cursor) == CURSOR_END(cursor))) {
+                size_t end = CURSOR_END(cursor) > previousEnd ? CURSOR_END(cursor) : previousEnd;
+                if (previous->anchor <= previous->caret) {
+                    previous->caret = end;
+                } else {
+                    previous->anchor = end;
+                }
+                if (isPrimary) {
+                    set->primary = kept - 1;
+                    primaryFound = TRUE;
+                }
+                continue;
+            }
+        }
+
+        if (isPrimary) {
+            set->primary = kept;
+            primaryFound = TRUE;
+        }
+        set->items[kept++] = cursor;
+    }
+    set->count = kept;
+}
+
+size_t CursorSetFindFirst(const CursorSet* set, size_t offset) {
+    size_t low = 0;
+    size_t high = set->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (CURSOR_END(set->items[middle]) < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Function to copy one line of the document into a scratch buffer that grows as needed
+static BOOL CursorLineText(const Document* doc, size_t line, WCHAR** buffer, size_t* capacity,
+    size_t* lineStart, size_t* lineLength) {
+    *lineStart = DocLineStart(doc, line);
+    *lineLength = DocLineLength(doc, line);
+
+    if (*lineLength + 1 > *capacity) {
+        WCHAR* grown = (WCHAR*)MemRealloc(MEM_SCRATCH, *buffer, (*lineLength + 1) * sizeof(WCHAR));
+        if (grown == NULL) {
+            return FALSE;
+        }
+        *buffer = grown;
+        *capacity = *lineLength + 1;
+    }
+
+    DocGetText(doc, *lineStart, *lineStart + *lineLength, *buffer);
+    return TRUE;
+}
+
+BOOL CursorSetBlock(CursorSet* set, const Document* doc, size_t anchorLine, size_t anchorColumn,
+    size_t caretLine, size_t caretColumn, int tabWidth) {
+    size_t lastLine = DocLineCount(doc) - 1;
+    if (anchorLine > lastLine) {
+        anchorLine = lastLine;
+    }
+    if (caretLine > lastLine) {
+        caretLine = lastLine;
+    }
+
+    size_t firstLine = anchorLine < caretLine ? anchorLine : caretLine;
+    size_t endLine = anchorLine < caretLine ? caretLine : anchorLine;
+    size_t leftColumn = anchorColumn < caretColumn ? anchorColumn : caretColumn;
+    size_t rightColumn = anchorColumn < caretColumn ? caretColumn : anchorColumn;
+
+    // Copy the block's lines once and walk them in order
+    size_t blockStart = DocLineStart(doc, firstLine);
+    size_t blockEnd = DocLineStart(doc, endLine) + DocLineLength(doc, endLine);
+    WCHAR* text = (WCHAR*)MemAlloc(MEM_SCRATCH, (blockEnd - blockStart + 1) * sizeof(WCHAR));
+    if (text == NULL) {
+        return FALSE;
+    }
+    DocGetText(doc, blockStart, blockEnd, text);
+
+    BOOL ok = TRUE;
+    size_t lineStart = 0;
+    CursorSetClear(set);
+
+    // One cursor per line; lines shorter than the block get a caret at their end
+    for (size_t line = firstLine; line <= endLine && ok; line++) {
+        size_t lineEnd = lineStart;
+        while (lineEnd < blockEnd - blockStart && text[lineEnd] != L'\r') {
+            lineEnd++;
+        }
+
+        size_t left = blockStart + lineStart + OffsetFromColumn(text + lineStart, lineEnd - lineStart, leftColumn, tabWidth);
+        size_t right = blockStart + lineStart + OffsetFromColumn(text + lineStart, lineEnd - lineStart, rightColumn, tabWidth);
+        if (caretColumn < anchorColumn) {
+            ok = CursorSetAdd(set, right, left, line == caretLine);
+        } else {
+            ok = CursorSetAdd(set, left, right, line == caretLine);
+        }
+        lineStart = lineEnd + 1;
+    }
+
+    MemFree(text);
+    return ok;
+}
+
+BOOL CursorSetAddLine(CursorSet* set, const Document* doc, int direction, int tabWidth) {
+    if (set->count == 0) {
+        return FALSE;
+    }
+
+    CursorSetNormalize(set);
+    size_t caret = set->items[direction < 0 ? 0 : set->count - 1].caret;
+    size_t line = DocLineFromOffset(doc, caret);
+    if ((direction < 0 && line == 0) || (direction > 0 && line + 1 >= DocLineCount(doc))) {
+        return FALSE;
+    }
+
+    WCHAR* buffer = NULL;
+    size_t capacity = 0;
+    size_t lineStart, lineLength;
+    BOOL ok = CursorLineText(doc, line, &buffer, &capacity, &lineStart, &lineLength);
+    if (ok) {
+        size_t column = ColumnFromOffset(buffer, lineLength, caret - lineStart, tabWidth);
+        line = direction < 0 ? line - 1 : line + 1;
+        ok = CursorLineText(doc, line, &buffer, &capacity, &lineStart, &lineLength);
+        if (ok) {
+            size_t offset = lineStart + OffsetFromColumn(buffer, lineLength, column, tabWidth);
+            ok = CursorSetAdd(set, offset, offset, TRUE);
+        }
+    }
+
+    MemFree(buffer);
+    CursorSetNormalize(set);
+    return ok;
+}
+
+// Function to tell whether the units at offset and offset + 1 form a surrogate pair
+static BOOL CursorIsSurrogatePair(const Document* doc, size_t offset) {
+    WCHAR high = DocCharAt(doc, offset);
+    WCHAR low = DocCharAt(doc, offset + 1);
+    return high >= 0xD800 && high <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF;
+}
+
+BOOL CursorSetEdit(CursorSet* set, Document* doc, int kind, const WCHAR* text, size_t length,
+    BOOL distribute, CursorBatch* batch) {
+    ZeroMemory(batch, sizeof(CursorBatch));
+    if (set->count == 0) {
+        return TRUE;
+    }
+
+    // Cursors may be stale if the text changed underneath them
+    size_t docLength = DocLength(doc);
+    for (size_t i = 0; i < set->count; i++) {
+        if (set->items[i].anchor > docLength) {
+            set->items[i].anchor = docLength;
+        }
+        if (set->items[i].caret > docLength) {
+            set->items[i].caret = docLength;
+        }
+    }
+    CursorSetNormalize(set);
+
+    // Distribute one line per cursor when the text has exactly as many lines as there are cursors
+    size_t pieces = 1;
+    if (distribute && kind == CURSOR_EDIT_INSERT) {
+        for (size_t i = 0; i < length; i++) {
+            if (text[i] == L'\r') {
+                pieces++;
+            }
+        }
+        if (length > 0 && text[length - 1] == L'\r') {
+            pieces--;
+        }
+        distribute = pieces == set->count && pieces > 1;
+    }
+
+    DocEdit* edits = (DocEdit*)MemAlloc(MEM_SCRATCH, set->count * sizeof(DocEdit));
+    if (edits == NULL) {
+        return FALSE;
+    }
+
+    size_t editCount = 0;
+    size_t primaryEdit = 0;
+    size_t pieceStart = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        DocEdit edit;
+        edit.start = CURSOR_START(set->items[i]);
+        edit.end = CURSOR_END(set->items[i]);
+        edit.text = NULL;
+        edit.length = 0;
+
+        if (kind == CURSOR_EDIT_INSERT) {
+            edit.text = text;
+            edit.length = length;
+            if (distribute) {
+                size_t pieceEnd = pieceStart;
+                while (pieceEnd < length && text[pieceEnd] != L'\r') {
+                    pieceEnd++;
+                }
+                edit.text = text + pieceStart;
+                edit.length = pieceEnd - pieceStart;
+                pieceStart = pieceEnd + 1;
+            }
+        } else if (edit.start == edit.end) {
+            if (kind == CURSOR_EDIT_BACKSPACE && edit.start > 0) {
+                edit.start -= (edit.start >= 2 && CursorIsSurrogatePair(doc, edit.start - 2)) ? 2 : 1;
+            } else if (kind == CURSOR_EDIT_DELETE && edit.end < docLength) {
+                edit.end += CursorIsSurrogatePair(doc, edit.end) ? 2 : 1;
+            }
+        }
+
+        // Deletions next to a neighbouring selection can overlap it; the two cursors become one
+        if (editCount > 0 && edit.start < edits[editCount - 1].end) {
+            if (edit.end > edits[editCount - 1].end) {
+                edits[editCount - 1].end = edit.end;
+            }
+        } else {
+            edits[editCount++] = edit;
+        }
+        if (i == set->primary) {
+            primaryEdit = editCount - 1;
+        }
+    }
+
+    // Build the replacement for the control from the old text between the edits
+    size_t start = edits[0].start;
+    size_t end = edits[editCount - 1].end;
+    size_t newLength = end - start;
+    BOOL changed = FALSE;
+    for (size_t i = 0; i < editCount; i++) {
+        newLength += edits[i].length;
+        newLength -= edits[i].end - edits[i].start;
+        changed = changed || edits[i].length > 0 || edits[i].end > edits[i].start;
+    }
+
+    if (!changed) {
+        MemFree(edits);
+        return TRUE;
+    }
+
+    WCHAR* replacement = (WCHAR*)MemAlloc(MEM_SCRATCH, (newLength + 1) * sizeof(WCHAR));
+    if (replacement == NULL) {
+        MemFree(edits);
+        return FALSE;
+    }
+
+    WCHAR* out = replacement;
+    size_t position = start;
+    for (size_t i = 0; i < editCount; i++) {
+        out += DocGetText(doc, position, edits[i].start, out);
+        if (edits[i].length > 0) {
+            memcpy(out, edits[i].text, edits[i].length * sizeof(WCHAR));
+            out += edits[i].length;
+        }
+        position = edits[i].end;
+    }
+    *out = L'\0';
+
+    // The document is rebuilt once for the whole batch
+    if (!DocApplyEdits(doc, edits, editCount)) {
+        MemFree(replacement);
+        MemFree(edits);
+        return FALSE;
+    }
+
+    // Each cursor collapses to a caret after its new text, shifted by the edits before it
+    ptrdiff_t shift = 0;
+    for (size_t i = 0; i < editCount; i++) {
+        size_t caret = (size_t)((ptrdiff_t)edits[i].start + shift) + edits[i].length;
+        set->items[i].anchor = caret;
+        set->items[i].caret = caret;
+        shift += (ptrdiff_t)edits[i].length - (ptrdiff_t)(edits[i].end - edits[i].start);
+    }
+    set->count = editCount;
+    set->primary = primaryEdit;
+
+    // Carets that ended up in the same place (deleting up to a neighbour) become one cursor
+    CursorSetNormalize(set);
+
+    batch->start = start;
+    batch->end = end;
+    batch->text = replacement;
+    batch->length = newLength;
+
+    MemFree(edits);
+    return TRUE;
+}
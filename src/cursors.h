@@ -0,0 +1,60 @@
+// CyCharm : Multiple cursors, block selection and batched cursor edits
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_CURSORS_H
+#define CYCHARM_CURSORS_H
+
+#include <windows.h>
+#include "document.h"
+
+// Kinds of edit applied at every cursor in one batch
+#define CURSOR_EDIT_INSERT 0     // Replace each selection with text
+#define CURSOR_EDIT_BACKSPACE 1  // Delete each selection, or the character before each caret
+#define CURSOR_EDIT_DELETE 2     // Delete each selection, or the character after each caret
+
+typedef struct Cursor {
+    size_t anchor;   // Fixed end of the selection
+    size_t caret;    // Moving end of the selection, where typing happens
+} Cursor;
+
+typedef struct CursorSet {
+    Cursor* items;   // Sorted by selection start and never overlapping once normalized (MEM_INDEX)
+    size_t count;
+    size_t capacity;
+    size_t primary;  // The cursor mirrored by the edit control's own selection
+} CursorSet;
+
+// One replacement of the edit control's text that covers every cursor's edit at once
+typedef struct CursorBatch {
+    size_t start;
+    size_t end;
+    WCHAR* text;     // Null-terminated, allocated with MemAlloc; NULL if the batch changed nothing
+    size_t length;
+} CursorBatch;
+
+void CursorSetInit(CursorSet* set);
+void CursorSetFree(CursorSet* set);
+void CursorSetClear(CursorSet* set);
+
+BOOL CursorSetAdd(CursorSet* set, size_t anchor, size_t caret, BOOL primary);
+
+// Sort the cursors and merge any whose selections overlap
+void CursorSetNormalize(CursorSet* set);
+
+// Index of the first cursor whose selection ends at or after an offset (cursors must be normalized)
+size_t CursorSetFindFirst(const CursorSet* set, size_t offset);
+
+// Replace the cursors with a rectangular selection between two (line, visual column) corners
+BOOL CursorSetBlock(CursorSet* set, const Document* doc, size_t anchorLine, size_t anchorColumn,
+    size_t caretLine, size_t caretColumn, int tabWidth);
+
+// Add a cursor on the line above (direction < 0) or below the outermost cursor, at the same visual column
+BOOL CursorSetAddLine(CursorSet* set, const Document* doc, int direction, int tabWidth);
+
+// Apply one edit at every cursor as a single transaction on the document and move the cursors
+// With distribute set and one line of text per cursor, each cursor receives its own line
+// The batch describes the same change for the edit control; the caller frees batch->text
+BOOL CursorSetEdit(CursorSet* set, Document* doc, int kind, const WCHAR* text, size_t length,
+    BOOL distribute, CursorBatch* batch);
+
+#endif
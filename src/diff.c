@@ -0,0 +1,787 @@
+// CyCharm : Line diff engine for the compare view
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include "memory.h"
+#include "diff.h"
+
+// Regions at least this long are handed back to the shared queue when split, so idle workers can take them
+#define DIFF_SHARE_SIZE 4096
+
+// Lower bound on the edit cost explored before a split point is picked heuristically
+#define DIFF_MIN_COST 256
+
+// A pair of line ranges [xoff, xlim) of the old text and [yoff, ylim) of the new text
+typedef struct DiffRegion {
+    ptrdiff_t xoff;
+    ptrdiff_t xlim;
+    ptrdiff_t yoff;
+    ptrdiff_t ylim;
+} DiffRegion;
+
+typedef struct DiffStack {
+    DiffRegion* items;
+    size_t count;
+    size_t capacity;
+} DiffStack;
+
+// Work shared by the diff threads: line ids, change flags and a queue of independent regions
+typedef struct DiffJob {
+    const int* xv;
+    const int* yv;
+    char* xChanged;
+    char* yChanged;
+    DiffStack queue;
+    size_t pending;          // Regions queued or being worked on
+    CRITICAL_SECTION lock;
+} DiffJob;
+
+// Function to hash one line (FNV-1a over UTF-16 units)
+static unsigned long long DiffHashLine(const WCHAR* text, size_t length) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+BOOL DiffTextInit(DiffText* diffText, const WCHAR* text, size_t length) {
+    size_t lines = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == L'\r') {
+            lines++;
+        }
+    }
+
+    diffText->text = text;
+    diffText->length = length;
+    diffText->lineCount = lines;
+    diffText->lineStarts = (size_t*)MemAlloc(MEM_SCRATCH, (lines + 1) * sizeof(size_t));
+    if (diffText->lineStarts == NULL) {
+        return FALSE;
+    }
+
+    size_t line = 1;
+    diffText->lineStarts[0] = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == L'\r') {
+            diffText->lineStarts[line++] = i + 1;
+        }
+    }
+    diffText->lineStarts[lines] = length + 1;
+    return TRUE;
+}
+
+void DiffTextFree(DiffText* diffText) {
+    MemFree(diffText->lineStarts);
+    diffText->lineStarts = NULL;
+    diffText->lineCount = 0;
+}
+
+#define DIFF_LINE_TEXT(diffText, line) ((diffText)->text + (diffText)->lineStarts[line])
+#define DIFF_LINE_LENGTH(diffText, line) ((diffText)->lineStarts[(line) + 1] - (diffText)->lineStarts[line] - 1)
+
+typedef struct DiffSlot {
+    unsigned long long hash;
+    const WCHAR* text;
+    size_t length;
+    int id;
+} DiffSlot;
+
+// Function to give every distinct line an integer id, so the diff compares integers from here on
+static BOOL DiffAssignIds(const DiffText* oldText, const DiffText* newText, int* oldIds, int* newIds, int* idCount) {
+    size_t total = oldText->lineCount + newText->lineCount;
+    size_t capacity = 16;
+    while (capacity < total * 2) {
+        capacity *= 2;
+    }
+
+    DiffSlot* slots = (DiffSlot*)MemAlloc(MEM_SCRATCH, capacity * sizeof(DiffSlot));
+    if (slots == NULL) {
+        return FALSE;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        slots[i].id = -1;
+    }
+
+    int next = 0;
+    for (int side = 0; side < 2; side++) {
+        const DiffText* diffText = side == 0 ? oldText : newText;
+        int* ids = side == 0 ? oldIds : newIds;
+
+        for (size_t line = 0; line < diffText->lineCount; line++) {
+            const WCHAR* text = DIFF_LINE_TEXT(diffText, line);
+            size_t length = DIFF_LINE_LENGTH(diffText, line);
+            unsigned long long hash = DiffHashLine(text, length);
+
+            size_t index = (size_t)hash & (capacity - 1);
+            while (slots[index].id >= 0) {
+                if (slots[index].hash == hash && slots[index].length == length &&
+                    memcmp(slots[index].text, text, length * sizeof(WCHAR)) == 0) {
+                    break;
+                }
+                index = (index + 1) & (capacity - 1);
+            }
+
+            if (slots[index].id < 0) {
+                slots[index].hash = hash;
+                slots[index].text = text;
+                slots[index].length = length;
+                slots[index].id = next++;
+            }
+            ids[line] = slots[index].id;
+        }
+    }
+
+    MemFree(slots);
+    *idCount = next;
+    return TRUE;
+}
+
+static BOOL DiffPush(DiffStack* stack, DiffRegion region) {
+    if (stack->count == stack->capacity) {
+        size_t capacity = stack->capacity > 0 ? stack->capacity * 2 : 64;
+        DiffRegion* items = (DiffRegion*)MemRealloc(MEM_SCRATCH, stack->items, capacity * sizeof(DiffRegion));
+        if (items == NULL) {
+            return FALSE;
+        }
+        stack->items = items;
+        stack->capacity = capacity;
+    }
+    stack->items[stack->count++] = region;
+    return TRUE;
+}
+
+static void DiffMarkChanged(char* flags, ptrdiff_t from, ptrdiff_t to) {
+    if (to > from) {
+        memset(flags + from, 1, (size_t)(to - from));
+    }
+}
+
+// Function to find where a shortest edit script crosses the middle of a region (Myers' middle snake)
+// fd and bd hold the furthest-reaching forward and backward paths per diagonal, so memory is linear.
+// Past maxCost the best split found so far is used, which keeps the worst case near-linear in time
+// at the price of a slightly longer (but still correct) script.
+static void DiffMiddleSnake(const int* xv, const int* yv, ptrdiff_t* fd, ptrdiff_t* bd, ptrdiff_t maxCost,
+    const DiffRegion* region, ptrdiff_t* xmid, ptrdiff_t* ymid) {
+    ptrdiff_t xoff = region->xoff, xlim = region->xlim;
+    ptrdiff_t yoff = region->yoff, ylim = region->ylim;
+
+    // Diagonal d = x - y is stored at index d - base
+    ptrdiff_t base = xoff - ylim - 1;
+    ptrdiff_t dmin = xoff - ylim;
+    ptrdiff_t dmax = xlim - yoff;
+    ptrdiff_t fmid = xoff - yoff;
+    ptrdiff_t bmid = xlim - ylim;
+    ptrdiff_t fmin = fmid, fmax = fmid;
+    ptrdiff_t bmin = bmid, bmax = bmid;
+    BOOL odd = ((fmid - bmid) & 1) != 0;
+
+    fd[fmid - base] = xoff;
+    bd[bmid - base] = xlim;
+
+    for (ptrdiff_t cost = 1;; cost++) {
+        // Extend the forward paths by one edit
+        if (fmin > dmin) {
+            fd[--fmin - 1 - base] = -1;
+        } else {
+            fmin++;
+        }
+        if (fmax < dmax) {
+            fd[++fmax + 1 - base] = -1;
+        } else {
+            fmax--;
+        }
+        for (ptrdiff_t d = fmax; d >= fmin; d -= 2) {
+            ptrdiff_t low = fd[d - 1 - base], high = fd[d + 1 - base];
+            ptrdiff_t x = low >= high ? low + 1 : high;
+            ptrdiff_t y = x - d;
+            while (x < xlim && y < ylim && xv[x] == yv[y]) {
+                x++;
+                y++;
+            }
+            fd[d - base] = x;
+            if (odd && bmin <= d && d <= bmax && bd[d - base] <= x) {
+                *xmid = x;
+                *ymid = y;
+                return;
+            }
+        }
+
+        // Extend the backward paths by one edit
+        if (bmin > dmin) {
+            bd[--bmin - 1 - base] = PTRDIFF_MAX;
+        } else {
+            bmin++;
+        }
+        if (bmax < dmax) {
+            bd[++bmax + 1 - base] = PTRDIFF_MAX;
+        } else {
+            bmax--;
+        }
+        for (ptrdiff_t d = bmax; d >= bmin; d -= 2) {
+            ptrdiff_t low = bd[d - 1 - base], high = bd[d + 1 - base];
+            ptrdiff_t x = low < high ? low : high - 1;
+            ptrdiff_t y = x - d;
+            while (x > xoff && y > yoff && xv[x - 1] == yv[y - 1]) {
+                x--;
+                y--;
+            }
+            bd[d - base] = x;
+            if (!odd && fmin <= d && d <= fmax && x <= fd[d - base]) {
+                *xmid = x;
+                *ymid = y;
+                return;
+            }
+        }
+
+        if (cost >= maxCost) {
+            // Too expensive: split at whichever path has made the most progress
+            ptrdiff_t forwardBest = -1, forwardX = xoff;
+            for (ptrdiff_t d = fmax; d >= fmin; d -= 2) {
+                ptrdiff_t x = fd[d - base] < xlim ? fd[d - base] : xlim;
+                ptrdiff_t y = x - d;
+                if (y > ylim) {
+                    x = ylim + d;
+                    y = ylim;
+                }
+                if (x + y > forwardBest) {
+                    forwardBest = x + y;
+                    forwardX = x;
+                }
+            }
+
+            ptrdiff_t backwardBest = PTRDIFF_MAX, backwardX = xlim;
+            for (ptrdiff_t d = bmax; d >= bmin; d -= 2) {
+                ptrdiff_t x = bd[d - base] > xoff ? bd[d - base] : xoff;
+                ptrdiff_t y = x - d;
+                if (y < yoff) {
+                    x = yoff + d;
+                    y = yoff;
+                }
+                if (x + y < backwardBest) {
+                    backwardBest = x + y;
+                    backwardX = x;
+                }
+            }
+
+            if ((xlim + ylim) - backwardBest < forwardBest - (xoff + yoff)) {
+                *xmid = forwardX;
+                *ymid = forwardBest - forwardX;
+            } else {
+                *xmid = backwardX;
+                *ymid = backwardBest - backwardX;
+            }
+            return;
+        }
+    }
+}
+
+// Per-thread scratch for diffing regions
+typedef struct DiffWorker {
+    DiffJob* job;
+    DiffStack local;
+    ptrdiff_t* fd;
+    ptrdiff_t* bd;
+    size_t diagonals;
+} DiffWorker;
+
+// Function to diff one region, splitting it at middle snakes until every piece is trivial
+static void DiffRegionRun(DiffWorker* worker, DiffRegion region) {
+    DiffJob* job = worker->job;
+    const int* xv = job->xv;
+    const int* yv = job->yv;
+
+    worker->local.count = 0;
+    if (!DiffPush(&worker->local, region)) {
+        DiffMarkChanged(job->xChanged, region.xoff, region.xlim);
+        DiffMarkChanged(job->yChanged, region.yoff, region.ylim);
+        return;
+    }
+
+    while (worker->local.count > 0) {
+        DiffRegion r = worker->local.items[--worker->local.count];
+
+        // Matching lines at either end are unchanged
+        while (r.xoff < r.xlim && r.yoff < r.ylim && xv[r.xoff] == yv[r.yoff]) {
+            r.xoff++;
+            r.yoff++;
+        }
+        while (r.xlim > r.xoff && r.ylim > r.yoff && xv[r.xlim - 1] == yv[r.ylim - 1]) {
+            r.xlim--;
+            r.ylim--;
+        }
+
+        if (r.xoff == r.xlim || r.yoff == r.ylim) {
+            DiffMarkChanged(job->xChanged, r.xoff, r.xlim);
+            DiffMarkChanged(job->yChanged, r.yoff, r.ylim);
+            continue;
+        }
+
+        size_t diagonals = (size_t)((r.xlim - r.xoff) + (r.ylim - r.yoff) + 3);
+        if (diagonals > worker->diagonals) {
+            MemFree(worker->fd);
+            MemFree(worker->bd);
+            worker->fd = (ptrdiff_t*)MemAlloc(MEM_SCRATCH, diagonals * sizeof(ptrdiff_t));
+            worker->bd = (ptrdiff_t*)MemAlloc(MEM_SCRATCH, diagonals * sizeof(ptrdiff_t));
+            worker->diagonals = (worker->fd != NULL && worker->bd != NULL) ? diagonals : 0;
+        }
+        if (worker->diagonals == 0) {
+            // Out of memory: report the whole region as changed rather than failing the compare
+            DiffMarkChanged(job->xChanged, r.xoff, r.xlim);
+            DiffMarkChanged(job->yChanged, r.yoff, r.ylim);
+            continue;
+        }
+
+        ptrdiff_t maxCost = 1;
+        for (size_t n = diagonals; n != 0; n >>= 2) {
+            maxCost <<= 1;
+        }
+        if (maxCost < DIFF_MIN_COST) {
+            maxCost = DIFF_MIN_COST;
+        }
+
+        ptrdiff_t xmid, ymid;
+        DiffMiddleSnake(xv, yv, worker->fd, worker->bd, maxCost, &r, &xmid, &ymid);
+
+        DiffRegion first = { r.xoff, xmid, r.yoff, ymid };
+        DiffRegion second = { xmid, r.xlim, ymid, r.ylim };
+
+        // Large halves go back to the shared queue so other threads can work on them
+        BOOL shared = FALSE;
+        if ((second.xlim - second.xoff) + (second.ylim - second.yoff) >= DIFF_SHARE_SIZE) {
+            EnterCriticalSection(&job->lock);
+            shared = DiffPush(&job->queue, second);
+            if (shared) {
+                job->pending++;
+            }
+            LeaveCriticalSection(&job->lock);
+        }
+        if ((!shared && !DiffPush(&worker->local, second)) || !DiffPush(&worker->local, first)) {
+            DiffMarkChanged(job->xChanged, r.xoff, r.xlim);
+            DiffMarkChanged(job->yChanged, r.yoff, r.ylim);
+        }
+    }
+}
+
+// Thread procedure: take regions from the shared queue until all of them are done
+static DWORD WINAPI DiffWorkerProc(LPVOID param) {
+    DiffWorker* worker = (DiffWorker*)param;
+    DiffJob* job = worker->job;
+
+    for (;;) {
+        EnterCriticalSection(&job->lock);
+        if (job->queue.count > 0) {
+            DiffRegion region = job->queue.items[--job->queue.count];
+            LeaveCriticalSection(&job->lock);
+
+            DiffRegionRun(worker, region);
+
+            EnterCriticalSection(&job->lock);
+            job->pending--;
+            LeaveCriticalSection(&job->lock);
+            continue;
+        }
+
+        BOOL finished = job->pending == 0;
+        LeaveCriticalSection(&job->lock);
+        if (finished) {
+            break;
+        }
+        Sleep(1);
+    }
+    return 0;
+}
+
+// Function to pair up lines that occur exactly once on each side, keeping the longest run that
+// appears in the same order on both (patience anchors); regions between anchors are independent
+static BOOL DiffQueueRegions(DiffJob* job, int idCount, ptrdiff_t xoff, ptrdiff_t xlim, ptrdiff_t yoff, ptrdiff_t ylim) {
+    int* oldCount = (int*)MemAlloc(MEM_SCRATCH, (size_t)idCount * sizeof(int));
+    int* newCount = (int*)MemAlloc(MEM_SCRATCH, (size_t)idCount * sizeof(int));
+    ptrdiff_t* oldPosition = (ptrdiff_t*)MemAlloc(MEM_SCRATCH, (size_t)idCount * sizeof(ptrdiff_t));
+    size_t span = (size_t)(ylim - yoff) + 1;
+    ptrdiff_t* pairOld = (ptrdiff_t*)MemAlloc(MEM_SCRATCH, span * sizeof(ptrdiff_t));
+    ptrdiff_t* pairNew = (ptrdiff_t*)MemAlloc(MEM_SCRATCH, span * sizeof(ptrdiff_t));
+    size_t* tails = (size_t*)MemAlloc(MEM_SCRATCH, span * sizeof(size_t));
+    size_t* previous = (size_t*)MemAlloc(MEM_SCRATCH, span * sizeof(size_t));
+
+    BOOL ok = oldCount != NULL && newCount != NULL && oldPosition != NULL && pairOld != NULL &&
+        pairNew != NULL && tails != NULL && previous != NULL;
+
+    if (ok) {
+        memset(oldCount, 0, (size_t)idCount * sizeof(int));
+        memset(newCount, 0, (size_t)idCount * sizeof(int));
+        for (ptrdiff_t x = xoff; x < xlim; x++) {
+            oldCount[job->xv[x]]++;
+            oldPosition[job->xv[x]] = x;
+        }
+        for (ptrdiff_t y = yoff; y < ylim; y++) {
+            newCount[job->yv[y]]++;
+        }
+
+        size_t pairs = 0;
+        for (ptrdiff_t y = yoff; y < ylim; y++) {
+            int id = job->yv[y];
+            if (oldCount[id] == 1 && newCount[id] == 1) {
+                pairOld[pairs] = oldPosition[id];
+                pairNew[pairs] = y;
+                pairs++;
+            }
+        }
+
+        // Longest increasing subsequence of old positions, in new-text order
+        size_t length = 0;
+        for (size_t i = 0; i < pairs; i++) {
+            size_t low = 0, high = length;
+            while (low < high) {
+                size_t middle = (low + high) / 2;
+                if (pairOld[tails[middle]] < pairOld[i]) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            previous[i] = low > 0 ? tails[low - 1] : (size_t)-1;
+            tails[low] = i;
+            if (low == length) {
+                length++;
+            }
+        }
+
+        // Walk the anchors back to front, queueing the region after each one
+        ptrdiff_t xEnd = xlim, yEnd = ylim;
+        size_t anchor = length > 0 ? tails[length - 1] : (size_t)-1;
+        for (;;) {
+            ptrdiff_t xStart = anchor != (size_t)-1 ? pairOld[anchor] + 1 : xoff;
+            ptrdiff_t yStart = anchor != (size_t)-1 ? pairNew[anchor] + 1 : yoff;
+            if (xStart < xEnd || yStart < yEnd) {
+                DiffRegion region = { xStart, xEnd, yStart, yEnd };
+                if (!DiffPush(&job->queue, region)) {
+                    ok = FALSE;
+                    break;
+                }
+            }
+            if (anchor == (size_t)-1) {
+                break;
+            }
+            xEnd = pairOld[anchor];
+            yEnd = pairNew[anchor];
+            anchor = previous[anchor];
+        }
+        job->pending = job->queue.count;
+    }
+
+    MemFree(oldCount);
+    MemFree(newCount);
+    MemFree(oldPosition);
+    MemFree(pairOld);
+    MemFree(pairNew);
+    MemFree(tails);
+    MemFree(previous);
+    return ok;
+}
+
+// Function to append a hunk to a result
+static BOOL DiffAddHunk(DiffResult* result, const DiffHunk* hunk) {
+    if (result->count == result->capacity) {
+        size_t capacity = result->capacity > 0 ? result->capacity * 2 : 64;
+        DiffHunk* hunks = (DiffHunk*)MemRealloc(MEM_SCRATCH, result->hunks, capacity * sizeof(DiffHunk));
+        if (hunks == NULL) {
+            return FALSE;
+        }
+        result->hunks = hunks;
+        result->capacity = capacity;
+    }
+    result->hunks[result->count++] = *hunk;
+    return TRUE;
+}
+
+BOOL DiffCompute(const DiffText* oldText, const DiffText* newText, DiffResult* result) {
+    ZeroMemory(result, sizeof(DiffResult));
+
+    size_t oldLines = oldText->lineCount;
+    size_t newLines = newText->lineCount;
+    int* oldIds = (int*)MemAlloc(MEM_SCRATCH, oldLines * sizeof(int));
+    int* newIds = (int*)MemAlloc(MEM_SCRATCH, newLines * sizeof(int));
+    char* oldChanged = (char*)MemAlloc(MEM_SCRATCH, oldLines + 1);
+    char* newChanged = (char*)MemAlloc(MEM_SCRATCH, newLines + 1);
+    int idCount = 0;
+
+    BOOL ok = oldIds != NULL && newIds != NULL && oldChanged != NULL && newChanged != NULL &&
+        DiffAssignIds(oldText, newText, oldIds, newIds, &idCount);
+
+    DiffJob job;
+    ZeroMemory(&job, sizeof(job));
+    if (ok) {
+        memset(oldChanged, 0, oldLines + 1);
+        memset(newChanged, 0, newLines + 1);
+        job.xv = oldIds;
+        job.yv = newIds;
+        job.xChanged = oldChanged;
+        job.yChanged = newChanged;
+        InitializeCriticalSection(&job.lock);
+
+        // Trim the common prefix and suffix before looking for anchors
+        ptrdiff_t xoff = 0, yoff = 0;
+        ptrdiff_t xlim = (ptrdiff_t)oldLines, ylim = (ptrdiff_t)newLines;
+        while (xoff < xlim && yoff < ylim && oldIds[xoff] == newIds[yoff]) {
+            xoff++;
+            yoff++;
+        }
+        while (xlim > xoff && ylim > yoff && oldIds[xlim - 1] == newIds[ylim - 1]) {
+            xlim--;
+            ylim--;
+        }
+
+        ok = DiffQueueRegions(&job, idCount, xoff, xlim, yoff, ylim);
+        if (ok && job.queue.count > 0) {
+            // Large inputs are spread over several threads; small ones stay on this one
+            int threads = 1;
+            if ((size_t)((xlim - xoff) + (ylim - yoff)) >= DIFF_PARALLEL_THRESHOLD) {
+                SYSTEM_INFO info;
+                GetSystemInfo(&info);
+                threads = (int)info.dwNumberOfProcessors;
+                threads = threads < 1 ? 1 : (threads > DIFF_MAX_THREADS ? DIFF_MAX_THREADS : threads);
+            }
+
+            DiffWorker workers[DIFF_MAX_THREADS];
+            HANDLE handles[DIFF_MAX_THREADS];
+            int started = 0;
+            ZeroMemory(workers, sizeof(workers));
+            for (int i = 0; i < threads; i++) {
+                workers[i].job = &job;
+            }
+            for (int i = 1; i < threads; i++) {
+                handles[started] = CreateThread(NULL, 0, DiffWorkerProc, &workers[i], 0, NULL);
+                if (handles[started] != NULL) {
+                    started++;
+                }
+            }
+
+            DiffWorkerProc(&workers[0]);
+            if (started > 0) {
+                WaitForMultipleObjects((DWORD)started, handles, TRUE, INFINITE);
+                for (int i = 0; i < started; i++) {
+                    CloseHandle(handles[i]);
+                }
+            }
+            for (int i = 0; i < threads; i++) {
+                MemFree(workers[i].local.items);
+                MemFree(workers[i].fd);
+                MemFree(workers[i].bd);
+            }
+        }
+        DeleteCriticalSection(&job.lock);
+        MemFree(job.queue.items);
+    }
+
+    // Turn the change flags into hunks; unchanged lines pair up in order on both sides
+    size_t x = 0, y = 0;
+    while (ok && (x < oldLines || y < newLines)) {
+        if (x < oldLines && y < newLines && !oldChanged[x] && !newChanged[y]) {
+            x++;
+            y++;
+            continue;
+        }
+
+        DiffHunk hunk = { x, 0, y, 0 };
+        while (x < oldLines && (oldChanged[x] || y >= newLines)) {
+            x++;
+        }
+        while (y < newLines && (newChanged[y] || x >= oldLines)) {
+            y++;
+        }
+        hunk.oldCount = x - hunk.oldStart;
+        hunk.newCount = y - hunk.newStart;
+        ok = DiffAddHunk(result, &hunk);
+    }
+
+    MemFree(oldIds);
+    MemFree(newIds);
+    MemFree(oldChanged);
+    MemFree(newChanged);
+    if (!ok) {
+        DiffResultFree(result);
+    }
+    return ok;
+}
+
+void DiffResultFree(DiffResult* result) {
+    MemFree(result->hunks);
+    ZeroMemory(result, sizeof(DiffResult));
+}
+
+// Growable output buffer for the RTF formatter
+typedef struct DiffWriter {
+    char* data;
+    size_t size;
+    size_t capacity;
+    BOOL failed;
+} DiffWriter;
+
+static void DiffWrite(DiffWriter* writer, const char* text, size_t length) {
+    if (writer->failed) {
+        return;
+    }
+    if (writer->size + length + 1 > writer->capacity) {
+        size_t capacity = writer->capacity > 0 ? writer->capacity : 65536;
+        while (capacity < writer->size + length + 1) {
+            capacity *= 2;
+        }
+        char* data = (char*)MemRealloc(MEM_SCRATCH, writer->data, capacity);
+        if (data == NULL) {
+            writer->failed = TRUE;
+            return;
+        }
+        writer->data = data;
+        writer->capacity = capacity;
+    }
+    memcpy(writer->data + writer->size, text, length);
+    writer->size += length;
+    writer->data[writer->size] = '\0';
+}
+
+static void DiffWriteString(DiffWriter* writer, const char* text) {
+    DiffWrite(writer, text, strlen(text));
+}
+
+// Function to write ANSI text with RTF escapes
+static void DiffWriteAnsi(DiffWriter* writer, const char* text) {
+    for (const unsigned char* p = (const unsigned char*)text; *p != '\0'; p++) {
+        char escaped[8];
+        if (*p == '\\' || *p == '{' || *p == '}') {
+            snprintf(escaped, sizeof(escaped), "\\%c", *p);
+        } else if (*p >= 0x80) {
+            snprintf(escaped, sizeof(escaped), "\\'%02x", *p);
+        } else {
+            escaped[0] = (char)*p;
+            escaped[1] = '\0';
+        }
+        DiffWriteString(writer, escaped);
+    }
+}
+
+// Function to write one line of the diff in the given color with its marker (' ', '-' or '+')
+static void DiffWriteLine(DiffWriter* writer, int color, char marker, const DiffText* diffText, size_t line) {
+    const WCHAR* text = DIFF_LINE_TEXT(diffText, line);
+    size_t length = DIFF_LINE_LENGTH(diffText, line);
+
+    char prefix[16];
+    snprintf(prefix, sizeof(prefix), "\\cf%d %c", color, marker);
+    DiffWriteString(writer, prefix);
+
+    // Plain ASCII runs are copied as they are; everything else is escaped
+    size_t runStart = 0;
+    for (size_t i = 0; i <= length; i++) {
+        WCHAR ch = i < length ? text[i] : 0;
+        BOOL plain = i < length && ch >= 0x20 && ch < 0x80 && ch != '\\' && ch != '{' && ch != '}';
+        if (plain) {
+            continue;
+        }
+
+        char run[256];
+        for (size_t j = runStart; j < i;) {
+            size_t n = 0;
+            while (j < i && n < sizeof(run)) {
+                run[n++] = (char)text[j++];
+            }
+            DiffWrite(writer, run, n);
+        }
+        runStart = i + 1;
+
+        if (i < length) {
+            char escaped[16];
+            if (ch == '\t') {
+                snprintf(escaped, sizeof(escaped), "\\tab ");
+            } else if (ch == '\\' || ch == '{' || ch == '}') {
+                snprintf(escaped, sizeof(escaped), "\\%c", (char)ch);
+            } else if (ch < 0x20) {
+                snprintf(escaped, sizeof(escaped), "?");
+            } else {
+                snprintf(escaped, sizeof(escaped), "\\u%d?", (int)(short)ch);
+            }
+            DiffWriteString(writer, escaped);
+        }
+    }
+    DiffWriteString(writer, "\\par\n");
+}
+
+// RTF color table indices
+#define DIFF_COLOR_TEXT 1
+#define DIFF_COLOR_HEADER 2
+#define DIFF_COLOR_REMOVED 3
+#define DIFF_COLOR_ADDED 4
+#define DIFF_COLOR_HUNK 5
+
+char* DiffFormatUnified(const DiffText* oldText, const DiffText* newText, const DiffResult* result,
+    const char* oldName, const char* newName, size_t* outSize) {
+    DiffWriter writer = { NULL, 0, 0, FALSE };
+
+    DiffWriteString(&writer, "{\\rtf1\\ansi\\deff0\\uc1{\\fonttbl{\\f0\\fmodern Cascadia Mono;}}"
+        "{\\colortbl;\\red0\\green0\\blue0;\\red90\\green90\\blue90;\\red176\\green0\\blue0;"
+        "\\red0\\green128\\blue0;\\red0\\green90\\blue176;}\\f0\\fs20\n");
+
+    DiffWriteString(&writer, "\\cf2 --- ");
+    DiffWriteAnsi(&writer, oldName);
+    DiffWriteString(&writer, "\\par\n+++ ");
+    DiffWriteAnsi(&writer, newName);
+    DiffWriteString(&writer, "\\par\n");
+
+    for (size_t first = 0; first < result->count && !writer.failed;) {
+        // Hunks whose context would touch are shown together
+        size_t last = first;
+        while (last + 1 < result->count &&
+            result->hunks[last + 1].oldStart - (result->hunks[last].oldStart + result->hunks[last].oldCount) <= 2 * DIFF_CONTEXT_LINES) {
+            last++;
+        }
+
+        const DiffHunk* head = &result->hunks[first];
+        const DiffHunk* tail = &result->hunks[last];
+        size_t oldFrom = head->oldStart > DIFF_CONTEXT_LINES ? head->oldStart - DIFF_CONTEXT_LINES : 0;
+        size_t newFrom = head->newStart - (head->oldStart - oldFrom);
+        size_t oldTo = tail->oldStart + tail->oldCount + DIFF_CONTEXT_LINES;
+        if (oldTo > oldText->lineCount) {
+            oldTo = oldText->lineCount;
+        }
+        size_t newTo = tail->newStart + tail->newCount + (oldTo - (tail->oldStart + tail->oldCount));
+
+        char header[96];
+        snprintf(header, sizeof(header), "\\cf%d @@ -%zu,%zu +%zu,%zu @@\\par\n", DIFF_COLOR_HUNK,
+            oldFrom + 1, oldTo - oldFrom, newFrom + 1, newTo - newFrom);
+        DiffWriteString(&writer, header);
+
+        size_t oldLine = oldFrom;
+        for (size_t i = first; i <= last; i++) {
+            const DiffHunk* hunk = &result->hunks[i];
+            for (; oldLine < hunk->oldStart; oldLine++) {
+                DiffWriteLine(&writer, DIFF_COLOR_TEXT, ' ', oldText, oldLine);
+            }
+            for (size_t k = 0; k < hunk->oldCount; k++) {
+                DiffWriteLine(&writer, DIFF_COLOR_REMOVED, '-', oldText, hunk->oldStart + k);
+            }
+            for (size_t k = 0; k < hunk->newCount; k++) {
+                DiffWriteLine(&writer, DIFF_COLOR_ADDED, '+', newText, hunk->newStart + k);
+            }
+            oldLine = hunk->oldStart + hunk->oldCount;
+        }
+        for (; oldLine < oldTo; oldLine++) {
+            DiffWriteLine(&writer, DIFF_COLOR_TEXT, ' ', oldText, oldLine);
+        }
+
+        first = last + 1;
+    }
+
+    DiffWriteString(&writer, "}");
+    if (writer.failed) {
+        MemFree(writer.data);
+        *outSize = 0;
+        return NULL;
+    }
+
+    *outSize = writer.size;
+    return writer.data;
+}
@@ -0,0 +1,53 @@
+// CyCharm : Line diff engine for the compare view
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_DIFF_H
+#define CYCHARM_DIFF_H
+
+#include <windows.h>
+
+// Regions with fewer lines than this are diffed on the calling thread only
+#define DIFF_PARALLEL_THRESHOLD 20000
+
+// Upper bound on worker threads used for independent regions
+#define DIFF_MAX_THREADS 8
+
+// Lines of unchanged context shown around each hunk
+#define DIFF_CONTEXT_LINES 3
+
+// Text split into lines at '\r'
+typedef struct DiffText {
+    const WCHAR* text;
+    size_t length;
+    size_t* lineStarts;  // lineCount + 1 entries; the last is length + 1 so every line ends at the next start - 1
+    size_t lineCount;
+} DiffText;
+
+// A run of changed lines: oldCount lines removed at oldStart, newCount lines inserted at newStart
+typedef struct DiffHunk {
+    size_t oldStart;
+    size_t oldCount;
+    size_t newStart;
+    size_t newCount;
+} DiffHunk;
+
+typedef struct DiffResult {
+    DiffHunk* hunks;
+    size_t count;
+    size_t capacity;
+} DiffResult;
+
+BOOL DiffTextInit(DiffText* diffText, const WCHAR* text, size_t length);
+void DiffTextFree(DiffText* diffText);
+
+// Compare two texts line by line
+// Identical lines are matched by hash, lines unique to both sides anchor independent regions,
+// and each region is diffed with linear-space Myers, in parallel when the texts are large
+BOOL DiffCompute(const DiffText* oldText, const DiffText* newText, DiffResult* result);
+void DiffResultFree(DiffResult* result);
+
+// Format a result as a colored unified diff in RTF; the caller frees the buffer with MemFree
+char* DiffFormatUnified(const DiffText* oldText, const DiffText* newText, const DiffResult* result,
+    const char* oldName, const char* newName, size_t* outSize);
+
+#endif
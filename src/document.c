@@ -0,0 +1,1092 @@
+// CyCharm : Document model - a balanced tree of text chunks with a line index
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "memory.h"
+#include "compress.h"
+#include "document.h"
+
+#define DOC_HEIGHT(node) ((node) != NULL ? (node)->height : -1)
+
+// Function to count line breaks in a run of text
+static size_t DocCountLines(const WCHAR* text, size_t length) {
+    size_t lines = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == L'\r') {
+            lines++;
+        }
+    }
+    return lines;
+}
+
+// Chunk store shared by all documents. Resident chunks are listed most recently used first;
+// when their text passes the resident limit the least recently used are compressed.
+typedef struct DocStore {
+    CRITICAL_SECTION lock;
+    DocNode* hotHead;
+    DocNode* hotTail;
+    size_t hotBytes;          // Text bytes of the chunks in the list
+    size_t residentLimit;     // 0 means never compress
+    unsigned char* scratch;   // Compression output before it is copied to its exact size
+    size_t scratchSize;
+} DocStore;
+
+static DocStore g_docStore;
+static volatile LONG g_docStoreState = 0; // 0 uninitialized, 1 initializing, 2 ready
+
+static void DocStoreEnter(void) {
+    if (g_docStoreState != 2) {
+        if (InterlockedCompareExchange(&g_docStoreState, 1, 0) == 0) {
+            InitializeCriticalSection(&g_docStore.lock);
+            InterlockedExchange(&g_docStoreState, 2);
+        } else {
+            while (g_docStoreState != 2) {
+                Sleep(0);
+            }
+        }
+    }
+    EnterCriticalSection(&g_docStore.lock);
+}
+
+static void DocStoreLeave(void) {
+    LeaveCriticalSection(&g_docStore.lock);
+}
+
+// Function to put a resident chunk at the front of the recently used list
+static void DocHotPush(DocNode* leaf) {
+    leaf->storage = DOC_STORAGE_HOT;
+    leaf->hotPrev = NULL;
+    leaf->hotNext = g_docStore.hotHead;
+    if (g_docStore.hotHead != NULL) {
+        g_docStore.hotHead->hotPrev = leaf;
+    } else {
+        g_docStore.hotTail = leaf;
+    }
+    g_docStore.hotHead = leaf;
+    g_docStore.hotBytes += leaf->length * sizeof(WCHAR);
+}
+
+static void DocHotUnlink(DocNode* leaf) {
+    if (leaf->hotPrev != NULL) {
+        leaf->hotPrev->hotNext = leaf->hotNext;
+    } else {
+        g_docStore.hotHead = leaf->hotNext;
+    }
+    if (leaf->hotNext != NULL) {
+        leaf->hotNext->hotPrev = leaf->hotPrev;
+    } else {
+        g_docStore.hotTail = leaf->hotPrev;
+    }
+    leaf->hotPrev = NULL;
+    leaf->hotNext = NULL;
+    g_docStore.hotBytes -= leaf->length * sizeof(WCHAR);
+}
+
+// Function to make the compressed copy of a chunk; FALSE if it would not save at least an eighth
+static BOOL DocPackLeaf(DocNode* leaf) {
+    size_t size = leaf->length * sizeof(WCHAR);
+    size_t bound = LzCompressBound(size);
+    if (g_docStore.scratchSize < bound) {
+        unsigned char* scratch = (unsigned char*)MemRealloc(MEM_SCRATCH, g_docStore.scratch, bound);
+        if (scratch == NULL) {
+            return FALSE;
+        }
+        g_docStore.scratch = scratch;
+        g_docStore.scratchSize = bound;
+    }
+
+    size_t packedSize = LzCompress(leaf->text, size, g_docStore.scratch, g_docStore.scratchSize);
+    if (packedSize == 0 || packedSize > size - size / 8) {
+        return FALSE;
+    }
+
+    leaf->packed = (unsigned char*)MemAlloc(MEM_DOCUMENT, packedSize);
+    if (leaf->packed == NULL) {
+        return FALSE;
+    }
+    memcpy(leaf->packed, g_docStore.scratch, packedSize);
+    leaf->packedSize = packedSize;
+    return TRUE;
+}
+
+// Function to take a chunk out of the recently used list, compressing it if that is worthwhile
+static void DocEvictLeaf(DocNode* leaf) {
+    DocHotUnlink(leaf);
+    if (leaf->packed != NULL || DocPackLeaf(leaf)) {
+        MemFree(leaf->text);
+        leaf->text = NULL;
+        leaf->storage = DOC_STORAGE_COLD;
+    } else {
+        leaf->storage = DOC_STORAGE_RESIDENT;
+    }
+}
+
+// Function to evict unpinned chunks, least recently used first, until resident text fits a budget
+static void DocTrimHot(size_t limit) {
+    DocNode* leaf = g_docStore.hotTail;
+    while (leaf != NULL && g_docStore.hotBytes > limit) {
+        DocNode* previous = leaf->hotPrev;
+        if (leaf->pins == 0) {
+            DocEvictLeaf(leaf);
+        }
+        leaf = previous;
+    }
+}
+
+// Function to get a chunk's text for reading, decompressing it if it is cold
+// The text stays valid until DocUnpinText; returns NULL if memory ran out
+static const WCHAR* DocPinText(const DocNode* node) {
+    DocNode* leaf = (DocNode*)node; // The text itself never changes, only how it is stored
+    DocStoreEnter();
+
+    if (leaf->storage == DOC_STORAGE_COLD) {
+        size_t size = leaf->length * sizeof(WCHAR);
+        WCHAR* text = (WCHAR*)MemAlloc(MEM_CACHE, size > 0 ? size : 1);
+        if (text == NULL) {
+            // Make room by compressing everything that is not in use, then try once more
+            DocTrimHot(0);
+            text = (WCHAR*)MemAlloc(MEM_CACHE, size > 0 ? size : 1);
+        }
+        if (text == NULL || !LzDecompress(leaf->packed, leaf->packedSize, text, size)) {
+            MemFree(text);
+            DocStoreLeave();
+            return NULL;
+        }
+        leaf->text = text;
+        DocHotPush(leaf);
+    } else if (leaf->storage == DOC_STORAGE_HOT && leaf != g_docStore.hotHead) {
+        DocHotUnlink(leaf);
+        DocHotPush(leaf);
+    }
+
+    leaf->pins++;
+    if (g_docStore.residentLimit > 0) {
+        DocTrimHot(g_docStore.residentLimit);
+    }
+    const WCHAR* text = leaf->text;
+    DocStoreLeave();
+    return text;
+}
+
+static void DocUnpinText(const DocNode* node) {
+    DocNode* leaf = (DocNode*)node;
+    DocStoreEnter();
+    leaf->pins--;
+    if (g_docStore.residentLimit > 0 && leaf->pins == 0 && leaf->storage == DOC_STORAGE_HOT) {
+        DocTrimHot(g_docStore.residentLimit);
+    }
+    DocStoreLeave();
+}
+
+void DocSetResidentLimit(size_t bytes) {
+    DocStoreEnter();
+    g_docStore.residentLimit = bytes;
+    if (bytes > 0) {
+        DocTrimHot(bytes);
+    }
+    DocStoreLeave();
+}
+
+size_t DocGetResidentLimit(void) {
+    DocStoreEnter();
+    size_t limit = g_docStore.residentLimit;
+    DocStoreLeave();
+    return limit;
+}
+
+static DocNode* DocAddRef(DocNode* node) {
+    if (node != NULL) {
+        InterlockedIncrement(&node->refCount);
+    }
+    return node;
+}
+
+static void DocRelease(DocNode* node) {
+    while (node != NULL && InterlockedDecrement(&node->refCount) == 0) {
+        DocNode* right = node->right;
+        DocRelease(node->left);
+        if (node->height == 0) {
+            // Another thread trimming the store can evict the chunk up to the moment the lock is held
+            DocStoreEnter();
+            if (node->storage == DOC_STORAGE_HOT) {
+                DocHotUnlink(node);
+            }
+            DocStoreLeave();
+        }
+        MemFree(node->text);
+        MemFree(node->packed);
+        MemFree(node);
+        node = right; // Release the right subtree iteratively to keep recursion shallow
+    }
+}
+
+// Function to create a chunk holding a copy of the given text
+static DocNode* DocNewLeaf(const WCHAR* text, size_t length) {
+    DocNode* node = (DocNode*)MemAlloc(MEM_DOCUMENT, sizeof(DocNode));
+    if (node == NULL) {
+        return NULL;
+    }
+    ZeroMemory(node, sizeof(DocNode));
+
+    node->text = (WCHAR*)MemAlloc(MEM_DOCUMENT, (length > 0 ? length : 1) * sizeof(WCHAR));
+    if (node->text == NULL) {
+        MemFree(node);
+        return NULL;
+    }
+
+    memcpy(node->text, text, length * sizeof(WCHAR));
+    node->refCount = 1;
+    node->length = length;
+    node->lines = DocCountLines(text, length);
+    node->hash = HashText(text, length);
+    StructScanText(text, length, &node->structure);
+
+    DocStoreEnter();
+    DocHotPush(node);
+    if (g_docStore.residentLimit > 0) {
+        DocTrimHot(g_docStore.residentLimit);
+    }
+    DocStoreLeave();
+    return node;
+}
+
+// Function to create an internal node; takes over the caller's references to both children
+// A missing child means building it ran out of memory: the other is released and NULL returned
+static DocNode* DocNewBranch(DocNode* left, DocNode* right) {
+    DocNode* node = left != NULL && right != NULL ? (DocNode*)MemAlloc(MEM_DOCUMENT, sizeof(DocNode)) : NULL;
+    if (node == NULL) {
+        DocRelease(left);
+        DocRelease(right);
+        return NULL;
+    }
+    ZeroMemory(node, sizeof(DocNode));
+
+    node->refCount = 1;
+    node->left = left;
+    node->right = right;
+    node->height = (DOC_HEIGHT(left) > DOC_HEIGHT(right) ? DOC_HEIGHT(left) : DOC_HEIGHT(right)) + 1;
+    node->length = left->length + right->length;
+    node->lines = left->lines + right->lines;
+    node->hash = HashCombine(left->hash, right->hash);
+    node->structure = StructCombine(left->structure, right->structure);
+    return node;
+}
+
+// Function to take a node apart into new references to its children, releasing the node
+static void DocUnpack(DocNode* node, DocNode** left, DocNode** right) {
+    *left = DocAddRef(node->left);
+    *right = DocAddRef(node->right);
+    DocRelease(node);
+}
+
+// Function to join two subtrees whose heights differ by at most two, rotating if needed
+// Consumes both references; sets *ok to FALSE if memory ran out
+static DocNode* DocBalance(DocNode* left, DocNode* right, BOOL* ok) {
+    if (left == NULL || right == NULL) {
+        return left != NULL ? left : right;
+    }
+
+    DocNode* node;
+    if (DOC_HEIGHT(left) > DOC_HEIGHT(right) + 1) {
+        DocNode* leftLeft;
+        DocNode* leftRight;
+        DocUnpack(left, &leftLeft, &leftRight);
+        if (DOC_HEIGHT(leftLeft) >= DOC_HEIGHT(leftRight)) {
+            node = DocNewBranch(leftLeft, DocNewBranch(leftRight, right));
+        } else {
+            DocNode* innerLeft;
+            DocNode* innerRight;
+            DocUnpack(leftRight, &innerLeft, &innerRight);
+            node = DocNewBranch(DocNewBranch(leftLeft, innerLeft), DocNewBranch(innerRight, right));
+        }
+    } else if (DOC_HEIGHT(right) > DOC_HEIGHT(left) + 1) {
+        DocNode* rightLeft;
+        DocNode* rightRight;
+        DocUnpack(right, &rightLeft, &rightRight);
+        if (DOC_HEIGHT(rightRight) >= DOC_HEIGHT(rightLeft)) {
+            node = DocNewBranch(DocNewBranch(left, rightLeft), rightRight);
+        } else {
+            DocNode* innerLeft;
+            DocNode* innerRight;
+            DocUnpack(rightLeft, &innerLeft, &innerRight);
+            node = DocNewBranch(DocNewBranch(left, innerLeft), DocNewBranch(innerRight, rightRight));
+        }
+    } else {
+        node = DocNewBranch(left, right);
+    }
+
+    if (node == NULL) {
+        *ok = FALSE;
+    }
+    return node;
+}
+
+// Function to concatenate two trees of any height (AVL join); consumes both references
+// Sets *ok to FALSE if memory ran out, and then returns NULL
+static DocNode* DocJoin(DocNode* left, DocNode* right, BOOL* ok) {
+    if (left == NULL || right == NULL) {
+        return left != NULL ? left : right;
+    }
+
+    if (DOC_HEIGHT(left) > DOC_HEIGHT(right) + 1) {
+        DocNode* leftLeft;
+        DocNode* leftRight;
+        DocUnpack(left, &leftLeft, &leftRight);
+        DocNode* joined = DocJoin(leftRight, right, ok);
+        if (joined == NULL) {
+            DocRelease(leftLeft); // Both parts had text, so an empty join means memory ran out
+            return NULL;
+        }
+        return DocBalance(leftLeft, joined, ok);
+    }
+    if (DOC_HEIGHT(right) > DOC_HEIGHT(left) + 1) {
+        DocNode* rightLeft;
+        DocNode* rightRight;
+        DocUnpack(right, &rightLeft, &rightRight);
+        DocNode* joined = DocJoin(left, rightLeft, ok);
+        if (joined == NULL) {
+            DocRelease(rightRight);
+            return NULL;
+        }
+        return DocBalance(joined, rightRight, ok);
+    }
+
+    DocNode* node = DocNewBranch(left, right);
+    if (node == NULL) {
+        *ok = FALSE;
+    }
+    return node;
+}
+
+// Function to split a tree at an offset that falls on a chunk boundary; the node is borrowed
+// Sets *ok to FALSE if memory ran out, and then returns both parts empty
+static void DocSplit(DocNode* node, size_t offset, DocNode** left, DocNode** right, BOOL* ok) {
+    if (node == NULL) {
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+    if (offset == 0) {
+        *left = NULL;
+        *right = DocAddRef(node);
+        return;
+    }
+    if (offset >= node->length || node->height == 0) {
+        *left = DocAddRef(node);
+        *right = NULL;
+        return;
+    }
+
+    if (offset <= node->left->length) {
+        DocNode* leftRight;
+        DocSplit(node->left, offset, left, &leftRight, ok);
+        *right = *ok ? DocJoin(leftRight, DocAddRef(node->right), ok) : NULL;
+    } else {
+        DocNode* rightLeft;
+        DocSplit(node->right, offset - node->left->length, &rightLeft, right, ok);
+        *left = *ok ? DocJoin(DocAddRef(node->left), rightLeft, ok) : NULL;
+    }
+
+    if (!*ok) {
+        DocRelease(*left);
+        DocRelease(*right);
+        *left = NULL;
+        *right = NULL;
+    }
+}
+
+// Function to find the chunk containing an offset (the last chunk for the end of the document)
+static DocNode* DocFindLeaf(DocNode* node, size_t offset, size_t* leafStart) {
+    *leafStart = 0;
+    if (node == NULL) {
+        return NULL;
+    }
+
+    while (node->height > 0) {
+        if (offset < node->left->length) {
+            node = node->left;
+        } else {
+            offset -= node->left->length;
+            *leafStart += node->left->length;
+            node = node->right;
+        }
+    }
+    return node;
+}
+
+// Function to choose where a chunk ends: after a line break near the target size if there is one
+static size_t DocChunkEnd(const WCHAR* text, size_t start, size_t length) {
+    if (length - start <= DOC_CHUNK_SIZE + DOC_CHUNK_SIZE / 2) {
+        return length;
+    }
+
+    size_t target = start + DOC_CHUNK_SIZE;
+    for (size_t i = target; i > start + DOC_CHUNK_SIZE / 2; i--) {
+        if (text[i - 1] == L'\r') {
+            return i;
+        }
+    }
+
+    // No line break nearby (a very long line): cut anyway, but never inside a surrogate pair
+    if (text[target - 1] >= 0xD800 && text[target - 1] <= 0xDBFF) {
+        target--;
+    }
+    return target;
+}
+
+// Function to build a balanced tree from a run of chunks
+static DocNode* DocBuildBalanced(DocNode** leaves, size_t count) {
+    if (count == 0) {
+        return NULL;
+    }
+    if (count == 1) {
+        return leaves[0];
+    }
+
+    size_t half = count / 2;
+    DocNode* left = DocBuildBalanced(leaves, half);
+    DocNode* right = DocBuildBalanced(leaves + half, count - half);
+    if (left == NULL || right == NULL) {
+        DocRelease(left);
+        DocRelease(right);
+        return NULL;
+    }
+    return DocNewBranch(left, right);
+}
+
+// Function to cut text into chunks and build a balanced tree from them
+// Sets *ok to FALSE if memory ran out
+static DocNode* DocBuildTree(const WCHAR* text, size_t length, BOOL* ok) {
+    *ok = TRUE;
+    if (length == 0) {
+        return NULL;
+    }
+
+    size_t capacity = length / (DOC_CHUNK_SIZE / 2) + 2;
+    DocNode** leaves = (DocNode**)MemAlloc(MEM_SCRATCH, capacity * sizeof(DocNode*));
+    if (leaves == NULL) {
+        *ok = FALSE;
+        return NULL;
+    }
+
+    size_t count = 0;
+    for (size_t start = 0; start < length;) {
+        size_t end = DocChunkEnd(text, start, length);
+        leaves[count] = DocNewLeaf(text + start, end - start);
+        if (leaves[count] == NULL) {
+            for (size_t i = 0; i < count; i++) {
+                DocRelease(leaves[i]);
+            }
+            MemFree(leaves);
+            *ok = FALSE;
+            return NULL;
+        }
+        count++;
+        start = end;
+    }
+
+    DocNode* root = DocBuildBalanced(leaves, count);
+    MemFree(leaves);
+    *ok = root != NULL;
+    return root;
+}
+
+void DocInit(Document* doc) {
+    doc->root = NULL;
+}
+
+void DocFree(Document* doc) {
+    DocRelease(doc->root);
+    doc->root = NULL;
+}
+
+void DocCopy(Document* doc, const Document* source) {
+    DocNode* root = DocAddRef(source->root);
+    DocRelease(doc->root);
+    doc->root = root;
+}
+
+BOOL DocSetText(Document* doc, const WCHAR* text, size_t length) {
+    BOOL ok;
+    DocNode* root = DocBuildTree(text, length, &ok);
+    if (!ok) {
+        return FALSE;
+    }
+
+    DocRelease(doc->root);
+    doc->root = root;
+    return TRUE;
+}
+
+size_t DocLength(const Document* doc) {
+    return doc->root != NULL ? doc->root->length : 0;
+}
+
+size_t DocLineCount(const Document* doc) {
+    return (doc->root != NULL ? doc->root->lines : 0) + 1;
+}
+
+size_t DocLineStart(const Document* doc, size_t line) {
+    if (line == 0 || doc->root == NULL) {
+        return 0;
+    }
+    if (line > doc->root->lines) {
+        return doc->root->length;
+    }
+
+    // Find the line-th line break; the line starts right after it
+    const DocNode* node = doc->root;
+    size_t offset = 0;
+    while (node->height > 0) {
+        if (line <= node->left->lines) {
+            node = node->left;
+        } else {
+            line -= node->left->lines;
+            offset += node->left->length;
+            node = node->right;
+        }
+    }
+
+    const WCHAR* text = DocPinText(node);
+    if (text == NULL) {
+        return offset + node->length;
+    }
+    for (size_t i = 0; i < node->length; i++) {
+        if (text[i] == L'\r' && --line == 0) {
+            DocUnpinText(node);
+            return offset + i + 1;
+        }
+    }
+    DocUnpinText(node);
+    return offset + node->length;
+}
+
+size_t DocLineLength(const Document* doc, size_t line) {
+    size_t start = DocLineStart(doc, line);
+    size_t end = line + 1 < DocLineCount(doc) ? DocLineStart(doc, line + 1) - 1 : DocLength(doc);
+    return end - start;
+}
+
+size_t DocLineFromOffset(const Document* doc, size_t offset) {
+    const DocNode* node = doc->root;
+    size_t line = 0;
+    if (node == NULL) {
+        return 0;
+    }
+    if (offset >= node->length) {
+        return node->lines;
+    }
+
+    while (node->height > 0) {
+        if (offset < node->left->length) {
+            node = node->left;
+        } else {
+            offset -= node->left->length;
+            line += node->left->lines;
+            node = node->right;
+        }
+    }
+    const WCHAR* text = DocPinText(node);
+    if (text == NULL) {
+        return line;
+    }
+    line += DocCountLines(text, offset);
+    DocUnpinText(node);
+    return line;
+}
+
+ContentHash DocHash(const Document* doc) {
+    return doc->root != NULL ? doc->root->hash : HashEmpty();
+}
+
+// State of a search for the bracket that closes (or opens) the current depth
+typedef struct DocBracketSearch {
+    size_t from;     // Forwards: first offset to look at; backwards: one past the first
+    size_t limit;    // Backwards only: lowest offset to look at
+    int depth;       // Unmatched brackets passed so far
+    size_t found;
+    BOOL failed;     // A chunk could not be read
+} DocBracketSearch;
+
+// Function to search forwards for the closer that takes the depth below zero
+// Subtrees that never reach that depth are skipped using their summaries
+static BOOL DocSearchCloser(const DocNode* node, size_t nodeStart, DocBracketSearch* search) {
+    if (nodeStart + node->length <= search->from) {
+        return FALSE;
+    }
+    if (nodeStart >= search->from && search->depth + node->structure.bracketMin >= 0) {
+        search->depth += node->structure.bracketDelta;
+        return FALSE;
+    }
+
+    if (node->height > 0) {
+        return DocSearchCloser(node->left, nodeStart, search) ||
+            DocSearchCloser(node->right, nodeStart + node->left->length, search);
+    }
+
+    const WCHAR* text = DocPinText(node);
+    if (text == NULL) {
+        search->failed = TRUE;
+        return TRUE;
+    }
+    for (size_t i = search->from > nodeStart ? search->from - nodeStart : 0; i < node->length; i++) {
+        search->depth += StructBracketDirection(text[i]);
+        if (search->depth < 0) {
+            search->found = nodeStart + i;
+            DocUnpinText(node);
+            return TRUE;
+        }
+    }
+    DocUnpinText(node);
+    return FALSE;
+}
+
+// Function to search backwards for the opener that takes the depth below zero
+// Seen from its end, a run's lowest depth is its lowest running depth minus its total
+static BOOL DocSearchOpener(const DocNode* node, size_t nodeStart, DocBracketSearch* search) {
+    size_t nodeEnd = nodeStart + node->length;
+    if (nodeStart >= search->from || nodeEnd <= search->limit) {
+        return FALSE;
+    }
+    if (nodeEnd <= search->from && nodeStart >= search->limit &&
+        search->depth + node->structure.bracketMin - node->structure.bracketDelta >= 0) {
+        search->depth -= node->structure.bracketDelta;
+        return FALSE;
+    }
+
+    if (node->height > 0) {
+        return DocSearchOpener(node->right, nodeStart + node->left->length, search) ||
+            DocSearchOpener(node->left, nodeStart, search);
+    }
+
+    const WCHAR* text = DocPinText(node);
+    if (text == NULL) {
+        search->failed = TRUE;
+        return TRUE;
+    }
+    size_t low = search->limit > nodeStart ? search->limit - nodeStart : 0;
+    for (size_t i = search->from < nodeEnd ? search->from - nodeStart : node->length; i > low; i--) {
+        search->depth -= StructBracketDirection(text[i - 1]);
+        if (search->depth < 0) {
+            search->found = nodeStart + i - 1;
+            DocUnpinText(node);
+            return TRUE;
+        }
+    }
+    DocUnpinText(node);
+    return FALSE;
+}
+
+BOOL DocFindMatchingBracket(const Document* doc, size_t offset, size_t* match) {
+    if (offset >= DocLength(doc)) {
+        return FALSE;
+    }
+
+    int direction = StructBracketDirection(DocCharAt(doc, offset));
+    DocBracketSearch search = { 0, 0, 0, 0, FALSE };
+    BOOL found = FALSE;
+    if (direction > 0) {
+        search.from = offset + 1;
+        found = DocSearchCloser(doc->root, 0, &search);
+    } else if (direction < 0) {
+        search.from = offset;
+        found = DocSearchOpener(doc->root, 0, &search);
+    }
+
+    if (!found || search.failed) {
+        return FALSE;
+    }
+    *match = search.found;
+    return TRUE;
+}
+
+// State of a search for the next line indented no deeper than a given indent
+typedef struct DocIndentSearch {
+    size_t from;     // A line start; lines starting here or later are considered
+    int indent;
+    BOOL open;       // The line the next node to visit goes on with is whitespace so far
+    int column;      // Its whitespace so far, in columns
+    size_t found;    // The first non-blank character of the line found
+    BOOL failed;
+} DocIndentSearch;
+
+// Function to search forwards for the first non-blank line indented at most search->indent
+static BOOL DocSearchIndent(const DocNode* node, size_t nodeStart, DocIndentSearch* search) {
+    if (nodeStart + node->length <= search->from) {
+        return FALSE;
+    }
+    if (nodeStart >= search->from) {
+        const StructSummary* summary = &node->structure;
+        int lowest = summary->minIndent;
+        if (search->open && summary->leadEnd == STRUCT_END_TEXT && StructAdvance(summary->lead, search->column) < lowest) {
+            lowest = StructAdvance(summary->lead, search->column);
+        }
+        if (lowest > search->indent) {
+            // Carry the line the node leaves open, whitespace and all, into the next one
+            if (summary->hasBreak) {
+                search->open = summary->tailOpen;
+                search->column = StructAdvance(summary->tail, 0);
+            } else if (search->open && summary->leadEnd == STRUCT_END_NONE) {
+                search->column = StructAdvance(summary->lead, search->column);
+            } else {
+                search->open = FALSE;
+            }
+            return FALSE;
+        }
+    }
+
+    if (node->height > 0) {
+        return DocSearchIndent(node->left, nodeStart, search) ||
+            DocSearchIndent(node->right, nodeStart + node->left->length, search);
+    }
+
+    const WCHAR* text = DocPinText(node);
+    if (text == NULL) {
+        search->failed = TRUE;
+        return TRUE;
+    }
+    size_t i = 0;
+    if (search->from > nodeStart) {
+        i = search->from - nodeStart;
+        search->open = TRUE;
+        search->column = 0;
+    }
+    for (; i < node->length; i++) {
+        WCHAR c = text[i];
+        if (c == L'\r') {
+            search->open = TRUE;
+            search->column = 0;
+        } else if (!search->open) {
+            continue;
+        } else if (c == L' ' || c == L'\t') {
+            search->column = StructStep(search->column, c);
+        } else if (search->column <= search->indent) {
+            search->found = nodeStart + i;
+            DocUnpinText(node);
+            return TRUE;
+        } else {
+            search->open = FALSE;
+        }
+    }
+    DocUnpinText(node);
+    return FALSE;
+}
+
+// Function to measure a line's indent from the document itself, STRUCT_NO_INDENT if it is blank
+static int DocLineIndent(const Document* doc, size_t line) {
+    size_t start = DocLineStart(doc, line);
+    size_t end = start + DocLineLength(doc, line);
+    int indent = 0;
+    for (size_t offset = start; offset < end; offset++) {
+        WCHAR c = DocCharAt(doc, offset);
+        if (c != L' ' && c != L'\t') {
+            return indent;
+        }
+        indent = StructStep(indent, c);
+    }
+    return STRUCT_NO_INDENT;
+}
+
+BOOL DocFindFold(const Document* doc, size_t line, size_t* lastLine) {
+    size_t lineCount = DocLineCount(doc);
+    if (line + 1 >= lineCount) {
+        return FALSE;
+    }
+    size_t start = DocLineStart(doc, line);
+    size_t end = start + DocLineLength(doc, line);
+
+    // A bracket left open on the line folds up to the line that closes it
+    DocBracketSearch opener = { end, start, 0, 0, FALSE };
+    if (DocSearchOpener(doc->root, 0, &opener) && !opener.failed) {
+        size_t match;
+        if (DocFindMatchingBracket(doc, opener.found, &match)) {
+            size_t closeLine = DocLineFromOffset(doc, match);
+            if (closeLine > line + 1) {
+                *lastLine = closeLine - 1;
+                return TRUE;
+            }
+            return FALSE;
+        }
+    }
+
+    // Otherwise fold the lines indented deeper than this one
+    int indent = DocLineIndent(doc, line);
+    if (indent == STRUCT_NO_INDENT) {
+        return FALSE;
+    }
+    DocIndentSearch search = { DocLineStart(doc, line + 1), indent, TRUE, 0, 0, FALSE };
+    size_t last = lineCount - 1;
+    if (DocSearchIndent(doc->root, 0, &search)) {
+        if (search.failed) {
+            return FALSE;
+        }
+        last = DocLineFromOffset(doc, search.found) - 1;
+    }
+
+    // Blank lines after the block stay visible
+    while (last > line && DocLineIndent(doc, last) == STRUCT_NO_INDENT) {
+        last--;
+    }
+    if (last <= line) {
+        return FALSE;
+    }
+    *lastLine = last;
+    return TRUE;
+}
+
+// Recursive helper for DocForEachChunk; returns FALSE once the callback asks to stop
+static BOOL DocWalk(const DocNode* node, size_t nodeStart, size_t start, size_t end, DocChunkProc proc, void* context) {
+    if (node == NULL || end <= nodeStart || start >= nodeStart + node->length) {
+        return TRUE;
+    }
+
+    if (node->height == 0) {
+        size_t from = start > nodeStart ? start - nodeStart : 0;
+        size_t to = end - nodeStart < node->length ? end - nodeStart : node->length;
+        const WCHAR* text = DocPinText(node);
+        if (text == NULL) {
+            return FALSE;
+        }
+        BOOL more = proc(text + from, to - from, nodeStart + from, context);
+        DocUnpinText(node);
+        return more;
+    }
+
+    if (!DocWalk(node->left, nodeStart, start, end, proc, context)) {
+        return FALSE;
+    }
+    return DocWalk(node->right, nodeStart + node->left->length, start, end, proc, context);
+}
+
+void DocForEachChunk(const Document* doc, size_t start, size_t end, DocChunkProc proc, void* context) {
+    DocWalk(doc->root, 0, start, end, proc, context);
+}
+
+// Chunk callback that copies text into a buffer
+static BOOL DocCopyChunk(const WCHAR* text, size_t length, size_t offset, void* context) {
+    WCHAR** out = (WCHAR**)context;
+    memcpy(*out, text, length * sizeof(WCHAR));
+    *out += length;
+    return TRUE;
+}
+
+size_t DocGetText(const Document* doc, size_t start, size_t end, WCHAR* out) {
+    size_t length = DocLength(doc);
+    if (end > length) {
+        end = length;
+    }
+    if (start >= end) {
+        return 0;
+    }
+
+    WCHAR* cursor = out;
+    DocForEachChunk(doc, start, end, DocCopyChunk, &cursor);
+    return (size_t)(cursor - out);
+}
+
+WCHAR DocCharAt(const Document* doc, size_t offset) {
+    size_t leafStart;
+    const DocNode* leaf = DocFindLeaf(doc->root, offset, &leafStart);
+    if (leaf == NULL || offset >= leafStart + leaf->length) {
+        return L'\0';
+    }
+    const WCHAR* text = DocPinText(leaf);
+    if (text == NULL) {
+        return L'\0';
+    }
+    WCHAR c = text[offset - leafStart];
+    DocUnpinText(leaf);
+    return c;
+}
+
+BOOL DocApplyEdits(Document* doc, const DocEdit* edits, size_t count) {
+    if (count == 0) {
+        return TRUE;
+    }
+
+    size_t length = DocLength(doc);
+    size_t firstStart = edits[0].start;
+    size_t lastEnd = edits[count - 1].end;
+    if (firstStart > length || lastEnd > length) {
+        return FALSE;
+    }
+
+    // The region to rebuild runs from the start of the first touched chunk to the end of the last
+    size_t regionStart = 0;
+    size_t regionEnd = 0;
+    DocNode* firstLeaf = DocFindLeaf(doc->root, firstStart, &regionStart);
+    if (firstLeaf != NULL) {
+        size_t lastLeafStart;
+        DocNode* lastLeaf = DocFindLeaf(doc->root, lastEnd > firstStart ? lastEnd - 1 : firstStart, &lastLeafStart);
+        regionEnd = lastLeafStart + lastLeaf->length;
+    }
+
+    size_t newLength = regionEnd - regionStart;
+    for (size_t i = 0; i < count; i++) {
+        newLength += edits[i].length;
+        newLength -= edits[i].end - edits[i].start;
+    }
+
+    // Fold a small result into the following (or preceding) chunk so edits never leave slivers behind
+    if (newLength < DOC_CHUNK_MIN && doc->root != NULL) {
+        size_t neighbourStart;
+        if (regionEnd < length) {
+            DocNode* next = DocFindLeaf(doc->root, regionEnd, &neighbourStart);
+            regionEnd += next->length;
+            newLength += next->length;
+        } else if (regionStart > 0) {
+            DocNode* previous = DocFindLeaf(doc->root, regionStart - 1, &neighbourStart);
+            regionStart = neighbourStart;
+            newLength += previous->length;
+        }
+    }
+
+    // Rebuild the region in one pass: old text between edits interleaved with the new text
+    WCHAR* buffer = (WCHAR*)MemAlloc(MEM_SCRATCH, (newLength > 0 ? newLength : 1) * sizeof(WCHAR));
+    if (buffer == NULL) {
+        return FALSE;
+    }
+
+    WCHAR* out = buffer;
+    size_t position = regionStart;
+    for (size_t i = 0; i < count; i++) {
+        out += DocGetText(doc, position, edits[i].start, out);
+        if (edits[i].length > 0) {
+            memcpy(out, edits[i].text, edits[i].length * sizeof(WCHAR));
+            out += edits[i].length;
+        }
+        position = edits[i].end;
+    }
+    out += DocGetText(doc, position, regionEnd, out);
+    if ((size_t)(out - buffer) != newLength) {
+        MemFree(buffer); // A cold chunk could not be decompressed
+        return FALSE;
+    }
+
+    BOOL ok;
+    DocNode* middle = DocBuildTree(buffer, (size_t)(out - buffer), &ok);
+    MemFree(buffer);
+    if (!ok) {
+        return FALSE;
+    }
+
+    // The old root stays in place until the new one is whole, so running out of memory loses nothing
+    DocNode* before;
+    DocNode* rest;
+    DocNode* replaced = NULL;
+    DocNode* after = NULL;
+    DocSplit(doc->root, regionStart, &before, &rest, &ok);
+    if (ok) {
+        DocSplit(rest, regionEnd - regionStart, &replaced, &after, &ok);
+    }
+    DocRelease(rest);
+    DocRelease(replaced);
+
+    DocNode* root = NULL;
+    if (ok) {
+        root = DocJoin(before, middle, &ok);
+        before = NULL;
+        middle = NULL;
+    }
+    if (ok) {
+        root = DocJoin(root, after, &ok);
+        after = NULL;
+    }
+    if (!ok) {
+        DocRelease(before);
+        DocRelease(middle);
+        DocRelease(after);
+        return FALSE;
+    }
+
+    DocRelease(doc->root);
+    doc->root = root;
+    return TRUE;
+}
+
+BOOL DocReplace(Document* doc, size_t start, size_t end, const WCHAR* text, size_t length) {
+    DocEdit edit = { start, end, text, length };
+    return DocApplyEdits(doc, &edit, 1);
+}
+
+// State for finding the common prefix of the document and a text
+typedef struct DocPrefixState {
+    const WCHAR* text;
+    size_t length;
+    size_t matched;
+} DocPrefixState;
+
+static BOOL DocMatchPrefix(const WCHAR* text, size_t length, size_t offset, void* context) {
+    DocPrefixState* state = (DocPrefixState*)context;
+    size_t limit = state->length - state->matched < length ? state->length - state->matched : length;
+
+    size_t i = 0;
+    while (i < limit && text[i] == state->text[state->matched + i]) {
+        i++;
+    }
+    state->matched += i;
+    return i == length;
+}
+
+// Function to count how many trailing units of a subtree match the end of a text
+static BOOL DocMatchSuffix(const DocNode* node, const WCHAR* text, size_t* remaining, size_t* matched) {
+    if (node == NULL) {
+        return TRUE;
+    }
+
+    if (node->height > 0) {
+        if (!DocMatchSuffix(node->right, text, remaining, matched)) {
+            return FALSE;
+        }
+        return DocMatchSuffix(node->left, text, remaining, matched);
+    }
+
+    const WCHAR* chunk = DocPinText(node);
+    if (chunk == NULL) {
+        return FALSE;
+    }
+    for (size_t i = node->length; i > 0; i--) {
+        if (*remaining == 0 || chunk[i - 1] != text[*remaining - 1]) {
+            DocUnpinText(node);
+            return FALSE;
+        }
+        (*remaining)--;
+        (*matched)++;
+    }
+    DocUnpinText(node);
+    return TRUE;
+}
+
+BOOL DocFindChange(const Document* doc, const WCHAR* text, size_t length, size_t* start, size_t* oldEnd, size_t* newEnd) {
+    size_t oldLength = DocLength(doc);
+
+    DocPrefixState prefix = { text, length, 0 };
+    DocForEachChunk(doc, 0, oldLength, DocMatchPrefix, &prefix);
+    if (prefix.matched == length && length == oldLength) {
+        return FALSE;
+    }
+
+    size_t remaining = length;
+    size_t suffix = 0;
+    DocMatchSuffix(doc->root, text, &remaining, &suffix);
+
+    // The prefix and suffix must not overlap in either text
+    size_t shortest = length < oldLength ? length : oldLength;
+    if (suffix > shortest - prefix.matched) {
+        suffix = shortest - prefix.matched;
+    }
+
+    *start = prefix.matched;
+    *oldEnd = oldLength - suffix;
+    *newEnd = length - suffix;
+    return TRUE;
+}
+
+BOOL DocSyncText(Document* doc, const WCHAR* text, size_t length) {
+    size_t start, oldEnd, newEnd;
+    if (!DocFindChange(doc, text, length, &start, &oldEnd, &newEnd)) {
+        return TRUE;
+    }
+    return DocReplace(doc, start, oldEnd, text + start, newEnd - start);
+}
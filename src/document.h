@@ -0,0 +1,103 @@
+// CyCharm : Document model - a balanced tree of text chunks with a line index
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_DOCUMENT_H
+#define CYCHARM_DOCUMENT_H
+
+#include <windows.h>
+#include "hash.h"
+#include "structure.h"
+
+// Chunk sizes in UTF-16 units. Chunks are cut after a line break where possible.
+#define DOC_CHUNK_SIZE 16384
+#define DOC_CHUNK_MIN 2048
+
+// How a chunk's text is held
+#define DOC_STORAGE_HOT 0       // Resident and in the recently used list, compressed once it goes cold
+#define DOC_STORAGE_COLD 1      // Compressed only; decompressed again on access
+#define DOC_STORAGE_RESIDENT 2  // Resident for good because it does not compress
+
+// A node of the document tree. Nodes are immutable once built and shared between
+// versions by reference count, so an edit only rebuilds the path to the chunks it touches.
+// Only the storage of a chunk's text changes after that, under the chunk store's lock.
+typedef struct DocNode {
+    volatile LONG refCount;
+    int height;              // 0 for a chunk (leaf)
+    size_t length;           // UTF-16 units in this subtree
+    size_t lines;            // Line breaks ('\r') in this subtree
+    ContentHash hash;        // Hash of this subtree's text, independent of how it is split into chunks
+    StructSummary structure; // Brackets and indentation in this subtree
+    struct DocNode* left;
+    struct DocNode* right;
+    WCHAR* text;             // Chunk text, not null-terminated; NULL while the chunk is cold
+    unsigned char* packed;   // Compressed copy of the chunk, made the first time it goes cold
+    size_t packedSize;
+    LONG pins;               // Readers using text right now; a pinned chunk is never compressed
+    int storage;             // DOC_STORAGE_*
+    struct DocNode* hotPrev; // Neighbours in the recently used list
+    struct DocNode* hotNext;
+} DocNode;
+
+typedef struct Document {
+    DocNode* root;           // NULL for an empty document
+} Document;
+
+// One replacement of the range [start, end) with text; batches must be sorted and non-overlapping
+typedef struct DocEdit {
+    size_t start;
+    size_t end;
+    const WCHAR* text;
+    size_t length;
+} DocEdit;
+
+// Callback for walking the chunks of a range; return FALSE to stop
+typedef BOOL (*DocChunkProc)(const WCHAR* text, size_t length, size_t offset, void* context);
+
+void DocInit(Document* doc);
+void DocFree(Document* doc);
+
+// Make doc share source's text in O(1); later edits to either leave the other as it was, so a copy
+// can be read on another thread as a snapshot
+void DocCopy(Document* doc, const Document* source);
+
+BOOL DocSetText(Document* doc, const WCHAR* text, size_t length);
+
+// Budget in bytes for resident chunk text across all documents, 0 means never compress
+// Past the budget the least recently used chunks are compressed and their text freed
+void DocSetResidentLimit(size_t bytes);
+size_t DocGetResidentLimit(void);
+
+size_t DocLength(const Document* doc);
+size_t DocLineCount(const Document* doc);
+size_t DocLineStart(const Document* doc, size_t line);
+size_t DocLineLength(const Document* doc, size_t line);
+size_t DocLineFromOffset(const Document* doc, size_t offset);
+
+// Hash of the whole text in O(1); kept up to date by every edit
+ContentHash DocHash(const Document* doc);
+
+// Find the bracket matching the one at offset, forwards from an opener or backwards from a closer
+// The match may be of a different kind when brackets are unbalanced; check with StructBracketsPair
+BOOL DocFindMatchingBracket(const Document* doc, size_t offset, size_t* match);
+
+// Find the last line of the block that starts on a line: up to the line before the one closing the
+// line's last unclosed bracket, or failing that the lines indented deeper than it
+BOOL DocFindFold(const Document* doc, size_t line, size_t* lastLine);
+
+// Copy [start, end) into out (which must hold end - start units); returns the number copied
+size_t DocGetText(const Document* doc, size_t start, size_t end, WCHAR* out);
+WCHAR DocCharAt(const Document* doc, size_t offset);
+void DocForEachChunk(const Document* doc, size_t start, size_t end, DocChunkProc proc, void* context);
+
+// Apply a batch of edits as one transaction: the chunks spanning the batch are rebuilt once
+BOOL DocApplyEdits(Document* doc, const DocEdit* edits, size_t count);
+BOOL DocReplace(Document* doc, size_t start, size_t end, const WCHAR* text, size_t length);
+
+// Find the span that differs from a full copy of the text: [start, oldEnd) in the document
+// became [start, newEnd) in text; returns FALSE if they are identical
+BOOL DocFindChange(const Document* doc, const WCHAR* text, size_t length, size_t* start, size_t* oldEnd, size_t* newEnd);
+
+// Bring the document in line with a full copy of the text, rebuilding only the part that differs
+BOOL DocSyncText(Document* doc, const WCHAR* text, size_t length);
+
+#endif
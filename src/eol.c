@@ -0,0 +1,145 @@
+// CyCharm : Line ending detection, normalization and expansion
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "eol.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EOL_USE_SSE2
+#endif
+
+#ifdef EOL_USE_SSE2
+// Function to tell whether 8 units hold no '\r' or '\n', so a scan can step over them at once
+static BOOL EolBlockIsPlain(__m128i units) {
+    __m128i breaks = _mm_or_si128(_mm_cmpeq_epi16(units, _mm_set1_epi16(L'\r')),
+        _mm_cmpeq_epi16(units, _mm_set1_epi16(L'\n')));
+    return _mm_movemask_epi8(breaks) == 0;
+}
+#endif
+
+void EolScan(const WCHAR* text, size_t length, EolStats* stats) {
+    size_t i = 0;
+    while (i < length) {
+#ifdef EOL_USE_SSE2
+        if (i + 8 <= length && EolBlockIsPlain(_mm_loadu_si128((const __m128i*)(text + i)))) {
+            i += 8;
+            continue;
+        }
+#endif
+        if (text[i] == L'\r') {
+            if (i + 1 < length && text[i + 1] == L'\n') {
+                stats->counts[EOL_CRLF]++;
+                i++;
+            } else {
+                stats->counts[EOL_CR]++;
+            }
+        } else if (text[i] == L'\n') {
+            stats->counts[EOL_LF]++;
+        }
+        i++;
+    }
+}
+
+int EolDominant(const EolStats* stats, int fallback) {
+    int dominant = fallback;
+    size_t most = 0;
+    for (int style = 0; style < EOL_STYLE_COUNT; style++) {
+        if (stats->counts[style] > most) {
+            most = stats->counts[style];
+            dominant = style;
+        }
+    }
+    return dominant;
+}
+
+BOOL EolIsMixed(const EolStats* stats) {
+    int styles = 0;
+    for (int style = 0; style < EOL_STYLE_COUNT; style++) {
+        if (stats->counts[style] > 0) {
+            styles++;
+        }
+    }
+    return styles > 1;
+}
+
+size_t EolNormalize(WCHAR* text, size_t length) {
+    size_t out = 0;
+    size_t i = 0;
+    while (i < length) {
+#ifdef EOL_USE_SSE2
+        if (i + 8 <= length) {
+            __m128i units = _mm_loadu_si128((const __m128i*)(text + i));
+            if (EolBlockIsPlain(units)) {
+                // The block is loaded before it is stored, so moving it down over itself is safe
+                _mm_storeu_si128((__m128i*)(text + out), units);
+                out += 8;
+                i += 8;
+                continue;
+            }
+        }
+#endif
+        if (text[i] == L'\r' && i + 1 < length && text[i + 1] == L'\n') {
+            i++;
+        }
+        text[out++] = text[i] == L'\n' ? L'\r' : text[i];
+        i++;
+    }
+    return out;
+}
+
+size_t EolExpandedLength(const WCHAR* text, size_t length, int style) {
+    if (style != EOL_CRLF) {
+        return length;
+    }
+
+    EolStats stats = { { 0 } };
+    EolScan(text, length, &stats);
+    return length + stats.counts[EOL_CR];
+}
+
+size_t EolExpand(const WCHAR* text, size_t length, int style, WCHAR* out) {
+    if (style == EOL_CR) {
+        memcpy(out, text, length * sizeof(WCHAR));
+        return length;
+    }
+
+    size_t written = 0;
+    size_t i = 0;
+    while (i < length) {
+#ifdef EOL_USE_SSE2
+        if (i + 8 <= length) {
+            __m128i units = _mm_loadu_si128((const __m128i*)(text + i));
+            if (EolBlockIsPlain(units)) {
+                _mm_storeu_si128((__m128i*)(out + written), units);
+                written += 8;
+                i += 8;
+                continue;
+            }
+        }
+#endif
+        if (text[i] == L'\r') {
+            if (style == EOL_CRLF) {
+                out[written++] = L'\r';
+            }
+            out[written++] = L'\n';
+        } else {
+            out[written++] = text[i];
+        }
+        i++;
+    }
+    return written;
+}
+
+const char* EolName(int style) {
+    switch (style) {
+        case EOL_CRLF:
+            return "CRLF";
+        case EOL_LF:
+            return "LF";
+        case EOL_CR:
+            return "CR";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,38 @@
+// CyCharm : Line ending detection, normalization and expansion
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_EOL_H
+#define CYCHARM_EOL_H
+
+#include <windows.h>
+
+// Line ending styles
+#define EOL_CRLF 0  // Windows
+#define EOL_LF 1    // Unix
+#define EOL_CR 2    // Classic Mac, and the edit control's own form
+#define EOL_STYLE_COUNT 3
+
+// Line breaks of each style found in a text
+typedef struct EolStats {
+    size_t counts[EOL_STYLE_COUNT];
+} EolStats;
+
+// Count the line breaks of each style, adding to stats
+void EolScan(const WCHAR* text, size_t length, EolStats* stats);
+
+// Most frequent style, or fallback for text without line breaks
+int EolDominant(const EolStats* stats, int fallback);
+BOOL EolIsMixed(const EolStats* stats);
+
+// Convert every line break to '\r' in place; returns the new length
+size_t EolNormalize(WCHAR* text, size_t length);
+
+// Length of '\r'-only text once every '\r' is written in a style
+size_t EolExpandedLength(const WCHAR* text, size_t length, int style);
+
+// Write '\r'-only text with every '\r' in a style; out must hold EolExpandedLength units
+size_t EolExpand(const WCHAR* text, size_t length, int style, WCHAR* out);
+
+const char* EolName(int style);
+
+#endif
@@ -0,0 +1,630 @@
+// CyCharm : Streaming JSON and XML pretty-printer and minifier
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "memory.h"
+#include "format.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FORMAT_USE_SSE2
+#endif
+
+// JSON states
+#define JSON_VALUE 0       // Between strings
+#define JSON_STRING 1
+#define JSON_ESCAPE 2      // After a backslash in a string
+
+// JSON tokens
+#define JSON_TOKEN_NONE 0
+#define JSON_TOKEN_LITERAL 1
+#define JSON_TOKEN_OTHER 2
+#define JSON_TOKEN_SPACED 3 // Whitespace after a literal inside an object or array
+
+// XML states
+#define XML_TEXT 0
+#define XML_OPEN 1         // After '<'
+#define XML_BANG 2         // After "<!"
+#define XML_BANG_COMMENT 3 // Matching "<!--"
+#define XML_BANG_CDATA 4   // Matching "<![CDATA["
+#define XML_START_TAG 5
+#define XML_END_TAG 6
+#define XML_COMMENT 7
+#define XML_CDATA 8
+#define XML_PI 9
+#define XML_DECLARATION 10 // <!DOCTYPE ...> and other declarations
+
+// XML tokens
+#define XML_TOKEN_NONE 0
+#define XML_TOKEN_OPEN 1        // A start tag
+#define XML_TOKEN_CLOSE 2       // An end tag
+#define XML_TOKEN_MARKUP 3      // An empty element, comment, processing instruction or declaration
+#define XML_TOKEN_TEXT_INLINE 4 // Text (or CDATA) written straight after its start tag
+#define XML_TOKEN_TEXT_BLOCK 5  // Text written on a line of its own
+
+static const WCHAR g_spaces[] = L"                                ";
+#define FORMAT_SPACES ((sizeof(g_spaces) / sizeof(WCHAR)) - 1)
+
+static const WCHAR g_commentOpening[] = L"--";
+static const WCHAR g_cdataOpening[] = L"[CDATA[";
+
+static BOOL IsSpace(WCHAR c) {
+    return c == L' ' || c == L'\t' || c == L'\r' || c == L'\n';
+}
+
+// Position of the first unit from i on that is a or b, or at most a space when stopAtSpace is set
+static size_t FindStop(const WCHAR* text, size_t i, size_t length, WCHAR a, WCHAR b, BOOL stopAtSpace) {
+#ifdef FORMAT_USE_SSE2
+    __m128i first = _mm_set1_epi16((short)a);
+    __m128i second = _mm_set1_epi16((short)b);
+    __m128i space = _mm_set1_epi16(0x20);
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= length; i += 8) {
+        __m128i units = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi16(units, first), _mm_cmpeq_epi16(units, second));
+        if (stopAtSpace) {
+            // Saturating subtraction leaves zero exactly for units up to 0x20
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi16(_mm_subs_epu16(units, space), zero));
+        }
+        if (_mm_movemask_epi8(hits) != 0) {
+            break;
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        WCHAR c = text[i];
+        if (c == a || c == b || (stopAtSpace && c <= 0x20)) {
+            break;
+        }
+    }
+    return i;
+}
+
+// Position of the first unit from i on that is not whitespace
+static size_t SkipSpace(const WCHAR* text, size_t i, size_t length) {
+#ifdef FORMAT_USE_SSE2
+    __m128i space = _mm_set1_epi16(0x20);
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= length; i += 8) {
+        __m128i units = _mm_loadu_si128((const __m128i*)(text + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(units, space), zero)) != 0xFFFF) {
+            break;
+        }
+    }
+#endif
+    while (i < length && IsSpace(text[i])) {
+        i++;
+    }
+    return i;
+}
+
+static void FlushOutput(Formatter* formatter) {
+    if (formatter->outLength > 0 && !formatter->failed) {
+        if (!formatter->sink(formatter->out, formatter->outLength, formatter->context)) {
+            formatter->failed = TRUE;
+        }
+    }
+    formatter->outLength = 0;
+}
+
+static void Emit(Formatter* formatter, const WCHAR* text, size_t length) {
+    formatter->wroteAny = TRUE;
+    while (length > 0) {
+        size_t room = FORMAT_OUTPUT_UNITS - formatter->outLength;
+        size_t count = length < room ? length : room;
+        memcpy(formatter->out + formatter->outLength, text, count * sizeof(WCHAR));
+        formatter->outLength += count;
+        text += count;
+        length -= count;
+        if (formatter->outLength == FORMAT_OUTPUT_UNITS) {
+            FlushOutput(formatter);
+        }
+    }
+}
+
+static void EmitChar(Formatter* formatter, WCHAR c) {
+    formatter->wroteAny = TRUE;
+    formatter->out[formatter->outLength++] = c;
+    if (formatter->outLength == FORMAT_OUTPUT_UNITS) {
+        FlushOutput(formatter);
+    }
+}
+
+// Function to start a new line indented to the current depth
+static void EmitLineBreak(Formatter* formatter) {
+    size_t spaces = (size_t)formatter->depth * (size_t)formatter->indentWidth;
+    EmitChar(formatter, L'\r');
+    while (spaces > 0) {
+        size_t count = spaces < FORMAT_SPACES ? spaces : FORMAT_SPACES;
+        Emit(formatter, g_spaces, count);
+        spaces -= count;
+    }
+}
+
+int FormatDetectLanguage(const WCHAR* text, size_t length) {
+    size_t i = SkipSpace(text, 0, length);
+    // Skip a byte order mark
+    if (i < length && text[i] == 0xFEFF) {
+        i = SkipSpace(text, i + 1, length);
+    }
+    return (i < length && text[i] == L'<') ? FORMAT_XML : FORMAT_JSON;
+}
+
+void FormatInit(Formatter* formatter, int language, BOOL minify, int indentWidth, FormatSink sink, void* context) {
+    formatter->language = language;
+    formatter->minify = minify;
+    formatter->indentWidth = indentWidth < 0 ? 0 : indentWidth;
+    formatter->sink = sink;
+    formatter->context = context;
+    formatter->failed = FALSE;
+    formatter->malformed = FALSE;
+    formatter->wroteAny = FALSE;
+    formatter->depth = 0;
+    formatter->state = 0;
+    formatter->pendingOpen = FALSE;
+    formatter->topBreak = FALSE;
+    formatter->lastToken = 0;
+    formatter->prefixLength = 0;
+    formatter->tail = 0;
+    formatter->brackets = 0;
+    formatter->quote = 0;
+    formatter->pendingLength = 0;
+    formatter->outLength = 0;
+}
+
+// Function to lay out the start of a JSON value or member
+static void BeginJsonValue(Formatter* formatter) {
+    if (formatter->topBreak) {
+        // Values at the top level (as in JSON Lines) keep a line each
+        EmitChar(formatter, L'\r');
+        formatter->topBreak = FALSE;
+    }
+    if (formatter->pendingOpen) {
+        if (!formatter->minify) {
+            EmitLineBreak(formatter);
+        }
+        formatter->pendingOpen = FALSE;
+    }
+}
+
+// Function to record whether the bracket opened at the current depth is a '[' or a '{'
+static void SetJsonArray(Formatter* formatter, BOOL array) {
+    if (formatter->depth >= FORMAT_JSON_KIND_DEPTH) {
+        return;
+    }
+    BYTE bit = (BYTE)(1 << (formatter->depth & 7));
+    if (array) {
+        formatter->arrays[formatter->depth >> 3] |= bit;
+    } else {
+        formatter->arrays[formatter->depth >> 3] &= (BYTE)~bit;
+    }
+}
+
+// Function to tell whether the bracket open at the current depth is a '['
+static BOOL IsJsonArray(const Formatter* formatter) {
+    return (formatter->arrays[formatter->depth >> 3] >> (formatter->depth & 7)) & 1;
+}
+
+static void FeedJson(Formatter* formatter, const WCHAR* text, size_t length) {
+    size_t i = 0;
+    while (i < length && !formatter->failed) {
+        if (formatter->state == JSON_STRING) {
+            // Copy the string up to its closing quote or next escape in one piece
+            size_t stop = FindStop(text, i, length, L'"', L'\\', FALSE);
+            Emit(formatter, text + i, stop - i);
+            i = stop;
+            if (i == length) {
+                break;
+            }
+            EmitChar(formatter, text[i]);
+            if (text[i] == L'"') {
+                formatter->state = JSON_VALUE;
+                formatter->lastToken = JSON_TOKEN_OTHER;
+                formatter->topBreak = formatter->depth == 0;
+            } else {
+                formatter->state = JSON_ESCAPE;
+            }
+            i++;
+            continue;
+        }
+        if (formatter->state == JSON_ESCAPE) {
+            EmitChar(formatter, text[i++]);
+            formatter->state = JSON_STRING;
+            continue;
+        }
+
+        WCHAR c = text[i];
+        switch (c) {
+        case L' ':
+        case L'\t':
+        case L'\r':
+        case L'\n':
+            if (formatter->lastToken == JSON_TOKEN_LITERAL) {
+                if (formatter->depth == 0) {
+                    formatter->topBreak = TRUE;
+                    formatter->lastToken = JSON_TOKEN_OTHER;
+                } else {
+                    formatter->lastToken = JSON_TOKEN_SPACED;
+                }
+            }
+            i = SkipSpace(text, i, length);
+            continue;
+        case L'{':
+        case L'[':
+            BeginJsonValue(formatter);
+            EmitChar(formatter, c);
+            SetJsonArray(formatter, c == L'[');
+            formatter->depth++;
+            formatter->pendingOpen = TRUE;
+            formatter->lastToken = JSON_TOKEN_OTHER;
+            break;
+        case L'}':
+        case L']':
+            if (formatter->depth == 0) {
+                formatter->malformed = TRUE;
+            } else {
+                formatter->depth--;
+                if (formatter->depth < FORMAT_JSON_KIND_DEPTH && IsJsonArray(formatter) != (c == L']')) {
+                    formatter->malformed = TRUE;
+                }
+            }
+            // An empty object or array stays on one line
+            if (!formatter->pendingOpen && !formatter->minify) {
+                EmitLineBreak(formatter);
+            }
+            formatter->pendingOpen = FALSE;
+            EmitChar(formatter, c);
+            formatter->lastToken = JSON_TOKEN_OTHER;
+            formatter->topBreak = formatter->depth == 0;
+            break;
+        case L',':
+            formatter->topBreak = FALSE;
+            EmitChar(formatter, c);
+            if (!formatter->minify) {
+                EmitLineBreak(formatter);
+            }
+            formatter->lastToken = JSON_TOKEN_OTHER;
+            break;
+        case L':':
+            EmitChar(formatter, c);
+            if (!formatter->minify) {
+                EmitChar(formatter, L' ');
+            }
+            formatter->lastToken = JSON_TOKEN_OTHER;
+            break;
+        case L'"':
+            BeginJsonValue(formatter);
+            EmitChar(formatter, c);
+            formatter->state = JSON_STRING;
+            break;
+        default:
+            // Numbers, true, false and null; two of them with only whitespace between would run together
+            if (formatter->lastToken == JSON_TOKEN_SPACED) {
+                formatter->malformed = TRUE;
+            }
+            if (formatter->lastToken != JSON_TOKEN_LITERAL) {
+                BeginJsonValue(formatter);
+            }
+            EmitChar(formatter, c);
+            formatter->lastToken = JSON_TOKEN_LITERAL;
+            break;
+        }
+        i++;
+    }
+}
+
+// Function to put the next XML token on a new line, unless it is the first
+static void BeginXmlLine(Formatter* formatter) {
+    if (formatter->wroteAny && !formatter->minify) {
+        EmitLineBreak(formatter);
+    }
+}
+
+// Function to lay out the start of text or CDATA: straight after a start tag, or on its own line
+static void BeginXmlText(Formatter* formatter) {
+    if (formatter->lastToken == XML_TOKEN_TEXT_INLINE || formatter->lastToken == XML_TOKEN_TEXT_BLOCK) {
+        // Continuing the same text, so the whitespace held back belongs inside it
+        Emit(formatter, formatter->pending, (size_t)formatter->pendingLength);
+    } else if (formatter->lastToken == XML_TOKEN_OPEN) {
+        formatter->lastToken = XML_TOKEN_TEXT_INLINE;
+    } else {
+        BeginXmlLine(formatter);
+        formatter->lastToken = XML_TOKEN_TEXT_BLOCK;
+    }
+    formatter->pendingLength = 0;
+}
+
+// Function to begin a tag, comment or declaration, dropping the whitespace that ended any text
+static void BeginXmlMarkup(Formatter* formatter) {
+    formatter->pendingLength = 0;
+    BeginXmlLine(formatter);
+}
+
+static void FeedXml(Formatter* formatter, const WCHAR* text, size_t length) {
+    size_t i = 0;
+    while (i < length && !formatter->failed) {
+        WCHAR c = text[i];
+        switch (formatter->state) {
+        case XML_TEXT:
+            if (c == L'<') {
+                formatter->state = XML_OPEN;
+                i++;
+            } else if (IsSpace(c)) {
+                if (formatter->lastToken == XML_TOKEN_TEXT_INLINE || formatter->lastToken == XML_TOKEN_TEXT_BLOCK) {
+                    if (formatter->pendingLength == FORMAT_MAX_PENDING) {
+                        Emit(formatter, formatter->pending, FORMAT_MAX_PENDING);
+                        formatter->pendingLength = 0;
+                    }
+                    formatter->pending[formatter->pendingLength++] = c;
+                }
+                i++;
+            } else {
+                BeginXmlText(formatter);
+                size_t stop = FindStop(text, i + 1, length, L'<', L'<', TRUE);
+                Emit(formatter, text + i, stop - i);
+                i = stop;
+            }
+            break;
+
+        case XML_OPEN:
+            if (c == L'/') {
+                formatter->pendingLength = 0;
+                if (formatter->depth == 0) {
+                    formatter->malformed = TRUE;
+                } else {
+                    formatter->depth--;
+                }
+                // An end tag stays on the line of its start tag when only text came between them
+                if (formatter->lastToken != XML_TOKEN_OPEN && formatter->lastToken != XML_TOKEN_TEXT_INLINE) {
+                    BeginXmlLine(formatter);
+                }
+                Emit(formatter, L"</", 2);
+                formatter->state = XML_END_TAG;
+                i++;
+            } else if (c == L'!') {
+                formatter->state = XML_BANG;
+                i++;
+            } else if (c == L'?') {
+                BeginXmlMarkup(formatter);
+                Emit(formatter, L"<?", 2);
+                formatter->state = XML_PI;
+                formatter->tail = 0;
+                i++;
+            } else {
+                BeginXmlMarkup(formatter);
+                EmitChar(formatter, L'<');
+                formatter->state = XML_START_TAG;
+                formatter->tail = 0;
+            }
+            formatter->quote = 0;
+            break;
+
+        case XML_BANG:
+            formatter->prefixLength = 0;
+            if (c == L'-') {
+                formatter->state = XML_BANG_COMMENT;
+            } else if (c == L'[') {
+                formatter->state = XML_BANG_CDATA;
+            } else {
+                BeginXmlMarkup(formatter);
+                Emit(formatter, L"<!", 2);
+                formatter->state = XML_DECLARATION;
+                formatter->brackets = 0;
+            }
+            break;
+
+        case XML_BANG_COMMENT:
+        case XML_BANG_CDATA: {
+            const WCHAR* opening = g_commentOpening;
+            int openingLength = (int)(sizeof(g_commentOpening) / sizeof(WCHAR)) - 1;
+            if (formatter->state == XML_BANG_CDATA) {
+                opening = g_cdataOpening;
+                openingLength = (int)(sizeof(g_cdataOpening) / sizeof(WCHAR)) - 1;
+            }
+            if (c == opening[formatter->prefixLength]) {
+                formatter->prefixLength++;
+                i++;
+                if (formatter->prefixLength == openingLength) {
+                    if (formatter->state == XML_BANG_COMMENT) {
+                        BeginXmlMarkup(formatter);
+                        formatter->state = XML_COMMENT;
+                    } else {
+                        BeginXmlText(formatter);
+                        formatter->state = XML_CDATA;
+                    }
+                    Emit(formatter, L"<!", 2);
+                    Emit(formatter, opening, (size_t)openingLength);
+                    formatter->tail = 0;
+                }
+            } else {
+                // Not a comment or CDATA after all, so some other declaration
+                BeginXmlMarkup(formatter);
+                Emit(formatter, L"<!", 2);
+                Emit(formatter, opening, (size_t)formatter->prefixLength);
+                formatter->state = XML_DECLARATION;
+                formatter->brackets = 0;
+            }
+            break;
+        }
+
+        case XML_START_TAG:
+        case XML_END_TAG:
+            if (formatter->quote != 0) {
+                size_t stop = FindStop(text, i, length, formatter->quote, formatter->quote, FALSE);
+                Emit(formatter, text + i, stop - i);
+                i = stop;
+                if (i < length) {
+                    EmitChar(formatter, text[i]);
+                    formatter->quote = 0;
+                    formatter->tail = 0;
+                    i++;
+                }
+            } else if (IsSpace(c)) {
+                // Whitespace between attributes becomes a single space
+                formatter->pendingLength = 1;
+                i++;
+            } else {
+                if (formatter->pendingLength != 0 && c != L'>' && c != L'/') {
+                    EmitChar(formatter, L' ');
+                }
+                formatter->pendingLength = 0;
+                EmitChar(formatter, c);
+                i++;
+                if (c == L'>') {
+                    if (formatter->state == XML_END_TAG) {
+                        formatter->lastToken = XML_TOKEN_CLOSE;
+                    } else if (formatter->tail) {
+                        formatter->lastToken = XML_TOKEN_MARKUP;
+                    } else {
+                        formatter->depth++;
+                        formatter->lastToken = XML_TOKEN_OPEN;
+                    }
+                    formatter->state = XML_TEXT;
+                } else if (c == L'"' || c == L'\'') {
+                    formatter->quote = c;
+                }
+                formatter->tail = c == L'/';
+            }
+            break;
+
+        case XML_COMMENT:
+        case XML_CDATA: {
+            // Copied as they are, up to "-->" or "]]>"
+            WCHAR close = formatter->state == XML_COMMENT ? L'-' : L']';
+            if (c != close && c != L'>') {
+                size_t stop = FindStop(text, i, length, close, L'>', FALSE);
+                Emit(formatter, text + i, stop - i);
+                i = stop;
+                formatter->tail = 0;
+                break;
+            }
+            EmitChar(formatter, c);
+            i++;
+            if (c == close) {
+                formatter->tail = formatter->tail < 2 ? formatter->tail + 1 : 2;
+            } else if (formatter->tail == 2) {
+                if (formatter->state == XML_COMMENT) {
+                    formatter->lastToken = XML_TOKEN_MARKUP;
+                }
+                formatter->state = XML_TEXT;
+            } else {
+                formatter->tail = 0;
+            }
+            break;
+        }
+
+        case XML_PI:
+            EmitChar(formatter, c);
+            i++;
+            if (c == L'>' && formatter->tail) {
+                formatter->lastToken = XML_TOKEN_MARKUP;
+                formatter->state = XML_TEXT;
+            }
+            formatter->tail = c == L'?';
+            break;
+
+        case XML_DECLARATION:
+            EmitChar(formatter, c);
+            i++;
+            if (formatter->quote != 0) {
+                if (c == formatter->quote) {
+                    formatter->quote = 0;
+                }
+            } else if (c == L'"' || c == L'\'') {
+                formatter->quote = c;
+            } else if (c == L'[') {
+                formatter->brackets++;
+            } else if (c == L']') {
+                formatter->brackets--;
+            } else if (c == L'>' && formatter->brackets <= 0) {
+                formatter->lastToken = XML_TOKEN_MARKUP;
+                formatter->state = XML_TEXT;
+            }
+            break;
+        }
+    }
+}
+
+BOOL FormatFeed(Formatter* formatter, const WCHAR* text, size_t length) {
+    if (formatter->language == FORMAT_XML) {
+        FeedXml(formatter, text, length);
+    } else {
+        FeedJson(formatter, text, length);
+    }
+    return !formatter->failed;
+}
+
+BOOL FormatFinish(Formatter* formatter) {
+    // Whitespace held back after the last text is trailing, so it is dropped
+    formatter->pendingLength = 0;
+    if (formatter->depth != 0 || formatter->state != 0) {
+        formatter->malformed = TRUE;
+    }
+    FlushOutput(formatter);
+    return !formatter->failed && !formatter->malformed;
+}
+
+typedef struct FormatRangeContext {
+    Formatter* formatter;
+    Document* out;
+    size_t position;       // Where the next piece of output goes
+    size_t done;
+    size_t total;
+    size_t nextReport;
+    FormatProgress progress;
+    void* progressContext;
+} FormatRangeContext;
+
+static BOOL InsertIntoDocument(const WCHAR* text, size_t length, void* context) {
+    FormatRangeContext* range = (FormatRangeContext*)context;
+    if (!DocReplace(range->out, range->position, range->position, text, length)) {
+        return FALSE;
+    }
+    range->position += length;
+    return TRUE;
+}
+
+static BOOL FormatChunk(const WCHAR* text, size_t length, size_t offset, void* context) {
+    FormatRangeContext* range = (FormatRangeContext*)context;
+    (void)offset;
+    if (!FormatFeed(range->formatter, text, length)) {
+        return FALSE;
+    }
+    range->done += length;
+    if (range->progress != NULL && range->done >= range->nextReport) {
+        range->progress(range->done, range->total, range->progressContext);
+        range->nextReport = range->done + FORMAT_PROGRESS_UNITS;
+    }
+    return TRUE;
+}
+
+BOOL FormatDocumentRange(const Document* doc, size_t start, size_t end, int language, BOOL minify, int indentWidth,
+    Document* out, size_t position, size_t* written, FormatProgress progress, void* progressContext, BOOL* malformed) {
+    Formatter* formatter = (Formatter*)MemAlloc(MEM_SCRATCH, sizeof(Formatter));
+    if (formatter == NULL) {
+        return FALSE;
+    }
+
+    FormatRangeContext range;
+    range.formatter = formatter;
+    range.out = out;
+    range.position = position;
+    range.done = 0;
+    range.total = end - start;
+    range.nextReport = FORMAT_PROGRESS_UNITS;
+    range.progress = progress;
+    range.progressContext = progressContext;
+    FormatInit(formatter, language, minify, indentWidth, InsertIntoDocument, &range);
+    DocForEachChunk(doc, start, end, FormatChunk, &range);
+
+    BOOL result = FormatFinish(formatter);
+    if (written != NULL) {
+        *written = range.position - position;
+    }
+    if (malformed != NULL) {
+        *malformed = formatter->malformed;
+    }
+    MemFree(formatter);
+    return result;
+}
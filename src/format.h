@@ -0,0 +1,75 @@
+// CyCharm : Streaming JSON and XML pretty-printer and minifier
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_FORMAT_H
+#define CYCHARM_FORMAT_H
+
+#include <windows.h>
+#include "document.h"
+
+// Languages
+#define FORMAT_JSON 0
+#define FORMAT_XML 1
+
+// Output is handed on in pieces of this many UTF-16 units, one document chunk each
+#define FORMAT_OUTPUT_UNITS DOC_CHUNK_SIZE
+
+// Whitespace inside XML text held back in case it ends the text; longer runs are written out as they are
+#define FORMAT_MAX_PENDING 256
+
+// JSON nesting whose opening brackets are remembered, so a '}' closing a '[' is caught; deeper
+// nesting is still balanced but its closing brackets are not matched against their kinds
+#define FORMAT_JSON_KIND_DEPTH 4096
+
+// Input between progress reports, in UTF-16 units
+#define FORMAT_PROGRESS_UNITS 4194304
+
+// Receives formatted output; return FALSE to stop
+typedef BOOL (*FormatSink)(const WCHAR* text, size_t length, void* context);
+
+// Receives how much of the input has been formatted
+typedef void (*FormatProgress)(size_t done, size_t total, void* context);
+
+// A formatter that takes its input in pieces of any size, so it never needs the whole text at once.
+// It keeps only its nesting (depth, and for JSON the kind of each bracket) and where it is within a
+// token, and allocates nothing.
+typedef struct Formatter {
+    int language;
+    BOOL minify;
+    int indentWidth;
+    FormatSink sink;
+    void* context;
+    BOOL failed;                       // The sink refused output
+    BOOL malformed;                    // Unbalanced or mismatched nesting, or the input ended inside a token
+    BOOL wroteAny;
+    int depth;
+    int state;                         // Where the input is: within a string, a tag, a comment...
+    BOOL pendingOpen;                  // JSON: an object or array was opened and nothing is in it yet
+    BOOL topBreak;                     // JSON: a line break separates top-level values
+    BYTE arrays[FORMAT_JSON_KIND_DEPTH / 8]; // JSON: one bit per depth, set where a '[' is open
+    int lastToken;                     // XML: the kind of the last token written
+    int prefixLength;                  // XML: units of "<!" matched against a comment or CDATA opening
+    int tail;                          // XML: units of a closing "-->", "]]>" or "?>" seen so far
+    int brackets;                      // XML: '[' open in a DOCTYPE declaration
+    WCHAR quote;                       // XML: quote character of the attribute value being copied
+    WCHAR pending[FORMAT_MAX_PENDING]; // XML: whitespace after text
+    int pendingLength;                 // XML: units in pending, or within a tag, 1 if a space is owed
+    WCHAR out[FORMAT_OUTPUT_UNITS];
+    size_t outLength;
+} Formatter;
+
+// Guess the language of a text from its first character that is not whitespace
+int FormatDetectLanguage(const WCHAR* text, size_t length);
+
+void FormatInit(Formatter* formatter, int language, BOOL minify, int indentWidth, FormatSink sink, void* context);
+BOOL FormatFeed(Formatter* formatter, const WCHAR* text, size_t length);
+
+// Write out the rest of the output; returns FALSE if the sink failed or the input was malformed
+BOOL FormatFinish(Formatter* formatter);
+
+// Format [start, end) of a document and insert the result into out at position, a chunk at a time,
+// storing its length in written and reporting progress as it goes
+BOOL FormatDocumentRange(const Document* doc, size_t start, size_t end, int language, BOOL minify, int indentWidth,
+    Document* out, size_t position, size_t* written, FormatProgress progress, void* progressContext, BOOL* malformed);
+
+#endif
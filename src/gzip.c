@@ -0,0 +1,621 @@
+// CyCharm : Streaming gzip decompression with seek points, and writing gzip files
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "gzip.h"
+#include "compress.h"
+#include "memory.h"
+
+// Where the inflater is
+#define INFLATE_MEMBER 0  // Before a member's gzip header
+#define INFLATE_BLOCK 1   // Before a block header
+#define INFLATE_STORED 2  // Within an uncompressed block
+#define INFLATE_CODES 3   // Within a Huffman-coded block
+#define INFLATE_TRAILER 4 // After a member's last block
+#define INFLATE_DONE 5
+
+#define INFLATE_WINDOW_MASK (INFLATE_WINDOW - 1)
+#define GZIP_STORED_BLOCK 65535
+
+// Header flags
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+#define GZIP_FRESERVED 0xE0
+
+static const unsigned short g_lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const unsigned char g_lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short g_distanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577
+};
+static const unsigned char g_distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Order code length code lengths are stored in
+static const unsigned char g_codeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static DWORD g_crcTable[256];
+static BOOL g_crcTableReady = FALSE;
+
+DWORD GzipCrc32(DWORD crc, const void* data, size_t size) {
+    if (!g_crcTableReady) {
+        for (DWORD n = 0; n < 256; n++) {
+            DWORD c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+            }
+            g_crcTable[n] = c;
+        }
+        g_crcTableReady = TRUE;
+    }
+
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = g_crcTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+BOOL GzipIsCompressed(const unsigned char* bytes, size_t size) {
+    return size >= 3 && bytes[0] == 0x1F && bytes[1] == 0x8B && bytes[2] == 8;
+}
+
+void InflateInit(Inflater* inflater, const unsigned char* input, size_t size) {
+    ZeroMemory(inflater, sizeof(Inflater));
+    inflater->input = input;
+    inflater->inputSize = size;
+    inflater->state = INFLATE_MEMBER;
+    inflater->pointAt = ~0ULL;
+}
+
+// Function to top the bit buffer up to at least 56 bits; past the end of the input it reads zeros,
+// which InflateOverrun catches once they are used
+static void InflateRefill(Inflater* inflater) {
+    if (inflater->inputPosition + 8 <= inflater->inputSize) {
+        // Load a whole word; bits above the new count belong to the next byte, which is loaded again
+        // in the same place later, so they do no harm
+        unsigned long long word;
+        memcpy(&word, inflater->input + inflater->inputPosition, sizeof(word));
+        inflater->bitBuffer |= word << inflater->bitCount;
+        inflater->inputPosition += (size_t)((63 - inflater->bitCount) >> 3);
+        inflater->bitCount |= 56;
+        return;
+    }
+    while (inflater->bitCount <= 56) {
+        unsigned long long byte = inflater->inputPosition < inflater->inputSize ? inflater->input[inflater->inputPosition] : 0;
+        inflater->bitBuffer |= byte << inflater->bitCount;
+        inflater->inputPosition++;
+        inflater->bitCount += 8;
+    }
+}
+
+// Function to tell whether more bits were used than the input has
+static BOOL InflateOverrun(const Inflater* inflater) {
+    return (unsigned long long)inflater->inputPosition * 8 - (unsigned long long)inflater->bitCount >
+        (unsigned long long)inflater->inputSize * 8;
+}
+
+static unsigned int InflateBits(Inflater* inflater, int count) {
+    if (inflater->bitCount < count) {
+        InflateRefill(inflater);
+    }
+    unsigned int value = (unsigned int)(inflater->bitBuffer & ((1ULL << count) - 1));
+    inflater->bitBuffer >>= count;
+    inflater->bitCount -= count;
+    return value;
+}
+
+// Function to skip to the next byte boundary and hand the whole bytes still in the bit buffer back
+// to the input, so bytes can be read from it directly
+static void InflateAlign(Inflater* inflater) {
+    inflater->inputPosition -= (size_t)(inflater->bitCount >> 3);
+    inflater->bitBuffer = 0;
+    inflater->bitCount = 0;
+}
+
+// Function to build the decoding tables for a set of code lengths; FALSE if the lengths describe
+// more codes than fit. An incomplete set is accepted, and a missing code fails when it is decoded.
+static BOOL InflateBuild(InflateHuffman* huffman, const unsigned char* lengths, int count) {
+    unsigned short offsets[16];
+    ZeroMemory(huffman->count, sizeof(huffman->count));
+    ZeroMemory(huffman->fast, sizeof(huffman->fast));
+    for (int i = 0; i < count; i++) {
+        huffman->count[lengths[i]]++;
+    }
+    huffman->count[0] = 0;
+
+    int left = 1;
+    for (int length = 1; length <= 15; length++) {
+        left = (left << 1) - huffman->count[length];
+        if (left < 0) {
+            return FALSE;
+        }
+    }
+
+    offsets[1] = 0;
+    for (int length = 1; length < 15; length++) {
+        offsets[length + 1] = (unsigned short)(offsets[length] + huffman->count[length]);
+    }
+    for (int i = 0; i < count; i++) {
+        if (lengths[i] != 0) {
+            huffman->symbol[offsets[lengths[i]]++] = (unsigned short)i;
+        }
+    }
+
+    // Codes are assigned in order of length, then symbol; each short one fills every table entry
+    // whose low bits are its code, which is stored bit-reversed
+    unsigned int code = 0;
+    int index = 0;
+    for (int length = 1; length <= INFLATE_FAST_BITS; length++) {
+        for (int k = 0; k < huffman->count[length]; k++, index++, code++) {
+            unsigned int reversed = 0;
+            for (int bit = 0; bit < length; bit++) {
+                reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+            }
+            unsigned short entry = (unsigned short)((huffman->symbol[index] << 4) | length);
+            for (unsigned int j = reversed; j < (1U << INFLATE_FAST_BITS); j += 1U << length) {
+                huffman->fast[j] = entry;
+            }
+        }
+        code <<= 1;
+    }
+    return TRUE;
+}
+
+// Function to decode one symbol; -1 if the bits are not a code
+static int InflateDecode(Inflater* inflater, const InflateHuffman* huffman) {
+    if (inflater->bitCount < 15) {
+        InflateRefill(inflater);
+    }
+    unsigned int entry = huffman->fast[inflater->bitBuffer & ((1U << INFLATE_FAST_BITS) - 1)];
+    if (entry != 0) {
+        int length = (int)(entry & 15);
+        inflater->bitBuffer >>= length;
+        inflater->bitCount -= length;
+        return (int)(entry >> 4);
+    }
+
+    // A longer code, found a bit at a time by counting codes of each length
+    unsigned long long bits = inflater->bitBuffer;
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int length = 1; length <= 15; length++) {
+        code |= (int)(bits & 1);
+        bits >>= 1;
+        int count = huffman->count[length];
+        if (code - count < first) {
+            inflater->bitBuffer >>= length;
+            inflater->bitCount -= length;
+            return huffman->symbol[index + (code - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+// Function to set up the fixed codes of a block of type 1
+static void InflateFixedCodes(Inflater* inflater) {
+    unsigned char lengths[288];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 112);
+    memset(lengths + 256, 7, 24);
+    memset(lengths + 280, 8, 8);
+    InflateBuild(&inflater->lengths, lengths, 288);
+    memset(lengths, 5, 30);
+    InflateBuild(&inflater->distances, lengths, 30);
+}
+
+// Function to read the code lengths of a block of type 2 and set up its codes
+static BOOL InflateDynamicCodes(Inflater* inflater) {
+    int literalCount = (int)InflateBits(inflater, 5) + 257;
+    int distanceCount = (int)InflateBits(inflater, 5) + 1;
+    int lengthCount = (int)InflateBits(inflater, 4) + 4;
+    if (literalCount > 286 || distanceCount > 30) {
+        return FALSE;
+    }
+
+    unsigned char lengths[286 + 30];
+    ZeroMemory(lengths, 19);
+    for (int i = 0; i < lengthCount; i++) {
+        lengths[g_codeLengthOrder[i]] = (unsigned char)InflateBits(inflater, 3);
+    }
+    InflateHuffman lengthCodes;
+    if (!InflateBuild(&lengthCodes, lengths, 19)) {
+        return FALSE;
+    }
+
+    int total = literalCount + distanceCount;
+    int i = 0;
+    while (i < total) {
+        int symbol = InflateDecode(inflater, &lengthCodes);
+        if (symbol < 0) {
+            return FALSE;
+        }
+        if (symbol < 16) {
+            lengths[i++] = (unsigned char)symbol;
+            continue;
+        }
+
+        unsigned char repeated = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (i == 0) {
+                return FALSE;
+            }
+            repeated = lengths[i - 1];
+            repeat = 3 + (int)InflateBits(inflater, 2);
+        } else if (symbol == 17) {
+            repeat = 3 + (int)InflateBits(inflater, 3);
+        } else {
+            repeat = 11 + (int)InflateBits(inflater, 7);
+        }
+        if (i + repeat > total) {
+            return FALSE;
+        }
+        memset(lengths + i, repeated, (size_t)repeat);
+        i += repeat;
+    }
+
+    // A block that cannot end is not valid
+    if (lengths[256] == 0) {
+        return FALSE;
+    }
+    return InflateBuild(&inflater->lengths, lengths, literalCount) &&
+        InflateBuild(&inflater->distances, lengths + literalCount, distanceCount);
+}
+
+// Function to read a member's gzip header, which starts at a byte boundary
+static BOOL InflateMemberHeader(Inflater* inflater) {
+    const unsigned char* p = inflater->input + inflater->inputPosition;
+    size_t left = inflater->inputPosition <= inflater->inputSize ? inflater->inputSize - inflater->inputPosition : 0;
+    if (left < 18 || !GzipIsCompressed(p, left) || (p[3] & GZIP_FRESERVED) != 0) {
+        return FALSE;
+    }
+
+    unsigned char flags = p[3];
+    size_t i = 10;
+    if (flags & GZIP_FEXTRA) {
+        i += 2 + (size_t)(p[10] | (p[11] << 8));
+    }
+    if (flags & GZIP_FNAME) {
+        while (i < left && p[i] != 0) {
+            i++;
+        }
+        i++;
+    }
+    if (flags & GZIP_FCOMMENT) {
+        while (i < left && p[i] != 0) {
+            i++;
+        }
+        i++;
+    }
+    if (flags & GZIP_FHCRC) {
+        i += 2;
+    }
+    if (i > left) {
+        return FALSE;
+    }
+    inflater->inputPosition += i;
+    return TRUE;
+}
+
+static DWORD InflateRead32(const unsigned char* p) {
+    return (DWORD)p[0] | ((DWORD)p[1] << 8) | ((DWORD)p[2] << 16) | ((DWORD)p[3] << 24);
+}
+
+// Function to copy as much of a pending back-reference as fits; history before this call's output
+// comes from the window, which holds the output before base
+static size_t InflateCopyMatch(Inflater* inflater, unsigned char* out, size_t produced, size_t capacity,
+    unsigned long long base) {
+    size_t count = (size_t)inflater->matchLength;
+    if (count > capacity - produced) {
+        count = capacity - produced;
+    }
+    size_t distance = (size_t)inflater->matchDistance;
+    unsigned char* to = out + produced;
+    if (distance <= produced) {
+        const unsigned char* from = to - distance;
+        if (distance >= count) {
+            memcpy(to, from, count);
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                to[i] = from[i];
+            }
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            size_t at = produced + i;
+            to[i] = at >= distance ? out[at - distance] :
+                inflater->window[(size_t)(base + at - distance) & INFLATE_WINDOW_MASK];
+        }
+    }
+    inflater->matchLength -= (int)count;
+    return count;
+}
+
+size_t InflateRead(Inflater* inflater, unsigned char* out, size_t capacity) {
+    unsigned long long base = inflater->totalOut;
+    size_t produced = 0;
+    size_t memberFrom = 0; // Where this call's output of the current member starts
+    inflater->atPoint = FALSE;
+
+    while (produced < capacity && !inflater->failed && !inflater->atPoint && inflater->state != INFLATE_DONE) {
+        switch (inflater->state) {
+        case INFLATE_MEMBER:
+            if (InflateMemberHeader(inflater)) {
+                inflater->state = INFLATE_BLOCK;
+            } else if (inflater->inputPosition == 0) {
+                inflater->failed = TRUE;
+            } else {
+                // Padding or other bytes after the last member are ignored, as gzip does
+                inflater->state = INFLATE_DONE;
+            }
+            break;
+
+        case INFLATE_BLOCK: {
+            if (inflater->lastBlock) {
+                inflater->state = INFLATE_TRAILER;
+                break;
+            }
+            if (base + produced >= inflater->pointAt) {
+                inflater->atPoint = TRUE;
+                break;
+            }
+
+            inflater->lastBlock = InflateBits(inflater, 1);
+            unsigned int type = InflateBits(inflater, 2);
+            if (type == 0) {
+                InflateAlign(inflater);
+                if (inflater->inputPosition > inflater->inputSize || inflater->inputSize - inflater->inputPosition < 4) {
+                    inflater->failed = TRUE;
+                    break;
+                }
+                const unsigned char* p = inflater->input + inflater->inputPosition;
+                unsigned int length = p[0] | (p[1] << 8);
+                if ((length ^ (p[2] | (p[3] << 8))) != 0xFFFF) {
+                    inflater->failed = TRUE;
+                    break;
+                }
+                inflater->inputPosition += 4;
+                inflater->storedLeft = length;
+                inflater->state = INFLATE_STORED;
+            } else if (type == 1) {
+                InflateFixedCodes(inflater);
+                inflater->state = INFLATE_CODES;
+            } else if (type == 2 && InflateDynamicCodes(inflater)) {
+                inflater->state = INFLATE_CODES;
+            } else {
+                inflater->failed = TRUE;
+            }
+            break;
+        }
+
+        case INFLATE_STORED: {
+            size_t count = inflater->storedLeft < capacity - produced ? inflater->storedLeft : capacity - produced;
+            if (inflater->inputSize - inflater->inputPosition < count) {
+                inflater->failed = TRUE;
+                break;
+            }
+            memcpy(out + produced, inflater->input + inflater->inputPosition, count);
+            inflater->inputPosition += count;
+            inflater->storedLeft -= count;
+            produced += count;
+            if (inflater->storedLeft == 0) {
+                inflater->state = INFLATE_BLOCK;
+            }
+            break;
+        }
+
+        case INFLATE_CODES:
+            while (produced < capacity) {
+                if (inflater->matchLength > 0) {
+                    produced += InflateCopyMatch(inflater, out, produced, capacity, base);
+                    continue;
+                }
+                if (inflater->inputPosition > inflater->inputSize && InflateOverrun(inflater)) {
+                    inflater->failed = TRUE;
+                    break;
+                }
+
+                int symbol = InflateDecode(inflater, &inflater->lengths);
+                if (symbol < 256) {
+                    if (symbol < 0) {
+                        inflater->failed = TRUE;
+                        break;
+                    }
+                    out[produced++] = (unsigned char)symbol;
+                    continue;
+                }
+                if (symbol == 256) {
+                    inflater->state = INFLATE_BLOCK;
+                    break;
+                }
+
+                symbol -= 257;
+                if (symbol >= 29) {
+                    inflater->failed = TRUE;
+                    break;
+                }
+                int length = g_lengthBase[symbol] + (int)InflateBits(inflater, g_lengthExtra[symbol]);
+                int distanceSymbol = InflateDecode(inflater, &inflater->distances);
+                if (distanceSymbol < 0 || distanceSymbol >= 30) {
+                    inflater->failed = TRUE;
+                    break;
+                }
+                int distance = g_distanceBase[distanceSymbol] + (int)InflateBits(inflater, g_distanceExtra[distanceSymbol]);
+
+                // A back-reference cannot reach before the start of its member
+                if (inflater->memberOut + (produced - memberFrom) < (unsigned long long)distance) {
+                    inflater->failed = TRUE;
+                    break;
+                }
+                inflater->matchLength = length;
+                inflater->matchDistance = distance;
+            }
+            break;
+
+        case INFLATE_TRAILER: {
+            InflateAlign(inflater);
+            if (inflater->inputPosition > inflater->inputSize || inflater->inputSize - inflater->inputPosition < 8) {
+                inflater->failed = TRUE;
+                break;
+            }
+            DWORD crc = GzipCrc32(inflater->crc, out + memberFrom, produced - memberFrom);
+            unsigned long long memberOut = inflater->memberOut + (produced - memberFrom);
+            const unsigned char* p = inflater->input + inflater->inputPosition;
+            if (InflateRead32(p) != crc || InflateRead32(p + 4) != (DWORD)memberOut) {
+                inflater->failed = TRUE;
+                break;
+            }
+            inflater->inputPosition += 8;
+            inflater->crc = 0;
+            inflater->memberOut = 0;
+            inflater->lastBlock = FALSE;
+            memberFrom = produced;
+            inflater->state = INFLATE_MEMBER;
+            break;
+        }
+        }
+    }
+
+    if (InflateOverrun(inflater)) {
+        inflater->failed = TRUE;
+    }
+
+    // Carry the member's checksum and length over, and keep the last of the output as history
+    inflater->crc = GzipCrc32(inflater->crc, out + memberFrom, produced - memberFrom);
+    inflater->memberOut += produced - memberFrom;
+    size_t kept = produced < INFLATE_WINDOW ? produced : INFLATE_WINDOW;
+    for (size_t i = produced - kept; i < produced;) {
+        size_t at = (size_t)(base + i) & INFLATE_WINDOW_MASK;
+        size_t count = INFLATE_WINDOW - at < produced - i ? INFLATE_WINDOW - at : produced - i;
+        memcpy(inflater->window + at, out + i, count);
+        i += count;
+    }
+    inflater->totalOut = base + produced;
+    return produced;
+}
+
+BOOL InflateFinished(const Inflater* inflater) {
+    return inflater->state == INFLATE_DONE;
+}
+
+size_t InflateInputPosition(const Inflater* inflater) {
+    size_t position = inflater->inputPosition - (size_t)(inflater->bitCount >> 3);
+    return position < inflater->inputSize ? position : inflater->inputSize;
+}
+
+// Function to copy the window's history into a straight run, oldest byte first
+static void InflateUnwindow(const Inflater* inflater, unsigned char* out, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        out[i] = inflater->window[(size_t)(inflater->totalOut - length + i) & INFLATE_WINDOW_MASK];
+    }
+}
+
+BOOL InflateSavePoint(const Inflater* inflater, InflatePoint* point) {
+    size_t length = inflater->totalOut < INFLATE_WINDOW ? (size_t)inflater->totalOut : INFLATE_WINDOW;
+    unsigned char* history = (unsigned char*)MemAlloc(MEM_SCRATCH, length + 1);
+    unsigned char* window = (unsigned char*)MemAlloc(MEM_INDEX, LzCompressBound(length));
+    if (history == NULL || window == NULL) {
+        MemFree(history);
+        MemFree(window);
+        return FALSE;
+    }
+    InflateUnwindow(inflater, history, length);
+    size_t size = LzCompress(history, length, window, LzCompressBound(length));
+    MemFree(history);
+
+    unsigned char* shrunk = (unsigned char*)MemRealloc(MEM_INDEX, window, size + 1);
+    point->window = shrunk != NULL ? shrunk : window;
+    point->windowSize = size;
+    point->windowLength = length;
+    point->out = inflater->totalOut;
+    point->bitOffset = (unsigned long long)inflater->inputPosition * 8 - (unsigned long long)inflater->bitCount;
+    point->crc = inflater->crc;
+    point->memberOut = inflater->memberOut;
+    return TRUE;
+}
+
+void InflateFreePoint(InflatePoint* point) {
+    MemFree(point->window);
+    point->window = NULL;
+}
+
+BOOL InflateSeek(Inflater* inflater, const InflatePoint* point) {
+    unsigned char* history = (unsigned char*)MemAlloc(MEM_SCRATCH, point->windowLength + 1);
+    if (history == NULL) {
+        return FALSE;
+    }
+    if (!LzDecompress(point->window, point->windowSize, history, point->windowLength)) {
+        MemFree(history);
+        return FALSE;
+    }
+
+    InflateInit(inflater, inflater->input, inflater->inputSize);
+    inflater->state = INFLATE_BLOCK;
+    inflater->totalOut = point->out;
+    inflater->crc = point->crc;
+    inflater->memberOut = point->memberOut;
+    for (size_t i = 0; i < point->windowLength; i++) {
+        inflater->window[(size_t)(point->out - point->windowLength + i) & INFLATE_WINDOW_MASK] = history[i];
+    }
+    MemFree(history);
+
+    inflater->inputPosition = (size_t)(point->bitOffset >> 3);
+    InflateBits(inflater, (int)(point->bitOffset & 7));
+    return TRUE;
+}
+
+size_t GzipStoredSize(size_t size) {
+    size_t blocks = size == 0 ? 1 : (size + GZIP_STORED_BLOCK - 1) / GZIP_STORED_BLOCK;
+    return 10 + blocks * 5 + size + 8;
+}
+
+static void GzipWrite32(unsigned char* p, DWORD value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+size_t GzipStore(const void* data, size_t size, void* out) {
+    const unsigned char* in = (const unsigned char*)data;
+    unsigned char* p = (unsigned char*)out;
+
+    // No name or time is recorded; the operating system is "unknown"
+    static const unsigned char header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+    memcpy(p, header, sizeof(header));
+    p += sizeof(header);
+
+    size_t offset = 0;
+    do {
+        size_t length = size - offset < GZIP_STORED_BLOCK ? size - offset : GZIP_STORED_BLOCK;
+        *p++ = offset + length == size ? 1 : 0; // Final bit, block type 0, padding to the byte
+        p[0] = (unsigned char)length;
+        p[1] = (unsigned char)(length >> 8);
+        p[2] = (unsigned char)~length;
+        p[3] = (unsigned char)(~length >> 8);
+        memcpy(p + 4, in + offset, length);
+        p += 4 + length;
+        offset += length;
+    } while (offset < size);
+
+    GzipWrite32(p, GzipCrc32(0, data, size));
+    GzipWrite32(p + 4, (DWORD)size);
+    p += 8;
+    return (size_t)(p - (unsigned char*)out);
+}
@@ -0,0 +1,87 @@
+// CyCharm : Streaming gzip decompression with seek points, and writing gzip files
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_GZIP_H
+#define CYCHARM_GZIP_H
+
+#include <windows.h>
+
+// Back-references reach at most this far into the output
+#define INFLATE_WINDOW 32768
+
+// Codes up to this many bits are decoded with one table lookup; longer ones bit by bit
+#define INFLATE_FAST_BITS 10
+
+typedef struct InflateHuffman {
+    unsigned short fast[1 << INFLATE_FAST_BITS]; // Symbol << 4 | code length, 0 if the code is longer
+    unsigned short count[16];                    // Codes of each length
+    unsigned short symbol[288];                  // Symbols in code order
+} InflateHuffman;
+
+// Where decompression can start again without the output before it: a block boundary, with the
+// output window as it was there kept compressed
+typedef struct InflatePoint {
+    unsigned long long out;       // Output bytes before the point
+    unsigned long long bitOffset; // Input bit the next block header starts at
+    DWORD crc;                    // CRC-32 of the member's output so far
+    unsigned long long memberOut; // Output bytes of the member so far
+    unsigned char* window;        // Last windowLength output bytes, compressed
+    size_t windowSize;
+    size_t windowLength;
+} InflatePoint;
+
+// A decompressor for gzip data that is all in memory (a mapped file), producing its output in
+// pieces of any size. Several members one after another decompress as one stream, as with gzip -d.
+typedef struct Inflater {
+    const unsigned char* input;
+    size_t inputSize;
+    size_t inputPosition;          // Next byte to load into the bit buffer
+    unsigned long long bitBuffer;
+    int bitCount;
+    int state;
+    BOOL lastBlock;
+    size_t storedLeft;             // Bytes left of a stored block
+    int matchLength;               // A back-reference cut short by the end of the output
+    int matchDistance;
+    InflateHuffman lengths;
+    InflateHuffman distances;
+    unsigned long long totalOut;
+    DWORD crc;                     // CRC-32 of the member's output before this call
+    unsigned long long memberOut;  // Output bytes of the member before this call
+    unsigned long long pointAt;    // Stop at the first block boundary at or after this much output
+    BOOL atPoint;                  // Stopped at such a boundary; InflateSavePoint can record it
+    BOOL failed;                   // The data is damaged or cut short
+    unsigned char window[INFLATE_WINDOW];
+} Inflater;
+
+// Tell whether bytes start like a gzip file
+BOOL GzipIsCompressed(const unsigned char* bytes, size_t size);
+
+void InflateInit(Inflater* inflater, const unsigned char* input, size_t size);
+
+// Decompress up to capacity bytes into out, returning how many were written. Fewer than capacity
+// means the data ended, failed, or a block boundary at pointAt was reached (atPoint is set).
+size_t InflateRead(Inflater* inflater, unsigned char* out, size_t capacity);
+
+// Tell whether everything has been decompressed
+BOOL InflateFinished(const Inflater* inflater);
+
+// Input bytes consumed so far
+size_t InflateInputPosition(const Inflater* inflater);
+
+// Record where the inflater is stopped (atPoint set), allocating its window from the index subsystem
+BOOL InflateSavePoint(const Inflater* inflater, InflatePoint* point);
+void InflateFreePoint(InflatePoint* point);
+
+// Resume decompression at a recorded point
+BOOL InflateSeek(Inflater* inflater, const InflatePoint* point);
+
+DWORD GzipCrc32(DWORD crc, const void* data, size_t size);
+
+// Size of the gzip file GzipStore writes for size bytes
+size_t GzipStoredSize(size_t size);
+
+// Write data as a gzip file of uncompressed (stored) blocks, returning its size
+size_t GzipStore(const void* data, size_t size, void* out);
+
+#endif
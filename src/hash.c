@@ -0,0 +1,71 @@
+// CyCharm : Composable content hashing for the document model
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include "hash.h"
+
+// Function to multiply two residues modulo 2^61 - 1 using only 64-bit arithmetic
+static unsigned long long HashMultiply(unsigned long long a, unsigned long long b) {
+    unsigned long long aLow = a & 0xFFFFFFFFULL, aHigh = a >> 32;
+    unsigned long long bLow = b & 0xFFFFFFFFULL, bHigh = b >> 32;
+    unsigned long long low = aLow * bLow;
+    unsigned long long middle = aLow * bHigh + aHigh * bLow;
+    unsigned long long high = aHigh * bHigh;
+
+    // 2^64 = 2^3 and 2^61 = 1 modulo the prime, so every part folds down by its bit position
+    unsigned long long result = (low & HASH_MODULUS) + (low >> 61) + (high << 3) + (middle >> 29) +
+        ((middle << 35) >> 3) + 1;
+    result = (result & HASH_MODULUS) + (result >> 61);
+    result = (result & HASH_MODULUS) + (result >> 61);
+    return result - 1;
+}
+
+static unsigned long long HashAdd(unsigned long long a, unsigned long long b) {
+    unsigned long long sum = a + b;
+    return sum >= HASH_MODULUS ? sum - HASH_MODULUS : sum;
+}
+
+ContentHash HashEmpty(void) {
+    ContentHash hash = { 0, 1 };
+    return hash;
+}
+
+// Function to hash a run of text with Horner's rule
+// Four units are folded per step so the multiplications of one step do not wait on each other
+ContentHash HashText(const WCHAR* text, size_t length) {
+    // HASH_BASE squared, cubed and to the fourth, modulo the prime
+    const unsigned long long base2 = 0x1BD5C50408BF9928ULL;
+    const unsigned long long base3 = 0x060B3363CFECFF39ULL;
+    const unsigned long long base4 = 0x0CC732BAB6C24B94ULL;
+
+    unsigned long long value = 0;
+    unsigned long long power = 1;
+    size_t i = 0;
+
+    // Units are offset by one so a run of NUL characters still changes the hash
+    for (; i + 4 <= length; i += 4) {
+        unsigned long long part = HashAdd(
+            HashAdd(HashMultiply(text[i] + 1ULL, base3), HashMultiply(text[i + 1] + 1ULL, base2)),
+            HashAdd(HashMultiply(text[i + 2] + 1ULL, HASH_BASE), text[i + 3] + 1ULL));
+        value = HashAdd(HashMultiply(value, base4), part);
+        power = HashMultiply(power, base4);
+    }
+    for (; i < length; i++) {
+        value = HashAdd(HashMultiply(value, HASH_BASE), text[i] + 1ULL);
+        power = HashMultiply(power, HASH_BASE);
+    }
+
+    ContentHash hash = { value, power };
+    return hash;
+}
+
+ContentHash HashCombine(ContentHash left, ContentHash right) {
+    ContentHash hash;
+    hash.value = HashAdd(HashMultiply(left.value, right.power), right.value);
+    hash.power = HashMultiply(left.power, right.power);
+    return hash;
+}
+
+BOOL HashEqual(ContentHash a, ContentHash b) {
+    return a.value == b.value && a.power == b.power;
+}
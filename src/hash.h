@@ -0,0 +1,30 @@
+// CyCharm : Composable content hashing for the document model
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_HASH_H
+#define CYCHARM_HASH_H
+
+#include <windows.h>
+
+// Polynomial hash modulo the Mersenne prime 2^61 - 1. Unlike a streaming hash such as xxHash,
+// the hash of a concatenation can be computed from the hashes of its parts, so a tree of chunks
+// hashes to the same value however the text happens to be split.
+#define HASH_MODULUS 0x1FFFFFFFFFFFFFFFULL
+#define HASH_BASE 0x0D6E8FEB86659FD9ULL
+
+typedef struct ContentHash {
+    unsigned long long value;
+    unsigned long long power;  // HASH_BASE raised to the text length, needed to combine
+} ContentHash;
+
+// Hash of the empty text
+ContentHash HashEmpty(void);
+
+ContentHash HashText(const WCHAR* text, size_t length);
+
+// Hash of left's text followed by right's text
+ContentHash HashCombine(ContentHash left, ContentHash right);
+
+BOOL HashEqual(ContentHash a, ContentHash b);
+
+#endif
@@ -0,0 +1,617 @@
+// CyCharm : Line operations - sort, unique, reverse and filter over a block of text
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include <float.h>
+#include "memory.h"
+#include "lines.h"
+
+// Runs of at most this many lines are sorted by insertion
+#define LINES_INSERTION_RUN 16
+
+// Larger exponents already overflow a double to infinity, or underflow it to zero
+#define LINES_MAX_EXPONENT 400
+
+// Work on lines [begin, end) of one slice
+typedef void (*LinesTaskProc)(LineSet* set, int slice, size_t begin, size_t end, void* context);
+
+typedef struct LinesTask {
+    LinesTaskProc proc;
+    LineSet* set;
+    int slice;
+    size_t begin;
+    size_t end;
+    void* context;
+} LinesTask;
+
+// A piece of one merge round: a[aStart, aEnd) and a[bStart, bEnd) merged to out onwards
+typedef struct LinesMergePiece {
+    size_t aStart;
+    size_t aEnd;
+    size_t bStart;
+    size_t bEnd;
+    size_t out;
+} LinesMergePiece;
+
+typedef struct LinesSortContext {
+    const WCHAR* text;
+    int order;
+    LineRef* source;
+    LineRef* target;
+    LinesMergePiece pieces[3 * LINES_MAX_THREADS];
+} LinesSortContext;
+
+static WCHAR LinesFold(WCHAR c) {
+    return c >= L'A' && c <= L'Z' ? (WCHAR)(c + (L'a' - L'A')) : c;
+}
+
+static BOOL LinesIsDigit(WCHAR c) {
+    return c >= L'0' && c <= L'9';
+}
+
+// Function to pick the number of threads for an amount of work
+static int LinesThreadCount(size_t work) {
+    if (work < LINES_PARALLEL_THRESHOLD) {
+        return 1;
+    }
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int threads = (int)info.dwNumberOfProcessors;
+    return threads < 1 ? 1 : (threads > LINES_MAX_THREADS ? LINES_MAX_THREADS : threads);
+}
+
+static size_t LinesSliceStart(size_t count, int threads, int slice) {
+    return (size_t)((unsigned long long)count * (unsigned)slice / (unsigned)threads);
+}
+
+static DWORD WINAPI LinesTaskThread(LPVOID param) {
+    LinesTask* task = (LinesTask*)param;
+    task->proc(task->set, task->slice, task->begin, task->end, task->context);
+    return 0;
+}
+
+// Function to run a task over [0, count) in even slices, one per thread
+// The calling thread takes the first slice, and any slice whose thread cannot be started
+static void LinesRunParallel(LineSet* set, size_t count, int threads, LinesTaskProc proc, void* context) {
+    LinesTask tasks[LINES_MAX_THREADS];
+    HANDLE handles[LINES_MAX_THREADS];
+    int started = 0;
+
+    for (int i = 0; i < threads; i++) {
+        tasks[i].proc = proc;
+        tasks[i].set = set;
+        tasks[i].slice = i;
+        tasks[i].begin = LinesSliceStart(count, threads, i);
+        tasks[i].end = LinesSliceStart(count, threads, i + 1);
+        tasks[i].context = context;
+    }
+    for (int i = 1; i < threads; i++) {
+        handles[started] = CreateThread(NULL, 0, LinesTaskThread, &tasks[i], 0, NULL);
+        if (handles[started] != NULL) {
+            started++;
+        } else {
+            LinesTaskThread(&tasks[i]);
+        }
+    }
+
+    LinesTaskThread(&tasks[0]);
+    if (started > 0) {
+        WaitForMultipleObjects((DWORD)started, handles, TRUE, INFINITE);
+        for (int i = 0; i < started; i++) {
+            CloseHandle(handles[i]);
+        }
+    }
+}
+
+typedef struct LinesSplitContext {
+    size_t breaks[LINES_MAX_THREADS];     // Line breaks in each slice of the text
+    size_t firstLine[LINES_MAX_THREADS];  // Index of the line after the slice's first break
+} LinesSplitContext;
+
+static void LinesCountBreaks(LineSet* set, int slice, size_t begin, size_t end, void* context) {
+    LinesSplitContext* split = (LinesSplitContext*)context;
+    size_t breaks = 0;
+    for (size_t i = begin; i < end; i++) {
+        breaks += set->text[i] == L'\r';
+    }
+    split->breaks[slice] = breaks;
+}
+
+static void LinesRecordStarts(LineSet* set, int slice, size_t begin, size_t end, void* context) {
+    LinesSplitContext* split = (LinesSplitContext*)context;
+    size_t line = split->firstLine[slice];
+    for (size_t i = begin; i < end; i++) {
+        if (set->text[i] == L'\r') {
+            set->lines[line++].start = i + 1;
+        }
+    }
+}
+
+static void LinesMeasure(LineSet* set, int slice, size_t begin, size_t end, void* context) {
+    for (size_t i = begin; i < end; i++) {
+        size_t next = i + 1 < set->count ? set->lines[i + 1].start - 1 : set->length;
+        set->lines[i].length = next - set->lines[i].start;
+    }
+}
+
+BOOL LineSetInit(LineSet* set, const WCHAR* text, size_t length) {
+    ZeroMemory(set, sizeof(LineSet));
+    set->text = text;
+    set->length = length;
+
+    // Count the breaks in each slice of the text, then record where every line starts
+    LinesSplitContext split;
+    int threads = LinesThreadCount(length);
+    LinesRunParallel(set, length, threads, LinesCountBreaks, &split);
+
+    size_t count = 1;
+    for (int i = 0; i < threads; i++) {
+        split.firstLine[i] = count;
+        count += split.breaks[i];
+    }
+
+    set->lines = (LineRef*)MemAlloc(MEM_SCRATCH, count * sizeof(LineRef));
+    if (set->lines == NULL) {
+        return FALSE;
+    }
+    set->count = count;
+    set->lines[0].start = 0;
+    LinesRunParallel(set, length, threads, LinesRecordStarts, &split);
+    LinesRunParallel(set, count, LinesThreadCount(count), LinesMeasure, NULL);
+    return TRUE;
+}
+
+void LineSetFree(LineSet* set) {
+    MemFree(set->lines);
+    set->lines = NULL;
+    set->count = 0;
+}
+
+static int LinesCompareText(const WCHAR* a, size_t aLength, const WCHAR* b, size_t bLength, BOOL fold) {
+    size_t shorter = aLength < bLength ? aLength : bLength;
+    for (size_t i = 0; i < shorter; i++) {
+        WCHAR x = fold ? LinesFold(a[i]) : a[i];
+        WCHAR y = fold ? LinesFold(b[i]) : b[i];
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+    }
+    return aLength == bLength ? 0 : (aLength < bLength ? -1 : 1);
+}
+
+// Function to compare lines with runs of digits taken as numbers, so "file9" sorts before "file10"
+static int LinesCompareNatural(const WCHAR* a, size_t aLength, const WCHAR* b, size_t bLength) {
+    size_t i = 0, j = 0;
+    while (i < aLength && j < bLength) {
+        if (LinesIsDigit(a[i]) && LinesIsDigit(b[j])) {
+            // Without leading zeros, the longer run of digits is the larger number
+            while (i < aLength && a[i] == L'0') {
+                i++;
+            }
+            while (j < bLength && b[j] == L'0') {
+                j++;
+            }
+            size_t aEnd = i, bEnd = j;
+            while (aEnd < aLength && LinesIsDigit(a[aEnd])) {
+                aEnd++;
+            }
+            while (bEnd < bLength && LinesIsDigit(b[bEnd])) {
+                bEnd++;
+            }
+            if (aEnd - i != bEnd - j) {
+                return aEnd - i < bEnd - j ? -1 : 1;
+            }
+            for (; i < aEnd; i++, j++) {
+                if (a[i] != b[j]) {
+                    return a[i] < b[j] ? -1 : 1;
+                }
+            }
+            continue;
+        }
+
+        WCHAR x = LinesFold(a[i]);
+        WCHAR y = LinesFold(b[j]);
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+        i++;
+        j++;
+    }
+    if (aLength - i != bLength - j) {
+        return aLength - i < bLength - j ? -1 : 1;
+    }
+    return 0;
+}
+
+static int LinesCompare(const LinesSortContext* sort, const LineRef* a, const LineRef* b) {
+    // Different prefixes decide the order without touching the text; equal ones decide nothing,
+    // since a missing code unit packs the same as U+0000
+    if (sort->order != LINES_SORT_NATURAL && (sort->order != LINES_SORT_NUMERIC || a->key.number == b->key.number) &&
+        a->prefix != b->prefix) {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+
+    const WCHAR* x = sort->text + a->start;
+    const WCHAR* y = sort->text + b->start;
+    switch (sort->order) {
+    case LINES_SORT_NUMERIC:
+        if (a->key.number != b->key.number) {
+            return a->key.number < b->key.number ? -1 : 1;
+        }
+        return LinesCompareText(x, a->length, y, b->length, FALSE);
+    case LINES_SORT_NATURAL:
+        return LinesCompareNatural(x, a->length, y, b->length);
+    case LINES_SORT_CASELESS:
+        return LinesCompareText(x, a->length, y, b->length, TRUE);
+    default:
+        return LinesCompareText(x, a->length, y, b->length, FALSE);
+    }
+}
+
+size_t LinesParseNumber(const WCHAR* text, size_t length, double* number) {
+    size_t i = 0;
+    while (i < length && (text[i] == L' ' || text[i] == L'\t')) {
+        i++;
+    }
+    BOOL negative = FALSE;
+    if (i < length && (text[i] == L'-' || text[i] == L'+')) {
+        negative = text[i] == L'-';
+        i++;
+    }
+    if (i == length || !(LinesIsDigit(text[i]) || (text[i] == L'.' && i + 1 < length && LinesIsDigit(text[i + 1])))) {
+        return 0;
+    }
+
+    double value = 0;
+    while (i < length && LinesIsDigit(text[i])) {
+        value = value * 10 + (text[i++] - L'0');
+    }
+    if (i < length && text[i] == L'.') {
+        double scale = 0.1;
+        for (i++; i < length && LinesIsDigit(text[i]); i++) {
+            value += (text[i] - L'0') * scale;
+            scale *= 0.1;
+        }
+    }
+
+    // An exponent counts only with at least one digit, so "2e" reads as 2 followed by text
+    size_t e = i + 1;
+    if (e < length && (text[i] == L'e' || text[i] == L'E')) {
+        BOOL negativeExponent = text[e] == L'-';
+        if (text[e] == L'-' || text[e] == L'+') {
+            e++;
+        }
+        if (e < length && LinesIsDigit(text[e])) {
+            int exponent = 0;
+            for (i = e; i < length && LinesIsDigit(text[i]); i++) {
+                if (exponent <= LINES_MAX_EXPONENT) {
+                    exponent = exponent * 10 + (text[i] - L'0');
+                }
+            }
+            if (exponent > LINES_MAX_EXPONENT) {
+                exponent = LINES_MAX_EXPONENT;
+            }
+            for (; exponent > 0; exponent--) {
+                value = negativeExponent ? value / 10 : value * 10;
+            }
+        }
+    }
+
+    *number = negative ? -value : value;
+    return i;
+}
+
+static void LinesComputeKeys(LineSet* set, int slice, size_t begin, size_t end, void* context) {
+    int order = *(const int*)context;
+    for (size_t i = begin; i < end; i++) {
+        LineRef* line = &set->lines[i];
+        const WCHAR* text = set->text + line->start;
+        unsigned long long prefix = 0;
+        for (size_t j = 0; j < 4; j++) {
+            WCHAR c = j < line->length ? text[j] : 0;
+            prefix = (prefix << 16) | (order == LINES_SORT_CASELESS ? LinesFold(c) : c);
+        }
+        line->prefix = prefix;
+        if (order == LINES_SORT_NUMERIC) {
+            if (LinesParseNumber(text, line->length, &line->key.number) == 0) {
+                line->key.number = -DBL_MAX;
+            }
+        }
+    }
+}
+
+// Function to merge two sorted runs; equal lines keep the first run's first, so the sort is stable
+static void LinesMerge(const LinesSortContext* sort, const LineRef* a, size_t aCount,
+    const LineRef* b, size_t bCount, LineRef* out) {
+    size_t i = 0, j = 0;
+    while (i < aCount && j < bCount) {
+        *out++ = LinesCompare(sort, &b[j], &a[i]) < 0 ? b[j++] : a[i++];
+    }
+    memcpy(out, a + i, (aCount - i) * sizeof(LineRef));
+    memcpy(out + (aCount - i), b + j, (bCount - j) * sizeof(LineRef));
+}
+
+// Function to sort a[0, count), leaving the result in b when toB is set and in a otherwise;
+// the other array is scratch
+static void LinesSortRun(const LinesSortContext* sort, LineRef* a, LineRef* b, size_t count, BOOL toB) {
+    if (count <= LINES_INSERTION_RUN) {
+        for (size_t i = 1; i < count; i++) {
+            LineRef item = a[i];
+            size_t j = i;
+            while (j > 0 && LinesCompare(sort, &item, &a[j - 1]) < 0) {
+                a[j] = a[j - 1];
+                j--;
+            }
+            a[j] = item;
+        }
+        if (toB) {
+            memcpy(b, a, count * sizeof(LineRef));
+        }
+        return;
+    }
+
+    size_t half = count / 2;
+    LinesSortRun(sort, a, b, half, !toB);
+    LinesSortRun(sort, a + half, b + half, count - half, !toB);
+    if (toB) {
+        LinesMerge(sort, a, half, a + half, count - half, b);
+    } else {
+        LinesMerge(sort, b, half, b + half, count - half, a);
+    }
+}
+
+static void LinesSortSlice(LineSet* set, int slice, size_t begin, size_t end, void* context) {
+    LinesSortContext* sort = (LinesSortContext*)context;
+    LinesSortRun(sort, sort->source + begin, sort->target + begin, end - begin, FALSE);
+}
+
+static void LinesMergePieces(LineSet* set, int slice, size_t begin, size_t end, void* context) {
+    LinesSortContext* sort = (LinesSortContext*)context;
+    for (size_t i = begin; i < end; i++) {
+        const LinesMergePiece* piece = &sort->pieces[i];
+        LinesMerge(sort, sort->source + piece->aStart, piece->aEnd - piece->aStart,
+            sort->source + piece->bStart, piece->bEnd - piece->bStart, sort->target + piece->out);
+    }
+}
+
+// Function to find how many of the first k lines of the merge of a and b come from a
+static size_t LinesCoRank(const LinesSortContext* sort, const LineRef* a, size_t aCount,
+    const LineRef* b, size_t bCount, size_t k) {
+    size_t low = k > bCount ? k - bCount : 0;
+    size_t high = k < aCount ? k : aCount;
+    while (low < high) {
+        size_t i = low + (high - low) / 2;
+        size_t j = k - i;
+        if (j > 0 && LinesCompare(sort, &b[j - 1], &a[i]) >= 0) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    return low;
+}
+
+BOOL LineSetSort(LineSet* set, int order) {
+    size_t count = set->count;
+    LineRef* temp = (LineRef*)MemAlloc(MEM_SCRATCH, (count > 0 ? count : 1) * sizeof(LineRef));
+    if (temp == NULL) {
+        return FALSE;
+    }
+
+    LinesSortContext sort;
+    sort.text = set->text;
+    sort.order = order;
+    sort.source = set->lines;
+    sort.target = temp;
+
+    int threads = LinesThreadCount(count);
+    if (order != LINES_SORT_NATURAL) {
+        LinesRunParallel(set, count, threads, LinesComputeKeys, &order);
+    }
+
+    // Sort each slice on its own thread, then merge pairs of runs until one is left; every merge
+    // round is cut into pieces of about the same size so all threads stay busy to the end
+    LinesRunParallel(set, count, threads, LinesSortSlice, &sort);
+
+    size_t bounds[LINES_MAX_THREADS + 1];
+    int runs = threads;
+    for (int i = 0; i <= runs; i++) {
+        bounds[i] = LinesSliceStart(count, threads, i);
+    }
+
+    while (runs > 1) {
+        size_t pieceCount = 0;
+        int merged = 0;
+        for (int r = 0; r < runs; r += 2) {
+            size_t aStart = bounds[r];
+            size_t aEnd = bounds[r + 1];
+            size_t bEnd = r + 2 <= runs ? bounds[r + 2] : aEnd;
+            size_t total = bEnd - aStart;
+
+            size_t parts = (size_t)((unsigned long long)threads * total / count);
+            if (parts < 1) {
+                parts = 1;
+            }
+            for (size_t p = 0; p < parts; p++) {
+                size_t k0 = (size_t)((unsigned long long)total * p / parts);
+                size_t k1 = (size_t)((unsigned long long)total * (p + 1) / parts);
+                size_t i0 = LinesCoRank(&sort, sort.source + aStart, aEnd - aStart, sort.source + aEnd, bEnd - aEnd, k0);
+                size_t i1 = LinesCoRank(&sort, sort.source + aStart, aEnd - aStart, sort.source + aEnd, bEnd - aEnd, k1);
+
+                LinesMergePiece* piece = &sort.pieces[pieceCount++];
+                piece->aStart = aStart + i0;
+                piece->aEnd = aStart + i1;
+                piece->bStart = aEnd + (k0 - i0);
+                piece->bEnd = aEnd + (k1 - i1);
+                piece->out = aStart + k0;
+            }
+            bounds[merged++] = aStart;
+        }
+        bounds[merged] = count;
+        runs = merged;
+
+        LinesRunParallel(set, pieceCount, (int)pieceCount < threads ? (int)pieceCount : threads, LinesMergePieces, &sort);
+        LineRef* swap = sort.source;
+        sort.source = sort.target;
+        sort.target = swap;
+    }
+
+    set->lines = sort.source;
+    MemFree(sort.target);
+    return TRUE;
+}
+
+static BOOL LinesEqual(const LineSet* set, const LineRef* a, const LineRef* b) {
+    return a->length == b->length && memcmp(set->text + a->start, set->text + b->start, a->length * sizeof(WCHAR)) == 0;
+}
+
+// Function to drop the lines whose flag is clear, keeping the order of the rest
+static void LinesCompact(LineSet* set, const BYTE* keep) {
+    size_t kept = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        if (keep[i]) {
+            set->lines[kept++] = set->lines[i];
+        }
+    }
+    set->count = kept;
+}
+
+BOOL LineSetUnique(LineSet* set) {
+    // Sort a copy of the lines; a stable sort leaves each line's first occurrence first among its repeats
+    LineSet sorted = *set;
+    sorted.lines = (LineRef*)MemAlloc(MEM_SCRATCH, (set->count > 0 ? set->count : 1) * sizeof(LineRef));
+    BYTE* keep = (BYTE*)MemAlloc(MEM_SCRATCH, set->count > 0 ? set->count : 1);
+    if (sorted.lines == NULL || keep == NULL) {
+        MemFree(sorted.lines);
+        MemFree(keep);
+        return FALSE;
+    }
+
+    for (size_t i = 0; i < set->count; i++) {
+        sorted.lines[i] = set->lines[i];
+        sorted.lines[i].key.index = i;
+    }
+    if (!LineSetSort(&sorted, LINES_SORT_LEXICAL)) {
+        MemFree(sorted.lines);
+        MemFree(keep);
+        return FALSE;
+    }
+
+    memset(keep, 1, set->count);
+    for (size_t i = 1; i < sorted.count; i++) {
+        if (LinesEqual(set, &sorted.lines[i], &sorted.lines[i - 1])) {
+            keep[sorted.lines[i].key.index] = 0;
+        }
+    }
+    LinesCompact(set, keep);
+
+    MemFree(sorted.lines);
+    MemFree(keep);
+    return TRUE;
+}
+
+void LineSetReverse(LineSet* set) {
+    for (size_t i = 0, j = set->count; i + 1 < j; i++, j--) {
+        LineRef swap = set->lines[i];
+        set->lines[i] = set->lines[j - 1];
+        set->lines[j - 1] = swap;
+    }
+}
+
+typedef struct LinesFilterContext {
+    WCHAR pattern[256];
+    int patternLength;
+    BOOL keepMatching;
+    BYTE* keep;
+} LinesFilterContext;
+
+static void LinesMatchSlice(LineSet* set, int slice, size_t begin, size_t end, void* context) {
+    LinesFilterContext* filter = (LinesFilterContext*)context;
+    size_t patternLength = (size_t)filter->patternLength;
+    for (size_t i = begin; i < end; i++) {
+        const WCHAR* line = set->text + set->lines[i].start;
+        size_t length = set->lines[i].length;
+        BOOL found = FALSE;
+        for (size_t p = 0; !found && p + patternLength <= length; p++) {
+            size_t q = 0;
+            while (q < patternLength && LinesFold(line[p + q]) == filter->pattern[q]) {
+                q++;
+            }
+            found = q == patternLength;
+        }
+        filter->keep[i] = found == filter->keepMatching;
+    }
+}
+
+BOOL LineSetFilter(LineSet* set, const WCHAR* pattern, int patternLength, BOOL keep) {
+    LinesFilterContext filter;
+    if (patternLength <= 0 || patternLength > (int)(sizeof(filter.pattern) / sizeof(WCHAR))) {
+        return FALSE;
+    }
+    for (int i = 0; i < patternLength; i++) {
+        filter.pattern[i] = LinesFold(pattern[i]);
+    }
+    filter.patternLength = patternLength;
+    filter.keepMatching = keep != FALSE;
+    filter.keep = (BYTE*)MemAlloc(MEM_SCRATCH, set->count > 0 ? set->count : 1);
+    if (filter.keep == NULL) {
+        return FALSE;
+    }
+
+    LinesRunParallel(set, set->count, LinesThreadCount(set->count), LinesMatchSlice, &filter);
+    LinesCompact(set, filter.keep);
+    MemFree(filter.keep);
+    return TRUE;
+}
+
+typedef struct LinesJoinContext {
+    WCHAR* out;
+    size_t offsets[LINES_MAX_THREADS]; // Where each slice's text goes
+} LinesJoinContext;
+
+static void LinesMeasureSlice(LineSet* set, int slice, size_t begin, size_t end, void* context) {
+    LinesJoinContext* join = (LinesJoinContext*)context;
+    size_t total = 0;
+    for (size_t i = begin; i < end; i++) {
+        total += set->lines[i].length + 1;
+    }
+    join->offsets[slice] = total;
+}
+
+static void LinesCopySlice(LineSet* set, int slice, size_t begin, size_t end, void* context) {
+    LinesJoinContext* join = (LinesJoinContext*)context;
+    WCHAR* out = join->out + join->offsets[slice];
+    for (size_t i = begin; i < end; i++) {
+        memcpy(out, set->text + set->lines[i].start, set->lines[i].length * sizeof(WCHAR));
+        out += set->lines[i].length;
+        if (i + 1 < set->count) {
+            *out++ = L'\r';
+        }
+    }
+}
+
+WCHAR* LineSetJoin(const LineSet* set, size_t* outLength) {
+    LineSet* lines = (LineSet*)set;
+    LinesJoinContext join;
+    int threads = LinesThreadCount(set->count);
+    LinesRunParallel(lines, set->count, threads, LinesMeasureSlice, &join);
+
+    // Every line but the last is followed by a break
+    size_t length = 0;
+    for (int i = 0; i < threads; i++) {
+        size_t sliceLength = join.offsets[i];
+        join.offsets[i] = length;
+        length += sliceLength;
+    }
+    length = length > 0 ? length - 1 : 0;
+
+    join.out = (WCHAR*)MemAlloc(MEM_SCRATCH, (length + 1) * sizeof(WCHAR));
+    if (join.out == NULL) {
+        return NULL;
+    }
+    LinesRunParallel(lines, set->count, threads, LinesCopySlice, &join);
+    join.out[length] = L'\0';
+    *outLength = length;
+    return join.out;
+}
@@ -0,0 +1,63 @@
+// CyCharm : Line operations - sort, unique, reverse and filter over a block of text
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_LINES_H
+#define CYCHARM_LINES_H
+
+#include <windows.h>
+
+// Work on fewer lines (or text units, while splitting) than this stays on the calling thread
+#define LINES_PARALLEL_THRESHOLD 65536
+
+// Upper bound on threads used for one operation
+#define LINES_MAX_THREADS 8
+
+// Sort orders
+#define LINES_SORT_LEXICAL 0   // By UTF-16 code unit
+#define LINES_SORT_NUMERIC 1   // By the number at the start of the line, then lexically; lines without one first
+#define LINES_SORT_NATURAL 2   // Runs of digits compare as numbers, everything else ignoring ASCII case
+#define LINES_SORT_CASELESS 3  // Ignoring ASCII case
+
+// A line of the block, referring into its text rather than holding a copy
+typedef struct LineRef {
+    size_t start;
+    size_t length;
+    unsigned long long prefix; // The first four code units, packed so they compare as one integer
+    union {
+        double number;         // Sort key for LINES_SORT_NUMERIC
+        size_t index;          // Position in the block, while finding repeated lines
+    } key;
+} LineRef;
+
+// A block of text split into lines at '\r'. Operations reorder or drop the references only;
+// the text itself is never copied until the lines are joined again.
+typedef struct LineSet {
+    const WCHAR* text;
+    size_t length;
+    LineRef* lines;
+    size_t count;
+} LineSet;
+
+// Split text into lines; the text must outlive the set
+BOOL LineSetInit(LineSet* set, const WCHAR* text, size_t length);
+void LineSetFree(LineSet* set);
+
+// Stable parallel merge sort over slices of the lines
+BOOL LineSetSort(LineSet* set, int order);
+
+// Drop every line that repeats an earlier one
+BOOL LineSetUnique(LineSet* set);
+
+void LineSetReverse(LineSet* set);
+
+// Keep only the lines containing a pattern (ignoring ASCII case), or only the ones without it
+BOOL LineSetFilter(LineSet* set, const WCHAR* pattern, int patternLength, BOOL keep);
+
+// Read the decimal number text starts with, after any blanks: optional sign, digits, fraction and exponent
+// Returns the number of units read, or 0 (leaving number unset) if the text does not start with one
+size_t LinesParseNumber(const WCHAR* text, size_t length, double* number);
+
+// Join the lines in their current order with '\r' into a null-terminated buffer (free with MemFree)
+WCHAR* LineSetJoin(const LineSet* set, size_t* outLength);
+
+#endif
@@ -6,9 +6,26 @@
 #include <commdlg.h>
 #include <CommCtrl.h>
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 #include <shellapi.h>
 #include "main.h"
+#include "memory.h"
+#include "wrap.h"
+#include "column.h"
+#include "document.h"
+#include "eol.h"
+#include "cursors.h"
+#include "diff.h"
+#include "completion.h"
+#include "search.h"
+#include "lines.h"
+#include "table.h"
+#include "format.h"
+#include "source.h"
+#include "gzip.h"
+#include "snapshot.h"
 
 // Global variables
 HWND g_hEdit;
@@ -23,10 +40,26 @@ HMENU hHelpMenu;
 HFONT g_hFont = NULL;
 
 OPENFILENAME ofn; // Structure for the open and save common dialogs
+char g_szDialogFile[MAX_PATH]; // File name buffer for the open and save common dialogs
+char g_szFileName[MAX_PATH] = ""; // Path of the current document, used by Save and Auto Save
+
+// Scratch arena shared by the load and save pipelines, reset after every operation
+Arena g_ioArena;
 
 // Global variable to track word wrap state
 BOOL g_bWordWrap = FALSE;
 
+// Word wrap layout cache and the width (in columns) the edit control is currently wrapped at
+WrapCache g_wrapCache;
+WrapLayout* g_wrapLayout = NULL;
+int g_wrapColumns = 0;
+HDC g_hWrapDC = NULL;      // Information context used as the wrap target device
+BOOL g_bSizing = FALSE;    // TRUE while the user is dragging the window frame
+
+// Bumped on every change to the edit control's text, so caches can tell when they are stale
+LONG g_editGeneration = 0;
+LONG g_wrapGeneration = -1; // Text generation the wrap cache was built from
+
 // Global variable to track Auto Save state
 BOOL g_bAutoSave = FALSE;
 
@@ -34,6 +67,145 @@ int g_zoomLevel = 100;
 int g_currentLine = 1;
 int g_currentColumn = 1;
 int g_currentEncoding = ENCODING_UTF8; // Default to UTF-8
+int g_lineEnding = EOL_CRLF;           // Line break style written on save
+BOOL g_bMixedLineEndings = FALSE;      // The file had more than one style when it was opened
+BOOL g_bTextTruncated = FALSE;         // Only the start of the file's text fit, so it is never saved over the file
+
+// Per-line visual column maps for the status bar
+ColumnCache g_columnCache;
+
+// Document model mirrored from the edit control, kept in step by describing each edit as it happens
+Document g_document;
+BOOL g_bDocumentStale = TRUE; // The model missed a change and must be resynced before use
+BOOL g_bTrackingEdit = FALSE; // A describable edit message is being processed
+BOOL g_bEditChanged = FALSE;  // The tracked message changed the text
+BOOL g_bBatchEdit = FALSE;    // A cursor batch is being applied; the model already has the change
+BOOL g_bUndoing = FALSE;      // An undo or redo is being processed
+
+// The control's undo history only changes text its edits changed, so the model and the control agree
+// on the first g_undoPrefix and last g_undoSuffix units even after an undo, and a resync reads the rest
+size_t g_undoPrefix = 0;
+size_t g_undoSuffix = 0;
+
+// Hash, length and encoding of the text as last loaded or saved, so "is it modified?" is one comparison
+ContentHash g_savedHash = { 0, 1 };
+size_t g_savedLength = 0;
+int g_savedEncoding = ENCODING_UTF8;
+int g_savedLineEnding = EOL_CRLF;
+
+// Versions of the document model published for background readers; each change publishes one
+SnapshotChannel g_snapshots;
+
+// Auto Save writes a pinned version of the document on a worker thread, so the UI never waits on the disk
+typedef struct AutoSaveJob {
+    HANDLE worker;
+    char path[MAX_PATH];
+    int encoding;
+    int lineEnding;
+    BOOL success;
+    ContentHash hash;  // Version that was written
+    size_t length;
+} AutoSaveJob;
+AutoSaveJob g_autoSave;
+
+// Multiple cursors and block selection
+CursorSet g_cursors;
+BOOL g_bBlockSelecting = FALSE;
+size_t g_blockAnchorLine = 0;
+size_t g_blockAnchorColumn = 0;
+WCHAR g_swallowChar = 0; // Character message to drop after its key was already handled
+
+// Offsets of the highlighted bracket at the caret and its match, -1 when there is none
+LONG g_bracketPair[2] = { -1, -1 };
+
+// Words of the open documents for completion, and the list offering them under the caret
+CompletionIndex g_completion;
+HWND g_hCompletion = NULL;
+LONG g_completionStart = 0; // Start of the word being completed
+
+// Find bar: the document is searched as the query is typed
+SearchState g_search;
+HWND g_hFindBar = NULL;
+HWND g_hFindStatus = NULL;
+WNDPROC g_OldFindProc;
+LONG g_searchOrigin = 0;           // Selection start when the find bar was opened; typing searches from here
+BOOL g_bSearchJumpPending = FALSE; // Select the first match after the origin once the background search finds it
+
+// Table view: delimited data shown as aligned columns in place of the editor
+TableIndex g_table;
+HWND g_hTable = NULL;
+HWND g_hTableGoto = NULL;
+HWND g_hTableGotoLabel = NULL;
+WNDPROC g_OldTableGotoProc;
+BOOL g_bTableView = FALSE;
+size_t g_tableTop = 0;         // First position shown below the header
+size_t g_tableCurrent = 1;     // Highlighted position
+int g_tableLeft = 0;           // First column shown
+ContentHash g_tableHash;       // Text the index was built from
+size_t g_tableLength = 0;
+
+void UpdateTableScrollBars();
+
+// Bytes of the open file, kept mapped so the text can be decoded again in another encoding
+SourceFile g_source;
+
+// Decoding the open file's bytes again in another encoding: the lines in view are replaced at once,
+// and the rest is decoded a slice at a time on a timer and swapped in around them at the end.
+// A compressed file is opened the same way, except that each slice goes straight onto the end of
+// the control, so the top of the file shows while the rest is still being decompressed.
+typedef struct EncodingReload {
+    BOOL active;
+    BOOL opening;         // Slices are appended to the control rather than collected in text
+    int encoding;
+    SourceReader reader;  // Next bytes of the source to decode
+    Document text;        // Text decoded so far, with '\r' line breaks
+    EolStats eolStats;    // Line breaks as they were in the file
+    size_t firstLine;     // First of the lines already replaced in the control
+    size_t visibleStart;  // Where those lines start in the control
+    size_t visibleLength; // Their length; 0 if nothing was replaced up front
+    BOOL truncated;       // The next slice would not fit, so opening stops with the text so far
+} EncodingReload;
+EncodingReload g_reload;
+
+void FinishEncodingReload();
+void CancelEncodingReload();
+void FinishAutoSave();
+void TruncateOpenedSource();
+BOOL OpenCompressedSource(SourceFile* source);
+
+void UpdateBracketMatch();
+
+// Function to fetch a range of the edit control's text as UTF-16 (caller frees with MemFree)
+WCHAR* GetEditTextRange(int subsystem, LONG start, LONG end) {
+    WCHAR* text = (WCHAR*)MemAlloc(subsystem, ((size_t)(end - start) + 1) * sizeof(WCHAR));
+    if (text == NULL) {
+        return NULL;
+    }
+
+    TEXTRANGEW range = { { start, end }, text };
+    SendMessageW(g_hEdit, EM_GETTEXTRANGE, 0, (LPARAM)&range);
+    return text;
+}
+
+// Function to map an offset within a line to its visual column (tabs, wide characters, surrogate pairs)
+// The line's column map is cached until an edit touches the line, so moving around a long line stays cheap
+size_t GetVisualColumn(LONG lineStart, LONG offset) {
+    LONG lineLength = (LONG)SendMessage(g_hEdit, EM_LINELENGTH, lineStart, 0);
+    ColumnLine* entry = ColumnCacheLookup(&g_columnCache, g_editGeneration, (size_t)lineStart, (size_t)lineLength, TAB_WIDTH);
+    if (entry == NULL) {
+        WCHAR* text = GetEditTextRange(MEM_SCRATCH, lineStart, lineStart + lineLength);
+        if (text == NULL) {
+            return (size_t)offset;
+        }
+
+        entry = ColumnCacheStore(&g_columnCache, g_editGeneration, (size_t)lineStart, TAB_WIDTH, text, (size_t)lineLength);
+        MemFree(text);
+        if (entry == NULL) {
+            return (size_t)offset;
+        }
+    }
+    return ColumnLineToColumn(entry, (size_t)offset);
+}
 
 // Function to update the status bar with current cursor position and character count
 void UpdateStatusBar() {
@@ -44,9 +216,9 @@ void UpdateStatusBar() {
     // Get the line number of the cursor
     g_currentLine = (int)SendMessage(g_hEdit, EM_LINEFROMCHAR, (WPARAM)dwSelStart, 0);
     
-    // Get the column number of the cursor
+    // Get the visual column number of the cursor
     int lineStart = (int)SendMessage(g_hEdit, EM_LINEINDEX, g_currentLine, 0);
-    g_currentColumn = dwSelStart - lineStart + 1;
+    g_currentColumn = (int)GetVisualColumn(lineStart, (LONG)dwSelStart - lineStart) + 1;
     
     // Get total character count
     int charCount = GetWindowTextLength(g_hEdit);
@@ -55,10 +227,15 @@ void UpdateStatusBar() {
     char positionText[64];
     char charCountText[64];
     char encodingText[32];
+    char eolText[32];
     char zoomText[32];
     
     // Format the text for each part
-    snprintf(positionText, sizeof(positionText), "Line: %d, Column: %d", g_currentLine + 1, g_currentColumn);
+    if (g_cursors.count > 1) {
+        snprintf(positionText, sizeof(positionText), "Line: %d, Column: %d (%zu cursors)", g_currentLine + 1, g_currentColumn, g_cursors.count);
+    } else {
+        snprintf(positionText, sizeof(positionText), "Line: %d, Column: %d", g_currentLine + 1, g_currentColumn);
+    }
     snprintf(charCountText, sizeof(charCountText), "Characters: %d", charCount);
     
     // Get the encoding text based on the current encoding
@@ -93,13 +270,21 @@ void UpdateStatusBar() {
             break;
     }
     snprintf(encodingText, sizeof(encodingText), "Encoding: %s", encodingStr);
+    if (g_bMixedLineEndings) {
+        snprintf(eolText, sizeof(eolText), "Mixed (%s)", EolName(g_lineEnding));
+    } else {
+        snprintf(eolText, sizeof(eolText), "%s", EolName(g_lineEnding));
+    }
     snprintf(zoomText, sizeof(zoomText), "Zoom: %d%%", g_zoomLevel);
     
     // Set the text for each part
     SendMessage(g_hStatusBar, SB_SETTEXT, SB_PART_POSITION, (LPARAM)positionText);
     SendMessage(g_hStatusBar, SB_SETTEXT, SB_PART_CHARCOUNT, (LPARAM)charCountText);
     SendMessage(g_hStatusBar, SB_SETTEXT, SB_PART_ENCODING, (LPARAM)encodingText);
+    SendMessage(g_hStatusBar, SB_SETTEXT, SB_PART_EOL, (LPARAM)eolText);
     SendMessage(g_hStatusBar, SB_SETTEXT, SB_PART_ZOOM, (LPARAM)zoomText);
+
+    UpdateBracketMatch();
 }
 
 void SetZoomLevel(int zoom);
@@ -209,155 +394,3148 @@ int DetectEncoding(const unsigned char* buffer, size_t size) {
             }
             return ENCODING_ISO_8859_1;  // Default to ISO-8859-1 if no Euro sign found
         }
-        
-        // Default to UTF-8 if no other encoding detected
-        return ENCODING_UTF8;
+        
+        // Default to UTF-8 if no other encoding detected
+        return ENCODING_UTF8;
+    }
+}
+
+// Function to map an encoding to its Windows code page (UTF-16 is handled separately)
+UINT GetEncodingCodePage(int encoding) {
+    switch (encoding) {
+        case ENCODING_UTF8:
+            return CP_UTF8;
+        case ENCODING_ASCII:
+            return 20127;
+        case ENCODING_ISO_8859_1:
+            return 28591;
+        case ENCODING_ISO_8859_15:
+            return 28605;
+        case ENCODING_WINDOWS_1252:
+            return 1252;
+        case ENCODING_SHIFT_JIS:
+            return 932;
+        case ENCODING_GB18030:
+            return 54936;
+        default:
+            return CP_ACP;
+    }
+}
+
+// Function to decode bytes that hold whole characters into UTF-16 text, without looking for a BOM
+// The result lives in the arena and is null-terminated
+WCHAR* DecodeBytes(Arena* arena, const unsigned char* bytes, size_t size, int encoding, size_t* outLength) {
+    WCHAR* result = NULL;
+    *outLength = 0;
+
+    switch (encoding) {
+        case ENCODING_UTF16LE:
+        case ENCODING_UTF16BE: {
+            size_t length = size / 2;
+            result = (WCHAR*)ArenaAlloc(arena, (length + 1) * sizeof(WCHAR));
+            if (result) {
+                for (size_t i = 0; i < length; i++) {
+                    if (encoding == ENCODING_UTF16LE) {
+                        result[i] = (WCHAR)(bytes[i * 2] | (bytes[i * 2 + 1] << 8));
+                    } else {
+                        result[i] = (WCHAR)((bytes[i * 2] << 8) | bytes[i * 2 + 1]);
+                    }
+                }
+                result[length] = L'\0';
+                *outLength = length;
+            }
+            break;
+        }
+
+        default: {
+            UINT codePage = GetEncodingCodePage(encoding);
+            int length = size > 0 ? MultiByteToWideChar(codePage, 0, (LPCSTR)bytes, (int)size, NULL, 0) : 0;
+            if (length == 0 && size > 0) {
+                // Code page not available on this system, fall back to the ANSI code page
+                codePage = CP_ACP;
+                length = MultiByteToWideChar(codePage, 0, (LPCSTR)bytes, (int)size, NULL, 0);
+            }
+
+            result = (WCHAR*)ArenaAlloc(arena, ((size_t)length + 1) * sizeof(WCHAR));
+            if (result) {
+                if (length > 0) {
+                    MultiByteToWideChar(codePage, 0, (LPCSTR)bytes, (int)size, result, length);
+                }
+                result[length] = L'\0';
+                *outLength = (size_t)length;
+            }
+            break;
+        }
+    }
+
+    return result;
+}
+
+// Function to decode raw file bytes into UTF-16 text (decode stage of the load pipeline)
+// A BOM is skipped; the result lives in the arena and is null-terminated
+WCHAR* DecodeText(Arena* arena, const unsigned char* bytes, size_t size, int encoding, size_t* outLength) {
+    size_t bomSize = SourceBomSize(bytes, size, encoding);
+    return DecodeBytes(arena, bytes + bomSize, size - bomSize, encoding, outLength);
+}
+
+// Function to convert '\r'-only text to a code page in pieces, writing line breaks in a style on the way
+// With out NULL it only measures; returns the encoded size in bytes
+size_t EncodeCodePageText(UINT codePage, const WCHAR* text, size_t length, int lineEnding, WCHAR* stage,
+    char* out, size_t outSize) {
+    size_t written = 0;
+    size_t position = 0;
+    while (position < length) {
+        size_t count = length - position < ENCODE_STAGE_UNITS ? length - position : ENCODE_STAGE_UNITS;
+        if (position + count < length && text[position + count - 1] >= 0xD800 && text[position + count - 1] <= 0xDBFF) {
+            count--; // Keep surrogate pairs in one piece
+        }
+
+        size_t staged = EolExpand(text + position, count, lineEnding, stage);
+        int encoded = WideCharToMultiByte(codePage, 0, stage, (int)staged, out != NULL ? out + written : NULL,
+            out != NULL ? (int)(outSize - written) : 0, NULL, NULL);
+        written += (size_t)encoded;
+        position += count;
+    }
+    return written;
+}
+
+// Function to encode UTF-16 text into the bytes written to disk (encode stage of the save pipeline)
+// The text uses the edit control's '\r' line breaks, which are written in the given line ending style.
+// The result lives in the arena
+unsigned char* EncodeText(Arena* arena, const WCHAR* text, size_t length, int encoding, int lineEnding, size_t* outSize) {
+    unsigned char* result = NULL;
+    *outSize = 0;
+
+    switch (encoding) {
+        case ENCODING_UTF16LE:
+        case ENCODING_UTF16BE: {
+            // 2 bytes per code unit + 2 bytes for BOM
+            size_t expandedLength = EolExpandedLength(text, length, lineEnding);
+            result = (unsigned char*)ArenaAlloc(arena, expandedLength * 2 + 2);
+            if (result) {
+                // Add UTF-16LE BOM (FF FE) or UTF-16BE BOM (FE FF)
+                result[0] = encoding == ENCODING_UTF16LE ? 0xFF : 0xFE;
+                result[1] = encoding == ENCODING_UTF16LE ? 0xFE : 0xFF;
+
+                size_t out = 2;
+                for (size_t i = 0; i < length; i++) {
+                    WCHAR units[2] = { text[i], 0 };
+                    int count = 1;
+                    if (text[i] == L'\r' && lineEnding != EOL_CR) {
+                        units[0] = lineEnding == EOL_CRLF ? L'\r' : L'\n';
+                        units[1] = L'\n';
+                        count = lineEnding == EOL_CRLF ? 2 : 1;
+                    }
+                    for (int j = 0; j < count; j++) {
+                        unsigned char low = (unsigned char)(units[j] & 0xFF);
+                        unsigned char high = (unsigned char)(units[j] >> 8);
+                        result[out++] = encoding == ENCODING_UTF16LE ? low : high;
+                        result[out++] = encoding == ENCODING_UTF16LE ? high : low;
+                    }
+                }
+                *outSize = out;
+            }
+            break;
+        }
+
+        default: {
+            UINT codePage = GetEncodingCodePage(encoding);
+            size_t bomSize = encoding == ENCODING_UTF8 ? 3 : 0;
+
+            // Line breaks are expanded a piece at a time, so the text is never copied whole
+            WCHAR* stage = (WCHAR*)ArenaAlloc(arena, ENCODE_STAGE_UNITS * 2 * sizeof(WCHAR));
+            if (stage == NULL) {
+                break;
+            }
+            size_t encodedLength = EncodeCodePageText(codePage, text, length, lineEnding, stage, NULL, 0);
+
+            result = (unsigned char*)ArenaAlloc(arena, bomSize + encodedLength + 1);
+            if (result) {
+                if (bomSize > 0) {
+                    // Add UTF-8 BOM (EF BB BF)
+                    result[0] = 0xEF;
+                    result[1] = 0xBB;
+                    result[2] = 0xBF;
+                }
+                EncodeCodePageText(codePage, text, length, lineEnding, stage, (char*)(result + bomSize), encodedLength);
+                *outSize = bomSize + encodedLength;
+            }
+            break;
+        }
+    }
+
+    return result;
+}
+
+// Function to show the Open or Save As dialog; on success the chosen path is in g_szDialogFile
+BOOL PromptForFileName(BOOL save) {
+    ZeroMemory(&ofn, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = g_hWnd;
+    ofn.lpstrFile = g_szDialogFile;
+    ofn.lpstrFile[0] = '\0';
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrFilter = "Text Files\0*.txt\0Gzip-Compressed Text\0*.gz\0All Files\0*.*\0";
+    ofn.nFilterIndex = 1;
+
+    if (save) {
+        ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT;
+        return GetSaveFileName(&ofn);
+    }
+
+    ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+    return GetOpenFileName(&ofn);
+}
+
+// Function to report how much of the document the edit control is holding
+void UpdateDocumentMemoryUsage() {
+    GETTEXTLENGTHEX gtl = { GTL_NUMCHARS | GTL_PRECISE, 1200 };
+    LRESULT length = SendMessage(g_hEdit, EM_GETTEXTLENGTHEX, (WPARAM)&gtl, 0);
+    MemSetExternalUsage(MEM_DOCUMENT, (size_t)length * sizeof(WCHAR));
+}
+
+// Function to fetch the edit control's text as UTF-16 with '\r' paragraph breaks
+// The buffer is allocated with MemAlloc against the given subsystem
+WCHAR* GetEditText(int subsystem, size_t* outLength) {
+    GETTEXTLENGTHEX gtl = { GTL_NUMCHARS | GTL_PRECISE, 1200 };
+    size_t length = (size_t)SendMessage(g_hEdit, EM_GETTEXTLENGTHEX, (WPARAM)&gtl, 0);
+
+    WCHAR* text = (WCHAR*)MemAlloc(subsystem, (length + 1) * sizeof(WCHAR));
+    if (text == NULL) {
+        *outLength = 0;
+        return NULL;
+    }
+
+    GETTEXTEX gt = { (DWORD)((length + 1) * sizeof(WCHAR)), GT_DEFAULT, 1200, NULL, NULL };
+    *outLength = (size_t)SendMessage(g_hEdit, EM_GETTEXTEX, (WPARAM)&gt, (LPARAM)text);
+    return text;
+}
+
+// Function to get the length of the edit control's text in UTF-16 units, counting '\r' breaks once
+LONG GetEditLength() {
+    GETTEXTLENGTHEX gtl = { GTL_NUMCHARS | GTL_PRECISE, 1200 };
+    return (LONG)SendMessage(g_hEdit, EM_GETTEXTLENGTHEX, (WPARAM)&gtl, 0);
+}
+
+// Function to publish the document model for background readers, unless that version already is
+// Only the UI thread publishes, so the current version can be read without pinning it
+void PublishDocument() {
+    if (g_snapshots.current == NULL || g_snapshots.current->doc.root != g_document.root) {
+        SnapshotPublish(&g_snapshots, &g_document);
+    }
+}
+
+// Function to note that [start, end) of the control's text, length units long before, changed in a
+// way that undo or redo can change back
+void WidenUndoSpan(size_t start, size_t end, size_t length) {
+    if (start < g_undoPrefix) {
+        g_undoPrefix = start;
+    }
+    if (end <= length && length - end < g_undoSuffix) {
+        g_undoSuffix = length - end;
+    } else if (end > length) {
+        g_undoSuffix = 0;
+    }
+}
+
+// Function to replace a range of the document model, keeping the completion index in step
+// The words touching the range are counted out before the change and back in after it
+BOOL ReplaceDocumentRange(size_t start, size_t end, const WCHAR* text, size_t length) {
+    WidenUndoSpan(start, end, DocLength(&g_document));
+    CompletionRemoveRange(&g_completion, &g_document, start, end);
+    BOOL replaced = DocReplace(&g_document, start, end, text, length);
+    CompletionAddRange(&g_completion, &g_document, start, replaced ? start + length : end);
+    PublishDocument();
+    return replaced;
+}
+
+// Function to bring the document model up to date after a change it could not be told about
+// Only the span the undo history can touch is read back, and only the part of it that differs is rebuilt
+BOOL SyncDocument() {
+    size_t editLength = (size_t)GetEditLength();
+    size_t docLength = DocLength(&g_document);
+    if (!g_bDocumentStale && docLength == editLength) {
+        return TRUE;
+    }
+
+    size_t shortest = editLength < docLength ? editLength : docLength;
+    size_t prefix = g_undoPrefix < shortest ? g_undoPrefix : shortest;
+    size_t suffix = g_undoSuffix < shortest - prefix ? g_undoSuffix : shortest - prefix;
+    size_t editSpan = editLength - prefix - suffix;
+    size_t docSpan = docLength - prefix - suffix;
+
+    WCHAR* text = GetEditTextRange(MEM_SCRATCH, (LONG)prefix, (LONG)(editLength - suffix));
+    WCHAR* old = (WCHAR*)MemAlloc(MEM_SCRATCH, (docSpan + 1) * sizeof(WCHAR));
+    if (text == NULL || old == NULL) {
+        MemFree(text);
+        MemFree(old);
+        return FALSE;
+    }
+    DocGetText(&g_document, prefix, docLength - suffix, old);
+
+    // Trim what the two spans still have in common at either end
+    size_t start = 0;
+    while (start < editSpan && start < docSpan && text[start] == old[start]) {
+        start++;
+    }
+    size_t end = 0;
+    while (end < editSpan - start && end < docSpan - start && text[editSpan - end - 1] == old[docSpan - end - 1]) {
+        end++;
+    }
+
+    g_bDocumentStale = FALSE;
+    if (start < editSpan || start < docSpan) {
+        g_bDocumentStale = !ReplaceDocumentRange(prefix + start, prefix + docSpan - end, text + start, editSpan - end - start);
+    }
+    MemFree(text);
+    MemFree(old);
+    return !g_bDocumentStale;
+}
+
+// Function to forget the control's undo history once it was emptied, if the model is in step
+void ResetUndoSpan() {
+    if (SyncDocument()) {
+        g_undoPrefix = (size_t)-1;
+        g_undoSuffix = (size_t)-1;
+    }
+}
+
+// Function to remember the current text as the one on disk
+void RecordSavedState() {
+    if (SyncDocument()) {
+        g_savedHash = DocHash(&g_document);
+        g_savedLength = DocLength(&g_document);
+    } else {
+        g_savedHash.value = ~0ULL; // Not a valid residue, so the text always counts as modified
+        g_savedLength = 0;
+    }
+    g_savedEncoding = g_currentEncoding;
+    g_savedLineEnding = g_lineEnding;
+}
+
+// Function to tell whether the text differs from what was last loaded or saved
+// The document hash is maintained by every edit, so this is O(1) unless the model needs a resync,
+// and an edit that is typed and then undone counts as unmodified
+BOOL IsDocumentModified() {
+    // Until decoding in another encoding finishes, the text is the file's and cannot be edited
+    if (g_reload.active) {
+        return FALSE;
+    }
+    if (!SyncDocument()) {
+        return TRUE;
+    }
+    return g_currentEncoding != g_savedEncoding || g_lineEnding != g_savedLineEnding ||
+        DocLength(&g_document) != g_savedLength ||
+        !HashEqual(DocHash(&g_document), g_savedHash);
+}
+
+// Function to tell whether an edit message only changes text around the selection, so its change
+// can be worked out from the selection and length before and after
+BOOL IsDescribableEdit(UINT message, WPARAM w_param) {
+    if (g_bBatchEdit) {
+        return FALSE;
+    }
+
+    // Undo and redo can change text anywhere in the document
+    if (message == WM_KEYDOWN) {
+        return !((GetKeyState(VK_CONTROL) & 0x8000) && (w_param == 'Z' || w_param == 'Y'));
+    }
+    if (message == WM_CHAR) {
+        return w_param != 0x1A && w_param != 0x19; // Ctrl+Z, Ctrl+Y
+    }
+    return TRUE;
+}
+
+// Function to apply a change made around the selection to the document model and the column cache
+// The changed range is bounded by the selections before and after and by the change in length;
+// generation is the edit generation of the text before the change
+void DescribeEdit(CHARRANGE before, CHARRANGE after, LONG lengthBefore, LONG lengthAfter, LONG generation) {
+    // The selection can include the final paragraph mark, which is never part of the text
+    if (before.cpMax > lengthBefore) {
+        before.cpMax = lengthBefore;
+    }
+    if (after.cpMax > lengthAfter) {
+        after.cpMax = lengthAfter;
+    }
+
+    LONG delta = lengthAfter - lengthBefore;
+    LONG start = before.cpMin < after.cpMin ? before.cpMin : after.cpMin;
+    LONG oldEnd = before.cpMax > after.cpMax - delta ? before.cpMax : after.cpMax - delta;
+    LONG newEnd = oldEnd + delta;
+
+    if (start < 0 || oldEnd > lengthBefore || newEnd < start) {
+        WidenUndoSpan(0, (size_t)-1, 0);
+        g_bDocumentStale = TRUE;
+        return;
+    }
+
+    // Only the cached lines the change touches are dropped; the ones after it move with the text
+    ColumnCacheEdit(&g_columnCache, generation, g_editGeneration, (size_t)start, (size_t)oldEnd, (size_t)newEnd);
+
+    if (g_bDocumentStale || (size_t)lengthBefore != DocLength(&g_document)) {
+        WidenUndoSpan((size_t)start, (size_t)oldEnd, (size_t)lengthBefore);
+        g_bDocumentStale = TRUE;
+        return;
+    }
+
+    WCHAR* text = GetEditTextRange(MEM_SCRATCH, start, newEnd);
+    if (text == NULL || !ReplaceDocumentRange((size_t)start, (size_t)oldEnd, text, (size_t)(newEnd - start))) {
+        g_bDocumentStale = TRUE;
+    }
+    MemFree(text);
+}
+
+// Function to wrap the edit control at the current window width
+// The control wraps to a fixed line width, so resizing and zooming only cost a re-wrap when the
+// width in columns changes and the cached layouts show that visual-line breaks actually move
+void ApplyWordWrapWidth() {
+    KillTimer(g_hWnd, WRAP_TIMER_ID);
+    if (!g_bWordWrap) {
+        return;
+    }
+
+    // Measure the font at the current zoom level
+    TEXTMETRIC tm;
+    HGDIOBJ oldFont = SelectObject(g_hWrapDC, g_hFont);
+    GetTextMetrics(g_hWrapDC, &tm);
+    SelectObject(g_hWrapDC, oldFont);
+
+    int charWidth = MulDiv(tm.tmAveCharWidth, g_zoomLevel, 100);
+    if (charWidth < 1) {
+        charWidth = 1;
+    }
+
+    RECT clientRect;
+    GetClientRect(g_hEdit, &clientRect);
+    int columns = (clientRect.right - clientRect.left) / charWidth;
+    if (columns < 1) {
+        columns = 1;
+    }
+
+    if (columns == g_wrapColumns) {
+        return;
+    }
+
+    // Refresh the cache's copy of the text if it was edited since the last layout
+    if (g_wrapGeneration != g_editGeneration) {
+        size_t length = 0;
+        WCHAR* text = GetEditText(MEM_CACHE, &length);
+        if (text != NULL && WrapCacheSetText(&g_wrapCache, text, length)) {
+            g_wrapGeneration = g_editGeneration;
+        }
+        g_wrapLayout = NULL;
+    }
+
+    WrapLayout* layout = WrapCacheSelect(&g_wrapCache, columns, tm.tmAveCharWidth, tm.tmHeight);
+
+    // Lay out the visible lines right away; the rest is finished in the background
+    int lineHeight = MulDiv(tm.tmHeight, g_zoomLevel, 100);
+    size_t firstVisible = (size_t)SendMessage(g_hEdit, EM_GETFIRSTVISIBLELINE, 0, 0);
+    size_t visibleLines = (size_t)((clientRect.bottom - clientRect.top) / (lineHeight > 0 ? lineHeight : 1)) + 1;
+    WrapLayoutLines(&g_wrapCache, layout, firstVisible, firstVisible + visibleLines);
+
+    // Returning to a width whose breaks match the current ones needs no re-wrap at all, but the new
+    // layout still becomes the current one: the cache now counts it as the most recently used
+    if (g_wrapLayout != NULL && WrapLayoutsEqual(&g_wrapCache, g_wrapLayout, layout)) {
+        g_wrapColumns = columns;
+        g_wrapLayout = layout;
+        return;
+    }
+
+    // Wrap at a fixed width in twips so later MoveWindow calls do not make the control re-wrap
+    int lineWidth = MulDiv(columns * tm.tmAveCharWidth, 1440, GetDeviceCaps(g_hWrapDC, LOGPIXELSX));
+    SendMessage(g_hEdit, EM_SETTARGETDEVICE, (WPARAM)g_hWrapDC, lineWidth);
+
+    g_wrapColumns = columns;
+    g_wrapLayout = layout;
+    WrapStartBackground(&g_wrapCache, layout);
+}
+
+// Function to decompress gzip data whole into the I/O arena, measuring it first so it fits in one block
+// NULL if the data is damaged or does not fit
+unsigned char* InflateIntoArena(const unsigned char* bytes, size_t size, size_t* outSize) {
+    Inflater* inflater = (Inflater*)ArenaAlloc(&g_ioArena, sizeof(Inflater));
+    unsigned char* scratch = (unsigned char*)ArenaAlloc(&g_ioArena, SOURCE_READ_SIZE);
+    if (inflater == NULL || scratch == NULL) {
+        return NULL;
+    }
+
+    size_t total = 0;
+    InflateInit(inflater, bytes, size);
+    while (!InflateFinished(inflater) && !inflater->failed) {
+        total += InflateRead(inflater, scratch, SOURCE_READ_SIZE);
+    }
+    unsigned char* out = inflater->failed ? NULL : (unsigned char*)ArenaAlloc(&g_ioArena, total + 2);
+    if (out == NULL) {
+        return NULL;
+    }
+
+    InflateInit(inflater, bytes, size);
+    *outSize = 0;
+    while (*outSize < total && !inflater->failed) {
+        *outSize += InflateRead(inflater, out + *outSize, total - *outSize);
+    }
+    return out;
+}
+
+// Function to read a file and decode it to UTF-16 using its detected encoding; gzip files are read
+// as the text they hold. The text lives in the I/O arena until the caller resets it; NULL if the
+// file cannot be read
+WCHAR* ReadTextFile(const char* path, int* outEncoding, size_t* outLength) {
+    HANDLE hFile = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    WCHAR* text = NULL;
+    LARGE_INTEGER fileSize = { 0 };
+    unsigned char* buffer = NULL;
+    if (GetFileSizeEx(hFile, &fileSize) && (unsigned long long)fileSize.QuadPart < (size_t)-1 - 2) {
+        buffer = (unsigned char*)ArenaAlloc(&g_ioArena, (size_t)fileSize.QuadPart + 2);
+    }
+
+    // ReadFile takes a DWORD count, so a file of 4 GB or more is read a piece at a time
+    size_t size = 0;
+    BOOL read = buffer != NULL;
+    while (read && size < (size_t)fileSize.QuadPart) {
+        size_t remaining = (size_t)fileSize.QuadPart - size;
+        DWORD bytesRead = 0;
+        read = ReadFile(hFile, buffer + size, remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining, &bytesRead, NULL) && bytesRead > 0;
+        size += bytesRead;
+    }
+
+    if (buffer == NULL) {
+        MessageBox(g_hWnd, "Not enough memory to open this file within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+    } else if (read) {
+        if (GzipIsCompressed(buffer, size)) {
+            buffer = InflateIntoArena(buffer, size, &size);
+        }
+
+        // Detect the encoding of the file and decode into UTF-16
+        if (buffer != NULL) {
+            *outEncoding = DetectEncoding(buffer, size);
+            text = DecodeText(&g_ioArena, buffer, size, *outEncoding, outLength);
+        }
+
+        if (text == NULL) {
+            MessageBox(g_hWnd, buffer == NULL ? "The compressed file is damaged, or too large to open within the configured memory limit." :
+                "Not enough memory to open this file within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+        }
+    }
+
+    CloseHandle(hFile);
+    return text;
+}
+
+// Function to load a file into the edit control: read, detect, decode, scan line endings, display
+// All stage buffers come from the I/O arena, which is reset once the control has the text
+BOOL LoadDocumentFromFile(const char* path) {
+    FinishAutoSave();
+    int encoding = ENCODING_UTF8;
+    size_t textLength = 0;
+    WCHAR* text = NULL;
+
+    // The file's bytes are decoded straight from a mapping, which is let go once the text is in the
+    // control; the file is remembered so it can be decoded again later. A file that cannot be mapped
+    // is read the usual way
+    SourceFile source;
+    SourceInit(&source);
+    if (SourceOpen(&source, path)) {
+        // Compressed files are decompressed as they are shown
+        if (source.container == SOURCE_ZSTD) {
+            SourceClose(&source);
+            MessageBox(g_hWnd, "Zstandard-compressed (.zst) files are not supported yet. Decompress the file first.", "Error", MB_ICONEXCLAMATION | MB_OK);
+            return FALSE;
+        }
+        if (source.container == SOURCE_GZIP) {
+            return OpenCompressedSource(&source);
+        }
+
+        encoding = DetectEncoding(source.bytes, source.size);
+        text = DecodeText(&g_ioArena, source.bytes, source.size, encoding, &textLength);
+        if (text == NULL) {
+            MessageBox(g_hWnd, "Not enough memory to open this file within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+        }
+    } else {
+        text = ReadTextFile(path, &encoding, &textLength);
+    }
+
+    if (text == NULL) {
+        SourceClose(&source);
+    } else {
+        CancelEncodingReload();
+        SourceClose(&g_source);
+        SourceRelease(&source);
+        g_source = source;
+        g_bTextTruncated = FALSE;
+        g_currentEncoding = encoding;
+
+        // Remember how lines ended so saving can write them back the same way,
+        // then hand the control its own '\r' form
+        EolStats eolStats = { { 0 } };
+        EolScan(text, textLength, &eolStats);
+        g_lineEnding = EolDominant(&eolStats, EOL_CRLF);
+        g_bMixedLineEndings = EolIsMixed(&eolStats);
+        textLength = EolNormalize(text, textLength);
+        text[textLength] = L'\0';
+
+        SETTEXTEX st = { ST_DEFAULT, 1200 };
+        CursorSetClear(&g_cursors);
+        SendMessage(g_hEdit, EM_SETTEXTEX, (WPARAM)&st, (LPARAM)text);
+        g_editGeneration++;
+        g_bDocumentStale = TRUE;
+    }
+
+    ArenaReset(&g_ioArena);
+    if (text != NULL) {
+        ResetUndoSpan(); // Setting the text emptied the undo history
+        RecordSavedState();
+    }
+    UpdateDocumentMemoryUsage();
+    return text != NULL;
+}
+
+// Function to wrap encoded bytes for the file they are written to: a .gz file stays one, written in
+// stored blocks so it needs no compressor. The result lives in the arena
+unsigned char* PackForPath(Arena* arena, const char* path, unsigned char* encoded, size_t* size) {
+    const char* extension = strrchr(path, '.');
+    if (encoded == NULL || extension == NULL || lstrcmpiA(extension, ".gz") != 0) {
+        return encoded;
+    }
+    unsigned char* packed = (unsigned char*)ArenaAlloc(arena, GzipStoredSize(*size));
+    *size = packed != NULL ? GzipStore(encoded, *size, packed) : 0;
+    return packed;
+}
+
+// Function to replace a file's contents with encoded bytes
+// WriteFile takes a DWORD count, so 4 GB or more is written a piece at a time
+BOOL WriteEncodedFile(const char* path, const unsigned char* bytes, size_t size) {
+    HANDLE hFile = CreateFile(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+    BOOL success = TRUE;
+    for (size_t written = 0; success && written < size; ) {
+        size_t remaining = size - written;
+        DWORD bytesWritten = 0;
+        success = WriteFile(hFile, bytes + written, remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining, &bytesWritten, NULL) &&
+            bytesWritten > 0;
+        written += bytesWritten;
+    }
+    CloseHandle(hFile);
+    return success;
+}
+
+// Function to save the edit control's text: fetch, encode, write
+// All stage buffers come from the I/O arena, which is reset once the file is written. The file is
+// only opened once the bytes are ready, so running out of memory leaves it as it was.
+BOOL SaveDocumentToFile(const char* path) {
+    FinishAutoSave();
+    FinishEncodingReload();
+
+    BOOL success = FALSE;
+    size_t textLength = (size_t)GetEditLength();
+    WCHAR* text = (WCHAR*)ArenaAlloc(&g_ioArena, (textLength + 1) * sizeof(WCHAR));
+
+    if (text != NULL) {
+        GETTEXTEX gt = { (DWORD)((textLength + 1) * sizeof(WCHAR)), GT_DEFAULT, 1200, NULL, NULL };
+        textLength = (size_t)SendMessage(g_hEdit, EM_GETTEXTEX, (WPARAM)&gt, (LPARAM)text);
+
+        // Convert the text to the selected encoding, writing line breaks in the document's style
+        size_t encodedSize = 0;
+        unsigned char* encodedBuffer = EncodeText(&g_ioArena, text, textLength, g_currentEncoding, g_lineEnding, &encodedSize);
+
+        encodedBuffer = PackForPath(&g_ioArena, path, encodedBuffer, &encodedSize);
+
+        // The file is not mapped outside a reload, so it can be written; once it is, it is the source
+        if (encodedBuffer) {
+            success = WriteEncodedFile(path, encodedBuffer, encodedSize);
+        }
+    }
+
+    ArenaReset(&g_ioArena);
+    if (success) {
+        g_bMixedLineEndings = FALSE; // Every line now ends the same way
+        RecordSavedState();
+        SourceRemember(&g_source, path);
+    }
+    return success;
+}
+
+// Function to write the current published version to the autosave file, on the worker thread
+// The version stays pinned only while its text is copied out; encoding and writing need no pin
+DWORD WINAPI AutoSaveWorker(LPVOID param) {
+    AutoSaveJob* job = (AutoSaveJob*)param;
+    int slot = SnapshotRegister(&g_snapshots);
+    if (slot < 0) {
+        PostMessage(g_hWnd, WM_AUTOSAVE_DONE, 0, 0);
+        return 0;
+    }
+
+    Arena arena;
+    ArenaInit(&arena, MEM_SCRATCH, ARENA_DEFAULT_BLOCK_SIZE);
+    WCHAR* text = NULL;
+    const SnapshotVersion* version = SnapshotPin(&g_snapshots, slot);
+    if (version != NULL) {
+        job->length = DocLength(&version->doc);
+        job->hash = DocHash(&version->doc);
+        text = (WCHAR*)ArenaAlloc(&arena, (job->length + 1) * sizeof(WCHAR));
+        if (text != NULL) {
+            DocGetText(&version->doc, 0, job->length, text);
+        }
+    }
+    SnapshotUnregister(&g_snapshots, slot);
+
+    if (text != NULL) {
+        size_t encodedSize = 0;
+        unsigned char* encodedBuffer = EncodeText(&arena, text, job->length, job->encoding, job->lineEnding, &encodedSize);
+        encodedBuffer = PackForPath(&arena, job->path, encodedBuffer, &encodedSize);
+        if (encodedBuffer) {
+            job->success = WriteEncodedFile(job->path, encodedBuffer, encodedSize);
+        }
+    }
+    ArenaRelease(&arena);
+    PostMessage(g_hWnd, WM_AUTOSAVE_DONE, 0, 0);
+    return 0;
+}
+
+// Function to start writing the document to its file in the background
+void StartAutoSave() {
+    if (g_autoSave.worker != NULL || g_szFileName[0] == '\0' || g_bTextTruncated || g_reload.active || !SyncDocument()) {
+        return;
+    }
+    PublishDocument(); // The worker writes the current version, so it must be the model as it is now
+
+    strcpy(g_autoSave.path, g_szFileName);
+    g_autoSave.encoding = g_currentEncoding;
+    g_autoSave.lineEnding = g_lineEnding;
+    g_autoSave.success = FALSE;
+
+    g_autoSave.worker = CreateThread(NULL, 0, AutoSaveWorker, &g_autoSave, 0, NULL);
+    if (g_autoSave.worker == NULL) {
+        // No thread available: save on the calling thread
+        SaveDocumentToFile(g_szFileName);
+    }
+}
+
+// Function to wait for the background autosave, if one is running, and take in its result
+// Called before anything that reads or writes the file, or changes which file is open
+void FinishAutoSave() {
+    if (g_autoSave.worker == NULL) {
+        return;
+    }
+
+    WaitForSingleObject(g_autoSave.worker, INFINITE);
+    CloseHandle(g_autoSave.worker);
+    g_autoSave.worker = NULL;
+    if (g_autoSave.success) {
+        // The version written may be older than the text now, which then still counts as modified
+        g_savedHash = g_autoSave.hash;
+        g_savedLength = g_autoSave.length;
+        g_savedEncoding = g_autoSave.encoding;
+        g_savedLineEnding = g_autoSave.lineEnding;
+        g_bMixedLineEndings = FALSE; // Every line now ends the same way
+        SourceRemember(&g_source, g_autoSave.path);
+    }
+}
+
+// Function to show per-subsystem memory usage
+void ShowMemoryUsage() {
+    UpdateDocumentMemoryUsage();
+
+    char report[512];
+    int written = 0;
+    for (int i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        written += snprintf(report + written, sizeof(report) - written, "%s: %zu KB\n",
+            MemGetSubsystemName(i), MemGetUsage(i) / 1024);
+    }
+    written += snprintf(report + written, sizeof(report) - written, "\nTotal: %zu KB\nPeak: %zu KB\n",
+        MemGetTotalUsage() / 1024, MemGetPeakUsage() / 1024);
+    if (MemGetCeiling() > 0) {
+        written += snprintf(report + written, sizeof(report) - written, "Limit: %zu KB\n", MemGetCeiling() / 1024);
+    } else {
+        written += snprintf(report + written, sizeof(report) - written, "Limit: none\n");
+    }
+    if (DocGetResidentLimit() > 0) {
+        snprintf(report + written, sizeof(report) - written, "Resident text limit: %zu KB (document model only; the edit control keeps its own full copy)",
+            DocGetResidentLimit() / 1024);
+    } else {
+        snprintf(report + written, sizeof(report) - written, "Resident text limit: none");
+    }
+
+    MessageBox(g_hWnd, report, "Memory Usage", MB_OK | MB_ICONINFORMATION);
+}
+
+// Source buffer for streaming text into a RichEdit control with EM_STREAMIN
+typedef struct StreamSource {
+    const char* data;
+    size_t size;
+    size_t position;
+} StreamSource;
+
+// EM_STREAMIN callback: hand the control the next piece of the buffer
+DWORD CALLBACK StreamInCallback(DWORD_PTR cookie, LPBYTE buffer, LONG count, LONG* transferred) {
+    StreamSource* source = (StreamSource*)cookie;
+    size_t remaining = source->size - source->position;
+    size_t chunk = remaining < (size_t)count ? remaining : (size_t)count;
+
+    memcpy(buffer, source->data + source->position, chunk);
+    source->position += chunk;
+    *transferred = (LONG)chunk;
+    return 0;
+}
+
+// Source range of a document for streaming plain UTF-16 text into a RichEdit control
+typedef struct DocStreamSource {
+    const Document* doc;
+    size_t position;
+    size_t end;
+} DocStreamSource;
+
+// EM_STREAMIN callback: copy the next piece of the range straight out of the document
+DWORD CALLBACK DocStreamInCallback(DWORD_PTR cookie, LPBYTE buffer, LONG count, LONG* transferred) {
+    DocStreamSource* source = (DocStreamSource*)cookie;
+    size_t remaining = source->end - source->position;
+    size_t units = (size_t)count / sizeof(WCHAR);
+    size_t chunk = remaining < units ? remaining : units;
+
+    chunk = DocGetText(source->doc, source->position, source->position + chunk, (WCHAR*)buffer);
+    source->position += chunk;
+    *transferred = (LONG)(chunk * sizeof(WCHAR));
+    return 0;
+}
+
+// Function to replace [start, end) of the edit control with [from, to) of a document, streamed a
+// piece at a time so the text is never copied out in one piece
+void StreamDocumentRange(LONG start, LONG end, const Document* doc, size_t from, size_t to) {
+    CHARRANGE range = { start, end };
+    SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+    DocStreamSource source = { doc, from, to };
+    EDITSTREAM stream = { (DWORD_PTR)&source, 0, DocStreamInCallback };
+    SendMessage(g_hEdit, EM_STREAMIN, SF_TEXT | SF_UNICODE | SFF_SELECTION, (LPARAM)&stream);
+}
+
+// Function to tell whether two ranges of the same length in two documents hold the same text
+BOOL DocumentRangesEqual(const Document* first, size_t firstStart, const Document* second, size_t secondStart, size_t length) {
+    WCHAR* firstText = (WCHAR*)ArenaAlloc(&g_ioArena, (length + 1) * sizeof(WCHAR));
+    WCHAR* secondText = (WCHAR*)ArenaAlloc(&g_ioArena, (length + 1) * sizeof(WCHAR));
+    BOOL equal = firstText != NULL && secondText != NULL &&
+        DocGetText(first, firstStart, firstStart + length, firstText) == length &&
+        DocGetText(second, secondStart, secondStart + length, secondText) == length &&
+        memcmp(firstText, secondText, length * sizeof(WCHAR)) == 0;
+    ArenaReset(&g_ioArena);
+    return equal;
+}
+
+// Compare view: a read-only window showing a unified diff
+HWND g_hCompareWnd = NULL;
+HWND g_hCompareEdit = NULL;
+
+LRESULT CALLBACK CompareProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param) {
+    switch (message) {
+    case WM_SIZE:
+        MoveWindow(g_hCompareEdit, 0, 0, LOWORD(l_param), HIWORD(l_param), TRUE);
+        return 0;
+
+    case WM_DESTROY:
+        g_hCompareWnd = NULL;
+        g_hCompareEdit = NULL;
+        return 0;
+    }
+
+    return DefWindowProc(hwnd, message, w_param, l_param);
+}
+
+// Function to show RTF text in the compare window, creating the window the first time
+void ShowCompareWindow(const char* title, const char* rtf, size_t size) {
+    if (g_hCompareWnd == NULL) {
+        g_hCompareWnd = CreateWindow("CyCharmCompare", title, WS_OVERLAPPEDWINDOW,
+            CW_USEDEFAULT, CW_USEDEFAULT, 800, 600, NULL, NULL, GetModuleHandle(NULL), NULL);
+        if (g_hCompareWnd == NULL) {
+            return;
+        }
+
+        g_hCompareEdit = CreateWindowExW(0, RICHEDIT_CLASSW, NULL,
+            WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_HSCROLL | ES_MULTILINE | ES_READONLY | ES_AUTOVSCROLL | ES_AUTOHSCROLL,
+            0, 0, 0, 0, g_hCompareWnd, NULL, GetModuleHandle(NULL), NULL);
+        SendMessage(g_hCompareEdit, EM_EXLIMITTEXT, 0, -1);
+
+        RECT clientRect;
+        GetClientRect(g_hCompareWnd, &clientRect);
+        MoveWindow(g_hCompareEdit, 0, 0, clientRect.right, clientRect.bottom, TRUE);
+    } else {
+        SetWindowText(g_hCompareWnd, title);
+    }
+
+    StreamSource source = { rtf, size, 0 };
+    EDITSTREAM stream = { (DWORD_PTR)&source, 0, StreamInCallback };
+    SendMessage(g_hCompareEdit, EM_STREAMIN, SF_RTF, (LPARAM)&stream);
+
+    ShowWindow(g_hCompareWnd, SW_SHOW);
+    SetForegroundWindow(g_hCompareWnd);
+}
+
+// Function to compare the file on disk (old) with the current text (new) and show a unified diff
+void CompareWithFile(const char* path) {
+    FinishAutoSave();
+    if (!SyncDocument()) {
+        return;
+    }
+
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+
+    int encoding = ENCODING_UTF8;
+    size_t oldLength = 0;
+    WCHAR* oldText = ReadTextFile(path, &encoding, &oldLength);
+    size_t newLength = DocLength(&g_document);
+    WCHAR* newText = (WCHAR*)ArenaAlloc(&g_ioArena, (newLength + 1) * sizeof(WCHAR));
+
+    if (oldText == NULL || newText == NULL) {
+        SetCursor(oldCursor);
+        if (newText == NULL) {
+            MessageBox(g_hWnd, "Not enough memory to compare within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+        } else {
+            MessageBox(g_hWnd, "The file could not be read.", "Compare", MB_ICONEXCLAMATION | MB_OK);
+        }
+        ArenaReset(&g_ioArena);
+        return;
+    }
+
+    oldLength = EolNormalize(oldText, oldLength);
+    newLength = DocGetText(&g_document, 0, newLength, newText);
+
+    DiffText oldLines, newLines;
+    DiffResult result;
+    char* rtf = NULL;
+    size_t rtfSize = 0;
+    BOOL ok = DiffTextInit(&oldLines, oldText, oldLength);
+    if (ok) {
+        ok = DiffTextInit(&newLines, newText, newLength);
+        if (ok) {
+            ok = DiffCompute(&oldLines, &newLines, &result);
+            if (ok) {
+                if (result.count > 0) {
+                    rtf = DiffFormatUnified(&oldLines, &newLines, &result, path, "Current text", &rtfSize);
+                    ok = rtf != NULL;
+                }
+                DiffResultFree(&result);
+            }
+            DiffTextFree(&newLines);
+        }
+        DiffTextFree(&oldLines);
+    }
+    SetCursor(oldCursor);
+
+    if (!ok) {
+        MessageBox(g_hWnd, "Not enough memory to compare within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+    } else if (rtf == NULL) {
+        MessageBox(g_hWnd, "The current text is identical to the file.", "Compare", MB_OK | MB_ICONINFORMATION);
+    } else {
+        char title[MAX_PATH + 32];
+        snprintf(title, sizeof(title), "Compare - %s", path);
+        ShowCompareWindow(title, rtf, rtfSize);
+        MemFree(rtf);
+    }
+
+    ArenaReset(&g_ioArena);
+}
+
+// Function prototypes
+LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param);
+LRESULT CALLBACK EditProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param);
+LRESULT CALLBACK FindBarProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param);
+LRESULT CALLBACK TableGotoProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param);
+
+// Original window procedure for the edit control
+WNDPROC g_OldEditProc;
+
+// Function to forward an edit message to the control and describe its change to the document model
+LRESULT CallTrackedEdit(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param) {
+    CHARRANGE before, after;
+    SendMessage(hwnd, EM_EXGETSEL, 0, (LPARAM)&before);
+    LONG lengthBefore = GetEditLength();
+    LONG generation = g_editGeneration;
+
+    BOOL wasTracking = g_bTrackingEdit;
+    BOOL wasChanged = g_bEditChanged;
+    g_bTrackingEdit = TRUE;
+    g_bEditChanged = FALSE;
+
+    LRESULT result = CallWindowProcW(g_OldEditProc, hwnd, message, w_param, l_param);
+
+    BOOL changed = g_bEditChanged;
+    g_bTrackingEdit = wasTracking;
+    g_bEditChanged = wasChanged;
+
+    if (changed) {
+        SendMessage(hwnd, EM_EXGETSEL, 0, (LPARAM)&after);
+        DescribeEdit(before, after, lengthBefore, GetEditLength(), generation);
+    }
+    return result;
+}
+
+// Function to forward an undo or redo to the control and bring the model in step with it at once
+// The change can be anywhere the undo history reaches, so only that span is read back
+LRESULT CallUndoEdit(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param) {
+    BOOL wasUndoing = g_bUndoing;
+    g_bUndoing = TRUE;
+    LRESULT result = CallWindowProcW(g_OldEditProc, hwnd, message, w_param, l_param);
+    g_bUndoing = wasUndoing;
+    if (g_bDocumentStale) {
+        SyncDocument();
+    }
+    return result;
+}
+
+// Function to measure the edit control's font at the current zoom level
+void GetZoomedCharSize(int* charWidth, int* lineHeight) {
+    TEXTMETRIC tm;
+    HGDIOBJ oldFont = SelectObject(g_hWrapDC, g_hFont);
+    GetTextMetrics(g_hWrapDC, &tm);
+    SelectObject(g_hWrapDC, oldFont);
+
+    *charWidth = MulDiv(tm.tmAveCharWidth, g_zoomLevel, 100);
+    *lineHeight = MulDiv(tm.tmHeight, g_zoomLevel, 100);
+    if (*charWidth < 1) {
+        *charWidth = 1;
+    }
+    if (*lineHeight < 1) {
+        *lineHeight = 1;
+    }
+}
+
+// Function to map a point in the edit control to a line and visual column
+// The column comes from the x position, so a block selection can extend past the end of short lines
+void PointToLineColumn(HWND hwnd, int x, int y, size_t* line, size_t* column) {
+    POINTL point = { x, y };
+    LONG offset = (LONG)SendMessage(hwnd, EM_CHARFROMPOS, 0, (LPARAM)&point);
+    *line = DocLineFromOffset(&g_document, (size_t)offset);
+
+    POINTL origin;
+    SendMessage(hwnd, EM_POSFROMCHAR, (WPARAM)&origin, (LPARAM)DocLineStart(&g_document, *line));
+
+    int charWidth, lineHeight;
+    GetZoomedCharSize(&charWidth, &lineHeight);
+    int dx = x - origin.x;
+    *column = dx > 0 ? (size_t)((dx + charWidth / 2) / charWidth) : 0;
+}
+
+// Function to mirror the primary cursor in the control's own selection and repaint the others
+void ShowPrimaryCursor(HWND hwnd) {
+    if (g_cursors.count > 0) {
+        Cursor* primary = &g_cursors.items[g_cursors.primary];
+        SendMessage(hwnd, EM_SETSEL, (WPARAM)primary->anchor, (LPARAM)primary->caret);
+        SendMessage(hwnd, EM_SCROLLCARET, 0, 0);
+    }
+    InvalidateRect(hwnd, NULL, FALSE);
+}
+
+// Function to go back to the control's single cursor
+void ClearCursors() {
+    if (g_cursors.count > 1) {
+        InvalidateRect(g_hEdit, NULL, FALSE);
+    }
+    CursorSetClear(&g_cursors);
+}
+
+// Function to start a cursor set from the control's current selection
+void BeginCursors() {
+    if (g_cursors.count <= 1) {
+        CHARRANGE range;
+        SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&range);
+        CursorSetClear(&g_cursors);
+        CursorSetAdd(&g_cursors, (size_t)range.cpMin, (size_t)range.cpMax, TRUE);
+    }
+}
+
+// Function to apply one edit at every cursor as a single transaction
+// The document model is rebuilt once and the control gets one replacement covering every cursor,
+// so the whole batch is one undo step and one repaint
+void ApplyCursorEdit(int kind, const WCHAR* text, size_t length, BOOL distribute) {
+    if (!SyncDocument()) {
+        return;
+    }
+
+    // Every edit falls within the cursors' selections and a character pair either side of them,
+    // so the words there are counted out of the completion index before the batch and back in after
+    size_t lengthBefore = DocLength(&g_document);
+    size_t spanStart = lengthBefore;
+    size_t spanEnd = 0;
+    for (size_t i = 0; i < g_cursors.count; i++) {
+        Cursor* cursor = &g_cursors.items[i];
+        size_t low = cursor->anchor < cursor->caret ? cursor->anchor : cursor->caret;
+        size_t high = cursor->anchor < cursor->caret ? cursor->caret : cursor->anchor;
+        spanStart = low < spanStart ? low : spanStart;
+        spanEnd = high > spanEnd ? high : spanEnd;
+    }
+    spanStart = spanStart > 2 ? spanStart - 2 : 0;
+    spanEnd = spanEnd + 2 < lengthBefore ? spanEnd + 2 : lengthBefore;
+
+    CursorBatch batch;
+    CompletionRemoveRange(&g_completion, &g_document, spanStart, spanEnd);
+    BOOL edited = CursorSetEdit(&g_cursors, &g_document, kind, text, length, distribute, &batch);
+    CompletionAddRange(&g_completion, &g_document, spanStart, spanEnd + DocLength(&g_document) - lengthBefore);
+    PublishDocument();
+    if (!edited) {
+        MessageBox(g_hWnd, "Not enough memory to edit at every cursor within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+        return;
+    }
+    if (batch.text == NULL) {
+        return;
+    }
+
+    WidenUndoSpan(batch.start, batch.end, lengthBefore);
+    g_bBatchEdit = TRUE;
+    SendMessage(g_hEdit, WM_SETREDRAW, FALSE, 0);
+
+    CHARRANGE range = { (LONG)batch.start, (LONG)batch.end };
+    SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+    SendMessageW(g_hEdit, EM_REPLACESEL, TRUE, (LPARAM)batch.text);
+    g_bBatchEdit = FALSE;
+
+    // If the control refused any of the text, the model has to catch up from it
+    if ((size_t)GetEditLength() != DocLength(&g_document)) {
+        g_bDocumentStale = TRUE;
+    }
+    MemFree(batch.text);
+
+    SendMessage(g_hEdit, WM_SETREDRAW, TRUE, 0);
+    ShowPrimaryCursor(g_hEdit);
+    if (g_cursors.count <= 1) {
+        CursorSetClear(&g_cursors);
+    }
+    UpdateDocumentMemoryUsage();
+}
+
+// Function to paste the clipboard at every cursor, one line per cursor if the line counts match
+void PasteAtCursors() {
+    if (!OpenClipboard(g_hWnd)) {
+        return;
+    }
+
+    HANDLE data = GetClipboardData(CF_UNICODETEXT);
+    const WCHAR* clip = data != NULL ? (const WCHAR*)GlobalLock(data) : NULL;
+    if (clip != NULL) {
+        size_t clipLength = 0;
+        while (clip[clipLength] != L'\0') {
+            clipLength++;
+        }
+
+        // Convert line breaks to the control's '\r' so the model and the control agree
+        WCHAR* text = (WCHAR*)MemAlloc(MEM_SCRATCH, (clipLength + 1) * sizeof(WCHAR));
+        if (text != NULL) {
+            size_t length = 0;
+            for (size_t i = 0; i < clipLength; i++) {
+                if (clip[i] == L'\r' && clip[i + 1] == L'\n') {
+                    i++;
+                }
+                text[length++] = clip[i] == L'\n' ? L'\r' : clip[i];
+            }
+            ApplyCursorEdit(CURSOR_EDIT_INSERT, text, length, TRUE);
+            MemFree(text);
+        }
+        GlobalUnlock(data);
+    }
+    CloseClipboard();
+}
+
+// Function to add a cursor on the line above or below, at the same visual column
+void AddCursorOnLine(int direction) {
+    if (!SyncDocument()) {
+        return;
+    }
+
+    BeginCursors();
+    if (CursorSetAddLine(&g_cursors, &g_document, direction, TAB_WIDTH)) {
+        ShowPrimaryCursor(g_hEdit);
+    }
+    UpdateStatusBar();
+}
+
+// Function to stretch the block selection from its anchor to a point
+void UpdateBlockSelection(HWND hwnd, int x, int y) {
+    size_t line, column;
+    PointToLineColumn(hwnd, x, y, &line, &column);
+    if (CursorSetBlock(&g_cursors, &g_document, g_blockAnchorLine, g_blockAnchorColumn, line, column, TAB_WIDTH)) {
+        ShowPrimaryCursor(hwnd);
+    }
+}
+
+// Function to draw the extra cursors over the edit control once it has painted
+// Drawing is clipped to the area just repainted, so inverted selections never flip back
+void PaintCursors(HWND hwnd, const RECT* update) {
+    if (g_cursors.count <= 1 || g_bDocumentStale) {
+        return;
+    }
+
+    RECT client;
+    GetClientRect(hwnd, &client);
+    POINTL topLeft = { client.left, client.top };
+    POINTL bottomRight = { client.right, client.bottom };
+    size_t first = (size_t)SendMessage(hwnd, EM_CHARFROMPOS, 0, (LPARAM)&topLeft);
+    size_t last = (size_t)SendMessage(hwnd, EM_CHARFROMPOS, 0, (LPARAM)&bottomRight);
+
+    int charWidth, lineHeight;
+    GetZoomedCharSize(&charWidth, &lineHeight);
+
+    HDC hdc = GetDC(hwnd);
+    IntersectClipRect(hdc, update->left, update->top, update->right, update->bottom);
+
+    for (size_t i = CursorSetFindFirst(&g_cursors, first); i < g_cursors.count; i++) {
+        Cursor* cursor = &g_cursors.items[i];
+        size_t start = cursor->anchor < cursor->caret ? cursor->anchor : cursor->caret;
+        size_t end = cursor->anchor < cursor->caret ? cursor->caret : cursor->anchor;
+        if (start > last) {
+            break;
+        }
+
+        // The control draws the primary cursor itself
+        if (i == g_cursors.primary) {
+            continue;
+        }
+
+        // Selection, one rectangle per line it covers
+        for (size_t from = start; from < end;) {
+            size_t line = DocLineFromOffset(&g_document, from);
+            size_t next = line + 1 < DocLineCount(&g_document) ? DocLineStart(&g_document, line + 1) : DocLength(&g_document);
+            size_t to = next > from + 1 && next - 1 < end ? next - 1 : end;
+
+            POINTL a, b;
+            SendMessage(hwnd, EM_POSFROMCHAR, (WPARAM)&a, (LPARAM)from);
+            SendMessage(hwnd, EM_POSFROMCHAR, (WPARAM)&b, (LPARAM)to);
+            RECT rect = { a.x, a.y, to < end ? b.x + charWidth : b.x, a.y + lineHeight };
+            InvertRect(hdc, &rect);
+            from = next > from ? next : end;
+        }
+
+        // Caret
+        POINTL caret;
+        SendMessage(hwnd, EM_POSFROMCHAR, (WPARAM)&caret, (LPARAM)cursor->caret);
+        PatBlt(hdc, caret.x, caret.y, 2, lineHeight, DSTINVERT);
+    }
+
+    ReleaseDC(hwnd, hdc);
+}
+
+// Function to get the cell a character occupies in the edit control
+void GetCharRect(LONG offset, RECT* rect) {
+    int charWidth, lineHeight;
+    GetZoomedCharSize(&charWidth, &lineHeight);
+
+    POINTL position;
+    SendMessage(g_hEdit, EM_POSFROMCHAR, (WPARAM)&position, (LPARAM)offset);
+    SetRect(rect, position.x, position.y, position.x + charWidth, position.y + lineHeight);
+}
+
+// Function to find the bracket pair at the caret and repaint the old and new highlights
+// Both lookups use the document's bracket summaries, so this stays cheap on every caret move
+void UpdateBracketMatch() {
+    LONG pair[2] = { -1, -1 };
+    CHARRANGE selection;
+    SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&selection);
+
+    if (selection.cpMin == selection.cpMax && g_cursors.count <= 1 && SyncDocument()) {
+        // A bracket after the caret takes precedence over one before it
+        size_t match;
+        if (DocFindMatchingBracket(&g_document, (size_t)selection.cpMin, &match)) {
+            pair[0] = selection.cpMin;
+            pair[1] = (LONG)match;
+        } else if (selection.cpMin > 0 && DocFindMatchingBracket(&g_document, (size_t)selection.cpMin - 1, &match)) {
+            pair[0] = selection.cpMin - 1;
+            pair[1] = (LONG)match;
+        }
+    }
+
+    if (pair[0] == g_bracketPair[0] && pair[1] == g_bracketPair[1]) {
+        return;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        RECT rect;
+        if (g_bracketPair[i] >= 0) {
+            GetCharRect(g_bracketPair[i], &rect);
+            InvalidateRect(g_hEdit, &rect, FALSE);
+        }
+        g_bracketPair[i] = pair[i];
+        if (pair[i] >= 0) {
+            GetCharRect(pair[i], &rect);
+            InvalidateRect(g_hEdit, &rect, FALSE);
+        }
+    }
+}
+
+// Function to frame the bracket pair once the edit control has painted; a pair of different kinds is framed in red
+void PaintBracketMatch(HWND hwnd, const RECT* update) {
+    if (g_bracketPair[0] < 0 || g_bDocumentStale) {
+        return;
+    }
+
+    WCHAR first = DocCharAt(&g_document, (size_t)g_bracketPair[0]);
+    WCHAR second = DocCharAt(&g_document, (size_t)g_bracketPair[1]);
+    BOOL paired = g_bracketPair[0] < g_bracketPair[1] ? StructBracketsPair(first, second) : StructBracketsPair(second, first);
+    HBRUSH brush = CreateSolidBrush(paired ? RGB(128, 128, 128) : RGB(220, 0, 0));
+
+    HDC hdc = GetDC(hwnd);
+    IntersectClipRect(hdc, update->left, update->top, update->right, update->bottom);
+    for (int i = 0; i < 2; i++) {
+        RECT rect;
+        GetCharRect(g_bracketPair[i], &rect);
+        FrameRect(hdc, &rect, brush);
+    }
+    ReleaseDC(hwnd, hdc);
+    DeleteObject(brush);
+}
+
+// Function to fold the block that starts on the caret's line, or unfold it if it is folded
+// Folded lines are hidden with character formatting, so the text is never copied or moved
+void ToggleFold() {
+    if (!SyncDocument()) {
+        return;
+    }
+
+    CHARRANGE selection;
+    SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&selection);
+    size_t line = DocLineFromOffset(&g_document, (size_t)selection.cpMin);
+    size_t lastLine;
+    if (!DocFindFold(&g_document, line, &lastLine)) {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    // Hide whole lines, line breaks included, so the folded lines take no space
+    CHARRANGE range;
+    range.cpMin = (LONG)DocLineStart(&g_document, line + 1);
+    range.cpMax = lastLine + 1 < DocLineCount(&g_document) ? (LONG)DocLineStart(&g_document, lastLine + 1) : (LONG)DocLength(&g_document);
+
+    SendMessage(g_hEdit, WM_SETREDRAW, FALSE, 0);
+    SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+
+    CHARFORMAT2W format;
+    ZeroMemory(&format, sizeof(format));
+    format.cbSize = sizeof(format);
+    SendMessage(g_hEdit, EM_GETCHARFORMAT, SCF_SELECTION, (LPARAM)&format);
+    BOOL folded = (format.dwMask & CFM_HIDDEN) && (format.dwEffects & CFE_HIDDEN);
+
+    format.dwMask = CFM_HIDDEN;
+    format.dwEffects = folded ? 0 : CFE_HIDDEN;
+    SendMessage(g_hEdit, EM_SETCHARFORMAT, SCF_SELECTION, (LPARAM)&format);
+
+    SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&selection);
+    SendMessage(g_hEdit, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(g_hEdit, NULL, TRUE);
+}
+
+// Function to show every folded line again
+void UnfoldAll() {
+    CHARFORMAT2W format;
+    ZeroMemory(&format, sizeof(format));
+    format.cbSize = sizeof(format);
+    format.dwMask = CFM_HIDDEN;
+    SendMessage(g_hEdit, EM_SETCHARFORMAT, SCF_ALL, (LPARAM)&format);
+    InvalidateRect(g_hEdit, NULL, TRUE);
+}
+
+// Function to hide the completion list
+void HideCompletion() {
+    if (g_hCompletion != NULL && IsWindowVisible(g_hCompletion)) {
+        ShowWindow(g_hCompletion, SW_HIDE);
+    }
+}
+
+// Function to offer completions for the word just typed, in a list under it
+// Only shown at the end of a word, with a single empty selection
+void UpdateCompletion() {
+    CHARRANGE selection;
+    SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&selection);
+    if (g_cursors.count > 1 || selection.cpMin != selection.cpMax || !SyncDocument()) {
+        HideCompletion();
+        return;
+    }
+
+    size_t caret = (size_t)selection.cpMin;
+    size_t start = caret;
+    while (start > 0 && caret - start <= COMPLETION_MAX_WORD && CompletionIsWordChar(DocCharAt(&g_document, start - 1))) {
+        start--;
+    }
+    int length = (int)(caret - start);
+    if (length < COMPLETION_MIN_PREFIX || length > COMPLETION_MAX_WORD ||
+        (caret < DocLength(&g_document) && CompletionIsWordChar(DocCharAt(&g_document, caret)))) {
+        HideCompletion();
+        return;
+    }
+
+    WCHAR prefix[COMPLETION_MAX_WORD];
+    DocGetText(&g_document, start, caret, prefix);
+    CompletionCandidate candidates[COMPLETION_MAX_CANDIDATES];
+    size_t count = CompletionLookup(&g_completion, prefix, length, candidates, COMPLETION_MAX_CANDIDATES);
+    if (count == 0) {
+        HideCompletion();
+        return;
+    }
+
+    // The list never takes activation or focus, so typing carries on in the editor
+    DWORD style = WS_POPUP | WS_BORDER;
+    DWORD exStyle = WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE;
+    if (g_hCompletion == NULL) {
+        g_hCompletion = CreateWindowExW(exStyle, L"LISTBOX", NULL, style,
+            0, 0, 0, 0, g_hWnd, NULL, GetModuleHandle(NULL), NULL);
+        if (g_hCompletion == NULL) {
+            return;
+        }
+        SendMessage(g_hCompletion, WM_SETFONT, (WPARAM)g_hFont, FALSE);
+    }
+
+    SendMessage(g_hCompletion, WM_SETREDRAW, FALSE, 0);
+    SendMessage(g_hCompletion, LB_RESETCONTENT, 0, 0);
+
+    HDC hdc = GetDC(g_hCompletion);
+    HGDIOBJ oldFont = SelectObject(hdc, g_hFont);
+    int width = 0;
+    for (size_t i = 0; i < count; i++) {
+        WCHAR item[COMPLETION_MAX_WORD + 1];
+        memcpy(item, candidates[i].text, candidates[i].length * sizeof(WCHAR));
+        item[candidates[i].length] = L'\0';
+        SendMessageW(g_hCompletion, LB_ADDSTRING, 0, (LPARAM)item);
+
+        SIZE extent;
+        if (GetTextExtentPoint32W(hdc, item, candidates[i].length, &extent) && extent.cx > width) {
+            width = extent.cx;
+        }
+    }
+    SelectObject(hdc, oldFont);
+    ReleaseDC(g_hCompletion, hdc);
+    SendMessage(g_hCompletion, LB_SETCURSEL, 0, 0);
+
+    // Line the list up under the start of the word
+    RECT wordRect;
+    GetCharRect((LONG)start, &wordRect);
+    POINT position = { wordRect.left, wordRect.bottom };
+    ClientToScreen(g_hEdit, &position);
+
+    int itemHeight = (int)SendMessage(g_hCompletion, LB_GETITEMHEIGHT, 0, 0);
+    RECT frame = { 0, 0, width + 2 * GetSystemMetrics(SM_CXEDGE) + 8, itemHeight * (int)count };
+    AdjustWindowRectEx(&frame, style, FALSE, exStyle);
+
+    SendMessage(g_hCompletion, WM_SETREDRAW, TRUE, 0);
+    SetWindowPos(g_hCompletion, HWND_TOP, position.x, position.y, frame.right - frame.left, frame.bottom - frame.top,
+        SWP_NOACTIVATE | SWP_SHOWWINDOW);
+    InvalidateRect(g_hCompletion, NULL, TRUE);
+    g_completionStart = (LONG)start;
+}
+
+// Function to replace the word being completed with the selected candidate
+// The replacement goes through the edit control, so it is one undo step and is tracked like typing
+void AcceptCompletion() {
+    WCHAR item[COMPLETION_MAX_WORD + 1];
+    int selected = (int)SendMessage(g_hCompletion, LB_GETCURSEL, 0, 0);
+    BOOL valid = selected != LB_ERR && SendMessageW(g_hCompletion, LB_GETTEXTLEN, selected, 0) <= COMPLETION_MAX_WORD;
+    if (valid) {
+        SendMessageW(g_hCompletion, LB_GETTEXT, selected, (LPARAM)item);
+    }
+    HideCompletion();
+    if (!valid) {
+        return;
+    }
+
+    CHARRANGE selection;
+    SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&selection);
+    CHARRANGE word = { g_completionStart, selection.cpMin };
+    SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&word);
+    SendMessageW(g_hEdit, EM_REPLACESEL, TRUE, (LPARAM)item);
+}
+
+// Function to let the completion list take the keys it uses while it is showing
+// Up and Down pick a candidate, Enter or Tab accept it, Escape and moving away close the list
+BOOL HandleCompletionMessage(HWND hwnd, UINT message, WPARAM w_param) {
+    if (g_hCompletion == NULL || !IsWindowVisible(g_hCompletion)) {
+        return FALSE;
+    }
+
+    switch (message) {
+    case WM_KEYDOWN:
+    {
+        int count = (int)SendMessage(g_hCompletion, LB_GETCOUNT, 0, 0);
+        int selected = (int)SendMessage(g_hCompletion, LB_GETCURSEL, 0, 0);
+        switch (w_param) {
+        case VK_UP:
+        case VK_DOWN:
+            if (count > 0) {
+                selected = w_param == VK_UP ? selected + count - 1 : selected + 1;
+                SendMessage(g_hCompletion, LB_SETCURSEL, selected % count, 0);
+            }
+            return TRUE;
+        case VK_RETURN:
+        case VK_TAB:
+            AcceptCompletion();
+            g_swallowChar = w_param == VK_RETURN ? L'\r' : L'\t';
+            return TRUE;
+        case VK_ESCAPE:
+            HideCompletion();
+            g_swallowChar = 0x1B;
+            return TRUE;
+        case VK_LEFT:
+        case VK_RIGHT:
+        case VK_HOME:
+        case VK_END:
+        case VK_PRIOR:
+        case VK_NEXT:
+        case VK_DELETE:
+            HideCompletion();
+            break;
+        }
+        break;
+    }
+
+    case WM_KILLFOCUS:
+    case WM_LBUTTONDOWN:
+    case WM_RBUTTONDOWN:
+    case WM_MOUSEWHEEL:
+    case WM_VSCROLL:
+    case WM_HSCROLL:
+        HideCompletion();
+        break;
+    }
+    return FALSE;
+}
+
+// Function to tell whether the find bar is open
+BOOL IsFindBarVisible() {
+    return g_hFindBar != NULL && IsWindowVisible(g_hFindBar);
+}
+
+// Function to lay out the main window's children again, e.g. after the find bar opens or closes
+void RelayoutMainWindow() {
+    RECT client;
+    GetClientRect(g_hWnd, &client);
+    SendMessage(g_hWnd, WM_SIZE, SIZE_RESTORED, MAKELPARAM(client.right, client.bottom));
+}
+
+// Function to select a match and scroll it into view
+void SelectMatch(size_t match, int length) {
+    SendMessage(g_hEdit, EM_SETSEL, (WPARAM)match, (LPARAM)(match + length));
+    SendMessage(g_hEdit, EM_SCROLLCARET, 0, 0);
+    UpdateStatusBar();
+}
+
+// Function to show how many matches the search has found so far
+void UpdateFindStatus() {
+    BOOL complete;
+    size_t count = SearchGetCount(&g_search, &complete);
+
+    char status[64] = "";
+    if (g_search.queryLength > 0) {
+        if (count == 0 && complete) {
+            strcpy(status, " No matches");
+        } else {
+            snprintf(status, sizeof(status), complete ? " %zu matches" : " %zu matches so far...", count);
+        }
+    }
+    SetWindowText(g_hFindStatus, status);
+}
+
+// Function to search for the find bar's query as it is typed
+// Matches in view are highlighted on the next paint straight from the text, so every keystroke is
+// cheap; the rest are found on a background thread, which narrows down the previous matches when
+// the query only grew. With jump set, the first match after the origin is selected once known.
+void UpdateSearch(BOOL jump) {
+    KillTimer(g_hWnd, SEARCH_TIMER_ID);
+
+    WCHAR query[SEARCH_MAX_QUERY + 1];
+    int length = GetWindowTextW(g_hFindBar, query, SEARCH_MAX_QUERY + 1);
+    g_bSearchJumpPending = FALSE;
+    if (length == 0 || !SyncDocument()) {
+        SearchClear(&g_search);
+    } else if (SearchStart(&g_search, &g_document, query, length, g_hWnd, WM_SEARCH_PROGRESS) && jump) {
+        // A match between the origin and the bottom of the view can be selected right away
+        RECT client;
+        GetClientRect(g_hEdit, &client);
+        POINTL bottomRight = { client.right, client.bottom };
+        size_t last = (size_t)SendMessage(g_hEdit, EM_CHARFROMPOS, 0, (LPARAM)&bottomRight);
+
+        size_t match;
+        if (SearchRange(&g_document, query, length, (size_t)g_searchOrigin, last + 1, &match, 1) == 1) {
+            SelectMatch(match, length);
+        } else {
+            g_bSearchJumpPending = TRUE;
+        }
+    }
+
+    UpdateFindStatus();
+    InvalidateRect(g_hEdit, NULL, FALSE);
+}
+
+// Function to take in the background search's progress
+void ShowSearchProgress() {
+    if (g_bSearchJumpPending) {
+        BOOL complete;
+        size_t match;
+        SearchGetCount(&g_search, &complete);
+        if (SearchFindNext(&g_search, (size_t)g_searchOrigin, TRUE, &match) ||
+            (complete && SearchFindNext(&g_search, 0, TRUE, &match))) {
+            SelectMatch(match, g_search.queryLength);
+            g_bSearchJumpPending = FALSE;
+        } else if (complete) {
+            g_bSearchJumpPending = FALSE;
+        }
+    }
+    UpdateFindStatus();
+}
+
+// Function to find the next or previous match from an offset straight from the text, wrapping around
+// the document; a window is searched at a time, so only the text up to the match is read
+BOOL FindMatchInText(size_t from, BOOL forward, size_t* match) {
+    size_t length = DocLength(&g_document);
+    from = from < length ? from : length;
+
+    if (forward) {
+        // From the offset to the end, then from the top up to the offset
+        for (int pass = 0; pass < 2; pass++) {
+            size_t end = pass == 0 ? length : from;
+            for (size_t start = pass == 0 ? from : 0; start < end; start += FIND_SCAN_WINDOW) {
+                size_t windowEnd = end - start > FIND_SCAN_WINDOW ? start + FIND_SCAN_WINDOW : end;
+                if (SearchRange(&g_document, g_search.query, g_search.queryLength, start, windowEnd, match, 1) == 1) {
+                    return TRUE;
+                }
+            }
+        }
+        return FALSE;
+    }
+
+    // From the offset back to the top, then from the end back to the offset; the last match in a window wins
+    size_t matches[FIND_MAX_HIGHLIGHTS];
+    for (int pass = 0; pass < 2; pass++) {
+        size_t limit = pass == 0 ? 0 : from;
+        for (size_t end = pass == 0 ? from : length; end > limit; ) {
+            size_t start = end - limit > FIND_SCAN_WINDOW ? end - FIND_SCAN_WINDOW : limit;
+            BOOL found = FALSE;
+            size_t count;
+            for (size_t at = start; (count = SearchRange(&g_document, g_search.query, g_search.queryLength, at, end,
+                    matches, FIND_MAX_HIGHLIGHTS)) > 0; at = *match + 1) {
+                *match = matches[count - 1];
+                found = TRUE;
+                if (count < FIND_MAX_HIGHLIGHTS) {
+                    break;
+                }
+            }
+            if (found) {
+                return TRUE;
+            }
+            end = start;
+        }
+    }
+    return FALSE;
+}
+
+// Function to move to the next or previous match from the selection, wrapping around the document
+void FindNextMatch(BOOL forward) {
+    if (g_search.queryLength == 0) {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    // Edits since the search started move the matches; search the current text first
+    if (!SyncDocument()) {
+        return;
+    }
+    if (g_search.snapshot.root != g_document.root) {
+        UpdateSearch(FALSE);
+    }
+
+    CHARRANGE selection;
+    SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&selection);
+    size_t from = forward ? (size_t)selection.cpMin + 1 : (size_t)selection.cpMin;
+
+    // Until the background search has been through the whole text, the matches it knows of may not
+    // be the nearest ones, or there may be none yet, as right after an edit; the text is searched instead
+    BOOL complete;
+    size_t match;
+    SearchGetCount(&g_search, &complete);
+    BOOL found = complete ?
+        SearchFindNext(&g_search, from, forward, &match) || SearchFindNext(&g_search, forward ? 0 : (size_t)-1, forward, &match) :
+        FindMatchInText(from, forward, &match);
+    if (found) {
+        SelectMatch(match, g_search.queryLength);
+    } else {
+        MessageBeep(MB_OK);
+    }
+}
+
+// Function to draw a frame around each match in view
+void PaintSearchMatches(HWND hwnd, const RECT* update) {
+    if (!IsFindBarVisible() || g_search.queryLength == 0 || g_bDocumentStale) {
+        return;
+    }
+
+    RECT client;
+    GetClientRect(hwnd, &client);
+    POINTL topLeft = { client.left, client.top };
+    POINTL bottomRight = { client.right, client.bottom };
+    size_t first = (size_t)SendMessage(hwnd, EM_CHARFROMPOS, 0, (LPARAM)&topLeft);
+    size_t last = (size_t)SendMessage(hwnd, EM_CHARFROMPOS, 0, (LPARAM)&bottomRight);
+
+    size_t matches[FIND_MAX_HIGHLIGHTS];
+    size_t count = SearchRange(&g_document, g_search.query, g_search.queryLength, first, last + 1, matches, FIND_MAX_HIGHLIGHTS);
+    if (count == 0) {
+        return;
+    }
+
+    HBRUSH brush = CreateSolidBrush(RGB(255, 140, 0));
+    HDC hdc = GetDC(hwnd);
+    IntersectClipRect(hdc, update->left, update->top, update->right, update->bottom);
+    for (size_t i = 0; i < count; i++) {
+        RECT rect;
+        GetCharRect((LONG)matches[i], &rect);
+
+        // Stretch the frame to the end of the match when it ends on the same row
+        POINTL end;
+        SendMessage(hwnd, EM_POSFROMCHAR, (WPARAM)&end, (LPARAM)(matches[i] + g_search.queryLength));
+        if (end.y == rect.top && end.x > rect.left) {
+            rect.right = end.x;
+        }
+        FrameRect(hdc, &rect, brush);
+    }
+    ReleaseDC(hwnd, hdc);
+    DeleteObject(brush);
+}
+
+// Function to open the find bar, starting from the selection and searching for it if it is a short piece of one line
+void ShowFindBar() {
+    if (g_hFindBar == NULL) {
+        g_hFindBar = CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", L"", WS_CHILD | ES_AUTOHSCROLL,
+            0, 0, 0, 0, g_hWnd, (HMENU)IDC_FINDBAR, GetModuleHandle(NULL), NULL);
+        g_hFindStatus = CreateWindowExW(0, L"STATIC", L"", WS_CHILD | SS_LEFT | SS_CENTERIMAGE,
+            0, 0, 0, 0, g_hWnd, (HMENU)IDC_FINDSTATUS, GetModuleHandle(NULL), NULL);
+        if (g_hFindBar == NULL || g_hFindStatus == NULL) {
+            return;
+        }
+        SendMessage(g_hFindBar, WM_SETFONT, (WPARAM)g_hFont, FALSE);
+        SendMessage(g_hFindStatus, WM_SETFONT, (WPARAM)GetStockObject(DEFAULT_GUI_FONT), FALSE);
+        SendMessage(g_hFindBar, EM_LIMITTEXT, SEARCH_MAX_QUERY, 0);
+        g_OldFindProc = (WNDPROC)SetWindowLongPtrW(g_hFindBar, GWLP_WNDPROC, (LONG_PTR)FindBarProc);
+    }
+
+    CHARRANGE selection;
+    SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&selection);
+    g_searchOrigin = selection.cpMin;
+    if (selection.cpMax > selection.cpMin && selection.cpMax - selection.cpMin <= SEARCH_MAX_QUERY) {
+        WCHAR* text = GetEditTextRange(MEM_SCRATCH, selection.cpMin, selection.cpMax);
+        if (text != NULL) {
+            BOOL singleLine = TRUE;
+            for (LONG i = 0; i < selection.cpMax - selection.cpMin; i++) {
+                singleLine = singleLine && text[i] != L'\r';
+            }
+            if (singleLine) {
+                SetWindowTextW(g_hFindBar, text);
+            }
+        }
+        MemFree(text);
+    }
+
+    // Keep the current match visible as a selection while the find bar has the focus
+    if (!IsFindBarVisible()) {
+        ShowWindow(g_hFindBar, SW_SHOW);
+        ShowWindow(g_hFindStatus, SW_SHOW);
+        SendMessage(g_hEdit, EM_SETOPTIONS, ECOOP_OR, ECO_NOHIDESEL);
+        RelayoutMainWindow();
+    }
+    SetFocus(g_hFindBar);
+    SendMessage(g_hFindBar, EM_SETSEL, 0, -1);
+    UpdateSearch(FALSE);
+}
+
+// Function to close the find bar and stop searching
+void HideFindBar() {
+    if (!IsFindBarVisible()) {
+        return;
+    }
+
+    KillTimer(g_hWnd, SEARCH_TIMER_ID);
+    SearchClear(&g_search);
+    g_bSearchJumpPending = FALSE;
+    ShowWindow(g_hFindBar, SW_HIDE);
+    ShowWindow(g_hFindStatus, SW_HIDE);
+    SendMessage(g_hEdit, EM_SETOPTIONS, ECOOP_AND, ~ECO_NOHIDESEL);
+    RelayoutMainWindow();
+    SetFocus(g_hEdit);
+    InvalidateRect(g_hEdit, NULL, FALSE);
+}
+
+// Window procedure for the find bar: Enter and F3 find the next match (with Shift, the previous one)
+// and Escape closes the bar
+LRESULT CALLBACK FindBarProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param) {
+    switch (message) {
+    case WM_KEYDOWN:
+        if (w_param == VK_RETURN || w_param == VK_F3) {
+            FindNextMatch((GetKeyState(VK_SHIFT) & 0x8000) == 0);
+            return 0;
+        }
+        if (w_param == VK_ESCAPE) {
+            HideFindBar();
+            return 0;
+        }
+        break;
+
+    case WM_CHAR:
+        // Handled on key down; a single-line edit control would only beep at them
+        if (w_param == L'\r' || w_param == 0x1B) {
+            return 0;
+        }
+        break;
+    }
+    return CallWindowProcW(g_OldFindProc, hwnd, message, w_param, l_param);
+}
+
+// Function to handle the find keys in the editor: Ctrl+F opens the find bar, F3 and Shift+F3 move
+// between matches and Escape closes the bar
+BOOL HandleFindKey(UINT message, WPARAM w_param) {
+    if (message != WM_KEYDOWN) {
+        return FALSE;
+    }
+
+    if (w_param == 'F' && (GetKeyState(VK_CONTROL) & 0x8000)) {
+        ShowFindBar();
+        g_swallowChar = 0x06; // Ctrl+F
+        return TRUE;
+    }
+    if (w_param == VK_F3) {
+        if (IsFindBarVisible()) {
+            FindNextMatch((GetKeyState(VK_SHIFT) & 0x8000) == 0);
+        } else {
+            ShowFindBar();
+        }
+        return TRUE;
+    }
+    if (w_param == VK_ESCAPE && IsFindBarVisible()) {
+        HideFindBar();
+        g_swallowChar = 0x1B;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// Function to run a Line Operations command over the selected lines, or the whole document
+// The lines are reordered as references into one copy of the text and written back with a single
+// replacement, so the operation is one undo step
+void ApplyLineOperation(UINT command) {
+    ClearCursors();
+    if (!SyncDocument()) {
+        return;
+    }
+
+    // Keep and Remove use the find bar's text as their pattern
+    WCHAR pattern[SEARCH_MAX_QUERY + 1];
+    int patternLength = 0;
+    if (command == 46 || command == 47) {
+        if (g_hFindBar != NULL) {
+            patternLength = GetWindowTextW(g_hFindBar, pattern, SEARCH_MAX_QUERY + 1);
+        }
+        if (patternLength == 0) {
+            ShowFindBar();
+            MessageBox(g_hWnd, "Type the text to match in the find bar first.", "Line Operations", MB_OK | MB_ICONINFORMATION);
+            return;
+        }
+    }
+
+    // Whole lines only; a selection ending at the start of a line does not take that line in,
+    // and a final empty line stays where it is
+    CHARRANGE selection;
+    SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&selection);
+    size_t length = DocLength(&g_document);
+    size_t firstLine = 0;
+    size_t lastLine = DocLineCount(&g_document) - 1;
+    if (selection.cpMin != selection.cpMax) {
+        size_t selectionEnd = (size_t)selection.cpMax < length ? (size_t)selection.cpMax : length;
+        firstLine = DocLineFromOffset(&g_document, (size_t)selection.cpMin);
+        lastLine = DocLineFromOffset(&g_document, selectionEnd);
+        if (lastLine > firstLine && DocLineStart(&g_document, lastLine) == selectionEnd) {
+            lastLine--;
+        }
+    } else if (lastLine > 0 && DocLineLength(&g_document, lastLine) == 0) {
+        lastLine--;
+    }
+    size_t start = DocLineStart(&g_document, firstLine);
+    size_t end = DocLineStart(&g_document, lastLine) + DocLineLength(&g_document, lastLine);
+
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    WCHAR* text = (WCHAR*)MemAlloc(MEM_SCRATCH, (end - start + 1) * sizeof(WCHAR));
+    WCHAR* result = NULL;
+    size_t resultLength = 0;
+    LineSet lines;
+    BOOL ok = text != NULL && LineSetInit(&lines, text, DocGetText(&g_document, start, end, text));
+    if (ok) {
+        switch (command) {
+        case 40: ok = LineSetSort(&lines, LINES_SORT_LEXICAL); break;
+        case 41: ok = LineSetSort(&lines, LINES_SORT_NUMERIC); break;
+        case 42: ok = LineSetSort(&lines, LINES_SORT_NATURAL); break;
+        case 43: ok = LineSetSort(&lines, LINES_SORT_CASELESS); break;
+        case 44: ok = LineSetUnique(&lines); break;
+        case 45: LineSetReverse(&lines); break;
+        case 46: ok = LineSetFilter(&lines, pattern, patternLength, TRUE); break;
+        case 47: ok = LineSetFilter(&lines, pattern, patternLength, FALSE); break;
+        }
+        if (ok) {
+            result = LineSetJoin(&lines, &resultLength);
+            ok = result != NULL;
+        }
+        LineSetFree(&lines);
+    }
+    SetCursor(oldCursor);
+
+    if (!ok) {
+        MessageBox(g_hWnd, "Not enough memory for the line operation within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+    } else if (resultLength != end - start || memcmp(result, text, resultLength * sizeof(WCHAR)) != 0) {
+        HideCompletion();
+        g_bBatchEdit = TRUE;
+        SendMessage(g_hEdit, WM_SETREDRAW, FALSE, 0);
+
+        CHARRANGE range = { (LONG)start, (LONG)end };
+        SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+        SendMessageW(g_hEdit, EM_REPLACESEL, TRUE, (LPARAM)result);
+        g_bBatchEdit = FALSE;
+        if (!ReplaceDocumentRange(start, end, result, resultLength) || (size_t)GetEditLength() != DocLength(&g_document)) {
+            g_bDocumentStale = TRUE;
+        }
+
+        range.cpMax = (LONG)(start + resultLength);
+        SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+        SendMessage(g_hEdit, WM_SETREDRAW, TRUE, 0);
+        InvalidateRect(g_hEdit, NULL, TRUE);
+        UpdateDocumentMemoryUsage();
+    }
+    MemFree(result);
+    MemFree(text);
+}
+
+// Function to show how far formatting has got in the status bar
+void ShowFormatProgress(size_t done, size_t total, void* context) {
+    char progressText[64];
+    snprintf(progressText, sizeof(progressText), "Formatting... %d%%", total > 0 ? (int)(done * 100 / total) : 100);
+    SendMessage(g_hStatusBar, SB_SETTEXT, SB_PART_POSITION, (LPARAM)progressText);
+    UpdateWindow(g_hStatusBar);
+}
+
+// Function to pretty-print or minify the selection, or the whole document, as JSON or XML
+// The result is written a chunk at a time into a new version of the document and streamed from
+// there into the control, so the text is never held in one piece
+void FormatDocumentText(BOOL minify) {
+    ClearCursors();
+    if (!SyncDocument()) {
+        return;
+    }
+
+    CHARRANGE selection;
+    SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&selection);
+    size_t length = DocLength(&g_document);
+    size_t start = 0;
+    size_t end = length;
+    if (selection.cpMin != selection.cpMax) {
+        start = (size_t)selection.cpMin < length ? (size_t)selection.cpMin : length;
+        end = (size_t)selection.cpMax < length ? (size_t)selection.cpMax : length;
+    }
+    if (start == end) {
+        return;
+    }
+
+    // The language is told from the first character of the text that is not whitespace
+    WCHAR sample[FORMAT_DETECT_SAMPLE];
+    size_t sampleEnd = end - start < FORMAT_DETECT_SAMPLE ? end : start + FORMAT_DETECT_SAMPLE;
+    int language = FormatDetectLanguage(sample, DocGetText(&g_document, start, sampleEnd, sample));
+
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    Document formatted;
+    DocInit(&formatted);
+    DocCopy(&formatted, &g_document);
+    size_t written = 0;
+    BOOL malformed = FALSE;
+    BOOL ok = DocReplace(&formatted, start, end, NULL, 0) &&
+        FormatDocumentRange(&g_document, start, end, language, minify, TAB_WIDTH, &formatted, start, &written,
+            ShowFormatProgress, NULL, &malformed);
+    SetCursor(oldCursor);
+
+    if (!ok) {
+        DocFree(&formatted);
+        UpdateStatusBar();
+        if (malformed) {
+            MessageBox(g_hWnd, language == FORMAT_XML ? "The text is not well-formed XML, so it was left as it was." :
+                "The text is not well-formed JSON, so it was left as it was.", "Format", MB_OK | MB_ICONEXCLAMATION);
+        } else {
+            MessageBox(g_hWnd, "Not enough memory to format the text within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+        }
+        return;
+    }
+    if (HashEqual(DocHash(&formatted), DocHash(&g_document))) {
+        // Already formatted
+        DocFree(&formatted);
+        return;
+    }
+
+    // The new version replaces the model, moving the completion index's words over with it
+    HideCompletion();
+    WidenUndoSpan(start, end, DocLength(&g_document));
+    CompletionRemoveRange(&g_completion, &g_document, start, end);
+    DocCopy(&g_document, &formatted);
+    DocFree(&formatted);
+    CompletionAddRange(&g_completion, &g_document, start, start + written);
+    PublishDocument();
+
+    g_bBatchEdit = TRUE;
+    SendMessage(g_hEdit, WM_SETREDRAW, FALSE, 0);
+
+    StreamDocumentRange((LONG)start, (LONG)end, &g_document, start, start + written);
+    g_bBatchEdit = FALSE;
+
+    // If the control refused any of the text, the model has to catch up from it
+    if ((size_t)GetEditLength() != DocLength(&g_document)) {
+        g_bDocumentStale = TRUE;
+    }
+
+    CHARRANGE range = { (LONG)start, (LONG)(start + written) };
+    SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+    SendMessage(g_hEdit, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(g_hEdit, NULL, TRUE);
+    UpdateDocumentMemoryUsage();
+}
+
+// Function to report why the source could not be read to the end
+void ShowSourceReadError(const SourceReader* reader) {
+    MessageBox(g_hWnd, reader->damaged ? "The compressed file is damaged; the text after the damage could not be read." :
+        "Not enough memory to decode the file within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+}
+
+// Function to decode the retained bytes of the lines in view in the reload's encoding and put
+// them in place of the lines there now, keeping the view where it was
+void ReplaceVisibleLines() {
+    RECT client;
+    GetClientRect(g_hEdit, &client);
+    POINTL topLeft = { client.left, client.top };
+    POINTL bottomRight = { client.right, client.bottom };
+    size_t firstLine = DocLineFromOffset(&g_document, (size_t)SendMessage(g_hEdit, EM_CHARFROMPOS, 0, (LPARAM)&topLeft));
+    size_t lastLine = DocLineFromOffset(&g_document, (size_t)SendMessage(g_hEdit, EM_CHARFROMPOS, 0, (LPARAM)&bottomRight));
+
+    // Line breaks are the same bytes whatever the encoding, so the lines are found without decoding
+    // anything before them; a compressed file is decompressed from the last seek point before them
+    SourceReader reader;
+    const unsigned char* bytes = NULL;
+    size_t size = 0;
+    BOOL final = FALSE;
+    if (!SourceReaderOpen(&reader, &g_source)) {
+        return;
+    }
+    if (!SourceReaderSeekLine(&reader, g_reload.encoding, firstLine) || !SourceReaderPeek(&reader, &bytes, &size, &final)) {
+        SourceReaderClose(&reader);
+        return;
+    }
+    size_t lines = lastLine - firstLine + 1;
+    size_t byteEnd = SourceSkipLines(bytes, size, g_reload.encoding, 0, &lines);
+    if (byteEnd > ENCODING_RELOAD_VISIBLE_LIMIT) {
+        SourceReaderClose(&reader);
+        return; // A very long line is left to the slices like everything else
+    }
+
+    size_t start = DocLineStart(&g_document, firstLine);
+    size_t end = lastLine + 1 < DocLineCount(&g_document) ? DocLineStart(&g_document, lastLine + 1) : DocLength(&g_document);
+    size_t length = 0;
+    WCHAR* text = DecodeBytes(&g_ioArena, bytes, byteEnd, g_reload.encoding, &length);
+    if (text != NULL) {
+        length = EolNormalize(text, length);
+        text[length] = L'\0';
+
+        LONG topLine = (LONG)SendMessage(g_hEdit, EM_GETFIRSTVISIBLELINE, 0, 0);
+        g_bBatchEdit = TRUE;
+        SendMessage(g_hEdit, WM_SETREDRAW, FALSE, 0);
+        CHARRANGE range = { (LONG)start, (LONG)end };
+        SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+        SendMessageW(g_hEdit, EM_REPLACESEL, FALSE, (LPARAM)text);
+        g_bBatchEdit = FALSE;
+        if (!ReplaceDocumentRange(start, end, text, length) || (size_t)GetEditLength() != DocLength(&g_document)) {
+            g_bDocumentStale = TRUE;
+        }
+
+        range.cpMax = range.cpMin;
+        SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+        SendMessage(g_hEdit, EM_LINESCROLL, 0, topLine - (LONG)SendMessage(g_hEdit, EM_GETFIRSTVISIBLELINE, 0, 0));
+        SendMessage(g_hEdit, WM_SETREDRAW, TRUE, 0);
+        InvalidateRect(g_hEdit, NULL, TRUE);
+
+        g_reload.firstLine = firstLine;
+        g_reload.visibleStart = start;
+        g_reload.visibleLength = length;
+    }
+    ArenaReset(&g_ioArena);
+    SourceReaderClose(&reader);
+}
+
+// Function to start decoding the source with a reader that has peeked at its first bytes
+void StartEncodingReload(int encoding, BOOL opening, const SourceReader* reader, const unsigned char* bytes, size_t size) {
+    DocFree(&g_reload.text);
+    DocInit(&g_reload.text);
+    ZeroMemory(&g_reload.eolStats, sizeof(EolStats));
+    g_reload.active = TRUE;
+    g_reload.opening = opening;
+    g_reload.encoding = encoding;
+    g_reload.reader = *reader;
+    g_reload.firstLine = 0;
+    g_reload.visibleStart = 0;
+    g_reload.visibleLength = 0;
+    g_reload.truncated = FALSE;
+    SourceReaderSkip(&g_reload.reader, SourceBomSize(bytes, size, encoding));
+}
+
+// Function to read the open file's bytes again as another encoding, showing the lines in view at
+// once and decoding the rest on a timer; the edit control is read-only until that finishes
+void ReloadWithEncoding(int encoding) {
+    HMENU hEncodingMenu = GetSubMenu(hViewMenu, 1);
+    FinishAutoSave();
+    if (!g_source.open) {
+        // Nothing was read from disk, so there is nothing to decode again; the text is written in
+        // this encoding when it is saved
+        g_currentEncoding = encoding;
+        CheckMenuRadioItem(hEncodingMenu, 21, 29, 21 + g_currentEncoding, MF_BYCOMMAND);
+        return;
+    }
+
+    // A reload still in progress, or a compressed file still opening, is replaced by this one; the
+    // text so far is the file's, so there are no changes to lose
+    BOOL reloading = g_reload.active;
+    CancelEncodingReload();
+    if (!reloading && IsDocumentModified() && MessageBox(g_hWnd, "Reading the file again in another encoding discards your changes. Continue?",
+            "Encoding", MB_YESNO | MB_ICONQUESTION) != IDYES) {
+        CheckMenuRadioItem(hEncodingMenu, 21, 29, 21 + g_currentEncoding, MF_BYCOMMAND);
+        return;
+    }
+
+    ClearCursors();
+    HideCompletion();
+    if (!SyncDocument()) {
+        return;
+    }
+
+    // The file is mapped again until the reload ends; if another program changed it since, its
+    // bytes are no longer the text's, and seek points made from them no longer fit
+    if (!SourceMap(&g_source)) {
+        CheckMenuRadioItem(hEncodingMenu, 21, 29, 21 + g_currentEncoding, MF_BYCOMMAND);
+        MessageBox(g_hWnd, "The file has changed on disk or can no longer be read since it was opened or saved. "
+            "Open it again to read it in another encoding.", "Encoding", MB_ICONEXCLAMATION | MB_OK);
+        return;
+    }
+
+    SourceReader reader;
+    const unsigned char* bytes = NULL;
+    size_t size = 0;
+    BOOL final = FALSE;
+    if (!SourceReaderOpen(&reader, &g_source) || !SourceReaderPeek(&reader, &bytes, &size, &final)) {
+        CheckMenuRadioItem(hEncodingMenu, 21, 29, 21 + g_currentEncoding, MF_BYCOMMAND);
+        ShowSourceReadError(&reader);
+        SourceReaderClose(&reader);
+        SourceRelease(&g_source);
+        return;
+    }
+
+    g_currentEncoding = encoding;
+    CheckMenuRadioItem(hEncodingMenu, 21, 29, 21 + g_currentEncoding, MF_BYCOMMAND);
+    StartEncodingReload(encoding, FALSE, &reader, bytes, size);
+
+    ReplaceVisibleLines();
+    SendMessage(g_hEdit, EM_SETREADONLY, TRUE, 0);
+    SetTimer(g_hWnd, ENCODING_TIMER_ID, ENCODING_RELOAD_INTERVAL, NULL);
+}
+
+// Function to put a slice of a file being opened onto the end of the control, leaving the selection
+// and the view where they are
+void AppendOpenedText(const WCHAR* text, size_t length) {
+    CHARRANGE selection;
+    SendMessage(g_hEdit, EM_EXGETSEL, 0, (LPARAM)&selection);
+    LONG topLine = (LONG)SendMessage(g_hEdit, EM_GETFIRSTVISIBLELINE, 0, 0);
+    LONG end = GetEditLength();
+
+    g_bBatchEdit = TRUE;
+    SendMessage(g_hEdit, WM_SETREDRAW, FALSE, 0);
+    SendMessage(g_hEdit, EM_SETREADONLY, FALSE, 0);
+    CHARRANGE range = { end, end };
+    SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+    SendMessageW(g_hEdit, EM_REPLACESEL, FALSE, (LPARAM)text);
+    SendMessage(g_hEdit, EM_SETREADONLY, TRUE, 0);
+    g_bBatchEdit = FALSE;
+    if (g_bDocumentStale || !ReplaceDocumentRange((size_t)end, (size_t)end, text, length) ||
+        (size_t)GetEditLength() != DocLength(&g_document)) {
+        g_bDocumentStale = TRUE;
+    }
+
+    SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&selection);
+    SendMessage(g_hEdit, EM_LINESCROLL, 0, topLine - (LONG)SendMessage(g_hEdit, EM_GETFIRSTVISIBLELINE, 0, 0));
+    SendMessage(g_hEdit, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(g_hEdit, NULL, TRUE);
+}
+
+// Function to tell whether a slice of decoded text fits after what there is: the control addresses
+// its text with LONG offsets, and the model keeps its own copy under the memory ceiling
+BOOL ReloadSliceFits(size_t length) {
+    size_t decoded = g_reload.opening ? (size_t)GetEditLength() : DocLength(&g_reload.text);
+    if (decoded + length > ENCODING_RELOAD_TEXT_LIMIT) {
+        return FALSE;
+    }
+    return MemGetCeiling() == 0 || MemGetTotalUsage() + 2 * length * sizeof(WCHAR) <= MemGetCeiling();
+}
+
+// Function to decode the next slice of the source onto the end of the reload's text, or of the
+// control when the file is being opened. A file being opened stops (truncated) at the first slice
+// that does not fit; decoding again in another encoding fails there instead
+BOOL DecodeReloadSlice() {
+    const unsigned char* bytes = NULL;
+    size_t size = 0;
+    BOOL final = FALSE;
+    if (!SourceReaderPeek(&g_reload.reader, &bytes, &size, &final)) {
+        // Whatever came before damaged data is still decoded
+        if (size == 0) {
+            return FALSE;
+        }
+        final = TRUE;
+    }
+    if (size > ENCODING_RELOAD_SLICE) {
+        size = ENCODING_RELOAD_SLICE;
+        final = FALSE;
+    }
+    size_t count = SourceCharBoundary(bytes, size, g_reload.encoding, final);
+
+    size_t length = 0;
+    WCHAR* text = DecodeBytes(&g_ioArena, bytes, count, g_reload.encoding, &length);
+    BOOL ok = text != NULL;
+    if (ok) {
+        EolScan(text, length, &g_reload.eolStats);
+        length = EolNormalize(text, length);
+        if (!ReloadSliceFits(length)) {
+            g_reload.truncated = g_reload.opening;
+            ok = g_reload.opening;
+        } else if (g_reload.opening) {
+            text[length] = L'\0';
+            AppendOpenedText(text, length);
+        } else {
+            size_t end = DocLength(&g_reload.text);
+            ok = DocReplace(&g_reload.text, end, end, text, length);
+        }
+    }
+    ArenaReset(&g_ioArena);
+
+    SourceReaderSkip(&g_reload.reader, count);
+    return ok;
+}
+
+// Function to end the background decoding, leaving the control editable again
+void EndEncodingReload() {
+    KillTimer(g_hWnd, ENCODING_TIMER_ID);
+    SendMessage(g_hEdit, EM_SETREADONLY, FALSE, 0);
+    SourceReaderClose(&g_reload.reader);
+    SourceRelease(&g_source); // Other programs may write the file again
+    g_reload.active = FALSE;
+}
+
+// Function to put the decoded text in place of what the control still holds in the old encoding
+// When the lines replaced up front came out the same, only the text around them is streamed in,
+// so the view does not move
+void ApplyEncodingReload() {
+    EndEncodingReload();
+
+    Document* decoded = &g_reload.text;
+    size_t length = DocLength(decoded);
+    size_t oldLength = DocLength(&g_document);
+    size_t middle = g_reload.firstLine < DocLineCount(decoded) ? DocLineStart(decoded, g_reload.firstLine) : length;
+    size_t middleLength = g_reload.visibleLength;
+    BOOL keepMiddle = middleLength > 0 && middle + middleLength <= length &&
+        DocumentRangesEqual(&g_document, g_reload.visibleStart, decoded, middle, middleLength);
+
+    LONG topLine = (LONG)SendMessage(g_hEdit, EM_GETFIRSTVISIBLELINE, 0, 0);
+    g_bBatchEdit = TRUE;
+    SendMessage(g_hEdit, WM_SETREDRAW, FALSE, 0);
+    if (keepMiddle) {
+        StreamDocumentRange((LONG)(g_reload.visibleStart + middleLength), (LONG)oldLength, decoded, middle + middleLength, length);
+        StreamDocumentRange(0, (LONG)g_reload.visibleStart, decoded, 0, middle);
+    } else {
+        StreamDocumentRange(0, (LONG)oldLength, decoded, 0, length);
+    }
+    g_bBatchEdit = FALSE;
+
+    CompletionFree(&g_completion);
+    DocCopy(&g_document, decoded);
+    DocFree(decoded);
+    CompletionAddRange(&g_completion, &g_document, 0, DocLength(&g_document));
+    PublishDocument();
+    if ((size_t)GetEditLength() != DocLength(&g_document)) {
+        g_bDocumentStale = TRUE;
+    }
+
+    // The file was read again, so there is nothing to undo, and its line breaks may read differently
+    SendMessage(g_hEdit, EM_EMPTYUNDOBUFFER, 0, 0);
+    ResetUndoSpan();
+    g_lineEnding = EolDominant(&g_reload.eolStats, EOL_CRLF);
+    g_bMixedLineEndings = EolIsMixed(&g_reload.eolStats);
+    CheckMenuRadioItem(GetSubMenu(hViewMenu, 2), 35, 37, 35 + g_lineEnding, MF_BYCOMMAND);
+
+    CHARRANGE range = { (LONG)middle, (LONG)middle };
+    SendMessage(g_hEdit, EM_EXSETSEL, 0, (LPARAM)&range);
+    SendMessage(g_hEdit, EM_LINESCROLL, 0, topLine - (LONG)SendMessage(g_hEdit, EM_GETFIRSTVISIBLELINE, 0, 0));
+    SendMessage(g_hEdit, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(g_hEdit, NULL, TRUE);
+
+    RecordSavedState();
+    UpdateDocumentMemoryUsage();
+    UpdateStatusBar();
+}
+
+// Function to finish opening a compressed file once the last of it is in the control
+void ApplyOpenedSource() {
+    EndEncodingReload();
+    SendMessage(g_hEdit, EM_EMPTYUNDOBUFFER, 0, 0);
+    ResetUndoSpan();
+    g_lineEnding = EolDominant(&g_reload.eolStats, EOL_CRLF);
+    g_bMixedLineEndings = EolIsMixed(&g_reload.eolStats);
+    CheckMenuRadioItem(GetSubMenu(hViewMenu, 2), 35, 37, 35 + g_lineEnding, MF_BYCOMMAND);
+
+    RecordSavedState();
+    UpdateDocumentMemoryUsage();
+    UpdateStatusBar();
+}
+
+// Function to stop opening a file whose text does not fit: the text so far stays, but as it is only
+// the start of the file it is never saved over it, and it is not decoded again in another encoding
+void TruncateOpenedSource() {
+    ApplyOpenedSource();
+    SourceClose(&g_source);
+    g_bTextTruncated = TRUE;
+
+    char message[256];
+    snprintf(message, sizeof(message), "The file is too large to open whole%s; only its first %zu MB of text are shown. "
+        "Save writes the text to another file, so the original is kept.",
+        MemGetCeiling() > 0 ? " within the configured memory limit" : "", DocLength(&g_document) * sizeof(WCHAR) / 1048576);
+    MessageBox(g_hWnd, message, "Open", MB_ICONINFORMATION | MB_OK);
+}
+
+// Function to stop decoding in another encoding, leaving the text as it is
+void CancelEncodingReload() {
+    if (!g_reload.active) {
+        return;
+    }
+    EndEncodingReload();
+    DocFree(&g_reload.text);
+    DocInit(&g_reload.text);
+}
+
+// Function to stop when the source cannot be read to the end: a file being opened keeps the text
+// read so far, and decoding in another encoding is abandoned
+void FailEncodingReload() {
+    SourceReader reader = g_reload.reader;
+    if (g_reload.opening) {
+        ApplyOpenedSource();
+    } else {
+        CancelEncodingReload();
+        UpdateStatusBar();
+    }
+    ShowSourceReadError(&reader);
+}
+
+// Function to decode one more slice on the timer, showing progress, and apply the text at the end
+void ContinueEncodingReload() {
+    if (!g_reload.active) {
+        return;
+    }
+    if (!DecodeReloadSlice()) {
+        FailEncodingReload();
+        return;
+    }
+    if (g_reload.truncated) {
+        TruncateOpenedSource();
+        return;
+    }
+    if (!SourceReaderAtEnd(&g_reload.reader)) {
+        char progressText[64];
+        snprintf(progressText, sizeof(progressText), "%s... %d%%", g_reload.opening ? "Opening" : "Decoding",
+            SourceReaderProgress(&g_reload.reader));
+        SendMessage(g_hStatusBar, SB_SETTEXT, SB_PART_POSITION, (LPARAM)progressText);
+        return;
+    }
+    if (g_reload.opening) {
+        ApplyOpenedSource();
+    } else {
+        ApplyEncodingReload();
+    }
+}
+
+// Function to decode whatever is left at once, before anything reads or edits the text
+void FinishEncodingReload() {
+    if (!g_reload.active) {
+        return;
+    }
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    while (!SourceReaderAtEnd(&g_reload.reader) && !g_reload.truncated && DecodeReloadSlice()) {
+    }
+    SetCursor(oldCursor);
+    if (g_reload.truncated) {
+        TruncateOpenedSource();
+    } else if (!SourceReaderAtEnd(&g_reload.reader)) {
+        FailEncodingReload();
+    } else if (g_reload.opening) {
+        ApplyOpenedSource();
+    } else {
+        ApplyEncodingReload();
+    }
+}
+
+// Function to open a compressed file: the first slice is decompressed and shown at once, and the
+// rest is appended on the timer while the control stays read-only. Seek points are recorded on the
+// way, so decoding it again in another encoding starts near the lines in view.
+BOOL OpenCompressedSource(SourceFile* source) {
+    SourceReader reader;
+    const unsigned char* bytes = NULL;
+    size_t size = 0;
+    BOOL final = FALSE;
+    if (!SourceReaderOpen(&reader, source) || (!SourceReaderPeek(&reader, &bytes, &size, &final) && size == 0)) {
+        ShowSourceReadError(&reader);
+        SourceReaderClose(&reader);
+        SourceClose(source);
+        return FALSE;
+    }
+
+    // The mapping becomes the open source, and the reader follows it
+    CancelEncodingReload();
+    SourceClose(&g_source);
+    g_source = *source;
+    g_bTextTruncated = FALSE;
+    reader.source = &g_source;
+
+    // The encoding is told from the top of the file, as that is all there is yet
+    int encoding = DetectEncoding(bytes, size);
+    g_currentEncoding = encoding;
+    SETTEXTEX st = { ST_DEFAULT, 1200 };
+    CursorSetClear(&g_cursors);
+    SendMessage(g_hEdit, EM_SETTEXTEX, (WPARAM)&st, (LPARAM)L"");
+    g_editGeneration++;
+    g_bDocumentStale = TRUE;
+    SyncDocument();
+
+    StartEncodingReload(encoding, TRUE, &reader, bytes, size);
+    SendMessage(g_hEdit, EM_SETREADONLY, TRUE, 0);
+    SetTimer(g_hWnd, ENCODING_TIMER_ID, ENCODING_RELOAD_INTERVAL, NULL);
+    ContinueEncodingReload();
+    if (g_reload.active) {
+        g_lineEnding = EolDominant(&g_reload.eolStats, EOL_CRLF);
+        g_bMixedLineEndings = EolIsMixed(&g_reload.eolStats);
+    }
+    return TRUE;
+}
+
+// Function to pick the table view's delimiter: a tab for .tsv files, otherwise guessed from the top of the text
+WCHAR GuessTableDelimiter() {
+    const char* extension = strrchr(g_szFileName, '.');
+    if (extension != NULL && (lstrcmpiA(extension, ".tsv") == 0 || lstrcmpiA(extension, ".tab") == 0)) {
+        return L'\t';
+    }
+
+    size_t length = DocLength(&g_document) < TABLE_DETECT_SAMPLE ? DocLength(&g_document) : TABLE_DETECT_SAMPLE;
+    WCHAR* sample = (WCHAR*)MemAlloc(MEM_SCRATCH, (length + 1) * sizeof(WCHAR));
+    if (sample == NULL) {
+        return L',';
+    }
+    WCHAR delimiter = TableDetectDelimiter(sample, DocGetText(&g_document, 0, length, sample));
+    MemFree(sample);
+    return delimiter;
+}
+
+// Function to tell whether a file is opened in the table view by default
+BOOL IsTableFile(const char* path) {
+    const char* extension = strrchr(path, '.');
+    return extension != NULL && (lstrcmpiA(extension, ".csv") == 0 || lstrcmpiA(extension, ".tsv") == 0 ||
+        lstrcmpiA(extension, ".tab") == 0);
+}
+
+// Function to bring the table index up to date with the document, keeping the sort order
+// The index is only rebuilt when the text differs from the one it was built from
+BOOL RefreshTableIndex() {
+    if (!SyncDocument()) {
+        return FALSE;
+    }
+
+    ContentHash hash = DocHash(&g_document);
+    size_t length = DocLength(&g_document);
+    if (g_table.checkpoints != NULL && length == g_tableLength && HashEqual(hash, g_tableHash)) {
+        return TRUE;
+    }
+
+    int sortColumn = g_table.sortColumn;
+    BOOL sortDescending = g_table.sortDescending;
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    BOOL built = TableBuild(&g_table, &g_document, GuessTableDelimiter());
+    if (built && sortColumn >= 0) {
+        TableSort(&g_table, &g_document, sortColumn, sortDescending);
+    }
+    SetCursor(oldCursor);
+    if (!built) {
+        return FALSE;
+    }
+
+    g_tableHash = hash;
+    g_tableLength = length;
+    if (g_tableCurrent == 0 || g_tableCurrent >= g_table.rowCount) {
+        g_tableCurrent = 1;
+    }
+    if (g_tableTop + 1 >= g_table.rowCount) {
+        g_tableTop = 0;
+    }
+    if (g_tableLeft >= g_table.columnCount) {
+        g_tableLeft = 0;
+    }
+    if (g_bTableView) {
+        UpdateTableScrollBars();
+    }
+    return TRUE;
+}
+
+// Function to measure the table view: the height of a row, the width of a character and of the row number gutter
+void GetTableMetrics(HDC hdc, int* rowHeight, int* charWidth, int* gutterWidth) {
+    TEXTMETRIC tm;
+    HGDIOBJ oldFont = SelectObject(hdc, g_hFont);
+    GetTextMetrics(hdc, &tm);
+    SelectObject(hdc, oldFont);
+
+    int digits = 1;
+    for (size_t rows = g_table.rowCount; rows >= 10; rows /= 10) {
+        digits++;
+    }
+    *rowHeight = tm.tmHeight + TABLE_CELL_PADDING / 2;
+    *charWidth = tm.tmAveCharWidth;
+    *gutterWidth = (digits + 1) * tm.tmAveCharWidth + 2 * TABLE_CELL_PADDING;
+}
+
+// Function to get the number of whole rows that fit below the header
+int GetTableVisibleRows() {
+    RECT client;
+    GetClientRect(g_hTable, &client);
+    HDC hdc = GetDC(g_hTable);
+    int rowHeight, charWidth, gutterWidth;
+    GetTableMetrics(hdc, &rowHeight, &charWidth, &gutterWidth);
+    ReleaseDC(g_hTable, hdc);
+
+    int rows = client.bottom / rowHeight - 1;
+    return rows > 1 ? rows : 1;
+}
+
+// Function to get the number of rows below the header
+size_t GetTableDataRows() {
+    return g_table.rowCount > 1 ? g_table.rowCount - 1 : 0;
+}
+
+void UpdateTableScrollBars() {
+    int visible = GetTableVisibleRows();
+    size_t dataRows = GetTableDataRows();
+
+    SCROLLINFO info;
+    info.cbSize = sizeof(info);
+    info.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+    info.nMin = 0;
+    info.nMax = dataRows > 0 ? (int)(dataRows - 1 < INT_MAX ? dataRows - 1 : INT_MAX) : 0;
+    info.nPage = (UINT)visible;
+    info.nPos = (int)(g_tableTop < INT_MAX ? g_tableTop : INT_MAX);
+    SetScrollInfo(g_hTable, SB_VERT, &info, TRUE);
+
+    info.nMax = g_table.columnCount > 0 ? g_table.columnCount - 1 : 0;
+    info.nPage = 1;
+    info.nPos = g_tableLeft;
+    SetScrollInfo(g_hTable, SB_HORZ, &info, TRUE);
+}
+
+// Function to scroll the table so a position below the header is the first one shown
+void ScrollTableTo(size_t top) {
+    size_t dataRows = GetTableDataRows();
+    size_t visible = (size_t)GetTableVisibleRows();
+    size_t last = dataRows > visible ? dataRows - visible : 0;
+    g_tableTop = top < last ? top : last;
+    UpdateTableScrollBars();
+    InvalidateRect(g_hTable, NULL, FALSE);
+}
+
+// Function to highlight a row and scroll it into view
+void SetTableCurrent(size_t position) {
+    size_t dataRows = GetTableDataRows();
+    if (dataRows == 0) {
+        return;
+    }
+    position = position < 1 ? 1 : (position > dataRows ? dataRows : position);
+    g_tableCurrent = position;
+
+    size_t visible = (size_t)GetTableVisibleRows();
+    if (position - 1 < g_tableTop) {
+        ScrollTableTo(position - 1);
+    } else if (position - 1 >= g_tableTop + visible) {
+        ScrollTableTo(position - visible);
+    } else {
+        InvalidateRect(g_hTable, NULL, FALSE);
+    }
+}
+
+// Function to scroll the table sideways so a column is the first one shown
+void ScrollTableToColumn(int column) {
+    int last = g_table.columnCount > 0 ? g_table.columnCount - 1 : 0;
+    g_tableLeft = column < 0 ? 0 : (column > last ? last : column);
+    UpdateTableScrollBars();
+    InvalidateRect(g_hTable, NULL, FALSE);
+}
+
+// Function to get the table view's width of a column in pixels
+int GetTableColumnWidth(int column, int charWidth) {
+    return g_table.widths[column] * charWidth + 2 * TABLE_CELL_PADDING;
+}
+
+// Function to draw one cell, reading no more of the field than fits
+void PaintTableCell(HDC hdc, const RECT* cell, const TableField* field, BOOL alignRight, const WCHAR* suffix) {
+    WCHAR text[2 * TABLE_MAX_COLUMN_WIDTH + 4];
+    size_t length = 0;
+    if (field != NULL) {
+        size_t wanted = field->length < 2 * TABLE_MAX_COLUMN_WIDTH ? field->length : 2 * TABLE_MAX_COLUMN_WIDTH;
+        length = DocGetText(&g_document, field->start, field->start + wanted, text);
+    }
+
+    // Show a quoted field as its value: line breaks and tabs as spaces, doubled quotes as one
+    size_t shown = 0;
+    for (size_t i = 0; i < length; i++) {
+        WCHAR c = text[i];
+        if (c == L'"' && i + 1 < length && text[i + 1] == L'"') {
+            i++;
+        }
+        text[shown++] = c == L'\r' || c == L'\t' ? L' ' : c;
+    }
+    for (; suffix != NULL && *suffix != L'\0'; suffix++) {
+        text[shown++] = *suffix;
+    }
+
+    RECT rect = *cell;
+    rect.left += TABLE_CELL_PADDING;
+    rect.right -= TABLE_CELL_PADDING;
+    DrawTextW(hdc, text, (int)shown, &rect,
+        DT_SINGLELINE | DT_VCENTER | DT_NOPREFIX | DT_END_ELLIPSIS | (alignRight ? DT_RIGHT : DT_LEFT));
+}
+
+// Function to paint the rows of the table view that are on screen, with the header row always at the top
+// Only the visible rows are read, each found from the nearest checkpoint in the index
+void PaintTable(HWND hwnd) {
+    // Commands run on the hidden editor, e.g. a line operation, can change the text under the table
+    RefreshTableIndex();
+
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(hwnd, &ps);
+    RECT client;
+    GetClientRect(hwnd, &client);
+
+    int rowHeight, charWidth, gutterWidth;
+    GetTableMetrics(hdc, &rowHeight, &charWidth, &gutterWidth);
+    HGDIOBJ oldFont = SelectObject(hdc, g_hFont);
+    HPEN gridPen = CreatePen(PS_SOLID, 1, GetSysColor(COLOR_BTNSHADOW));
+    HGDIOBJ oldPen = SelectObject(hdc, gridPen);
+    SetBkMode(hdc, TRANSPARENT);
+    FillRect(hdc, &client, GetSysColorBrush(COLOR_WINDOW));
+
+    TableField fields[TABLE_MAX_COLUMNS];
+    for (int line = 0; line * rowHeight < client.bottom; line++) {
+        size_t position = line == 0 ? 0 : g_tableTop + line;
+        if (position >= g_table.rowCount) {
+            break;
+        }
+
+        RECT rowRect = { 0, line * rowHeight, client.right, (line + 1) * rowHeight };
+        BOOL current = line > 0 && position == g_tableCurrent;
+        if (line == 0) {
+            FillRect(hdc, &rowRect, GetSysColorBrush(COLOR_BTNFACE));
+        } else if (current) {
+            FillRect(hdc, &rowRect, GetSysColorBrush(COLOR_HIGHLIGHT));
+        }
+        SetTextColor(hdc, GetSysColor(current ? COLOR_HIGHLIGHTTEXT : (line == 0 ? COLOR_BTNTEXT : COLOR_WINDOWTEXT)));
+
+        // Rows are numbered as in the document, so the numbers show where sorted rows came from
+        size_t row = TableRowAt(&g_table, position);
+        RECT cell = { 0, rowRect.top, gutterWidth, rowRect.bottom };
+        if (line > 0) {
+            WCHAR number[24];
+            int length = 0;
+            for (size_t value = row; length == 0 || value > 0; value /= 10) {
+                number[length++] = (WCHAR)(L'0' + value % 10);
+            }
+            for (int i = 0; i < length / 2; i++) {
+                WCHAR swap = number[i];
+                number[i] = number[length - 1 - i];
+                number[length - 1 - i] = swap;
+            }
+            RECT rect = cell;
+            rect.right -= TABLE_CELL_PADDING;
+            SetTextColor(hdc, GetSysColor(current ? COLOR_HIGHLIGHTTEXT : COLOR_GRAYTEXT));
+            DrawTextW(hdc, number, length, &rect, DT_SINGLELINE | DT_VCENTER | DT_RIGHT);
+            SetTextColor(hdc, GetSysColor(current ? COLOR_HIGHLIGHTTEXT : COLOR_WINDOWTEXT));
+        }
+
+        int count = TableReadRow(&g_table, &g_document, row, fields, TABLE_MAX_COLUMNS);
+        int x = gutterWidth;
+        for (int column = g_tableLeft; column < g_table.columnCount && x < client.right; column++) {
+            cell.left = x;
+            cell.right = x + GetTableColumnWidth(column, charWidth);
+            const WCHAR* suffix = NULL;
+            if (line == 0 && column == g_table.sortColumn) {
+                suffix = g_table.sortDescending ? L" \x25BC" : L" \x25B2";
+            }
+            PaintTableCell(hdc, &cell, column < count ? &fields[column] : NULL, line > 0 && g_table.numeric[column], suffix);
+            x = cell.right;
+            MoveToEx(hdc, x - 1, rowRect.top, NULL);
+            LineTo(hdc, x - 1, rowRect.bottom);
+        }
+        MoveToEx(hdc, 0, rowRect.bottom - 1, NULL);
+        LineTo(hdc, client.right, rowRect.bottom - 1);
+    }
+
+    SelectObject(hdc, oldPen);
+    DeleteObject(gridPen);
+    SelectObject(hdc, oldFont);
+    EndPaint(hwnd, &ps);
+}
+
+// Function to find the column under an x coordinate in the table view, or -1 for the gutter or past the last column
+int GetTableColumnFromPoint(int x) {
+    HDC hdc = GetDC(g_hTable);
+    int rowHeight, charWidth, gutterWidth;
+    GetTableMetrics(hdc, &rowHeight, &charWidth, &gutterWidth);
+    ReleaseDC(g_hTable, hdc);
+
+    int left = gutterWidth;
+    for (int column = g_tableLeft; column < g_table.columnCount; column++) {
+        int right = left + GetTableColumnWidth(column, charWidth);
+        if (x >= left && x < right) {
+            return column;
+        }
+        left = right;
+    }
+    return -1;
+}
+
+// Function to find the position under a y coordinate in the table view; 0 is the header
+size_t GetTablePositionFromPoint(int y) {
+    HDC hdc = GetDC(g_hTable);
+    int rowHeight, charWidth, gutterWidth;
+    GetTableMetrics(hdc, &rowHeight, &charWidth, &gutterWidth);
+    ReleaseDC(g_hTable, hdc);
+
+    int line = y / rowHeight;
+    return line <= 0 ? 0 : g_tableTop + line;
+}
+
+// Function to sort the table view by a column, or reverse the order if it is already sorted by it
+void SortTableByColumn(int column) {
+    BOOL descending = column == g_table.sortColumn && !g_table.sortDescending;
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    BOOL sorted = TableSort(&g_table, &g_document, column, descending);
+    SetCursor(oldCursor);
+    if (!sorted) {
+        MessageBox(g_hWnd, "Not enough memory to sort within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+    }
+    SetTableCurrent(1);
+    ScrollTableTo(0);
+}
+
+// Function to show the table view in place of the editor, or the editor again
+void ShowTableView(BOOL show) {
+    if (show) {
+        ClearCursors();
+        HideCompletion();
+        HideFindBar();
+        if (!RefreshTableIndex()) {
+            MessageBox(g_hWnd, "Not enough memory to index the table within the configured memory limit.", "Error", MB_ICONEXCLAMATION | MB_OK);
+            return;
+        }
+        if (g_hTable == NULL) {
+            g_hTable = CreateWindowEx(0, "CyCharmTable", NULL, WS_CHILD | WS_VSCROLL | WS_HSCROLL,
+                0, 0, 0, 0, g_hWnd, (HMENU)IDC_TABLE, GetModuleHandle(NULL), NULL);
+            if (g_hTable == NULL) {
+                return;
+            }
+        }
+    } else if (g_hTable == NULL) {
+        return;
+    }
+
+    g_bTableView = show;
+    ShowWindow(g_hTable, show ? SW_SHOW : SW_HIDE);
+    ShowWindow(g_hEdit, show ? SW_HIDE : SW_SHOW);
+    CheckMenuItem(hViewMenu, 48, show ? MF_CHECKED : MF_UNCHECKED);
+    RelayoutMainWindow();
+    if (show) {
+        UpdateTableScrollBars();
+        InvalidateRect(g_hTable, NULL, FALSE);
+    }
+    SetFocus(show ? g_hTable : g_hEdit);
+}
+
+// Function to leave the table view with the caret at the start of a row
+void OpenTableRowInEditor(size_t position) {
+    size_t start = TableRowStart(&g_table, &g_document, TableRowAt(&g_table, position));
+    ShowTableView(FALSE);
+    SendMessage(g_hEdit, EM_SETSEL, (WPARAM)start, (LPARAM)start);
+    SendMessage(g_hEdit, EM_SCROLLCARET, 0, 0);
+    UpdateStatusBar();
+}
+
+// Function to show the go-to-row box in the table view's header
+void ShowTableGoto() {
+    if (g_hTableGoto == NULL) {
+        g_hTableGotoLabel = CreateWindowExW(0, L"STATIC", L"Go to row:", WS_CHILD | SS_LEFT | SS_CENTERIMAGE,
+            0, 0, 0, 0, g_hTable, NULL, GetModuleHandle(NULL), NULL);
+        g_hTableGoto = CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", L"", WS_CHILD | ES_NUMBER | ES_AUTOHSCROLL,
+            0, 0, 0, 0, g_hTable, (HMENU)IDC_TABLEGOTO, GetModuleHandle(NULL), NULL);
+        if (g_hTableGoto == NULL || g_hTableGotoLabel == NULL) {
+            return;
+        }
+        SendMessage(g_hTableGotoLabel, WM_SETFONT, (WPARAM)GetStockObject(DEFAULT_GUI_FONT), FALSE);
+        SendMessage(g_hTableGoto, WM_SETFONT, (WPARAM)GetStockObject(DEFAULT_GUI_FONT), FALSE);
+        g_OldTableGotoProc = (WNDPROC)SetWindowLongPtrW(g_hTableGoto, GWLP_WNDPROC, (LONG_PTR)TableGotoProc);
+    }
+
+    RECT client;
+    GetClientRect(g_hTable, &client);
+    HDC hdc = GetDC(g_hTable);
+    int rowHeight, charWidth, gutterWidth;
+    GetTableMetrics(hdc, &rowHeight, &charWidth, &gutterWidth);
+    ReleaseDC(g_hTable, hdc);
+
+    int left = client.right - TABLE_GOTO_WIDTH;
+    MoveWindow(g_hTableGotoLabel, left - TABLE_GOTO_LABEL_WIDTH, 0, TABLE_GOTO_LABEL_WIDTH, rowHeight, TRUE);
+    MoveWindow(g_hTableGoto, left, 0, TABLE_GOTO_WIDTH, rowHeight, TRUE);
+    ShowWindow(g_hTableGotoLabel, SW_SHOW);
+    ShowWindow(g_hTableGoto, SW_SHOW);
+    SetFocus(g_hTableGoto);
+    SendMessage(g_hTableGoto, EM_SETSEL, 0, -1);
+}
+
+void HideTableGoto() {
+    if (g_hTableGoto != NULL && IsWindowVisible(g_hTableGoto)) {
+        ShowWindow(g_hTableGoto, SW_HIDE);
+        ShowWindow(g_hTableGotoLabel, SW_HIDE);
+        SetFocus(g_hTable);
+    }
+}
+
+// Function to highlight a row by its number in the document; in a sorted view its position is looked up
+void GoToTableRow(size_t row) {
+    size_t dataRows = GetTableDataRows();
+    if (row < 1 || row > dataRows) {
+        MessageBeep(MB_OK);
+        return;
+    }
+
+    size_t position = row;
+    if (g_table.order != NULL) {
+        for (position = 1; position <= dataRows && g_table.order[position] != row; position++) {
+        }
+    }
+    size_t visible = (size_t)GetTableVisibleRows();
+    ScrollTableTo(position - 1 > visible / 2 ? position - 1 - visible / 2 : 0);
+    SetTableCurrent(position);
+}
+
+// Window procedure for the go-to-row box: Enter goes to the row and Escape closes the box
+LRESULT CALLBACK TableGotoProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param) {
+    switch (message) {
+    case WM_KEYDOWN:
+        if (w_param == VK_RETURN) {
+            WCHAR text[24];
+            size_t row = 0;
+            int length = GetWindowTextW(hwnd, text, sizeof(text) / sizeof(WCHAR));
+            for (int i = 0; i < length; i++) {
+                row = row * 10 + (size_t)(text[i] - L'0');
+            }
+            HideTableGoto();
+            GoToTableRow(row);
+            return 0;
+        }
+        if (w_param == VK_ESCAPE) {
+            HideTableGoto();
+            return 0;
+        }
+        break;
+
+    case WM_CHAR:
+        // Handled on key down; a single-line edit control would only beep at them
+        if (w_param == L'\r' || w_param == 0x1B) {
+            return 0;
+        }
+        break;
     }
+    return CallWindowProcW(g_OldTableGotoProc, hwnd, message, w_param, l_param);
 }
 
-// Function to convert text to the specified encoding
-char* ConvertToEncoding(const char* text, size_t textLength, int targetEncoding, size_t* outSize) {
-    // For simplicity, we'll just handle the most common case: converting between UTF-8 and ASCII
-    // For real applications, you would use Windows API functions like MultiByteToWideChar and WideCharToMultiByte
-    
-    char* result = NULL;
-    *outSize = 0;
-    
-    switch (targetEncoding) {
-        case ENCODING_UTF8: {
-            // Add UTF-8 BOM
-            *outSize = textLength + 3; // 3 bytes for BOM
-            result = (char*)malloc(*outSize);
-            if (result) {
-                // Add UTF-8 BOM (EF BB BF)
-                result[0] = (char)0xEF;
-                result[1] = (char)0xBB;
-                result[2] = (char)0xBF;
-                // Copy the text after the BOM
-                memcpy(result + 3, text, textLength);
-            }
+// Window procedure for the table view: arrows and page keys move the highlighted row, clicking a
+// header sorts by its column, Enter or a double click opens the row in the editor, Ctrl+G goes to a row
+// and Escape returns to the editor
+LRESULT CALLBACK TableProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param) {
+    switch (message) {
+    case WM_PAINT:
+        PaintTable(hwnd);
+        return 0;
+
+    case WM_ERASEBKGND:
+        return 1; // Every pixel is painted
+
+    case WM_SIZE:
+        if (g_hTableGoto != NULL && IsWindowVisible(g_hTableGoto)) {
+            ShowTableGoto();
+        }
+        ScrollTableTo(g_tableTop);
+        return 0;
+
+    case WM_VSCROLL: {
+        size_t visible = (size_t)GetTableVisibleRows();
+        size_t top = g_tableTop;
+        switch (LOWORD(w_param)) {
+        case SB_LINEUP: top = top > 0 ? top - 1 : 0; break;
+        case SB_LINEDOWN: top++; break;
+        case SB_PAGEUP: top = top > visible ? top - visible : 0; break;
+        case SB_PAGEDOWN: top += visible; break;
+        case SB_TOP: top = 0; break;
+        case SB_BOTTOM: top = GetTableDataRows(); break;
+        case SB_THUMBTRACK:
+        case SB_THUMBPOSITION: {
+            SCROLLINFO info;
+            info.cbSize = sizeof(info);
+            info.fMask = SIF_TRACKPOS;
+            GetScrollInfo(hwnd, SB_VERT, &info);
+            top = (size_t)info.nTrackPos;
             break;
         }
-        
-        case ENCODING_UTF16LE: {
-            // Convert to UTF-16LE (simplified - just for ASCII range)
-            *outSize = (textLength * 2) + 2; // 2 bytes per char + 2 bytes for BOM
-            result = (char*)malloc(*outSize);
-            if (result) {
-                // Add UTF-16LE BOM (FF FE)
-                result[0] = (char)0xFF;
-                result[1] = (char)0xFE;
-                
-                // Convert each ASCII byte to UTF-16LE (char followed by zero byte)
-                for (size_t i = 0; i < textLength; i++) {
-                    result[2 + (i * 2)] = text[i];
-                    result[2 + (i * 2) + 1] = 0;
-                }
+        }
+        ScrollTableTo(top);
+        return 0;
+    }
+
+    case WM_HSCROLL:
+        switch (LOWORD(w_param)) {
+        case SB_LINELEFT:
+        case SB_PAGELEFT: ScrollTableToColumn(g_tableLeft - 1); break;
+        case SB_LINERIGHT:
+        case SB_PAGERIGHT: ScrollTableToColumn(g_tableLeft + 1); break;
+        case SB_THUMBTRACK:
+        case SB_THUMBPOSITION: ScrollTableToColumn(HIWORD(w_param)); break;
+        }
+        return 0;
+
+    case WM_MOUSEWHEEL: {
+        int notches = GET_WHEEL_DELTA_WPARAM(w_param) / WHEEL_DELTA;
+        size_t rows = (size_t)(notches < 0 ? -notches : notches) * TABLE_WHEEL_ROWS;
+        ScrollTableTo(notches > 0 ? (g_tableTop > rows ? g_tableTop - rows : 0) : g_tableTop + rows);
+        return 0;
+    }
+
+    case WM_LBUTTONDOWN: {
+        SetFocus(hwnd);
+        size_t position = GetTablePositionFromPoint((short)HIWORD(l_param));
+        if (position == 0) {
+            // The header: a column sorts, the gutter or the space past the last column restores the document's order
+            int column = GetTableColumnFromPoint((short)LOWORD(l_param));
+            if (column >= 0) {
+                SortTableByColumn(column);
+            } else if (g_table.order != NULL) {
+                TableClearSort(&g_table);
+                SetTableCurrent(1);
+                ScrollTableTo(0);
             }
-            break;
+        } else if (position < g_table.rowCount) {
+            SetTableCurrent(position);
         }
-        
-        case ENCODING_UTF16BE: {
-            // Convert to UTF-16BE (simplified - just for ASCII range)
-            *outSize = (textLength * 2) + 2; // 2 bytes per char + 2 bytes for BOM
-            result = (char*)malloc(*outSize);
-            if (result) {
-                // Add UTF-16BE BOM (FE FF)
-                result[0] = (char)0xFE;
-                result[1] = (char)0xFF;
-                
-                // Convert each ASCII byte to UTF-16BE (zero byte followed by char)
-                for (size_t i = 0; i < textLength; i++) {
-                    result[2 + (i * 2)] = 0;
-                    result[2 + (i * 2) + 1] = text[i];
-                }
+        return 0;
+    }
+
+    case WM_LBUTTONDBLCLK: {
+        size_t position = GetTablePositionFromPoint((short)HIWORD(l_param));
+        if (position > 0 && position < g_table.rowCount) {
+            OpenTableRowInEditor(position);
+        }
+        return 0;
+    }
+
+    case WM_KEYDOWN: {
+        BOOL control = (GetKeyState(VK_CONTROL) & 0x8000) != 0;
+        size_t visible = (size_t)GetTableVisibleRows();
+        switch (w_param) {
+        case VK_UP: SetTableCurrent(g_tableCurrent > 1 ? g_tableCurrent - 1 : 1); break;
+        case VK_DOWN: SetTableCurrent(g_tableCurrent + 1); break;
+        case VK_PRIOR: SetTableCurrent(g_tableCurrent > visible ? g_tableCurrent - visible : 1); break;
+        case VK_NEXT: SetTableCurrent(g_tableCurrent + visible); break;
+        case VK_HOME:
+            if (control) {
+                SetTableCurrent(1);
+            } else {
+                ScrollTableToColumn(0);
             }
             break;
-        }
-        
-        case ENCODING_ISO_8859_1: {
-            // ISO-8859-1 (Latin-1) - No BOM, just copy the text
-            // For non-ASCII characters, would need proper conversion
-            *outSize = textLength;
-            result = (char*)malloc(*outSize);
-            if (result) {
-                memcpy(result, text, textLength);
+        case VK_END:
+            if (control) {
+                SetTableCurrent(GetTableDataRows());
+            } else {
+                ScrollTableToColumn(g_table.columnCount - 1);
             }
             break;
-        }
-        
-        case ENCODING_ISO_8859_15: {
-            // ISO-8859-15 (Latin-9) - No BOM, just copy the text
-            // For non-ASCII characters, would need proper conversion
-            *outSize = textLength;
-            result = (char*)malloc(*outSize);
-            if (result) {
-                memcpy(result, text, textLength);
-                
-                // Simple conversion for Euro sign if present (ASCII 0x80 to ISO-8859-15 0xA4)
-                // This is a simplified approach and not a complete conversion
-                for (size_t i = 0; i < textLength; i++) {
-                    if ((unsigned char)text[i] == 0x80) { // Euro sign in Windows-1252
-                        result[i] = (char)0xA4;  // Euro sign position in ISO-8859-15
-                    }
-                }
+        case VK_LEFT: ScrollTableToColumn(g_tableLeft - 1); break;
+        case VK_RIGHT: ScrollTableToColumn(g_tableLeft + 1); break;
+        case VK_RETURN:
+            if (g_tableCurrent < g_table.rowCount) {
+                OpenTableRowInEditor(g_tableCurrent);
             }
             break;
-        }
-        
-        case ENCODING_WINDOWS_1252: {
-            // Windows-1252 - No BOM, just copy the text
-            *outSize = textLength;
-            result = (char*)malloc(*outSize);
-            if (result) {
-                memcpy(result, text, textLength);
+        case VK_ESCAPE: ShowTableView(FALSE); break;
+        case 'G':
+            if (control) {
+                ShowTableGoto();
             }
             break;
         }
-        
-        case ENCODING_SHIFT_JIS: {
-            // Shift-JIS - No BOM, simplified handling
-            // For proper conversion, would need a full mapping table
-            *outSize = textLength;
-            result = (char*)malloc(*outSize);
-            if (result) {
-                memcpy(result, text, textLength);
+        return 0;
+    }
+    }
+
+    return DefWindowProc(hwnd, message, w_param, l_param);
+}
+
+// Function to handle input while several cursors or a block selection are active
+// Ctrl+Click adds a cursor, Alt+Drag selects a block, Ctrl+Alt+Up/Down adds a cursor on the next line
+// Returns TRUE if the message was consumed
+BOOL HandleCursorMessage(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param) {
+    BOOL multiple = g_cursors.count > 1;
+    BOOL control = (GetKeyState(VK_CONTROL) & 0x8000) != 0;
+    int x = (short)LOWORD(l_param);
+    int y = (short)HIWORD(l_param);
+
+    switch (message) {
+    case WM_LBUTTONDOWN:
+        if (GetKeyState(VK_MENU) & 0x8000) {
+            if (!SyncDocument()) {
+                return FALSE;
             }
-            break;
+            SetFocus(hwnd);
+            SetCapture(hwnd);
+            g_bBlockSelecting = TRUE;
+            PointToLineColumn(hwnd, x, y, &g_blockAnchorLine, &g_blockAnchorColumn);
+            UpdateBlockSelection(hwnd, x, y);
+            return TRUE;
         }
-        
-        case ENCODING_GB18030: {
-            // GB18030 - No BOM, simplified handling
-            // For proper conversion, would need a full mapping table
-            *outSize = textLength;
-            result = (char*)malloc(*outSize);
-            if (result) {
-                memcpy(result, text, textLength);
+        if (w_param & MK_CONTROL) {
+            if (!SyncDocument()) {
+                return FALSE;
             }
-            break;
+            SetFocus(hwnd);
+            BeginCursors();
+            POINTL point = { x, y };
+            size_t offset = (size_t)SendMessage(hwnd, EM_CHARFROMPOS, 0, (LPARAM)&point);
+            CursorSetAdd(&g_cursors, offset, offset, TRUE);
+            CursorSetNormalize(&g_cursors);
+            ShowPrimaryCursor(hwnd);
+            return TRUE;
         }
-        
-        case ENCODING_ASCII:
-        default: {
-            // Just copy the text as-is for ASCII
-            *outSize = textLength;
-            result = (char*)malloc(*outSize);
-            if (result) {
-                memcpy(result, text, textLength);
+        ClearCursors();
+        return FALSE;
+
+    case WM_MOUSEMOVE:
+        if (g_bBlockSelecting) {
+            UpdateBlockSelection(hwnd, x, y);
+            return TRUE;
+        }
+        return FALSE;
+
+    case WM_LBUTTONUP:
+        if (g_bBlockSelecting) {
+            g_bBlockSelecting = FALSE;
+            ReleaseCapture();
+            if (g_cursors.count <= 1) {
+                CursorSetClear(&g_cursors);
             }
-            break;
+            return TRUE;
         }
-    }
-    
-    return result;
-}
+        return FALSE;
 
-// Function prototypes
-LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param);
-LRESULT CALLBACK EditProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param);
+    case WM_KEYDOWN:
+        if (control && (GetKeyState(VK_MENU) & 0x8000) && (w_param == VK_UP || w_param == VK_DOWN)) {
+            AddCursorOnLine(w_param == VK_UP ? -1 : 1);
+            return TRUE;
+        }
+        if (!multiple) {
+            return FALSE;
+        }
 
-// Original window procedure for the edit control
-WNDPROC g_OldEditProc;
+        switch (w_param) {
+        case VK_ESCAPE:
+            ClearCursors();
+            return TRUE;
+        case VK_BACK:
+            ApplyCursorEdit(CURSOR_EDIT_BACKSPACE, NULL, 0, FALSE);
+            g_swallowChar = L'\b';
+            return TRUE;
+        case VK_DELETE:
+            ApplyCursorEdit(CURSOR_EDIT_DELETE, NULL, 0, FALSE);
+            return TRUE;
+        case VK_RETURN:
+            ApplyCursorEdit(CURSOR_EDIT_INSERT, L"\r", 1, FALSE);
+            g_swallowChar = L'\r';
+            return TRUE;
+        case VK_TAB:
+            ApplyCursorEdit(CURSOR_EDIT_INSERT, L"\t", 1, FALSE);
+            g_swallowChar = L'\t';
+            return TRUE;
+        case VK_LEFT:
+        case VK_RIGHT:
+        case VK_UP:
+        case VK_DOWN:
+        case VK_HOME:
+        case VK_END:
+        case VK_PRIOR:
+        case VK_NEXT:
+            // Moving the caret goes back to a single cursor
+            ClearCursors();
+            return FALSE;
+        }
+
+        if (control && w_param == 'V') {
+            PasteAtCursors();
+            return TRUE;
+        }
+        if (control && w_param != VK_CONTROL && w_param != VK_SHIFT && w_param != VK_MENU) {
+            // Other shortcuts (undo, cut, select all) act on the control's own selection
+            ClearCursors();
+        }
+        return FALSE;
+
+    case WM_CHAR:
+        // The batch may have merged every cursor into one, so drop the key's character first
+        if (g_swallowChar != 0 && w_param == g_swallowChar) {
+            g_swallowChar = 0;
+            return TRUE;
+        }
+        g_swallowChar = 0;
+        if (!multiple) {
+            return FALSE;
+        }
+        if (w_param >= 0x20 && w_param != 0x7F) {
+            WCHAR ch = (WCHAR)w_param;
+            ApplyCursorEdit(CURSOR_EDIT_INSERT, &ch, 1, FALSE);
+        }
+        return TRUE;
+
+    case WM_PASTE:
+        if (multiple) {
+            PasteAtCursors();
+            return TRUE;
+        }
+        return FALSE;
+
+    case WM_CUT:
+    case WM_CLEAR:
+    case WM_UNDO:
+    case EM_UNDO:
+    case EM_REDO:
+        ClearCursors();
+        return FALSE;
+    }
+
+    return FALSE;
+}
 
 int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd_line, int n_cmd_show) {
 
@@ -367,6 +3545,23 @@ int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd
     icex.dwICC = ICC_WIN95_CLASSES;
     InitCommonControlsEx(&icex);
 
+    // Set up memory accounting: optional ceiling from the command line (--memory-limit=<MB>)
+    size_t memoryLimitMB = MEMORY_LIMIT_DEFAULT_MB;
+    const char* memoryLimitArg = strstr(lp_cmd_line, "--memory-limit=");
+    if (memoryLimitArg != NULL) {
+        memoryLimitMB = (size_t)strtoul(memoryLimitArg + strlen("--memory-limit="), NULL, 10);
+    }
+    MemSetCeiling(memoryLimitMB * 1024 * 1024);
+
+    // Budget for uncompressed document text (--resident-limit=<MB>)
+    size_t residentLimitMB = RESIDENT_LIMIT_DEFAULT_MB;
+    const char* residentLimitArg = strstr(lp_cmd_line, "--resident-limit=");
+    if (residentLimitArg != NULL) {
+        residentLimitMB = (size_t)strtoul(residentLimitArg + strlen("--resident-limit="), NULL, 10);
+    }
+    DocSetResidentLimit(residentLimitMB * 1024 * 1024);
+    ArenaInit(&g_ioArena, MEM_SCRATCH, ARENA_DEFAULT_BLOCK_SIZE);
+
     // Load the RichEdit library
     HMODULE hRichEdit = LoadLibrary("RICHED32.DLL");
     if (!hRichEdit) {
@@ -386,6 +3581,23 @@ int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd
         return 0;
     }
 
+    // Register the compare view's window class
+    WNDCLASS compare_class = { 0 };
+    compare_class.lpfnWndProc = CompareProc;
+    compare_class.hInstance = h_instance;
+    compare_class.hCursor = LoadCursor(NULL, IDC_ARROW);
+    compare_class.lpszClassName = "CyCharmCompare";
+    RegisterClass(&compare_class);
+
+    // Register the table view's window class
+    WNDCLASS table_class = { 0 };
+    table_class.style = CS_DBLCLKS;
+    table_class.lpfnWndProc = TableProc;
+    table_class.hInstance = h_instance;
+    table_class.hCursor = LoadCursor(NULL, IDC_ARROW);
+    table_class.lpszClassName = "CyCharmTable";
+    RegisterClass(&table_class);
+
     // Calculate the center coordinates
     int windowWidth = 800;
     int windowHeight = 600;
@@ -422,6 +3634,11 @@ int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd
     AppendMenu(hFileMenu, MF_STRING, 1, "Open");
     AppendMenu(hFileMenu, MF_STRING, 2, "Save");
     AppendMenu(hFileMenu, MF_STRING, 17, "Save As");
+
+    // Add a horizontal line (separator)
+    AppendMenu(hFileMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hFileMenu, MF_STRING, 33, "Compare with Saved");
+    AppendMenu(hFileMenu, MF_STRING, 34, "Compare with File");
     
     // Add a horizontal line (separator)
     AppendMenu(hFileMenu, MF_SEPARATOR, 0, NULL);
@@ -448,6 +3665,32 @@ int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd
     AppendMenu(hEditMenu, MF_STRING, 14, "Find");
     AppendMenu(hEditMenu, MF_STRING, 15, "Replace");
 
+    // Add a horizontal line (separator)
+    AppendMenu(hEditMenu, MF_SEPARATOR, 0, NULL);
+
+    AppendMenu(hEditMenu, MF_STRING, 31, "Add Cursor Above");
+    AppendMenu(hEditMenu, MF_STRING, 32, "Add Cursor Below");
+
+    // Add a horizontal line (separator)
+    AppendMenu(hEditMenu, MF_SEPARATOR, 0, NULL);
+
+    // Create Line Operations submenu; each works on the selected lines, or every line without a selection
+    HMENU hLinesMenu = CreateMenu();
+    AppendMenu(hEditMenu, MF_POPUP, (UINT_PTR)hLinesMenu, "Line Operations");
+    AppendMenu(hLinesMenu, MF_STRING, 40, "Sort Lines");
+    AppendMenu(hLinesMenu, MF_STRING, 41, "Sort Lines Numerically");
+    AppendMenu(hLinesMenu, MF_STRING, 42, "Sort Lines Naturally");
+    AppendMenu(hLinesMenu, MF_STRING, 43, "Sort Lines Ignoring Case");
+    AppendMenu(hLinesMenu, MF_STRING, 44, "Remove Duplicate Lines");
+    AppendMenu(hLinesMenu, MF_STRING, 45, "Reverse Lines");
+    AppendMenu(hLinesMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hLinesMenu, MF_STRING, 46, "Keep Lines Matching Find Text");
+    AppendMenu(hLinesMenu, MF_STRING, 47, "Remove Lines Matching Find Text");
+
+    // JSON or XML, told apart by the text; each works on the selection, or the whole document without one
+    AppendMenu(hEditMenu, MF_STRING, 49, "Format JSON/XML");
+    AppendMenu(hEditMenu, MF_STRING, 50, "Minify JSON/XML");
+
     // Add View menu items
     AppendMenu(hViewMenu, MF_STRING, 9, "Word Wrap");
 
@@ -472,9 +3715,38 @@ int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd
     // Check the default encoding (UTF-8)
     CheckMenuRadioItem(hEncodingMenu, 21, 29, 21, MF_BYCOMMAND);
 
+    // The encodings above read the file again; these keep the text and write it in another encoding on save
+    HMENU hConvertMenu = CreateMenu();
+    AppendMenu(hEncodingMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hEncodingMenu, MF_POPUP, (UINT_PTR)hConvertMenu, "Convert To");
+    AppendMenu(hConvertMenu, MF_STRING, 51, "UTF-8");
+    AppendMenu(hConvertMenu, MF_STRING, 52, "UTF-16LE");
+    AppendMenu(hConvertMenu, MF_STRING, 53, "UTF-16BE");
+    AppendMenu(hConvertMenu, MF_STRING, 54, "ASCII");
+    AppendMenu(hConvertMenu, MF_STRING, 55, "ISO-8859-1");
+    AppendMenu(hConvertMenu, MF_STRING, 56, "ISO-8859-15");
+    AppendMenu(hConvertMenu, MF_STRING, 57, "Windows-1252");
+    AppendMenu(hConvertMenu, MF_STRING, 58, "Shift-JIS");
+    AppendMenu(hConvertMenu, MF_STRING, 59, "GB18030");
+
+    // Create Line Endings submenu; files keep the style they were opened with unless changed here
+    HMENU hLineEndingMenu = CreateMenu();
+    AppendMenu(hViewMenu, MF_POPUP, (UINT_PTR)hLineEndingMenu, "Line Endings");
+    AppendMenu(hLineEndingMenu, MF_STRING, 35, "Windows (CRLF)");
+    AppendMenu(hLineEndingMenu, MF_STRING, 36, "Unix (LF)");
+    AppendMenu(hLineEndingMenu, MF_STRING, 37, "Classic Mac (CR)");
+    CheckMenuRadioItem(hLineEndingMenu, 35, 37, 35 + g_lineEnding, MF_BYCOMMAND);
+
     // Add Zoom dropdown
     AppendMenu(hViewMenu, MF_POPUP, (UINT_PTR)hZoomMenu, "Zoom");
 
+    // Folding by brackets, or by indentation where a line opens no bracket
+    AppendMenu(hViewMenu, MF_STRING, 38, "Toggle Fold");
+    AppendMenu(hViewMenu, MF_STRING, 39, "Unfold All");
+
+    // Delimited data as aligned columns; .csv and .tsv files open in it
+    AppendMenu(hViewMenu, MF_STRING | MF_UNCHECKED, 48, "Table View");
+
     // Add a horizontal line (separator)
     AppendMenu(hViewMenu, MF_SEPARATOR, 0, NULL);
 
@@ -488,6 +3760,7 @@ int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd
 
     // Add Help menu items
     AppendMenu(hHelpMenu, MF_STRING, 19, "View License");
+    AppendMenu(hHelpMenu, MF_STRING, 30, "Memory Usage");
     // Add a horizontal line (separator)
     AppendMenu(hHelpMenu, MF_SEPARATOR, 0, NULL);
     AppendMenu(hHelpMenu, MF_STRING, 12, "About");
@@ -498,11 +3771,11 @@ int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd
     g_hStatusBar = CreateStatusWindow(WS_CHILD | WS_VISIBLE, "", g_hWnd, IDC_STATUSBAR);
     
     // Set up the status bar parts
-    int statusWidths[4] = {200, 350, 500, -1}; // Width of each part, -1 means extend to the right edge
-    SendMessage(g_hStatusBar, SB_SETPARTS, 4, (LPARAM)statusWidths);
+    int statusWidths[SB_PART_COUNT] = {200, 350, 500, 620, -1}; // Width of each part, -1 means extend to the right edge
+    SendMessage(g_hStatusBar, SB_SETPARTS, SB_PART_COUNT, (LPARAM)statusWidths);
 
-    // Create the edit control (using RichEdit instead of EDIT)
-    g_hEdit = CreateWindowEx(0, RICHEDIT_CLASS, NULL, 
+    // Create the edit control (using the Unicode RichEdit class so decoded text is kept as UTF-16)
+    g_hEdit = CreateWindowExW(0, RICHEDIT_CLASSW, NULL, 
         WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_HSCROLL | ES_MULTILINE | ES_AUTOVSCROLL | ES_AUTOHSCROLL,
         0, 0, 800, 600, g_hWnd, (HMENU)IDC_EDIT, h_instance, NULL);
 
@@ -511,8 +3784,27 @@ int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd
         return 0;
     }
 
+    // Lift RichEdit's default 32K limit on typed and replaced text
+    SendMessage(g_hEdit, EM_EXLIMITTEXT, 0, -1);
+
+    // Get notified of text changes so cached layouts know when they are stale
+    SendMessage(g_hEdit, EM_SETEVENTMASK, 0, ENM_CHANGE);
+
+    // Word wrap layout cache and its target device
+    WrapCacheInit(&g_wrapCache);
+    ColumnCacheInit(&g_columnCache);
+    DocInit(&g_document);
+    SnapshotInit(&g_snapshots);
+    DocInit(&g_reload.text);
+    SourceInit(&g_source);
+    CompletionInit(&g_completion);
+    SearchInit(&g_search);
+    TableInit(&g_table);
+    CursorSetInit(&g_cursors);
+    g_hWrapDC = CreateIC("DISPLAY", NULL, NULL, NULL);
+
     // Subclass the edit control to handle messages
-    g_OldEditProc = (WNDPROC)SetWindowLongPtr(g_hEdit, GWLP_WNDPROC, (LONG_PTR)EditProc);
+    g_OldEditProc = (WNDPROC)SetWindowLongPtrW(g_hEdit, GWLP_WNDPROC, (LONG_PTR)EditProc);
     
     // Initialize the status bar
     UpdateStatusBar();
@@ -558,16 +3850,86 @@ int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE h_prev_instance, LPSTR lp_cmd
     // Free the RichEdit library
     FreeLibrary(hRichEdit);
 
+    // Release the scratch arena and the wrap target device
+    ArenaRelease(&g_ioArena);
+    if (g_hWrapDC != NULL) {
+        DeleteDC(g_hWrapDC);
+    }
+
     return msg.wParam;
 }
 
 LRESULT CALLBACK EditProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param) {
+    // Typing while the file is decoded in another encoding finishes the decoding, so the edit goes ahead;
+    // moving around and selecting read what is already there
+    BOOL moving = message == WM_KEYDOWN && ((w_param >= VK_PRIOR && w_param <= VK_DOWN) ||
+        w_param == VK_SHIFT || w_param == VK_CONTROL || w_param == VK_MENU);
+    if (g_reload.active && !moving && (message == WM_CHAR || message == WM_KEYDOWN || message == WM_PASTE || message == WM_CUT)) {
+        FinishEncodingReload();
+    }
+
+    // The completion list takes the keys it uses while it is showing
+    if (HandleCompletionMessage(hwnd, message, w_param)) {
+        return 0;
+    }
+    if (HandleFindKey(message, w_param)) {
+        return 0;
+    }
+
+    // Multiple cursors and block selection take over typing, pasting and some mouse input
+    if (HandleCursorMessage(hwnd, message, w_param, l_param)) {
+        UpdateStatusBar();
+        return 0;
+    }
+
     switch (message) {
+        case WM_PAINT:
+        {
+            // Draw the extra cursors and the bracket highlight over whatever the control repaints
+            RECT update;
+            BOOL hasUpdate = GetUpdateRect(hwnd, &update, FALSE);
+            LRESULT paintResult = CallWindowProcW(g_OldEditProc, hwnd, message, w_param, l_param);
+            if (hasUpdate) {
+                PaintCursors(hwnd, &update);
+                PaintSearchMatches(hwnd, &update);
+                PaintBracketMatch(hwnd, &update);
+            }
+            return paintResult;
+        }
+
+        case WM_PASTE:
+        case WM_CUT:
+        case WM_CLEAR:
+        case EM_REPLACESEL:
+        case WM_CHAR:
+        case WM_KEYDOWN:
+            // Edits made by these messages are described to the document model as they happen
+            if (IsDescribableEdit(message, w_param)) {
+                LRESULT editResult = CallTrackedEdit(hwnd, message, w_param, l_param);
+                if (message == WM_CHAR) {
+                    UpdateCompletion();
+                } else if (message != WM_KEYDOWN) {
+                    HideCompletion();
+                }
+                UpdateStatusBar();
+                return editResult;
+            }
+            if (message == WM_CHAR || message == WM_KEYDOWN) {
+                // Ctrl+Z and Ctrl+Y
+                LRESULT undoResult = CallUndoEdit(hwnd, message, w_param, l_param);
+                UpdateStatusBar();
+                return undoResult;
+            }
+            break;
+
+        case WM_UNDO:
+        case EM_UNDO:
+        case EM_REDO:
+            return CallUndoEdit(hwnd, message, w_param, l_param);
+
         case WM_SETFOCUS:
         case WM_KILLFOCUS:
-        case WM_CHAR:
         case WM_KEYUP:
-        case WM_KEYDOWN:
         case WM_LBUTTONDOWN:
         case WM_LBUTTONUP:
         case WM_MOUSEMOVE:
@@ -575,12 +3937,45 @@ LRESULT CALLBACK EditProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_para
         case WM_VSCROLL:
         case WM_HSCROLL:
             // Update the status bar after handling the message
-            LRESULT result = CallWindowProc(g_OldEditProc, hwnd, message, w_param, l_param);
+            LRESULT result = CallWindowProcW(g_OldEditProc, hwnd, message, w_param, l_param);
             UpdateStatusBar();
             return result;
     }
     
-    return CallWindowProc(g_OldEditProc, hwnd, message, w_param, l_param);
+    return CallWindowProcW(g_OldEditProc, hwnd, message, w_param, l_param);
+}
+
+// Function to tell whether a menu command or accelerator reads or edits the whole text, so decoding
+// in another encoding (or opening a compressed file) has to finish before it runs
+BOOL CommandNeedsWholeText(WORD command) {
+    switch (command) {
+        case 1:  // Open, Exit and New File leave the text behind anyway
+        case 3:
+        case 16:
+        case 7:  // Copy, Select All and Find work on the text shown so far
+        case 13:
+        case 14:
+        case 9:  // Word Wrap, zoom, Auto Save and the information boxes do not touch the text
+        case 10:
+        case 11:
+        case 20:
+        case 12:
+        case 18:
+        case 19:
+        case 30:
+        case 21: // Choosing an encoding starts decoding again, replacing the reload in progress
+        case 22:
+        case 23:
+        case 24:
+        case 25:
+        case 26:
+        case 27:
+        case 28:
+        case 29:
+            return FALSE;
+        default:
+            return TRUE;
+    }
 }
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param) {
@@ -592,14 +3987,15 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param
             int newHeight = HIWORD(l_param);
 
             // Calculate new status bar part widths based on window width
-            int statusWidths[4];
+            int statusWidths[SB_PART_COUNT];
             statusWidths[0] = newWidth / 5;        // Position info (20% of width)
             statusWidths[1] = statusWidths[0] * 2; // Character count (40% of width)
             statusWidths[2] = statusWidths[1] + newWidth / 5; // Encoding (20% of width)
-            statusWidths[3] = -1;                 // Zoom level (extends to right edge)
+            statusWidths[3] = statusWidths[2] + newWidth / 10; // Line endings (10% of width)
+            statusWidths[4] = -1;                 // Zoom level (extends to right edge)
             
             // Update the status bar parts
-            SendMessage(g_hStatusBar, SB_SETPARTS, 4, (LPARAM)statusWidths);
+            SendMessage(g_hStatusBar, SB_SETPARTS, SB_PART_COUNT, (LPARAM)statusWidths);
             
             // Resize status bar first
             SendMessage(g_hStatusBar, WM_SIZE, 0, 0);
@@ -609,154 +4005,113 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param
             GetWindowRect(g_hStatusBar, &statusRect);
             int statusHeight = statusRect.bottom - statusRect.top;
             
-            // Resize the edit control
-            MoveWindow(g_hEdit, 0, 0, newWidth, newHeight - statusHeight, TRUE);
+            // Resize the edit control, leaving room for the find bar when it is open
+            int findHeight = IsFindBarVisible() ? FIND_BAR_HEIGHT : 0;
+            int editHeight = newHeight - statusHeight - findHeight;
+            MoveWindow(g_hEdit, 0, 0, newWidth, editHeight, TRUE);
+            if (g_hTable != NULL) {
+                MoveWindow(g_hTable, 0, 0, newWidth, editHeight, TRUE);
+            }
+            if (findHeight > 0) {
+                MoveWindow(g_hFindBar, 0, editHeight, newWidth - FIND_STATUS_WIDTH, findHeight, TRUE);
+                MoveWindow(g_hFindStatus, newWidth - FIND_STATUS_WIDTH, editHeight, FIND_STATUS_WIDTH, findHeight, TRUE);
+            }
+            HideCompletion();
+
+            // While the frame is being dragged the control keeps its fixed wrap width;
+            // the new width is applied once, when the drag ends
+            if (!g_bSizing) {
+                ApplyWordWrapWidth();
+            }
             
             // Update the status bar text
             UpdateStatusBar();
         }
         break;
 
+    case WM_ENTERSIZEMOVE:
+        g_bSizing = TRUE;
+        HideCompletion();
+        break;
+
+    case WM_EXITSIZEMOVE:
+        g_bSizing = FALSE;
+        ApplyWordWrapWidth();
+        break;
+
     case WM_COMMAND:
+        // Decoding in another encoding finishes first for the commands that need the whole text
+        if (l_param == 0 && CommandNeedsWholeText(LOWORD(w_param))) {
+            FinishEncodingReload();
+        }
+
         switch (LOWORD(w_param)) {
-        case 1: // Open
-            ZeroMemory(&ofn, sizeof(ofn));
-            ofn.lStructSize = sizeof(ofn);
-            ofn.hwndOwner = g_hWnd;
-            ofn.lpstrFile = (LPSTR)malloc(MAX_PATH);
-            ofn.lpstrFile[0] = '\0';
-            ofn.nMaxFile = MAX_PATH;
-            ofn.lpstrFilter = "Text Files\0*.txt\0All Files\0*.*\0";
-            ofn.nFilterIndex = 1;
-            ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
-
-            if (GetOpenFileName(&ofn)) {
-                HANDLE hFile = CreateFile(ofn.lpstrFile, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-                if (hFile != INVALID_HANDLE_VALUE) {
-                    DWORD dwFileSize = GetFileSize(hFile, NULL);
-                    unsigned char* buffer = (unsigned char*)malloc(dwFileSize + 2); // +2 for null terminator and possible alignment
-
-                    DWORD bytesRead = 0;
-                    if (ReadFile(hFile, buffer, dwFileSize, &bytesRead, NULL)) {
-                        // Detect the encoding of the file
-                        g_currentEncoding = DetectEncoding(buffer, bytesRead);
-                        
-                        // Handle different encodings for display
-                        char* displayText = NULL;
-                        
-                        switch (g_currentEncoding) {
-                            case ENCODING_UTF8: {
-                                // Skip UTF-8 BOM if present (3 bytes: EF BB BF)
-                                if (bytesRead >= 3 && buffer[0] == 0xEF && buffer[1] == 0xBB && buffer[2] == 0xBF) {
-                                    displayText = (char*)(buffer + 3);
-                                    buffer[bytesRead] = '\0'; // Ensure null termination
-                                } else {
-                                    displayText = (char*)buffer;
-                                    buffer[bytesRead] = '\0'; // Ensure null termination
-                                }
-                                break;
-                            }
-                            
-                            case ENCODING_UTF16LE: {
-                                // Skip UTF-16LE BOM if present (2 bytes: FF FE)
-                                // For proper display, we would need to convert UTF-16LE to UTF-8
-                                // This is a simplified version that just skips the BOM
-                                if (bytesRead >= 2 && buffer[0] == 0xFF && buffer[1] == 0xFE) {
-                                    displayText = (char*)(buffer + 2);
-                                } else {
-                                    displayText = (char*)buffer;
-                                }
-                                // For UTF-16LE, we need a proper conversion to display correctly
-                                // This is a simplified version that may not display correctly
-                                buffer[bytesRead] = '\0';
-                                buffer[bytesRead + 1] = '\0'; // Ensure null termination for UTF-16
-                                break;
-                            }
-                            
-                            case ENCODING_UTF16BE: {
-                                // Skip UTF-16BE BOM if present (2 bytes: FE FF)
-                                // For proper display, we would need to convert UTF-16BE to UTF-8
-                                // This is a simplified version that just skips the BOM
-                                if (bytesRead >= 2 && buffer[0] == 0xFE && buffer[1] == 0xFF) {
-                                    displayText = (char*)(buffer + 2);
-                                } else {
-                                    displayText = (char*)buffer;
-                                }
-                                // For UTF-16BE, we need a proper conversion to display correctly
-                                // This is a simplified version that may not display correctly
-                                buffer[bytesRead] = '\0';
-                                buffer[bytesRead + 1] = '\0'; // Ensure null termination for UTF-16
-                                break;
-                            }
-                            
-                            case ENCODING_ASCII:
-                            default: {
-                                displayText = (char*)buffer;
-                                buffer[bytesRead] = '\0'; // Ensure null termination
-                                break;
-                            }
-                        }
-                        
-                        SetWindowText(g_hEdit, displayText);
-                        
-                        // Update the menu to reflect the detected encoding
-                        CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 21 + g_currentEncoding, MF_BYCOMMAND);
-                        
-                        // Update cursor position and status bar after loading file
-                        UpdateStatusBar();
+        case IDC_EDIT: // Notifications from the edit control
+            if (HIWORD(w_param) == EN_CHANGE) {
+                g_editGeneration++;
+
+                // A tracked edit is described to the document model once the control returns;
+                // any other change means the model must resync, only within the undo span after
+                // an undo or redo, but anywhere after drag and drop or IME input
+                if (g_bTrackingEdit) {
+                    g_bEditChanged = TRUE;
+                } else if (!g_bBatchEdit) {
+                    if (!g_bUndoing) {
+                        WidenUndoSpan(0, (size_t)-1, 0);
                     }
+                    g_bDocumentStale = TRUE;
+                }
 
-                    free(buffer);
-                    CloseHandle(hFile);
+                // The open find bar searches the changed text again once typing pauses
+                if (IsFindBarVisible()) {
+                    SetTimer(g_hWnd, SEARCH_TIMER_ID, SEARCH_REFRESH_DELAY, NULL);
+                }
+                if (g_bTableView) {
+                    InvalidateRect(g_hTable, NULL, FALSE);
                 }
             }
+            break;
 
-            free(ofn.lpstrFile);
+        case IDC_FINDBAR: // The find query changed
+            if (HIWORD(w_param) == EN_CHANGE) {
+                UpdateSearch(TRUE);
+            }
             break;
 
-        case 2: // Save
-            ZeroMemory(&ofn, sizeof(ofn));
-            ofn.lStructSize = sizeof(ofn);
-            ofn.hwndOwner = g_hWnd;
-            ofn.lpstrFile = (LPSTR)malloc(MAX_PATH);
-            ofn.lpstrFile[0] = '\0';
-            ofn.nMaxFile = MAX_PATH;
-            ofn.lpstrFilter = "Text Files\0*.txt\0All Files\0*.*\0";
-            ofn.nFilterIndex = 1;
-            ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT;
-
-            if (GetSaveFileName(&ofn)) {
-                HANDLE hFile = CreateFile(ofn.lpstrFile, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-                if (hFile != INVALID_HANDLE_VALUE) {
-                    DWORD dwTextLength = GetWindowTextLength(g_hEdit);
-                    char* buffer = (char*)malloc(dwTextLength + 1);
-
-                    GetWindowText(g_hEdit, buffer, dwTextLength + 1);
-                    
-                    // Convert the text to the selected encoding
-                    size_t encodedSize = 0;
-                    char* encodedBuffer = ConvertToEncoding(buffer, dwTextLength, g_currentEncoding, &encodedSize);
-                    
-                    if (encodedBuffer) {
-                        // Write the encoded text to the file
-                        DWORD bytesWritten = 0;
-                        WriteFile(hFile, encodedBuffer, (DWORD)encodedSize, &bytesWritten, NULL);
-                        free(encodedBuffer);
-                    } else {
-                        // Fallback to writing the original buffer if encoding conversion failed
-                        WriteFile(hFile, buffer, dwTextLength, NULL, NULL);
-                    }
+        case 1: // Open
+            if (PromptForFileName(FALSE)) {
+                if (LoadDocumentFromFile(g_szDialogFile)) {
+                    strcpy(g_szFileName, g_szDialogFile);
+
+                    // Update the menus to reflect the detected encoding and line endings
+                    CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 21 + g_currentEncoding, MF_BYCOMMAND);
+                    CheckMenuRadioItem(GetSubMenu(hViewMenu, 2), 35, 37, 35 + g_lineEnding, MF_BYCOMMAND);
 
-                    free(buffer);
-                    CloseHandle(hFile);
+                    // Delimited data opens as a table; anything else as text
+                    if (IsTableFile(g_szFileName)) {
+                        ShowTableView(TRUE);
+                    } else if (g_bTableView) {
+                        ShowTableView(FALSE);
+                    }
                 }
+
+                // Update cursor position and status bar after loading file
+                UpdateStatusBar();
             }
+            break;
 
-            free(ofn.lpstrFile);
+        case 2: // Save
+            // Save to the current document's path, or ask for one the first time
+            if (g_szFileName[0] == '\0' || g_bTextTruncated) {
+                SendMessage(g_hWnd, WM_COMMAND, 17, 0);
+            } else if (IsDocumentModified() || GetFileAttributes(g_szFileName) == INVALID_FILE_ATTRIBUTES) {
+                // Nothing to write if the text still matches the file
+                SaveDocumentToFile(g_szFileName);
+            }
             break;
 
         case 3: // Exit
-            DestroyWindow(g_hWnd);
+            SendMessage(g_hWnd, WM_CLOSE, 0, 0);
             break;
 
         case 4: // Undo
@@ -787,8 +4142,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param
             // Toggle word wrap state
             g_bWordWrap = !g_bWordWrap;
 
-            // Enable or disable word wrap using EM_SETTARGETDEVICE
-            SendMessage(g_hEdit, EM_SETTARGETDEVICE, 0, g_bWordWrap ? 0 : 1);
+            // Enable word wrap at the current width, or disable it using EM_SETTARGETDEVICE
+            g_wrapColumns = 0;
+            if (g_bWordWrap) {
+                ApplyWordWrapWidth();
+            } else {
+                WrapCancelBackground(&g_wrapCache);
+                SendMessage(g_hEdit, EM_SETTARGETDEVICE, 0, 1);
+            }
 
             // Update the menu item state
             CheckMenuItem(hViewMenu, 9, g_bWordWrap ? MF_CHECKED : MF_UNCHECKED);
@@ -815,68 +4176,58 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param
             break;
             
         case 14: // Find
+            ShowFindBar();
+            break;
+
         case 15: // Replace
-            // These would typically open dialog boxes for find/replace functionality
+            // This would typically open a dialog box for replace functionality
             // For now, just show a placeholder message
             MessageBox(g_hWnd, "This feature is not yet implemented.", "Information", MB_OK | MB_ICONINFORMATION);
             break;
         
         case 16: // New File
             // Confirm if the user wants to discard unsaved changes
-            if (GetWindowTextLength(g_hEdit) > 0) {
+            if (IsDocumentModified()) {
                 int response = MessageBox(g_hWnd, "Do you want to save changes?", "Confirmation", MB_YESNOCANCEL | MB_ICONQUESTION);
                 if (response == IDYES) {
-                    // Trigger Save functionality
+                    // Trigger Save functionality, and keep the text if it could not be saved
                     SendMessage(g_hWnd, WM_COMMAND, 2, 0);
+                    if (IsDocumentModified()) {
+                        break;
+                    }
                 } else if (response == IDCANCEL) {
                     // User canceled the operation
                     break;
                 }
             }
-            // Clear the edit control
+            // Clear the edit control and forget the old file so Auto Save cannot overwrite it
+            if (g_bTableView) {
+                ShowTableView(FALSE);
+            }
+            FinishAutoSave();
+            CancelEncodingReload();
+            SourceClose(&g_source);
+            g_bTextTruncated = FALSE;
+            CursorSetClear(&g_cursors);
             SetWindowText(g_hEdit, "");
+            g_szFileName[0] = '\0';
+            g_editGeneration++;
+            g_bDocumentStale = TRUE;
+            g_lineEnding = EOL_CRLF;
+            g_bMixedLineEndings = FALSE;
+            CheckMenuRadioItem(GetSubMenu(hViewMenu, 2), 35, 37, 35 + g_lineEnding, MF_BYCOMMAND);
+            RecordSavedState();
+            UpdateDocumentMemoryUsage();
             UpdateStatusBar();
             break;
         
         case 17: // Save As
-            ZeroMemory(&ofn, sizeof(ofn));
-            ofn.lStructSize = sizeof(ofn);
-            ofn.hwndOwner = g_hWnd;
-            ofn.lpstrFile = (LPSTR)malloc(MAX_PATH);
-            ofn.lpstrFile[0] = '\0';
-            ofn.nMaxFile = MAX_PATH;
-            ofn.lpstrFilter = "Text Files\0*.txt\0All Files\0*.*\0";
-            ofn.nFilterIndex = 1;
-            ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT;
-        
-            if (GetSaveFileName(&ofn)) {
-                HANDLE hFile = CreateFile(ofn.lpstrFile, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-                if (hFile != INVALID_HANDLE_VALUE) {
-                    DWORD dwTextLength = GetWindowTextLength(g_hEdit);
-                    char* buffer = (char*)malloc(dwTextLength + 1);
-        
-                    GetWindowText(g_hEdit, buffer, dwTextLength + 1);
-                    
-                    // Convert the text to the selected encoding
-                    size_t encodedSize = 0;
-                    char* encodedBuffer = ConvertToEncoding(buffer, dwTextLength, g_currentEncoding, &encodedSize);
-                    
-                    if (encodedBuffer) {
-                        // Write the encoded text to the file
-                        DWORD bytesWritten = 0;
-                        WriteFile(hFile, encodedBuffer, (DWORD)encodedSize, &bytesWritten, NULL);
-                        free(encodedBuffer);
-                    } else {
-                        // Fallback to writing the original buffer if encoding conversion failed
-                        WriteFile(hFile, buffer, dwTextLength, NULL, NULL);
-                    }
-        
-                    free(buffer);
-                    CloseHandle(hFile);
+            if (PromptForFileName(TRUE)) {
+                if (SaveDocumentToFile(g_szDialogFile)) {
+                    strcpy(g_szFileName, g_szDialogFile);
+                    g_bTextTruncated = FALSE;
                 }
             }
-        
-            free(ofn.lpstrFile);
             break;
         
         case 18: // Auto Save
@@ -898,58 +4249,102 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param
             break;
             
         case 21: // UTF-8 encoding
-            g_currentEncoding = ENCODING_UTF8;
-            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 21, MF_BYCOMMAND);
-            UpdateStatusBar();
-            break;
-            
         case 22: // UTF-16LE encoding
-            g_currentEncoding = ENCODING_UTF16LE;
-            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 22, MF_BYCOMMAND);
+        case 23: // UTF-16BE encoding
+        case 24: // ASCII encoding
+        case 25: // ISO-8859-1 encoding
+        case 26: // ISO-8859-15 encoding
+        case 27: // Windows-1252 encoding
+        case 28: // Shift-JIS encoding
+        case 29: // GB18030 encoding
+            // Read the file's bytes again as this encoding
+            ReloadWithEncoding(LOWORD(w_param) - 21);
             UpdateStatusBar();
             break;
-            
-        case 23: // UTF-16BE encoding
-            g_currentEncoding = ENCODING_UTF16BE;
-            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 23, MF_BYCOMMAND);
+
+        case 51: // Convert To UTF-8
+        case 52: // Convert To UTF-16LE
+        case 53: // Convert To UTF-16BE
+        case 54: // Convert To ASCII
+        case 55: // Convert To ISO-8859-1
+        case 56: // Convert To ISO-8859-15
+        case 57: // Convert To Windows-1252
+        case 58: // Convert To Shift-JIS
+        case 59: // Convert To GB18030
+            // The text is unchanged; it is written in this encoding on the next save
+            g_currentEncoding = LOWORD(w_param) - 51;
+            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 21 + g_currentEncoding, MF_BYCOMMAND);
             UpdateStatusBar();
             break;
-            
-        case 24: // ASCII encoding
-            g_currentEncoding = ENCODING_ASCII;
-            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 24, MF_BYCOMMAND);
+
+        case 35: // Windows (CRLF) line endings
+        case 36: // Unix (LF) line endings
+        case 37: // Classic Mac (CR) line endings
+            // The text itself is unchanged; the chosen style is written on the next save
+            g_lineEnding = LOWORD(w_param) - 35;
+            g_bMixedLineEndings = FALSE;
+            CheckMenuRadioItem(GetSubMenu(hViewMenu, 2), 35, 37, LOWORD(w_param), MF_BYCOMMAND);
             UpdateStatusBar();
             break;
-            
-        case 25: // ISO-8859-1 encoding
-            g_currentEncoding = ENCODING_ISO_8859_1;
-            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 25, MF_BYCOMMAND);
+
+        case 38: // Toggle Fold
+            ToggleFold();
             UpdateStatusBar();
             break;
-            
-        case 26: // ISO-8859-15 encoding
-            g_currentEncoding = ENCODING_ISO_8859_15;
-            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 26, MF_BYCOMMAND);
+
+        case 39: // Unfold All
+            UnfoldAll();
             UpdateStatusBar();
             break;
-            
-        case 27: // Windows-1252 encoding
-            g_currentEncoding = ENCODING_WINDOWS_1252;
-            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 27, MF_BYCOMMAND);
+
+        case 48: // Table View
+            ShowTableView(!g_bTableView);
             UpdateStatusBar();
             break;
-            
-        case 28: // Shift-JIS encoding
-            g_currentEncoding = ENCODING_SHIFT_JIS;
-            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 28, MF_BYCOMMAND);
+
+        case 49: // Format JSON/XML
+        case 50: // Minify JSON/XML
+            FormatDocumentText(LOWORD(w_param) == 50);
             UpdateStatusBar();
             break;
-            
-        case 29: // GB18030 encoding
-            g_currentEncoding = ENCODING_GB18030;
-            CheckMenuRadioItem(GetSubMenu(hViewMenu, 1), 21, 29, 29, MF_BYCOMMAND);
+
+        case 40: // Sort Lines
+        case 41: // Sort Lines Numerically
+        case 42: // Sort Lines Naturally
+        case 43: // Sort Lines Ignoring Case
+        case 44: // Remove Duplicate Lines
+        case 45: // Reverse Lines
+        case 46: // Keep Lines Matching Find Text
+        case 47: // Remove Lines Matching Find Text
+            ApplyLineOperation(LOWORD(w_param));
             UpdateStatusBar();
             break;
+
+        case 30: // Memory Usage
+            ShowMemoryUsage();
+            break;
+
+        case 31: // Add Cursor Above
+            AddCursorOnLine(-1);
+            break;
+
+        case 32: // Add Cursor Below
+            AddCursorOnLine(1);
+            break;
+
+        case 33: // Compare with Saved
+            if (g_szFileName[0] == '\0') {
+                MessageBox(g_hWnd, "The document has not been saved yet.", "Compare", MB_OK | MB_ICONINFORMATION);
+            } else {
+                CompareWithFile(g_szFileName);
+            }
+            break;
+
+        case 34: // Compare with File
+            if (PromptForFileName(FALSE)) {
+                CompareWithFile(g_szDialogFile);
+            }
+            break;
         }
         break;
 
@@ -974,36 +4369,74 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM w_param, LPARAM l_param
         }
         break;
 
+    case WM_CLOSE:
+        // Only ask about saving when the text really differs from the file
+        if (IsDocumentModified()) {
+            int response = MessageBox(g_hWnd, "Do you want to save changes?", "Confirmation", MB_YESNOCANCEL | MB_ICONQUESTION);
+            if (response == IDYES) {
+                SendMessage(g_hWnd, WM_COMMAND, 2, 0);
+
+                // Save As was cancelled or the file could not be written: keep the window and the text
+                if (IsDocumentModified()) {
+                    break;
+                }
+            } else if (response == IDCANCEL) {
+                break;
+            }
+        }
+        DestroyWindow(g_hWnd);
+        break;
+
     case WM_DESTROY:
         if (g_hFont != NULL) {
             DeleteObject(g_hFont);
         }
         PostQuitMessage(0);
         KillTimer(g_hWnd, AUTOSAVE_TIMER_ID);
+        KillTimer(g_hWnd, WRAP_TIMER_ID);
+        KillTimer(g_hWnd, SEARCH_TIMER_ID);
+        KillTimer(g_hWnd, ENCODING_TIMER_ID);
+
+        // Stop the background layout before the window goes away
+        WrapCacheFree(&g_wrapCache);
+        ColumnCacheFree(&g_columnCache);
+        CursorSetFree(&g_cursors);
+        CompletionFree(&g_completion);
+        SearchFree(&g_search);
+        TableFree(&g_table);
+        FinishAutoSave();
+        DocFree(&g_reload.text);
+        SourceReaderClose(&g_reload.reader);
+        SourceClose(&g_source);
+        DocFree(&g_document);
+        SnapshotFree(&g_snapshots);
         break;
     
     case WM_TIMER:
         if (w_param == AUTOSAVE_TIMER_ID && g_bAutoSave) {
-            // Perform auto save if there's content and Auto Save is enabled
-            if (GetWindowTextLength(g_hEdit) > 0) {
-                // If we have a file path already, save to it
-                if (ofn.lpstrFile != NULL && ofn.lpstrFile[0] != '\0') {
-                    HANDLE hFile = CreateFile(ofn.lpstrFile, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-                    if (hFile != INVALID_HANDLE_VALUE) {
-                        DWORD dwTextLength = GetWindowTextLength(g_hEdit);
-                        char* buffer = (char*)malloc(dwTextLength + 1);
-    
-                        GetWindowText(g_hEdit, buffer, dwTextLength + 1);
-                        WriteFile(hFile, buffer, dwTextLength, NULL, NULL);
-    
-                        free(buffer);
-                        CloseHandle(hFile);
-                    }
-                }
+            // Perform auto save if the text has changed since it was loaded or saved
+            if (IsDocumentModified()) {
+                // If we have a file path already, save to it in the background
+                StartAutoSave();
             }
+        } else if (w_param == WRAP_TIMER_ID) {
+            // Zooming has settled, re-wrap once at the new width
+            ApplyWordWrapWidth();
+        } else if (w_param == SEARCH_TIMER_ID) {
+            UpdateSearch(FALSE);
+        } else if (w_param == ENCODING_TIMER_ID) {
+            ContinueEncodingReload();
         }
         break;
 
+    case WM_SEARCH_PROGRESS:
+        ShowSearchProgress();
+        break;
+
+    case WM_AUTOSAVE_DONE:
+        FinishAutoSave();
+        break;
+
     default:
         return DefWindowProc(hwnd, message, w_param, l_param);
     }
@@ -1018,6 +4451,11 @@ void SetZoomLevel(int zoom) {
 
     // Set the zoom level using EM_SETZOOM
     SendMessage(g_hEdit, EM_SETZOOM, numerator, denominator);
+
+    // Re-wrap once zooming settles instead of on every step
+    if (g_bWordWrap) {
+        SetTimer(g_hWnd, WRAP_TIMER_ID, WRAP_REFLOW_DELAY, NULL);
+    }
     
     // Update the status bar to show the new zoom level
     UpdateStatusBar();
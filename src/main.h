@@ -6,14 +6,82 @@
 
 #define IDC_STATUSBAR 1001
 #define IDC_EDIT 1002
+#define IDC_FINDBAR 1003
+#define IDC_FINDSTATUS 1004
+#define IDC_TABLE 1005
+#define IDC_TABLEGOTO 1006
 
 // Status bar parts
 #define SB_PART_POSITION 0
 #define SB_PART_CHARCOUNT 1
 #define SB_PART_ENCODING 2
-#define SB_PART_ZOOM 3
+#define SB_PART_EOL 3
+#define SB_PART_ZOOM 4
+#define SB_PART_COUNT 5
 
 #define AUTOSAVE_TIMER_ID 100
+#define WRAP_TIMER_ID 101
+#define SEARCH_TIMER_ID 102
+#define ENCODING_TIMER_ID 103
+
+// Posted by the background search as it finds more matches
+#define WM_SEARCH_PROGRESS (WM_APP + 1)
+
+// Posted by the background autosave once the file is written
+#define WM_AUTOSAVE_DONE (WM_APP + 2)
+
+// Find bar size in pixels; it sits between the editor and the status bar while open
+#define FIND_BAR_HEIGHT 28
+#define FIND_STATUS_WIDTH 200
+
+// Most matches highlighted in the viewport at once
+#define FIND_MAX_HIGHLIGHTS 1024
+
+// Text searched at a time (UTF-16 units) when F3 cannot wait for the background search
+#define FIND_SCAN_WINDOW (1024 * 1024)
+
+// Delay (ms) after an edit before the open find bar searches the changed text again
+#define SEARCH_REFRESH_DELAY 300
+
+// Table view layout in pixels: space either side of a cell's text, and the go-to-row box in the header
+#define TABLE_CELL_PADDING 6
+#define TABLE_GOTO_WIDTH 120
+#define TABLE_GOTO_LABEL_WIDTH 80
+
+// Rows scrolled per mouse wheel notch in the table view
+#define TABLE_WHEEL_ROWS 3
+
+// UTF-16 units read from the top of the document to guess the delimiter of a file that is not .tsv
+#define TABLE_DETECT_SAMPLE 65536
+
+// Reading a file again in another encoding: bytes decoded per timer tick, the tick interval (ms),
+// and the most bytes of the lines in view decoded up front
+#define ENCODING_RELOAD_SLICE 4194304
+#define ENCODING_RELOAD_INTERVAL 10
+#define ENCODING_RELOAD_VISIBLE_LIMIT 1048576
+
+// Most characters of a file's text decoded a slice at a time; the edit control's offsets are LONG
+#define ENCODING_RELOAD_TEXT_LIMIT 1073741824
+
+// UTF-16 units read from the start of the text to tell JSON from XML before formatting
+#define FORMAT_DETECT_SAMPLE 256
+
+// Delay (ms) before re-wrapping after a zoom change, so repeated zoom steps re-wrap once
+#define WRAP_REFLOW_DELAY 200
+
+// Tab stop width in columns
+#define TAB_WIDTH 4
+
+// UTF-16 units converted per piece when saving to a code page, so line breaks can be expanded on the way
+#define ENCODE_STAGE_UNITS 16384
+
+// Memory ceiling in MB across all subsystems, 0 means unlimited (override with --memory-limit=<MB>)
+#define MEMORY_LIMIT_DEFAULT_MB 0
+
+// Resident document text in MB before cold chunks are compressed, 0 means never compress
+// (override with --resident-limit=<MB>)
+// Only the document model's copy is bounded: the edit control still holds the whole text uncompressed
+#define RESIDENT_LIMIT_DEFAULT_MB 256
 
 // Global variables for theming
 #define THEME_LIGHT 0
@@ -3,7 +3,7 @@ REM Set the name of the output executable
 set OUTPUT_FILE=cycharm.exe
 
 REM Set the name of the source file
-set SOURCE_FILE=main.c
+set SOURCE_FILE=main.c memory.c wrap.c column.c document.c cursors.c diff.c hash.c compress.c eol.c structure.c completion.c search.c lines.c table.c format.c source.c gzip.c snapshot.c
 
 REM Compilation command
 gcc -o %OUTPUT_FILE% %SOURCE_FILE% -mwindows -lcomdlg32 -lcomctl32 -lmsftedit
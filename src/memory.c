@@ -0,0 +1,238 @@
+// CyCharm : Memory accounting, arenas and per-subsystem usage tracking
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <stdlib.h>
+#include "memory.h"
+
+// Every accounted allocation carries a small header so MemFree knows what to give back
+typedef struct MemHeader {
+    size_t size;
+    size_t subsystem; // size_t keeps the user pointer 16-byte aligned on 64-bit
+} MemHeader;
+
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + 15) & ~(size_t)15)
+
+static volatile LONG64 g_memUsage[MEM_SUBSYSTEM_COUNT];
+static volatile LONG64 g_memExternal[MEM_SUBSYSTEM_COUNT];
+static volatile LONG64 g_memTotal = 0;
+static volatile LONG64 g_memPeak = 0;
+static size_t g_memCeiling = 0;
+
+static const char* g_memSubsystemNames[MEM_SUBSYSTEM_COUNT] = {
+    "Document",
+    "Undo",
+    "Indexes",
+    "Caches",
+    "Scratch"
+};
+
+// Function to add (or remove) bytes from a subsystem's running total
+static void MemAccount(int subsystem, LONG64 delta) {
+    InterlockedExchangeAdd64(&g_memUsage[subsystem], delta);
+    LONG64 total = InterlockedExchangeAdd64(&g_memTotal, delta) + delta;
+
+    // Track the peak so repeated operations can be checked for steady-state growth
+    LONG64 peak = InterlockedCompareExchange64(&g_memPeak, 0, 0);
+    while (total > peak) {
+        LONG64 previous = InterlockedCompareExchange64(&g_memPeak, total, peak);
+        if (previous == peak) {
+            break;
+        }
+        peak = previous;
+    }
+}
+
+// Function to check whether an allocation of the given size fits under the ceiling
+static int MemWithinCeiling(size_t size) {
+    if (g_memCeiling == 0) {
+        return 1;
+    }
+    return (size_t)g_memTotal + size <= g_memCeiling;
+}
+
+void* MemAlloc(int subsystem, size_t size) {
+    if (subsystem < 0 || subsystem >= MEM_SUBSYSTEM_COUNT || !MemWithinCeiling(size)) {
+        return NULL;
+    }
+
+    MemHeader* header = (MemHeader*)malloc(sizeof(MemHeader) + size);
+    if (header == NULL) {
+        return NULL;
+    }
+
+    header->size = size;
+    header->subsystem = (size_t)subsystem;
+    MemAccount(subsystem, (LONG64)size);
+    return header + 1;
+}
+
+void* MemRealloc(int subsystem, void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return MemAlloc(subsystem, size);
+    }
+
+    MemHeader* header = (MemHeader*)ptr - 1;
+    size_t oldSize = header->size;
+    subsystem = (int)header->subsystem;
+
+    if (size > oldSize && !MemWithinCeiling(size - oldSize)) {
+        return NULL;
+    }
+
+    MemHeader* grown = (MemHeader*)realloc(header, sizeof(MemHeader) + size);
+    if (grown == NULL) {
+        return NULL;
+    }
+
+    grown->size = size;
+    MemAccount(subsystem, (LONG64)size - (LONG64)oldSize);
+    return grown + 1;
+}
+
+void MemFree(void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    MemHeader* header = (MemHeader*)ptr - 1;
+    MemAccount((int)header->subsystem, -(LONG64)header->size);
+    free(header);
+}
+
+void MemSetExternalUsage(int subsystem, size_t bytes) {
+    if (subsystem < 0 || subsystem >= MEM_SUBSYSTEM_COUNT) {
+        return;
+    }
+
+    LONG64 previous = InterlockedExchange64(&g_memExternal[subsystem], (LONG64)bytes);
+    MemAccount(subsystem, (LONG64)bytes - previous);
+}
+
+size_t MemGetUsage(int subsystem) {
+    if (subsystem < 0 || subsystem >= MEM_SUBSYSTEM_COUNT) {
+        return 0;
+    }
+    return (size_t)g_memUsage[subsystem];
+}
+
+size_t MemGetTotalUsage(void) {
+    return (size_t)g_memTotal;
+}
+
+size_t MemGetPeakUsage(void) {
+    return (size_t)g_memPeak;
+}
+
+const char* MemGetSubsystemName(int subsystem) {
+    if (subsystem < 0 || subsystem >= MEM_SUBSYSTEM_COUNT) {
+        return "Unknown";
+    }
+    return g_memSubsystemNames[subsystem];
+}
+
+void MemSetCeiling(size_t bytes) {
+    g_memCeiling = bytes;
+}
+
+size_t MemGetCeiling(void) {
+    return g_memCeiling;
+}
+
+void ArenaInit(Arena* arena, int subsystem, size_t blockSize) {
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->blockSize = blockSize > 0 ? blockSize : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->highWater = 0;
+    arena->subsystem = subsystem;
+}
+
+// Function to append a new block large enough for the requested size
+static ArenaBlock* ArenaGrow(Arena* arena, size_t size) {
+    size_t blockSize = size > arena->blockSize ? size : arena->blockSize;
+    ArenaBlock* block = (ArenaBlock*)MemAlloc(arena->subsystem, ARENA_HEADER_SIZE + blockSize);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->size = blockSize;
+    block->used = 0;
+
+    if (arena->current != NULL) {
+        block->next = arena->current->next;
+        arena->current->next = block;
+    } else {
+        arena->first = block;
+    }
+    arena->current = block;
+    return block;
+}
+
+void* ArenaAlloc(Arena* arena, size_t size) {
+    // Keep every allocation 16-byte aligned
+    size = (size + 15) & ~(size_t)15;
+
+    ArenaBlock* block = arena->current != NULL ? arena->current : arena->first;
+    if (arena->current == NULL && block != NULL) {
+        arena->current = block;
+    }
+
+    // Walk forward through blocks retained from earlier operations before growing
+    while (block != NULL && block->size - block->used < size) {
+        block = block->next;
+        if (block != NULL) {
+            block->used = 0;
+            arena->current = block;
+        }
+    }
+
+    if (block == NULL) {
+        block = ArenaGrow(arena, size);
+        if (block == NULL) {
+            return NULL;
+        }
+    }
+
+    void* result = (unsigned char*)block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+    return result;
+}
+
+void ArenaReset(Arena* arena) {
+    size_t used = 0;
+    int blockCount = 0;
+    for (ArenaBlock* block = arena->first; block != NULL; block = block->next) {
+        used += block->used;
+        blockCount++;
+    }
+    if (used > arena->highWater) {
+        arena->highWater = used;
+    }
+
+    // If the last operation spilled over several blocks, replace them with one block
+    // sized for the high-water mark so the next operation of that size fits without growing
+    if (blockCount > 1) {
+        ArenaRelease(arena);
+        if (arena->highWater > arena->blockSize) {
+            arena->blockSize = arena->highWater;
+        }
+        return;
+    }
+
+    if (arena->first != NULL) {
+        arena->first->used = 0;
+    }
+    arena->current = arena->first;
+}
+
+void ArenaRelease(Arena* arena) {
+    ArenaBlock* block = arena->first;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        MemFree(block);
+        block = next;
+    }
+    arena->first = NULL;
+    arena->current = NULL;
+}
@@ -0,0 +1,59 @@
+// CyCharm : Memory accounting, arenas and per-subsystem usage tracking
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_MEMORY_H
+#define CYCHARM_MEMORY_H
+
+#include <stddef.h>
+
+// Memory subsystems tracked by the accounting API
+#define MEM_DOCUMENT 0
+#define MEM_UNDO 1
+#define MEM_INDEX 2
+#define MEM_CACHE 3
+#define MEM_SCRATCH 4
+#define MEM_SUBSYSTEM_COUNT 5
+
+// Default block size for per-operation arenas (1 MB)
+#define ARENA_DEFAULT_BLOCK_SIZE (1024 * 1024)
+
+// Accounted allocations. MemAlloc returns NULL when the allocation would exceed the ceiling.
+// MemRealloc of NULL allocates from the subsystem; otherwise the block stays in the one it came from.
+void* MemAlloc(int subsystem, size_t size);
+void* MemRealloc(int subsystem, void* ptr, size_t size);
+void MemFree(void* ptr);
+
+// Memory owned by something else (e.g. the edit control) that should still show up in the totals
+void MemSetExternalUsage(int subsystem, size_t bytes);
+
+size_t MemGetUsage(int subsystem);
+size_t MemGetTotalUsage(void);
+size_t MemGetPeakUsage(void);
+const char* MemGetSubsystemName(int subsystem);
+
+// Ceiling in bytes across all subsystems, 0 means unlimited
+void MemSetCeiling(size_t bytes);
+size_t MemGetCeiling(void);
+
+// Arena for per-operation scratch memory. Blocks are kept across ArenaReset
+// so a repeated operation of the same size does not touch the heap again.
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+typedef struct Arena {
+    ArenaBlock* first;
+    ArenaBlock* current;
+    size_t blockSize;
+    size_t highWater; // Largest total used between resets
+    int subsystem;
+} Arena;
+
+void ArenaInit(Arena* arena, int subsystem, size_t blockSize);
+void* ArenaAlloc(Arena* arena, size_t size);
+void ArenaReset(Arena* arena);
+void ArenaRelease(Arena* arena);
+
+#endif
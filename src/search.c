@@ -0,0 +1,346 @@
+// CyCharm : Incremental search with refinement and a background scan
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "memory.h"
+#include "search.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SEARCH_USE_SSE2
+#endif
+
+// Minimum time between progress notifications from the worker, in milliseconds
+#define SEARCH_NOTIFY_INTERVAL 50
+
+static WCHAR SearchFold(WCHAR c) {
+    return c >= L'A' && c <= L'Z' ? (WCHAR)(c + (L'a' - L'A')) : c;
+}
+
+static void SearchFoldQuery(const WCHAR* query, int length, WCHAR* folded) {
+    for (int i = 0; i < length; i++) {
+        folded[i] = SearchFold(query[i]);
+    }
+}
+
+// Function to find matches of a folded query starting in text[from, limit), where text holds length units
+// Stops once out is full; returns the number found and sets *next to where to carry on
+static size_t SearchScanText(const WCHAR* text, size_t length, size_t from, size_t limit,
+    const WCHAR* query, int queryLength, size_t* out, size_t maxOut, size_t* next) {
+    size_t found = 0;
+    size_t end = length >= (size_t)queryLength ? length - queryLength + 1 : 0;
+    if (end > limit) {
+        end = limit;
+    }
+
+    WCHAR first = query[0];
+    WCHAR firstUpper = first >= L'a' && first <= L'z' ? (WCHAR)(first - (L'a' - L'A')) : first;
+#ifdef SEARCH_USE_SSE2
+    __m128i lower = _mm_set1_epi16((short)first);
+    __m128i upper = _mm_set1_epi16((short)firstUpper);
+#endif
+
+    size_t i = from;
+    while (i < end) {
+#ifdef SEARCH_USE_SSE2
+        // Step over 8 units at once while none of them can start a match
+        if (i + 8 <= end) {
+            __m128i units = _mm_loadu_si128((const __m128i*)(text + i));
+            __m128i hits = _mm_or_si128(_mm_cmpeq_epi16(units, lower), _mm_cmpeq_epi16(units, upper));
+            if (_mm_movemask_epi8(hits) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+#endif
+        if (text[i] == first || text[i] == firstUpper) {
+            int j = 1;
+            while (j < queryLength && SearchFold(text[i + j]) == query[j]) {
+                j++;
+            }
+            if (j == queryLength) {
+                out[found++] = i;
+                if (found == maxOut) {
+                    *next = i + 1;
+                    return found;
+                }
+            }
+        }
+        i++;
+    }
+
+    *next = limit;
+    return found;
+}
+
+void SearchInit(SearchState* search) {
+    ZeroMemory(search, sizeof(SearchState));
+    DocInit(&search->snapshot);
+    InitializeCriticalSection(&search->lock);
+}
+
+void SearchFree(SearchState* search) {
+    SearchClear(search);
+    MemFree(search->matches);
+    search->matches = NULL;
+    search->capacity = 0;
+    DeleteCriticalSection(&search->lock);
+}
+
+// Function to make the worker's progress visible to the UI thread and tell it, at most every so often
+static void SearchPublish(SearchState* search, size_t count, size_t covered, BOOL complete, DWORD* lastNotify) {
+    EnterCriticalSection(&search->lock);
+    search->count = count;
+    search->covered = covered;
+    search->complete = complete;
+    LeaveCriticalSection(&search->lock);
+
+    DWORD now = GetTickCount();
+    if (search->notifyWindow != NULL && (complete || now - *lastNotify >= SEARCH_NOTIFY_INTERVAL)) {
+        PostMessage(search->notifyWindow, search->notifyMessage, 0, 0);
+        *lastNotify = now;
+    }
+}
+
+// Function to add matches found in a window of the text, growing the array under the lock
+static BOOL SearchAppend(SearchState* search, size_t count, const size_t* found, size_t foundCount, size_t base) {
+    if (count + foundCount > search->capacity) {
+        size_t capacity = search->capacity > 0 ? search->capacity * 2 : SEARCH_BATCH;
+        while (capacity < count + foundCount) {
+            capacity *= 2;
+        }
+
+        EnterCriticalSection(&search->lock);
+        size_t* matches = (size_t*)MemRealloc(MEM_INDEX, search->matches, capacity * sizeof(size_t));
+        if (matches != NULL) {
+            search->matches = matches;
+            search->capacity = capacity;
+        }
+        LeaveCriticalSection(&search->lock);
+        if (matches == NULL) {
+            return FALSE;
+        }
+    }
+
+    // Slots past the published count are never read by the UI thread, so they need no lock
+    for (size_t i = 0; i < foundCount; i++) {
+        search->matches[count + i] = base + found[i];
+    }
+    return TRUE;
+}
+
+// Background worker: narrows down the previous query's matches in place, then scans the rest of the
+// text window by window, checking for cancellation between batches
+static DWORD WINAPI SearchWorker(LPVOID param) {
+    SearchState* search = (SearchState*)param;
+    const Document* doc = &search->snapshot;
+    const WCHAR* query = search->query;
+    int queryLength = search->queryLength;
+    size_t length = DocLength(doc);
+    DWORD lastNotify = GetTickCount();
+    size_t kept = search->count;
+
+    WCHAR* window = (WCHAR*)MemAlloc(MEM_SCRATCH, ((size_t)SEARCH_WINDOW + SEARCH_MAX_QUERY) * sizeof(WCHAR));
+    if (window == NULL) {
+        SearchPublish(search, kept, search->refineCount > 0 ? search->matches[0] : search->scanFrom, FALSE, &lastNotify);
+        return 0;
+    }
+
+    // Check each batch of old matches against one copy of the text they span
+    size_t i = 0;
+    while (i < search->refineCount) {
+        size_t first = search->matches[i];
+        size_t batchEnd = i;
+        while (batchEnd < search->refineCount && batchEnd - i < SEARCH_BATCH &&
+            search->matches[batchEnd] + queryLength - first <= SEARCH_WINDOW) {
+            batchEnd++;
+        }
+        size_t textEnd = search->matches[batchEnd - 1] + queryLength;
+        if (textEnd > length) {
+            textEnd = length;
+        }
+        DocGetText(doc, first, textEnd, window);
+
+        for (; i < batchEnd; i++) {
+            size_t offset = search->matches[i];
+            if (offset + queryLength > textEnd) {
+                continue;
+            }
+            const WCHAR* candidate = window + (offset - first);
+            int j = 0;
+            while (j < queryLength && SearchFold(candidate[j]) == query[j]) {
+                j++;
+            }
+            if (j == queryLength) {
+                search->matches[kept++] = offset;
+            }
+        }
+
+        size_t covered = i < search->refineCount ? search->matches[i] : search->scanFrom;
+        SearchPublish(search, kept, covered, FALSE, &lastNotify);
+        if (search->cancel) {
+            MemFree(window);
+            return 0;
+        }
+    }
+
+    size_t found[SEARCH_BATCH];
+    size_t start = search->scanFrom;
+    do {
+        size_t end = length - start > SEARCH_WINDOW ? start + SEARCH_WINDOW : length;
+        size_t textEnd = length - end > (size_t)queryLength - 1 ? end + queryLength - 1 : length;
+        DocGetText(doc, start, textEnd, window);
+
+        size_t from = 0;
+        while (from < end - start) {
+            size_t next;
+            size_t foundCount = SearchScanText(window, textEnd - start, from, end - start,
+                query, queryLength, found, SEARCH_BATCH, &next);
+            if (!SearchAppend(search, kept, found, foundCount, start)) {
+                // Out of memory: keep what fits and report the search as incomplete
+                SearchPublish(search, kept, start + from, FALSE, &lastNotify);
+                MemFree(window);
+                return 0;
+            }
+            kept += foundCount;
+            from = next;
+        }
+
+        SearchPublish(search, kept, end, end == length, &lastNotify);
+        start = end;
+    } while (start < length && !search->cancel);
+
+    MemFree(window);
+    return 0;
+}
+
+BOOL SearchStart(SearchState* search, const Document* doc, const WCHAR* query, int length,
+    HWND notifyWindow, UINT notifyMessage) {
+    SearchCancel(search);
+    if (length <= 0 || length > SEARCH_MAX_QUERY) {
+        SearchClear(search);
+        return FALSE;
+    }
+
+    WCHAR folded[SEARCH_MAX_QUERY];
+    SearchFoldQuery(query, length, folded);
+
+    // The snapshot shares its root with the document until either changes, so equal roots mean equal text
+    BOOL extends = search->queryLength > 0 && search->snapshot.root == doc->root &&
+        length >= search->queryLength && memcmp(folded, search->query, search->queryLength * sizeof(WCHAR)) == 0;
+    if (extends && length == search->queryLength) {
+        // Same query: carry on from where the last scan stopped
+        if (search->complete) {
+            return TRUE;
+        }
+        search->refineCount = 0;
+        search->scanFrom = search->covered;
+    } else if (extends) {
+        search->refineCount = search->count;
+        search->scanFrom = search->covered;
+        search->count = 0;
+        search->covered = search->refineCount > 0 ? search->matches[0] : search->scanFrom;
+    } else {
+        DocCopy(&search->snapshot, doc);
+        search->refineCount = 0;
+        search->scanFrom = 0;
+        search->count = 0;
+        search->covered = 0;
+    }
+
+    memcpy(search->query, folded, length * sizeof(WCHAR));
+    search->queryLength = length;
+    search->complete = FALSE;
+    search->notifyWindow = notifyWindow;
+    search->notifyMessage = notifyMessage;
+    search->cancel = 0;
+
+    search->worker = CreateThread(NULL, 0, SearchWorker, search, 0, NULL);
+    if (search->worker == NULL) {
+        // No thread available: search on the calling thread
+        SearchWorker(search);
+    }
+    return TRUE;
+}
+
+void SearchCancel(SearchState* search) {
+    if (search->worker == NULL) {
+        return;
+    }
+
+    InterlockedExchange(&search->cancel, 1);
+    WaitForSingleObject(search->worker, INFINITE);
+    CloseHandle(search->worker);
+    search->worker = NULL;
+}
+
+void SearchClear(SearchState* search) {
+    SearchCancel(search);
+    DocFree(&search->snapshot);
+    search->queryLength = 0;
+    search->count = 0;
+    search->covered = 0;
+    search->complete = FALSE;
+}
+
+size_t SearchGetCount(SearchState* search, BOOL* complete) {
+    EnterCriticalSection(&search->lock);
+    size_t count = search->count;
+    *complete = search->complete;
+    LeaveCriticalSection(&search->lock);
+    return count;
+}
+
+BOOL SearchFindNext(SearchState* search, size_t offset, BOOL forward, size_t* match) {
+    EnterCriticalSection(&search->lock);
+    size_t low = 0;
+    size_t high = search->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (search->matches[middle] < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    BOOL found = forward ? low < search->count : low > 0;
+    if (found) {
+        *match = search->matches[forward ? low : low - 1];
+    }
+    LeaveCriticalSection(&search->lock);
+    return found;
+}
+
+size_t SearchRange(const Document* doc, const WCHAR* query, int length, size_t start, size_t end,
+    size_t* matches, size_t maxMatches) {
+    size_t docLength = DocLength(doc);
+    if (length <= 0 || length > SEARCH_MAX_QUERY || maxMatches == 0) {
+        return 0;
+    }
+    if (end > docLength) {
+        end = docLength;
+    }
+    if (start >= end) {
+        return 0;
+    }
+
+    WCHAR folded[SEARCH_MAX_QUERY];
+    SearchFoldQuery(query, length, folded);
+
+    size_t textEnd = docLength - end > (size_t)length - 1 ? end + length - 1 : docLength;
+    WCHAR* text = (WCHAR*)MemAlloc(MEM_SCRATCH, (textEnd - start) * sizeof(WCHAR));
+    if (text == NULL) {
+        return 0;
+    }
+    DocGetText(doc, start, textEnd, text);
+
+    size_t next;
+    size_t found = SearchScanText(text, textEnd - start, 0, end - start, folded, length, matches, maxMatches, &next);
+    for (size_t i = 0; i < found; i++) {
+        matches[i] += start;
+    }
+    MemFree(text);
+    return found;
+}
@@ -0,0 +1,63 @@
+// CyCharm : Incremental search with refinement and a background scan
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_SEARCH_H
+#define CYCHARM_SEARCH_H
+
+#include <windows.h>
+#include "document.h"
+
+// Longest query in UTF-16 units
+#define SEARCH_MAX_QUERY 256
+
+// Text the background scan reads at a time, in UTF-16 units; it checks for cancellation between windows
+#define SEARCH_WINDOW 1048576
+
+// Matches checked or found by the background scan between publishing its progress
+#define SEARCH_BATCH 4096
+
+// Matches of one query in a snapshot of a document. Queries ignore ASCII case and every occurrence
+// counts, overlapping ones included, so the matches of a longer query are always a subset of the
+// matches of a query it extends.
+typedef struct SearchState {
+    Document snapshot;             // Text being searched, sharing its chunks with the live document
+    WCHAR query[SEARCH_MAX_QUERY]; // Folded to lower case
+    int queryLength;
+    size_t* matches;               // Start offsets, ascending
+    size_t count;
+    size_t capacity;
+    size_t covered;                // Every match starting before this offset is in matches
+    BOOL complete;                 // The whole snapshot has been covered
+    size_t refineCount;            // Matches of the previous query the worker narrows down first
+    size_t scanFrom;               // Where the worker goes on to scan the text itself
+    CRITICAL_SECTION lock;         // Guards matches, count, covered and complete against the worker
+    HANDLE worker;
+    volatile LONG cancel;
+    HWND notifyWindow;             // Posted notifyMessage as the worker makes progress
+    UINT notifyMessage;
+} SearchState;
+
+void SearchInit(SearchState* search);
+void SearchFree(SearchState* search);
+
+// Start finding a query in a document on a background thread, cancelling any search in progress
+// If the document is unchanged and the query extends the previous one, the previous matches are
+// narrowed down instead of scanning the text again
+BOOL SearchStart(SearchState* search, const Document* doc, const WCHAR* query, int length,
+    HWND notifyWindow, UINT notifyMessage);
+void SearchCancel(SearchState* search);
+
+// Cancel the search and forget its matches
+void SearchClear(SearchState* search);
+
+// Matches found so far; complete is set once the whole document has been searched
+size_t SearchGetCount(SearchState* search, BOOL* complete);
+
+// Find the first known match starting at or after offset, or the last one starting before it
+BOOL SearchFindNext(SearchState* search, size_t offset, BOOL forward, size_t* match);
+
+// Find the matches starting in [start, end) of a document on the calling thread, for the viewport
+size_t SearchRange(const Document* doc, const WCHAR* query, int length, size_t start, size_t end,
+    size_t* matches, size_t maxMatches);
+
+#endif
@@ -0,0 +1,130 @@
+// CyCharm : Published document versions for background readers, reclaimed by epoch
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include "snapshot.h"
+#include "memory.h"
+
+// Function to read a 64-bit value in one piece, even on 32-bit builds
+static LONG64 SnapshotRead64(volatile LONG64* value) {
+    return InterlockedCompareExchange64(value, 0, 0);
+}
+
+// Function to push a retired version; writers may push at the same time
+static void SnapshotPushRetired(SnapshotChannel* channel, SnapshotVersion* version) {
+    SnapshotVersion* head;
+    do {
+        head = (SnapshotVersion*)InterlockedCompareExchangePointer((PVOID volatile*)&channel->retired, NULL, NULL);
+        version->next = head;
+    } while (InterlockedCompareExchangePointer((PVOID volatile*)&channel->retired, version, head) != head);
+}
+
+static void SnapshotFreeVersion(SnapshotVersion* version) {
+    DocFree(&version->doc);
+    MemFree(version);
+}
+
+BOOL SnapshotInit(SnapshotChannel* channel) {
+    ZeroMemory(channel, sizeof(SnapshotChannel));
+    channel->epoch = 1; // Slots announce 0 while idle, so epochs start after it
+
+    SnapshotVersion* version = (SnapshotVersion*)MemAlloc(MEM_DOCUMENT, sizeof(SnapshotVersion));
+    if (version == NULL) {
+        return FALSE;
+    }
+    ZeroMemory(version, sizeof(SnapshotVersion));
+    DocInit(&version->doc);
+    version->generation = 1;
+    channel->current = version;
+    return TRUE;
+}
+
+void SnapshotFree(SnapshotChannel* channel) {
+    SnapshotVersion* version = channel->retired;
+    while (version != NULL) {
+        SnapshotVersion* next = version->next;
+        SnapshotFreeVersion(version);
+        version = next;
+    }
+    if (channel->current != NULL) {
+        SnapshotFreeVersion(channel->current);
+    }
+    channel->current = NULL;
+    channel->retired = NULL;
+}
+
+BOOL SnapshotPublish(SnapshotChannel* channel, const Document* doc) {
+    SnapshotVersion* version = (SnapshotVersion*)MemAlloc(MEM_DOCUMENT, sizeof(SnapshotVersion));
+    if (version == NULL) {
+        return FALSE;
+    }
+    ZeroMemory(version, sizeof(SnapshotVersion));
+    DocCopy(&version->doc, doc);
+    version->generation = SnapshotRead64(&channel->epoch) + 1;
+
+    // A reader that announces the new epoch loaded the pointer after it moved on, so it cannot
+    // have pinned the old version
+    SnapshotVersion* old = (SnapshotVersion*)InterlockedExchangePointer((PVOID volatile*)&channel->current, version);
+    LONG64 retiredAt = InterlockedIncrement64(&channel->epoch);
+    if (old == NULL) {
+        return TRUE; // SnapshotInit ran out of memory; nothing was published before
+    }
+    old->retiredAt = retiredAt;
+    SnapshotPushRetired(channel, old);
+    SnapshotReclaim(channel);
+    return TRUE;
+}
+
+int SnapshotRegister(SnapshotChannel* channel) {
+    for (int i = 0; i < SNAPSHOT_MAX_READERS; i++) {
+        if (InterlockedCompareExchange(&channel->slots[i].owned, 1, 0) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void SnapshotUnregister(SnapshotChannel* channel, int slot) {
+    SnapshotUnpin(channel, slot);
+    InterlockedExchange(&channel->slots[slot].owned, 0);
+}
+
+const SnapshotVersion* SnapshotPin(SnapshotChannel* channel, int slot) {
+    // The announcement is a full barrier, so the pointer is read after every writer can see it;
+    // an epoch that is out of date by then only holds back more than it needs to
+    InterlockedExchange64(&channel->slots[slot].epoch, SnapshotRead64(&channel->epoch));
+    return (const SnapshotVersion*)InterlockedCompareExchangePointer((PVOID volatile*)&channel->current, NULL, NULL);
+}
+
+void SnapshotUnpin(SnapshotChannel* channel, int slot) {
+    InterlockedExchange64(&channel->slots[slot].epoch, 0);
+}
+
+void SnapshotReclaim(SnapshotChannel* channel) {
+    // One writer frees at a time; the others leave their retired versions for it or the next publish
+    if (InterlockedCompareExchange(&channel->reclaiming, 1, 0) != 0) {
+        return;
+    }
+
+    SnapshotVersion* list = (SnapshotVersion*)InterlockedExchangePointer((PVOID volatile*)&channel->retired, NULL);
+
+    // The oldest epoch any reader is still in; versions retired after it might be pinned
+    LONG64 oldest = SnapshotRead64(&channel->epoch) + 1;
+    for (int i = 0; i < SNAPSHOT_MAX_READERS; i++) {
+        LONG64 epoch = SnapshotRead64(&channel->slots[i].epoch);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    while (list != NULL) {
+        SnapshotVersion* next = list->next;
+        if (list->retiredAt <= oldest) {
+            SnapshotFreeVersion(list);
+        } else {
+            SnapshotPushRetired(channel, list);
+        }
+        list = next;
+    }
+    InterlockedExchange(&channel->reclaiming, 0);
+}
@@ -0,0 +1,65 @@
+// CyCharm : Published document versions for background readers, reclaimed by epoch
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_SNAPSHOT_H
+#define CYCHARM_SNAPSHOT_H
+
+#include <windows.h>
+#include "document.h"
+
+// Threads that can hold a version pinned at the same time
+#define SNAPSHOT_MAX_READERS 64
+
+// One published version of a document. Versions share their chunks with each other and with the
+// live document, so publishing costs one reference, whatever the size of the text.
+typedef struct SnapshotVersion {
+    Document doc;
+    LONG64 generation;             // Epoch the version was published in
+    LONG64 retiredAt;              // Epoch a newer version replaced it in
+    struct SnapshotVersion* next;  // Next retired version
+} SnapshotVersion;
+
+// A reader's announcement: the epoch it pinned a version in, 0 while it has none pinned.
+// Each slot has a cache line of its own, so readers do not slow each other down.
+typedef struct SnapshotSlot {
+    volatile LONG64 epoch;
+    volatile LONG owned;
+    char padding[64 - sizeof(LONG64) - sizeof(LONG)];
+} SnapshotSlot;
+
+// Where writers publish versions of a document and readers pin them, with no locks on either side.
+// A replaced version is freed once every reader that could have pinned it has moved on: readers
+// announce the epoch they pin in, and a version retired in epoch e is only freed when no reader
+// still announces an epoch before e. A reader that keeps a version pinned holds back only the
+// versions retired since, never the writers.
+typedef struct SnapshotChannel {
+    SnapshotVersion* volatile current;
+    volatile LONG64 epoch;
+    SnapshotVersion* volatile retired; // Replaced versions waiting for their readers, newest first
+    volatile LONG reclaiming;          // A writer is freeing retired versions
+    SnapshotSlot slots[SNAPSHOT_MAX_READERS];
+} SnapshotChannel;
+
+// Start with an empty document published
+BOOL SnapshotInit(SnapshotChannel* channel);
+
+// Free every version; no reader may have one pinned
+void SnapshotFree(SnapshotChannel* channel);
+
+// Publish doc as the current version in O(1), then free the retired versions no reader can see.
+// Any thread may publish.
+BOOL SnapshotPublish(SnapshotChannel* channel, const Document* doc);
+
+// Claim a reader slot for the calling thread; -1 if all are taken
+int SnapshotRegister(SnapshotChannel* channel);
+void SnapshotUnregister(SnapshotChannel* channel, int slot);
+
+// Pin the current version; it stays readable, unchanged, until the slot unpins it, however much is
+// published meanwhile. A slot pins one version at a time. NULL if nothing could be published.
+const SnapshotVersion* SnapshotPin(SnapshotChannel* channel, int slot);
+void SnapshotUnpin(SnapshotChannel* channel, int slot);
+
+// Free the retired versions that no pinned reader can still be using
+void SnapshotReclaim(SnapshotChannel* channel);
+
+#endif
@@ -0,0 +1,493 @@
+// CyCharm : Retained source bytes - the open file mapped read-only so its text can be decoded again
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "main.h"
+#include "memory.h"
+#include "source.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOURCE_USE_SSE2
+#endif
+
+void SourceInit(SourceFile* source) {
+    ZeroMemory(source, sizeof(SourceFile));
+}
+
+// Function to tell whether a file's size and write time are still the ones recorded
+static BOOL SourceUnchanged(const SourceFile* source, unsigned long long size, const FILETIME* writeTime) {
+    return size == (unsigned long long)source->size && CompareFileTime(writeTime, &source->writeTime) == 0;
+}
+
+BOOL SourceRemember(SourceFile* source, const char* path) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (strlen(path) >= MAX_PATH || !GetFileAttributesExA(path, GetFileExInfoStandard, &data)) {
+        SourceClose(source);
+        return FALSE;
+    }
+    unsigned long long size = ((unsigned long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    if (size > (unsigned long long)(size_t)-1) {
+        SourceClose(source);
+        return FALSE;
+    }
+
+    SourceClose(source);
+    source->open = TRUE;
+    strcpy(source->path, path);
+    source->writeTime = data.ftLastWriteTime;
+    source->size = (size_t)size;
+    return TRUE;
+}
+
+BOOL SourceMap(SourceFile* source) {
+    if (source->mapped) {
+        return TRUE;
+    }
+    if (!source->open) {
+        return FALSE;
+    }
+
+    HANDLE file = CreateFile(source->path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    // Seek points and the text in the control came from the file as it was; another version is not it
+    LARGE_INTEGER fileSize;
+    FILETIME writeTime;
+    if (!GetFileSizeEx(file, &fileSize) || !GetFileTime(file, NULL, NULL, &writeTime) ||
+        !SourceUnchanged(source, (unsigned long long)fileSize.QuadPart, &writeTime)) {
+        CloseHandle(file);
+        return FALSE;
+    }
+
+    // A mapping cannot be made of an empty file, and there is nothing to map anyway
+    HANDLE mapping = NULL;
+    const unsigned char* bytes = NULL;
+    if (source->size > 0) {
+        mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        bytes = mapping != NULL ? (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (bytes == NULL) {
+            if (mapping != NULL) {
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            return FALSE;
+        }
+    }
+
+    source->mapped = TRUE;
+    source->file = file;
+    source->mapping = mapping;
+    source->bytes = bytes;
+    source->container = SourceDetectContainer(bytes, source->size);
+    return TRUE;
+}
+
+BOOL SourceOpen(SourceFile* source, const char* path) {
+    SourceFile opened;
+    SourceInit(&opened);
+    if (!SourceRemember(&opened, path) || !SourceMap(&opened)) {
+        return FALSE;
+    }
+    SourceClose(source);
+    *source = opened;
+    return TRUE;
+}
+
+void SourceRelease(SourceFile* source) {
+    if (!source->mapped) {
+        return;
+    }
+    if (source->bytes != NULL) {
+        UnmapViewOfFile(source->bytes);
+    }
+    if (source->mapping != NULL) {
+        CloseHandle(source->mapping);
+    }
+    CloseHandle(source->file);
+    source->mapped = FALSE;
+    source->file = NULL;
+    source->mapping = NULL;
+    source->bytes = NULL;
+}
+
+void SourceClose(SourceFile* source) {
+    SourceRelease(source);
+    for (size_t i = 0; i < source->pointCount; i++) {
+        InflateFreePoint(&source->points[i].inflate);
+    }
+    MemFree(source->points);
+    SourceInit(source);
+}
+
+int SourceDetectContainer(const unsigned char* bytes, size_t size) {
+    if (GzipIsCompressed(bytes, size)) {
+        return SOURCE_GZIP;
+    }
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 && bytes[2] == 0x2F && bytes[3] == 0xFD) {
+        return SOURCE_ZSTD;
+    }
+    return SOURCE_PLAIN;
+}
+
+// Function to count the line breaks in freshly decompressed bytes, so seek points know their line
+static void SourceCountLines(SourceReader* reader, const unsigned char* bytes, size_t size) {
+    size_t lines = reader->lines;
+    BOOL lastCr = reader->lastCr;
+    size_t i = 0;
+#ifdef SOURCE_USE_SSE2
+    __m128i cr = _mm_set1_epi8('\r');
+    __m128i lf = _mm_set1_epi8('\n');
+#endif
+    while (i < size) {
+#ifdef SOURCE_USE_SSE2
+        if (i + 16 <= size) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(bytes + i));
+            if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, lf))) == 0) {
+                i += 16;
+                lastCr = FALSE;
+                continue;
+            }
+        }
+#endif
+        unsigned char c = bytes[i++];
+        if (c == '\r' || (c == '\n' && !lastCr)) {
+            lines++;
+        }
+        lastCr = c == '\r';
+    }
+    reader->lines = lines;
+    reader->lastCr = lastCr;
+}
+
+// Function to record a seek point where the inflater stopped, unless the index already reaches past it
+static void SourceAddPoint(SourceReader* reader) {
+    SourceFile* source = reader->source;
+    Inflater* inflater = reader->inflater;
+    unsigned long long last = source->pointCount > 0 ? source->points[source->pointCount - 1].inflate.out : 0;
+    if (inflater->totalOut > last) {
+        if (source->pointCount == source->pointCapacity) {
+            size_t capacity = source->pointCapacity > 0 ? source->pointCapacity * 2 : 64;
+            SourcePoint* points = (SourcePoint*)MemRealloc(MEM_INDEX, source->points, capacity * sizeof(SourcePoint));
+            if (points == NULL) {
+                inflater->pointAt = ~0ULL; // No more points; everything still reads, just from further back
+                return;
+            }
+            source->points = points;
+            source->pointCapacity = capacity;
+        }
+        SourcePoint* point = &source->points[source->pointCount];
+        if (!InflateSavePoint(inflater, &point->inflate)) {
+            inflater->pointAt = ~0ULL;
+            return;
+        }
+        point->lines = reader->lines;
+        point->afterCr = reader->lastCr;
+        source->pointCount++;
+        last = inflater->totalOut;
+    }
+    inflater->pointAt = last + SOURCE_POINT_SPAN;
+}
+
+BOOL SourceReaderOpen(SourceReader* reader, SourceFile* source) {
+    ZeroMemory(reader, sizeof(SourceReader));
+    reader->source = source;
+    if (source->container != SOURCE_GZIP) {
+        return TRUE;
+    }
+
+    // Twice the window, so a window is always there to hand after what was left of the last one
+    reader->inflater = (Inflater*)MemAlloc(MEM_SCRATCH, sizeof(Inflater));
+    reader->buffer = (unsigned char*)MemAlloc(MEM_SCRATCH, SOURCE_READ_SIZE * 2);
+    if (reader->inflater == NULL || reader->buffer == NULL) {
+        SourceReaderClose(reader);
+        return FALSE;
+    }
+    InflateInit(reader->inflater, source->bytes, source->size);
+    reader->inflater->pointAt = (source->pointCount > 0 ? source->points[source->pointCount - 1].inflate.out : 0) +
+        SOURCE_POINT_SPAN;
+    return TRUE;
+}
+
+void SourceReaderClose(SourceReader* reader) {
+    MemFree(reader->inflater);
+    MemFree(reader->buffer);
+    ZeroMemory(reader, sizeof(SourceReader));
+}
+
+BOOL SourceReaderPeek(SourceReader* reader, const unsigned char** bytes, size_t* size, BOOL* final) {
+    SourceFile* source = reader->source;
+    if (reader->inflater == NULL) {
+        *bytes = source->bytes + reader->position;
+        *size = source->size - (size_t)reader->position;
+        *final = TRUE;
+        return TRUE;
+    }
+
+    Inflater* inflater = reader->inflater;
+    if (reader->end - reader->start < SOURCE_READ_SIZE && !InflateFinished(inflater) && !reader->damaged) {
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+        while (reader->end < SOURCE_READ_SIZE && !InflateFinished(inflater)) {
+            size_t count = InflateRead(inflater, reader->buffer + reader->end, SOURCE_READ_SIZE * 2 - reader->end);
+            SourceCountLines(reader, reader->buffer + reader->end, count);
+            reader->end += count;
+            if (inflater->failed) {
+                reader->damaged = TRUE;
+                break;
+            }
+            if (inflater->atPoint) {
+                SourceAddPoint(reader);
+            }
+        }
+    }
+
+    *bytes = reader->buffer + reader->start;
+    *size = reader->end - reader->start;
+    *final = InflateFinished(inflater);
+    return !reader->damaged;
+}
+
+void SourceReaderSkip(SourceReader* reader, size_t count) {
+    if (reader->inflater != NULL) {
+        reader->start += count;
+    }
+    reader->position += count;
+}
+
+BOOL SourceReaderAtEnd(const SourceReader* reader) {
+    if (reader->inflater == NULL) {
+        return reader->position >= reader->source->size;
+    }
+    return reader->start == reader->end && InflateFinished(reader->inflater);
+}
+
+int SourceReaderProgress(const SourceReader* reader) {
+    size_t size = reader->source->size;
+    size_t done = reader->inflater != NULL ? InflateInputPosition(reader->inflater) : (size_t)reader->position;
+    return size > 0 ? (int)((unsigned long long)done * 100 / size) : 100;
+}
+
+BOOL SourceReaderSeekLine(SourceReader* reader, int encoding, size_t line) {
+    SourceFile* source = reader->source;
+    const unsigned char* bytes;
+    size_t size;
+    BOOL final;
+    size_t lines = line;
+
+    // Seek points count lines as 8-bit text has them, so they are no use for UTF-16
+    const SourcePoint* point = NULL;
+    if (reader->inflater != NULL && encoding != ENCODING_UTF16LE && encoding != ENCODING_UTF16BE) {
+        size_t low = 0;
+        size_t high = source->pointCount;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (source->points[middle].lines <= line) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        point = low > 0 ? &source->points[low - 1] : NULL;
+    }
+
+    if (point != NULL) {
+        unsigned long long pointAt = reader->inflater->pointAt;
+        if (!InflateSeek(reader->inflater, &point->inflate)) {
+            return FALSE;
+        }
+        reader->inflater->pointAt = pointAt;
+        reader->start = 0;
+        reader->end = 0;
+        reader->position = point->inflate.out;
+        reader->lines = point->lines;
+        reader->lastCr = point->afterCr;
+        lines -= point->lines;
+        if (point->afterCr) {
+            if (!SourceReaderPeek(reader, &bytes, &size, &final)) {
+                return FALSE;
+            }
+            if (size > 0 && bytes[0] == '\n') {
+                SourceReaderSkip(reader, 1);
+            }
+        }
+    } else {
+        if (!SourceReaderPeek(reader, &bytes, &size, &final)) {
+            return FALSE;
+        }
+        SourceReaderSkip(reader, SourceBomSize(bytes, size, encoding));
+    }
+
+    while (lines > 0) {
+        if (!SourceReaderPeek(reader, &bytes, &size, &final)) {
+            return FALSE;
+        }
+        if (size == 0) {
+            break;
+        }
+        // A window that ends in the middle of a character or a "\r\n" is only read up to it
+        size_t usable = SourceCharBoundary(bytes, size, encoding, final);
+        size_t offset = SourceSkipLines(bytes, usable, encoding, 0, &lines);
+        SourceReaderSkip(reader, offset);
+        if (final && lines > 0) {
+            break;
+        }
+    }
+    return TRUE;
+}
+
+size_t SourceBomSize(const unsigned char* bytes, size_t size, int encoding) {
+    if (encoding == ENCODING_UTF16LE || encoding == ENCODING_UTF16BE) {
+        if (size >= 2 && ((bytes[0] == 0xFF && bytes[1] == 0xFE) || (bytes[0] == 0xFE && bytes[1] == 0xFF))) {
+            return 2;
+        }
+    } else if (encoding == ENCODING_UTF8) {
+        if (size >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF) {
+            return 3;
+        }
+    }
+    return 0;
+}
+
+// Function to read the UTF-16 unit at an even offset
+static WCHAR SourceUnitAt(const unsigned char* bytes, size_t offset, int encoding) {
+    if (encoding == ENCODING_UTF16LE) {
+        return (WCHAR)(bytes[offset] | (bytes[offset + 1] << 8));
+    }
+    return (WCHAR)((bytes[offset] << 8) | bytes[offset + 1]);
+}
+
+size_t SourceSkipLines(const unsigned char* bytes, size_t size, int encoding, size_t offset, size_t* lines) {
+    size_t i = offset;
+    size_t left = *lines;
+    if (encoding == ENCODING_UTF16LE || encoding == ENCODING_UTF16BE) {
+#ifdef SOURCE_USE_SSE2
+        // Units are compared as loaded, so for big-endian text the bytes of '\r' and '\n' are swapped
+        BOOL little = encoding == ENCODING_UTF16LE;
+        __m128i cr = _mm_set1_epi16((short)(little ? 0x000D : 0x0D00));
+        __m128i lf = _mm_set1_epi16((short)(little ? 0x000A : 0x0A00));
+#endif
+        while (left > 0 && i + 2 <= size) {
+#ifdef SOURCE_USE_SSE2
+            if (i + 16 <= size) {
+                __m128i units = _mm_loadu_si128((const __m128i*)(bytes + i));
+                if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(units, cr), _mm_cmpeq_epi16(units, lf))) == 0) {
+                    i += 16;
+                    continue;
+                }
+            }
+#endif
+            WCHAR unit = SourceUnitAt(bytes, i, encoding);
+            i += 2;
+            if (unit == L'\r') {
+                if (i + 2 <= size && SourceUnitAt(bytes, i, encoding) == L'\n') {
+                    i += 2;
+                }
+                left--;
+            } else if (unit == L'\n') {
+                left--;
+            }
+        }
+        *lines = left;
+        return left > 0 ? size : i;
+    }
+
+#ifdef SOURCE_USE_SSE2
+    __m128i cr = _mm_set1_epi8('\r');
+    __m128i lf = _mm_set1_epi8('\n');
+#endif
+    while (left > 0 && i < size) {
+#ifdef SOURCE_USE_SSE2
+        if (i + 16 <= size) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(bytes + i));
+            if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, lf))) == 0) {
+                i += 16;
+                continue;
+            }
+        }
+#endif
+        unsigned char c = bytes[i++];
+        if (c == '\r') {
+            if (i < size && bytes[i] == '\n') {
+                i++;
+            }
+            left--;
+        } else if (c == '\n') {
+            left--;
+        }
+    }
+    *lines = left;
+    return left > 0 ? size : i;
+}
+
+size_t SourceCharBoundary(const unsigned char* bytes, size_t size, int encoding, BOOL final) {
+    if (final) {
+        return size;
+    }
+
+    size_t boundary = size;
+    switch (encoding) {
+    case ENCODING_UTF16LE:
+    case ENCODING_UTF16BE:
+        boundary = size & ~(size_t)1;
+        if (boundary >= 2) {
+            WCHAR last = SourceUnitAt(bytes, boundary - 2, encoding);
+            // Keep a surrogate pair together, and a '\r' with the '\n' that may follow it
+            if ((last >= 0xD800 && last <= 0xDBFF) || last == L'\r') {
+                boundary -= 2;
+            }
+        }
+        return boundary;
+
+    case ENCODING_UTF8:
+        // Step back over an incomplete sequence at the end
+        for (size_t back = 1; back <= 3 && back <= size; back++) {
+            unsigned char c = bytes[size - back];
+            if (c < 0x80) {
+                break;
+            }
+            if (c >= 0xC0) {
+                size_t needed = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+                if (needed > back) {
+                    boundary = size - back;
+                }
+                break;
+            }
+        }
+        break;
+
+    case ENCODING_SHIFT_JIS:
+    case ENCODING_GB18030: {
+        // Lead bytes can also be trail bytes, so characters are only told apart walking forward
+        size_t i = 0;
+        while (i < size) {
+            unsigned char c = bytes[i];
+            size_t length = 1;
+            if (encoding == ENCODING_SHIFT_JIS) {
+                if ((c >= 0x81 && c <= 0x9F) || (c >= 0xE0 && c <= 0xFC)) {
+                    length = 2;
+                }
+            } else if (c >= 0x81 && c <= 0xFE) {
+                length = (i + 1 < size && bytes[i + 1] >= 0x30 && bytes[i + 1] <= 0x39) ? 4 : 2;
+            }
+            if (i + length > size) {
+                break;
+            }
+            i += length;
+        }
+        boundary = i;
+        break;
+    }
+    }
+
+    // '\r' and '\n' are never part of a multibyte character in these encodings
+    if (boundary > 0 && bytes[boundary - 1] == '\r') {
+        boundary--;
+    }
+    return boundary;
+}
@@ -0,0 +1,113 @@
+// CyCharm : Source bytes - the open file mapped read-only when its text is decoded, again if need be
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_SOURCE_H
+#define CYCHARM_SOURCE_H
+
+#include <windows.h>
+#include "gzip.h"
+
+// Containers a file's text can be in
+#define SOURCE_PLAIN 0
+#define SOURCE_GZIP 1
+#define SOURCE_ZSTD 2
+
+// Decompressed text is read in windows of at least this many bytes
+#define SOURCE_READ_SIZE 4194304
+
+// A seek point is recorded about every this many bytes of decompressed text
+#define SOURCE_POINT_SPAN 16777216
+
+// A place in a compressed file that decompression can start from, with the line it is on. Lines are
+// counted as 8-bit encodings have them, which is how every encoding but UTF-16 has them.
+typedef struct SourcePoint {
+    InflatePoint inflate;
+    size_t lines;  // Line breaks before the point
+    BOOL afterCr;  // The byte before the point is '\r', so a '\n' at the point belongs to that break
+} SourcePoint;
+
+// The file a document was opened from. It is only mapped while its text is being decoded, shared
+// for reading and deleting so the bytes cannot change under the mapping; the rest of the time other
+// programs may write it, and its size and write time tell whether it is still what was decoded.
+// An empty file has no mapping. Seek points are added as compressed text is read for the first time.
+typedef struct SourceFile {
+    BOOL open;          // There is a file; its size and write time are known
+    BOOL mapped;        // The file and the bytes below are held
+    char path[MAX_PATH];
+    FILETIME writeTime;
+    HANDLE file;
+    HANDLE mapping;
+    const unsigned char* bytes;
+    size_t size;
+    int container;
+    SourcePoint* points;
+    size_t pointCount;
+    size_t pointCapacity;
+} SourceFile;
+
+// Reads a source's text from the start, decompressing it if need be. Plain files are read straight
+// from the mapping; compressed ones through a buffer holding a window of the text.
+typedef struct SourceReader {
+    SourceFile* source;
+    Inflater* inflater;          // NULL for a plain file
+    unsigned char* buffer;       // Decompressed bytes not yet consumed are [start, end)
+    size_t start;
+    size_t end;
+    unsigned long long position; // Offset in the text of the next byte
+    size_t lines;                // Line breaks in everything decompressed so far
+    BOOL lastCr;                 // The last byte decompressed was '\r'
+    BOOL damaged;                // The compressed data is damaged or cut short
+} SourceReader;
+
+void SourceInit(SourceFile* source);
+
+// Map a file, closing whatever source was open before only once the new one is mapped
+BOOL SourceOpen(SourceFile* source, const char* path);
+
+// Take a file as the source without mapping it, as after it was saved; FALSE if it cannot be found
+BOOL SourceRemember(SourceFile* source, const char* path);
+
+// Map the source again; FALSE if it can no longer be read, or was changed since it became the source
+BOOL SourceMap(SourceFile* source);
+
+// Let go of the file and its mapping, so other programs can write it; the source stays known
+void SourceRelease(SourceFile* source);
+
+void SourceClose(SourceFile* source);
+
+// Tell which container bytes are in from their magic number
+int SourceDetectContainer(const unsigned char* bytes, size_t size);
+
+// Start reading a mapped source from the top
+BOOL SourceReaderOpen(SourceReader* reader, SourceFile* source);
+void SourceReaderClose(SourceReader* reader);
+
+// The bytes from the reader's position on: at least SOURCE_READ_SIZE of them, unless the text ends
+// first, in which case final is set. FALSE if the data is damaged or memory runs out.
+BOOL SourceReaderPeek(SourceReader* reader, const unsigned char** bytes, size_t* size, BOOL* final);
+
+// Move past count of the bytes last peeked at
+void SourceReaderSkip(SourceReader* reader, size_t count);
+BOOL SourceReaderAtEnd(const SourceReader* reader);
+
+// Per cent of the file read so far
+int SourceReaderProgress(const SourceReader* reader);
+
+// Move a reader that has not read anything to the start of a line, past the byte order mark.
+// Compressed text is decompressed from the last seek point before the line rather than from the start.
+BOOL SourceReaderSeekLine(SourceReader* reader, int encoding, size_t line);
+
+// Size of the byte order mark the bytes start with, if it belongs to the encoding
+size_t SourceBomSize(const unsigned char* bytes, size_t size, int encoding);
+
+// Offset just past the given number of line breaks from offset, or size if there are fewer; lines is
+// left with how many were not found. "\r\n" is one break, as in the edit control; line breaks never
+// occur inside a character in any of the supported encodings, so a line start is always a character boundary.
+size_t SourceSkipLines(const unsigned char* bytes, size_t size, int encoding, size_t offset, size_t* lines);
+
+// Length of the longest prefix of bytes[0, size) that ends between two characters, so the bytes
+// can be decoded a piece at a time. Unless final is set, a trailing '\r' is left for the next
+// piece, which might start with its '\n'.
+size_t SourceCharBoundary(const unsigned char* bytes, size_t size, int encoding, BOOL final);
+
+#endif
@@ -0,0 +1,138 @@
+// CyCharm : Bracket and indentation summaries for matching and folding
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include "structure.h"
+
+int StructBracketDirection(WCHAR c) {
+    switch (c) {
+        case L'(':
+        case L'[':
+        case L'{':
+            return 1;
+        case L')':
+        case L']':
+        case L'}':
+            return -1;
+    }
+    return 0;
+}
+
+BOOL StructBracketsPair(WCHAR open, WCHAR close) {
+    return (open == L'(' && close == L')') || (open == L'[' && close == L']') || (open == L'{' && close == L'}');
+}
+
+int StructStep(int column, WCHAR c) {
+    return c == L'\t' ? column + STRUCT_TAB_WIDTH - column % STRUCT_TAB_WIDTH : column + 1;
+}
+
+int StructAdvance(StructWhitespace whitespace, int column) {
+    if (!whitespace.tabbed) {
+        return column + whitespace.spaces;
+    }
+    return StructStep(column + whitespace.spaces, L'\t') + whitespace.rest;
+}
+
+// Function to join whitespace with the whitespace that follows it
+// After the first tab the column is on a tab stop, where anything that follows adds the same as at 0
+static StructWhitespace StructJoin(StructWhitespace first, StructWhitespace second) {
+    if (!first.tabbed) {
+        second.spaces += first.spaces;
+        return second;
+    }
+    first.rest = StructAdvance(second, first.rest);
+    return first;
+}
+
+// Function to add one character of leading whitespace
+static void StructAddWhitespace(StructWhitespace* whitespace, WCHAR c) {
+    if (whitespace->tabbed) {
+        whitespace->rest = StructStep(whitespace->rest, c);
+    } else if (c == L'\t') {
+        whitespace->tabbed = TRUE;
+    } else {
+        whitespace->spaces++;
+    }
+}
+
+void StructScanText(const WCHAR* text, size_t length, StructSummary* summary) {
+    static const StructWhitespace none = { 0, FALSE, 0 };
+    int depth = 0;
+    int lowest = 0;
+    int minIndent = STRUCT_NO_INDENT;
+    int leadEnd = STRUCT_END_NONE;
+    BOOL hasBreak = FALSE;
+    BOOL open = TRUE; // The line so far is whitespace
+    StructWhitespace whitespace = none;
+    StructWhitespace lead = none;
+
+    for (size_t i = 0; i < length; i++) {
+        WCHAR c = text[i];
+        if (c == L'\r') {
+            if (!hasBreak && open) {
+                lead = whitespace;
+                leadEnd = STRUCT_END_BREAK;
+            }
+            hasBreak = TRUE;
+            open = TRUE;
+            whitespace = none;
+        } else if (c == L' ' || c == L'\t') {
+            if (open) {
+                StructAddWhitespace(&whitespace, c);
+            }
+        } else {
+            if (open) {
+                if (!hasBreak) {
+                    lead = whitespace;
+                    leadEnd = STRUCT_END_TEXT;
+                } else if (StructAdvance(whitespace, 0) < minIndent) {
+                    minIndent = StructAdvance(whitespace, 0);
+                }
+                open = FALSE;
+            }
+            if (c <= L'}') {
+                depth += StructBracketDirection(c);
+                if (depth < lowest) {
+                    lowest = depth;
+                }
+            }
+        }
+    }
+
+    summary->bracketDelta = depth;
+    summary->bracketMin = lowest;
+    summary->minIndent = minIndent;
+    summary->lead = leadEnd == STRUCT_END_NONE ? whitespace : lead;
+    summary->leadEnd = leadEnd;
+    summary->hasBreak = hasBreak;
+    summary->tailOpen = hasBreak && open;
+    summary->tail = summary->tailOpen ? whitespace : none;
+}
+
+StructSummary StructCombine(StructSummary left, StructSummary right) {
+    StructSummary summary;
+    summary.bracketDelta = left.bracketDelta + right.bracketDelta;
+    summary.bracketMin = left.bracketDelta + right.bracketMin < left.bracketMin ?
+        left.bracketDelta + right.bracketMin : left.bracketMin;
+
+    // A line left open at the end of the left run gets its indent once the right run's whitespace ends in text
+    summary.minIndent = left.minIndent < right.minIndent ? left.minIndent : right.minIndent;
+    if (left.tailOpen && right.leadEnd == STRUCT_END_TEXT) {
+        int indent = StructAdvance(StructJoin(left.tail, right.lead), 0);
+        if (indent < summary.minIndent) {
+            summary.minIndent = indent;
+        }
+    }
+
+    summary.lead = left.leadEnd == STRUCT_END_NONE ? StructJoin(left.lead, right.lead) : left.lead;
+    summary.leadEnd = left.leadEnd == STRUCT_END_NONE ? right.leadEnd : left.leadEnd;
+    summary.hasBreak = left.hasBreak || right.hasBreak;
+    if (right.hasBreak) {
+        summary.tailOpen = right.tailOpen;
+        summary.tail = right.tail;
+    } else {
+        summary.tailOpen = left.tailOpen && right.leadEnd == STRUCT_END_NONE;
+        summary.tail = summary.tailOpen ? StructJoin(left.tail, right.lead) : right.tail;
+    }
+    return summary;
+}
@@ -0,0 +1,60 @@
+// CyCharm : Bracket and indentation summaries for matching and folding
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_STRUCTURE_H
+#define CYCHARM_STRUCTURE_H
+
+#include <windows.h>
+
+// Columns per tab when comparing indentation; matches the editor's tab stops
+#define STRUCT_TAB_WIDTH 4
+
+// Indent of a blank line, or of a run of text without any line that counts
+#define STRUCT_NO_INDENT 0x7FFFFFFF
+
+// What ends the whitespace a run starts with
+#define STRUCT_END_NONE 0   // Nothing: the run is whitespace throughout
+#define STRUCT_END_TEXT 1   // Other text, so a line starting there is indented by it
+#define STRUCT_END_BREAK 2  // A line break, so a line starting there is blank
+
+// Leading whitespace of a line, or a piece of it. With tabs its width depends on the column it
+// starts at: the spaces before the first tab add to that column, the first tab goes on to the next
+// tab stop, and what follows adds the same from there whatever the start.
+typedef struct StructWhitespace {
+    int spaces; // Columns before the first tab
+    BOOL tabbed;
+    int rest;   // Columns after the first tab's stop
+} StructWhitespace;
+
+// Summary of a run of text. Summaries of adjacent runs combine in O(1), so the document tree
+// keeps one per node and can skip any subtree that cannot hold what a query looks for.
+// All bracket kinds share one depth; () [] {} are told apart only once a match is found.
+// A run can end or start inside a line's leading whitespace, so the whitespace at either end is
+// kept to be joined with the neighbouring run's.
+typedef struct StructSummary {
+    int bracketDelta;      // Openers minus closers
+    int bracketMin;        // Lowest running depth from the start of the run (0 or below)
+    int minIndent;         // Lowest indent of a non-blank line starting after a line break inside the run
+    StructWhitespace lead; // Whitespace the run starts with
+    int leadEnd;           // STRUCT_END_*
+    BOOL hasBreak;
+    BOOL tailOpen;         // Only whitespace follows the last line break, so the line goes on in the next run
+    StructWhitespace tail; // That whitespace
+} StructSummary;
+
+void StructScanText(const WCHAR* text, size_t length, StructSummary* summary);
+StructSummary StructCombine(StructSummary left, StructSummary right);
+
+// +1 for an opening bracket, -1 for a closing one, 0 otherwise
+int StructBracketDirection(WCHAR c);
+
+// TRUE if two brackets form a pair of the same kind
+BOOL StructBracketsPair(WCHAR open, WCHAR close);
+
+// Column reached by whitespace that starts at a column
+int StructAdvance(StructWhitespace whitespace, int column);
+
+// Column reached from a column by one more character of leading whitespace (' ' or '\t')
+int StructStep(int column, WCHAR c);
+
+#endif
@@ -0,0 +1,567 @@
+// CyCharm : Delimited data (CSV/TSV) - structural scanning, a sparse row index and column sorting
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "memory.h"
+#include "lines.h"
+#include "table.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TABLE_USE_SSE2
+#endif
+
+// Lines of the sample TableDetectDelimiter looks at
+#define TABLE_DETECT_LINES 32
+
+// Longest value read while checking whether a sampled field is a number
+#define TABLE_NUMBER_LENGTH 64
+
+size_t TableScan(TableScanner* scanner, const WCHAR* text, size_t length, BOOL breaksOnly, DWORD* out) {
+    size_t found = 0;
+    size_t i = 0;
+    unsigned quoted = scanner->quoted ? 0xFFFF : 0;
+
+#ifdef TABLE_USE_SSE2
+    // 16 units at a time: one bit per unit for quotes and for structural characters
+    __m128i quote = _mm_set1_epi16((short)L'"');
+    __m128i delimiter = _mm_set1_epi16((short)scanner->delimiter);
+    __m128i recordBreak = _mm_set1_epi16((short)L'\r');
+    for (; i + 16 <= length; i += 16) {
+        __m128i low = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i high = _mm_loadu_si128((const __m128i*)(text + i + 8));
+        unsigned quotes = (unsigned)_mm_movemask_epi8(_mm_packs_epi16(
+            _mm_cmpeq_epi16(low, quote), _mm_cmpeq_epi16(high, quote)));
+        __m128i lowHits = _mm_cmpeq_epi16(low, recordBreak);
+        __m128i highHits = _mm_cmpeq_epi16(high, recordBreak);
+        if (!breaksOnly) {
+            lowHits = _mm_or_si128(lowHits, _mm_cmpeq_epi16(low, delimiter));
+            highHits = _mm_or_si128(highHits, _mm_cmpeq_epi16(high, delimiter));
+        }
+        unsigned structural = (unsigned)_mm_movemask_epi8(_mm_packs_epi16(lowHits, highHits));
+
+        // A prefix XOR of the quote bits sets every unit from an opening quote up to its closing one
+        unsigned inside = quotes;
+        inside ^= inside << 1;
+        inside ^= inside << 2;
+        inside ^= inside << 4;
+        inside ^= inside << 8;
+        inside = (inside ^ quoted) & 0xFFFF;
+        quoted = (inside & 0x8000) ? 0xFFFF : 0;
+
+        structural &= ~inside;
+        for (size_t j = i; structural != 0; j++, structural >>= 1) {
+            if (structural & 1) {
+                out[found++] = (DWORD)j;
+            }
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        WCHAR c = text[i];
+        if (c == L'"') {
+            quoted ^= 0xFFFF;
+        } else if (!quoted && (c == L'\r' || (!breaksOnly && c == scanner->delimiter))) {
+            out[found++] = (DWORD)i;
+        }
+    }
+
+    scanner->quoted = quoted != 0;
+    return found;
+}
+
+WCHAR TableDetectDelimiter(const WCHAR* text, size_t length) {
+    static const WCHAR candidates[] = { L'\t', L',', L';', L'|' };
+    WCHAR best = L',';
+    int bestScore = 0;
+
+    for (int c = 0; c < (int)(sizeof(candidates) / sizeof(candidates[0])); c++) {
+        // Score each candidate by the lines that split into as many fields as the first one
+        int firstCount = -1;
+        int count = 0;
+        int lines = 0;
+        int score = 0;
+        BOOL quoted = FALSE;
+        for (size_t i = 0; i <= length && lines < TABLE_DETECT_LINES; i++) {
+            if (i < length && text[i] == L'"') {
+                quoted = !quoted;
+            } else if (i < length && text[i] == candidates[c] && !quoted) {
+                count++;
+            } else if ((i == length || text[i] == L'\r') && !quoted) {
+                if (firstCount < 0) {
+                    firstCount = count;
+                }
+                score += count > 0 && count == firstCount;
+                count = 0;
+                lines++;
+            }
+        }
+        if (score > bestScore) {
+            best = candidates[c];
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+void TableInit(TableIndex* table) {
+    ZeroMemory(table, sizeof(TableIndex));
+    table->sortColumn = -1;
+}
+
+void TableFree(TableIndex* table) {
+    MemFree(table->checkpoints);
+    MemFree(table->order);
+    TableInit(table);
+}
+
+void TableClearSort(TableIndex* table) {
+    MemFree(table->order);
+    table->order = NULL;
+    table->sortColumn = -1;
+    table->sortDescending = FALSE;
+}
+
+size_t TableRowAt(const TableIndex* table, size_t position) {
+    return table->order != NULL ? table->order[position] : position;
+}
+
+typedef struct TableBuildContext {
+    TableIndex* table;
+    TableScanner scanner;
+    size_t scanned;      // End of the text scanned so far
+    BOOL failed;
+    DWORD positions[TABLE_SCAN_BLOCK];
+} TableBuildContext;
+
+static BOOL TableAddCheckpoint(TableIndex* table, size_t offset) {
+    if (table->checkpointCount == table->checkpointCapacity) {
+        size_t capacity = table->checkpointCapacity > 0 ? table->checkpointCapacity * 2 : 256;
+        size_t* checkpoints = (size_t*)MemRealloc(MEM_INDEX, table->checkpoints, capacity * sizeof(size_t));
+        if (checkpoints == NULL) {
+            return FALSE;
+        }
+        table->checkpoints = checkpoints;
+        table->checkpointCapacity = capacity;
+    }
+    table->checkpoints[table->checkpointCount++] = offset;
+    return TRUE;
+}
+
+static BOOL TableBuildChunk(const WCHAR* text, size_t length, size_t offset, void* context) {
+    TableBuildContext* build = (TableBuildContext*)context;
+    TableIndex* table = build->table;
+
+    for (size_t done = 0; done < length; done += TABLE_SCAN_BLOCK) {
+        size_t piece = length - done < TABLE_SCAN_BLOCK ? length - done : TABLE_SCAN_BLOCK;
+        size_t found = TableScan(&build->scanner, text + done, piece, TRUE, build->positions);
+        for (size_t i = 0; i < found; i++) {
+            table->rowCount++;
+            if (table->rowCount % TABLE_CHECKPOINT_INTERVAL == 0 &&
+                !TableAddCheckpoint(table, offset + done + build->positions[i] + 1)) {
+                build->failed = TRUE;
+                return FALSE;
+            }
+        }
+    }
+    build->scanned = offset + length;
+    return TRUE;
+}
+
+// Function to tell whether a value is a decimal number, with optional sign, fraction and exponent;
+// read with the parser a numeric sort uses, so the two agree on what a number is
+static BOOL TableIsNumber(const WCHAR* text, size_t length) {
+    double number;
+    size_t i = LinesParseNumber(text, length, &number);
+    if (i == 0) {
+        return FALSE;
+    }
+    while (i < length && text[i] == L' ') {
+        i++;
+    }
+    return i == length;
+}
+
+// Function to widen the columns to fit a row, and note the columns holding text other than numbers
+static void TableSampleRow(TableIndex* table, const Document* doc, size_t row, BOOL* seen) {
+    TableField fields[TABLE_MAX_COLUMNS];
+    int count = TableReadRow(table, doc, row, fields, TABLE_MAX_COLUMNS);
+    if (count > TABLE_MAX_COLUMNS) {
+        count = TABLE_MAX_COLUMNS;
+    }
+    if (count > table->columnCount) {
+        table->columnCount = count;
+    }
+
+    for (int c = 0; c < count; c++) {
+        int width = fields[c].length < TABLE_MAX_COLUMN_WIDTH ? (int)fields[c].length : TABLE_MAX_COLUMN_WIDTH;
+        if (width > table->widths[c]) {
+            table->widths[c] = width;
+        }
+        if (row == 0 || fields[c].length == 0) {
+            continue;
+        }
+
+        WCHAR value[TABLE_NUMBER_LENGTH];
+        seen[c] = TRUE;
+        if (fields[c].length > TABLE_NUMBER_LENGTH) {
+            table->numeric[c] = FALSE;
+        } else if (table->numeric[c]) {
+            size_t length = DocGetText(doc, fields[c].start, fields[c].start + fields[c].length, value);
+            table->numeric[c] = TableIsNumber(value, length);
+        }
+    }
+}
+
+BOOL TableBuild(TableIndex* table, const Document* doc, WCHAR delimiter) {
+    TableFree(table);
+    table->delimiter = delimiter;
+
+    size_t length = DocLength(doc);
+    if (!TableAddCheckpoint(table, 0)) {
+        return FALSE;
+    }
+
+    // Count the records and keep the start of every TABLE_CHECKPOINT_INTERVAL-th one
+    TableBuildContext* build = (TableBuildContext*)MemAlloc(MEM_SCRATCH, sizeof(TableBuildContext));
+    if (build == NULL) {
+        return FALSE;
+    }
+    ZeroMemory(build, sizeof(TableBuildContext));
+    build->table = table;
+    build->scanner.delimiter = delimiter;
+    DocForEachChunk(doc, 0, length, TableBuildChunk, build);
+    BOOL ok = !build->failed && build->scanned == length;
+    MemFree(build);
+    if (!ok) {
+        TableFree(table);
+        return FALSE;
+    }
+
+    // A last record without a break after it still counts
+    size_t lastStart = table->rowCount / TABLE_CHECKPOINT_INTERVAL < table->checkpointCount ?
+        TableRowStart(table, doc, table->rowCount) : length;
+    if (lastStart < length) {
+        table->rowCount++;
+    }
+
+    // Size the columns from rows at the top and rows spread through the rest, instead of reading it all
+    BOOL seen[TABLE_MAX_COLUMNS];
+    ZeroMemory(seen, sizeof(seen));
+    for (int c = 0; c < TABLE_MAX_COLUMNS; c++) {
+        table->numeric[c] = TRUE;
+    }
+    for (size_t row = 0; row < table->rowCount && row < TABLE_SAMPLE_ROWS; row++) {
+        TableSampleRow(table, doc, row, seen);
+    }
+    if (table->rowCount > TABLE_SAMPLE_ROWS) {
+        for (size_t i = 1; i <= TABLE_SAMPLE_ROWS; i++) {
+            TableSampleRow(table, doc, (size_t)((unsigned long long)(table->rowCount - 1) * i / TABLE_SAMPLE_ROWS), seen);
+        }
+    }
+    for (int c = 0; c < TABLE_MAX_COLUMNS; c++) {
+        table->numeric[c] = table->numeric[c] && seen[c];
+        if (table->widths[c] < TABLE_MIN_COLUMN_WIDTH) {
+            table->widths[c] = TABLE_MIN_COLUMN_WIDTH;
+        }
+    }
+    return TRUE;
+}
+
+typedef struct TableRowContext {
+    TableScanner scanner;
+    size_t skip;            // Record breaks still to pass before the wanted row
+    size_t position;        // Where the scan stopped
+    TableField* fields;     // NULL while only finding the row
+    int maxFields;
+    int count;
+    size_t fieldStart;
+    BOOL done;
+    DWORD positions[TABLE_SCAN_BLOCK];
+} TableRowContext;
+
+static void TableAddField(TableRowContext* row, size_t end) {
+    if (row->count < row->maxFields) {
+        row->fields[row->count].start = row->fieldStart;
+        row->fields[row->count].length = end - row->fieldStart;
+    }
+    row->count++;
+}
+
+static BOOL TableRowChunk(const WCHAR* text, size_t length, size_t offset, void* context) {
+    TableRowContext* row = (TableRowContext*)context;
+
+    for (size_t done = 0; done < length; done += TABLE_SCAN_BLOCK) {
+        size_t piece = length - done < TABLE_SCAN_BLOCK ? length - done : TABLE_SCAN_BLOCK;
+        BOOL breaksOnly = row->fields == NULL || row->skip > 0;
+        size_t found = TableScan(&row->scanner, text + done, piece, breaksOnly, row->positions);
+        for (size_t i = 0; i < found; i++) {
+            size_t position = offset + done + row->positions[i];
+            BOOL recordBreak = text[done + row->positions[i]] == L'\r';
+            if (row->skip > 0) {
+                // The rest of this piece was scanned for breaks only, so scan it again for fields
+                if (--row->skip == 0) {
+                    row->position = position + 1;
+                    row->fieldStart = position + 1;
+                    if (row->fields == NULL) {
+                        row->done = TRUE;
+                        return FALSE;
+                    }
+                    row->scanner.quoted = FALSE;
+                    return TableRowChunk(text + done + row->positions[i] + 1,
+                        length - done - row->positions[i] - 1, position + 1, context);
+                }
+                continue;
+            }
+
+            TableAddField(row, position);
+            row->fieldStart = position + 1;
+            if (recordBreak) {
+                row->done = TRUE;
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+size_t TableRowStart(const TableIndex* table, const Document* doc, size_t row) {
+    size_t checkpoint = row / TABLE_CHECKPOINT_INTERVAL;
+    if (checkpoint >= table->checkpointCount) {
+        return DocLength(doc);
+    }
+
+    size_t start = table->checkpoints[checkpoint];
+    if (row % TABLE_CHECKPOINT_INTERVAL == 0) {
+        return start;
+    }
+
+    TableRowContext* context = (TableRowContext*)MemAlloc(MEM_SCRATCH, sizeof(TableRowContext));
+    if (context == NULL) {
+        return start;
+    }
+    ZeroMemory(context, sizeof(TableRowContext));
+    context->scanner.delimiter = table->delimiter;
+    context->skip = row % TABLE_CHECKPOINT_INTERVAL;
+    DocForEachChunk(doc, start, DocLength(doc), TableRowChunk, context);
+    size_t position = context->done ? context->position : DocLength(doc);
+    MemFree(context);
+    return position;
+}
+
+int TableReadRow(const TableIndex* table, const Document* doc, size_t row, TableField* fields, int maxFields) {
+    size_t checkpoint = row / TABLE_CHECKPOINT_INTERVAL;
+    if (row >= table->rowCount || checkpoint >= table->checkpointCount) {
+        return 0;
+    }
+
+    TableRowContext* context = (TableRowContext*)MemAlloc(MEM_SCRATCH, sizeof(TableRowContext));
+    if (context == NULL) {
+        return 0;
+    }
+    ZeroMemory(context, sizeof(TableRowContext));
+    context->scanner.delimiter = table->delimiter;
+    context->skip = row % TABLE_CHECKPOINT_INTERVAL;
+    context->fields = fields;
+    context->maxFields = maxFields;
+    context->fieldStart = table->checkpoints[checkpoint];
+
+    size_t length = DocLength(doc);
+    DocForEachChunk(doc, context->fieldStart, length, TableRowChunk, context);
+    if (!context->done) {
+        TableAddField(context, length); // The last record has no break after it
+    }
+    int count = context->count;
+    MemFree(context);
+
+    // Show quoted fields without their quotes
+    for (int i = 0; i < count && i < maxFields; i++) {
+        if (fields[i].length >= 2 && DocCharAt(doc, fields[i].start) == L'"' &&
+            DocCharAt(doc, fields[i].start + fields[i].length - 1) == L'"') {
+            fields[i].start++;
+            fields[i].length -= 2;
+        }
+    }
+    return count;
+}
+
+typedef struct TableSortContext {
+    const TableIndex* table;
+    TableScanner scanner;
+    int column;
+    int field;              // Field of the current row
+    size_t row;             // Current row; keys are stored for rows 1 onwards
+    LineRef* keys;          // Key of each row as a range of text
+    WCHAR* text;            // The keys' text, each followed by a '\0' and the number of its row
+    size_t length;
+    size_t capacity;
+    BOOL failed;
+    DWORD positions[TABLE_SCAN_BLOCK];
+} TableSortContext;
+
+static BOOL TableAppendKey(TableSortContext* sort, const WCHAR* text, size_t length) {
+    if (length == 0) {
+        return TRUE;
+    }
+    if (sort->length + length > sort->capacity) {
+        size_t capacity = sort->capacity > 0 ? sort->capacity * 2 : 65536;
+        while (capacity < sort->length + length) {
+            capacity *= 2;
+        }
+        WCHAR* grown = (WCHAR*)MemRealloc(MEM_SCRATCH, sort->text, capacity * sizeof(WCHAR));
+        if (grown == NULL) {
+            sort->failed = TRUE;
+            return FALSE;
+        }
+        sort->text = grown;
+        sort->capacity = capacity;
+    }
+    memcpy(sort->text + sort->length, text, length * sizeof(WCHAR));
+    sort->length += length;
+    return TRUE;
+}
+
+static void TableBeginKey(TableSortContext* sort) {
+    sort->keys[sort->row - 1].start = sort->length;
+}
+
+static BOOL TableEndKey(TableSortContext* sort) {
+    LineRef* key = &sort->keys[sort->row - 1];
+    key->length = sort->length - key->start;
+    if (key->length >= 2 && sort->text[key->start] == L'"' && sort->text[sort->length - 1] == L'"') {
+        key->start++;
+        key->length -= 2;
+    }
+
+    WCHAR trailer[1 + sizeof(size_t) / sizeof(WCHAR)];
+    trailer[0] = L'\0';
+    memcpy(trailer + 1, &sort->row, sizeof(size_t));
+    return TableAppendKey(sort, trailer, sizeof(trailer) / sizeof(WCHAR));
+}
+
+// Function to find the row of a sorted key from the trailer after it; a key that lost its closing
+// quote still has the quote before the '\0'
+static size_t TableKeyRow(const WCHAR* text, const LineRef* key) {
+    const WCHAR* end = text + key->start + key->length;
+    size_t row;
+    memcpy(&row, end + (*end == L'"' ? 2 : 1), sizeof(size_t));
+    return row;
+}
+
+// Function to finish a row at its break, giving rows without the column an empty key
+static BOOL TableEndSortRow(TableSortContext* sort) {
+    if (sort->field < sort->column) {
+        TableBeginKey(sort);
+    }
+    if (sort->field <= sort->column && !TableEndKey(sort)) {
+        return FALSE;
+    }
+    sort->row++;
+    sort->field = 0;
+    if (sort->row < sort->table->rowCount && sort->column == 0) {
+        TableBeginKey(sort);
+    }
+    return sort->row < sort->table->rowCount;
+}
+
+static BOOL TableSortChunk(const WCHAR* text, size_t length, size_t offset, void* context) {
+    TableSortContext* sort = (TableSortContext*)context;
+
+    for (size_t done = 0; done < length; done += TABLE_SCAN_BLOCK) {
+        size_t piece = length - done < TABLE_SCAN_BLOCK ? length - done : TABLE_SCAN_BLOCK;
+        size_t found = TableScan(&sort->scanner, text + done, piece, FALSE, sort->positions);
+        size_t segment = done;
+        for (size_t i = 0; i < found; i++) {
+            size_t position = done + sort->positions[i];
+            if (sort->field == sort->column && !TableAppendKey(sort, text + segment, position - segment)) {
+                return FALSE;
+            }
+            segment = position + 1;
+
+            if (text[position] == L'\r') {
+                if (!TableEndSortRow(sort)) {
+                    return FALSE;
+                }
+            } else {
+                if (sort->field == sort->column && !TableEndKey(sort)) {
+                    return FALSE;
+                }
+                sort->field++;
+                if (sort->field == sort->column) {
+                    TableBeginKey(sort);
+                }
+            }
+        }
+        if (sort->field == sort->column && !TableAppendKey(sort, text + segment, done + piece - segment)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+BOOL TableSort(TableIndex* table, const Document* doc, int column, BOOL descending) {
+    if (table->rowCount < 2 || column < 0 || column >= table->columnCount) {
+        return TRUE;
+    }
+
+    // Copy the column's value in every row below the header into one buffer of keys
+    size_t count = table->rowCount - 1;
+    TableSortContext* sort = (TableSortContext*)MemAlloc(MEM_SCRATCH, sizeof(TableSortContext));
+    LineRef* keys = (LineRef*)MemAlloc(MEM_SCRATCH, count * sizeof(LineRef));
+    size_t* order = (size_t*)MemAlloc(MEM_INDEX, table->rowCount * sizeof(size_t));
+    BOOL ok = sort != NULL && keys != NULL && order != NULL;
+    if (ok) {
+        ZeroMemory(sort, sizeof(TableSortContext));
+        sort->table = table;
+        sort->scanner.delimiter = table->delimiter;
+        sort->column = column;
+        sort->row = 1;
+        sort->keys = keys;
+        if (column == 0) {
+            TableBeginKey(sort);
+        }
+
+        size_t length = DocLength(doc);
+        DocForEachChunk(doc, TableRowStart(table, doc, 1), length, TableSortChunk, sort);
+        if (!sort->failed && sort->row < table->rowCount) {
+            TableEndSortRow(sort); // The last record has no break after it
+        }
+        ok = !sort->failed && sort->row == table->rowCount;
+    }
+
+    if (ok) {
+        // Reversing before and after a stable sort keeps equal rows in document order when descending
+        LineSet set = { sort->text, sort->length, keys, count };
+        if (descending) {
+            LineSetReverse(&set);
+        }
+        ok = LineSetSort(&set, table->numeric[column] ? LINES_SORT_NUMERIC : LINES_SORT_CASELESS);
+        keys = set.lines;
+        if (ok && descending) {
+            LineSetReverse(&set);
+        }
+    }
+
+    if (ok) {
+        order[0] = 0;
+        for (size_t i = 0; i < count; i++) {
+            order[i + 1] = TableKeyRow(sort->text, &keys[i]);
+        }
+
+        MemFree(table->order);
+        table->order = order;
+        table->sortColumn = column;
+        table->sortDescending = descending;
+        order = NULL;
+    }
+
+    if (sort != NULL) {
+        MemFree(sort->text);
+    }
+    MemFree(sort);
+    MemFree(keys);
+    MemFree(order);
+    return ok;
+}
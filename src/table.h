@@ -0,0 +1,86 @@
+// CyCharm : Delimited data (CSV/TSV) - structural scanning, a sparse row index and column sorting
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_TABLE_H
+#define CYCHARM_TABLE_H
+
+#include <windows.h>
+#include "document.h"
+
+// The start of every this many rows is kept, so finding a row scans at most this many
+#define TABLE_CHECKPOINT_INTERVAL 64
+
+// Fields past this many in a row are not shown or sorted
+#define TABLE_MAX_COLUMNS 256
+
+// Rows read from the top of the data, and again spread evenly through it, to size the columns
+#define TABLE_SAMPLE_ROWS 256
+
+// Column width bounds in characters
+#define TABLE_MIN_COLUMN_WIDTH 3
+#define TABLE_MAX_COLUMN_WIDTH 40
+
+// Units of text scanned per call, so structural positions fit in 32 bits
+#define TABLE_SCAN_BLOCK 4096
+
+// Scans text for delimiters and record breaks ('\r') outside double-quoted fields. A quote toggles
+// the quoted state, so an escaped quote ("") toggles it twice and leaves it unchanged; the state
+// carries over from one call to the next.
+typedef struct TableScanner {
+    WCHAR delimiter;
+    BOOL quoted;     // The text scanned so far ends inside a quoted field
+} TableScanner;
+
+// A field of a row, as a range of the document without its enclosing quotes
+typedef struct TableField {
+    size_t start;
+    size_t length;
+} TableField;
+
+// Index of delimited data in a document. Rows are records, so a quoted field can span lines.
+// The first row is the header; sorting reorders the rows after it.
+typedef struct TableIndex {
+    WCHAR delimiter;
+    size_t rowCount;
+    size_t* checkpoints;                 // Start of row i * TABLE_CHECKPOINT_INTERVAL
+    size_t checkpointCount;
+    size_t checkpointCapacity;
+    int columnCount;                     // Most fields in a sampled row
+    int widths[TABLE_MAX_COLUMNS];       // Sampled width of each column in characters
+    BOOL numeric[TABLE_MAX_COLUMNS];     // Every sampled value of the column below the header is a number
+    size_t* order;                       // Row shown at each position while sorted, or NULL
+    int sortColumn;                      // Column the order is sorted by, or -1
+    BOOL sortDescending;
+} TableIndex;
+
+// Scan text[0, length) with length at most TABLE_SCAN_BLOCK, storing the positions of structural
+// characters in out; with breaksOnly set only record breaks are stored. Returns the number stored.
+size_t TableScan(TableScanner* scanner, const WCHAR* text, size_t length, BOOL breaksOnly, DWORD* out);
+
+// Guess the delimiter of a sample of text: the one of tab, comma, semicolon and bar that splits
+// its first lines into the same number of fields most consistently
+WCHAR TableDetectDelimiter(const WCHAR* text, size_t length);
+
+void TableInit(TableIndex* table);
+void TableFree(TableIndex* table);
+
+// Index the rows of a document and sample the column widths, dropping any sort order
+BOOL TableBuild(TableIndex* table, const Document* doc, WCHAR delimiter);
+
+// Row shown at a position, following the sort order if there is one
+size_t TableRowAt(const TableIndex* table, size_t position);
+
+// Where a row starts in the document
+size_t TableRowStart(const TableIndex* table, const Document* doc, size_t row);
+
+// Read the fields of a row; returns how many there are, storing at most maxFields of them
+int TableReadRow(const TableIndex* table, const Document* doc, size_t row, TableField* fields, int maxFields);
+
+// Sort the rows below the header by one column, as numbers if the column is numeric and otherwise
+// ignoring case; the document itself is not changed
+BOOL TableSort(TableIndex* table, const Document* doc, int column, BOOL descending);
+
+// Go back to the rows' order in the document
+void TableClearSort(TableIndex* table);
+
+#endif
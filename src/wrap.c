@@ -0,0 +1,314 @@
+// CyCharm : Word-wrap layout engine with a per-line break cache
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <string.h>
+#include "column.h"
+#include "main.h"
+#include "memory.h"
+#include "wrap.h"
+
+void WrapCacheInit(WrapCache* cache) {
+    ZeroMemory(cache, sizeof(WrapCache));
+}
+
+// Function to release the per-line break arrays of a layout
+static void WrapLayoutFree(WrapCache* cache, WrapLayout* layout) {
+    if (layout == NULL) {
+        return;
+    }
+
+    if (layout->lines != NULL) {
+        for (size_t i = 0; i < cache->text.lineCount; i++) {
+            MemFree(layout->lines[i].breaks);
+            MemFree(layout->lines[i].resume);
+        }
+        MemFree(layout->lines);
+    }
+    MemFree(layout);
+}
+
+// Function to drop every cached layout (the worker must be stopped first)
+static void WrapDropLayouts(WrapCache* cache) {
+    for (int i = 0; i < WRAP_MAX_LAYOUTS; i++) {
+        WrapLayoutFree(cache, cache->layouts[i]);
+        cache->layouts[i] = NULL;
+    }
+}
+
+void WrapCacheFree(WrapCache* cache) {
+    WrapCancelBackground(cache);
+    WrapDropLayouts(cache);
+    MemFree(cache->text.text);
+    MemFree(cache->text.lineStarts);
+    ZeroMemory(&cache->text, sizeof(WrapText));
+}
+
+BOOL WrapCacheSetText(WrapCache* cache, WCHAR* text, size_t length) {
+    WrapCancelBackground(cache);
+    WrapDropLayouts(cache);
+    MemFree(cache->text.text);
+    MemFree(cache->text.lineStarts);
+    ZeroMemory(&cache->text, sizeof(WrapText));
+
+    // Count logical lines first so the line index is allocated once
+    size_t lineCount = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == L'\r' || (text[i] == L'\n' && (i == 0 || text[i - 1] != L'\r'))) {
+            lineCount++;
+        }
+    }
+
+    size_t* lineStarts = (size_t*)MemAlloc(MEM_CACHE, (lineCount + 1) * sizeof(size_t));
+    if (lineStarts == NULL) {
+        MemFree(text);
+        return FALSE;
+    }
+
+    size_t line = 0;
+    lineStarts[line++] = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == L'\r' && i + 1 < length && text[i + 1] == L'\n') {
+            continue;
+        }
+        if (text[i] == L'\r' || text[i] == L'\n') {
+            lineStarts[line++] = i + 1;
+        }
+    }
+    lineStarts[lineCount] = length;
+
+    cache->text.text = text;
+    cache->text.length = length;
+    cache->text.lineStarts = lineStarts;
+    cache->text.lineCount = lineCount;
+    return TRUE;
+}
+
+WrapLayout* WrapCacheSelect(WrapCache* cache, int columns, int charWidth, int fontHeight) {
+    int freeSlot = -1;
+    int oldestSlot = 0;
+
+    for (int i = 0; i < WRAP_MAX_LAYOUTS; i++) {
+        WrapLayout* layout = cache->layouts[i];
+        if (layout == NULL) {
+            if (freeSlot < 0) {
+                freeSlot = i;
+            }
+            continue;
+        }
+        if (layout->columns == columns && layout->charWidth == charWidth && layout->fontHeight == fontHeight) {
+            layout->lastUsed = ++cache->selections;
+            return layout;
+        }
+        if (cache->layouts[oldestSlot] == NULL || layout->lastUsed < cache->layouts[oldestSlot]->lastUsed) {
+            oldestSlot = i;
+        }
+    }
+
+    WrapLayout* layout = (WrapLayout*)MemAlloc(MEM_CACHE, sizeof(WrapLayout));
+    if (layout == NULL) {
+        return NULL;
+    }
+    ZeroMemory(layout, sizeof(WrapLayout));
+
+    layout->lines = (WrapLine*)MemAlloc(MEM_CACHE, (cache->text.lineCount + 1) * sizeof(WrapLine));
+    if (layout->lines == NULL) {
+        MemFree(layout);
+        return NULL;
+    }
+    ZeroMemory(layout->lines, cache->text.lineCount * sizeof(WrapLine));
+
+    layout->columns = columns > 0 ? columns : 1;
+    layout->charWidth = charWidth;
+    layout->fontHeight = fontHeight;
+    layout->lastUsed = ++cache->selections;
+
+    int slot = freeSlot;
+    if (slot < 0) {
+        // Evict the least recently used layout, stopping the worker if it is filling that one
+        slot = oldestSlot;
+        if (cache->workerLayout == cache->layouts[slot]) {
+            WrapCancelBackground(cache);
+        }
+        WrapLayoutFree(cache, cache->layouts[slot]);
+    }
+    cache->layouts[slot] = layout;
+    return layout;
+}
+
+// Function to record the start of a new visual row within a line
+static BOOL WrapAddBreak(WrapLine* line, size_t offset) {
+    if (line->breakCount == line->breakCapacity) {
+        size_t capacity = line->breakCapacity > 0 ? line->breakCapacity * 2 : 4;
+        size_t* breaks = (size_t*)MemRealloc(MEM_CACHE, line->breaks, capacity * sizeof(size_t));
+        if (breaks == NULL) {
+            return FALSE;
+        }
+        line->breaks = breaks;
+        line->breakCapacity = capacity;
+    }
+    line->breaks[line->breakCount++] = offset;
+    return TRUE;
+}
+
+// Function to lay out up to WRAP_CHUNK_SIZE units of one line with a greedy word wrap
+// Returns TRUE once the whole line is done
+static BOOL WrapLayoutSlice(const WrapText* text, WrapLayout* layout, size_t lineIndex) {
+    WrapLine* line = &layout->lines[lineIndex];
+    if (line->done) {
+        return TRUE;
+    }
+
+    const WCHAR* start = text->text + text->lineStarts[lineIndex];
+    size_t end = text->lineStarts[lineIndex + 1] - text->lineStarts[lineIndex];
+
+    // Exclude the line terminator
+    while (end > 0 && (start[end - 1] == L'\r' || start[end - 1] == L'\n')) {
+        end--;
+    }
+
+    WrapResume state = { 0, 0, 0, 0, 0 };
+    if (line->resume != NULL) {
+        state = *line->resume;
+    }
+
+    size_t columns = (size_t)layout->columns;
+    size_t sliceEnd = state.position + WRAP_CHUNK_SIZE < end ? state.position + WRAP_CHUNK_SIZE : end;
+
+    // A line longer than one slice needs somewhere to keep its state between slices;
+    // if that cannot be allocated, finish the line in one go instead
+    if (sliceEnd < end && line->resume == NULL) {
+        line->resume = (WrapResume*)MemAlloc(MEM_CACHE, sizeof(WrapResume));
+        if (line->resume == NULL) {
+            sliceEnd = end;
+        }
+    }
+
+    for (size_t i = state.position; i < sliceEnd; i++) {
+        WCHAR ch = start[i];
+        size_t width = ColumnUnitWidth(start, end, i, state.column, TAB_WIDTH);
+
+        // Zero-width units (combining marks, the low half of a surrogate pair) stay on their row
+        if (width > 0 && state.column + width > columns && state.column > 0) {
+            // Break after the last space in this row if there is one, otherwise mid-word
+            size_t rowStart = state.lastBreak > state.rowStart ? state.lastBreak : i;
+            state.column = rowStart == i ? 0 : state.column - state.lastBreakColumn;
+            state.rowStart = rowStart;
+            state.lastBreak = rowStart;
+            state.lastBreakColumn = 0;
+            if (!WrapAddBreak(line, rowStart)) {
+                InterlockedExchange(&layout->failed, 1);
+            }
+        }
+
+        state.column += width;
+        if (ch == L' ' || ch == L'\t') {
+            state.lastBreak = i + 1;
+            state.lastBreakColumn = state.column;
+        }
+    }
+    state.position = sliceEnd;
+
+    if (sliceEnd < end) {
+        *line->resume = state;
+        return FALSE;
+    }
+
+    MemFree(line->resume);
+    line->resume = NULL;
+    line->done = TRUE;
+    InterlockedIncrement(&layout->linesDone);
+    return TRUE;
+}
+
+void WrapLayoutLines(WrapCache* cache, WrapLayout* layout, size_t firstLine, size_t lastLine) {
+    if (layout == NULL || cache->text.lineCount == 0) {
+        return;
+    }
+    if (lastLine >= cache->text.lineCount) {
+        lastLine = cache->text.lineCount - 1;
+    }
+
+    for (size_t i = firstLine; i <= lastLine; i++) {
+        // Only the first slice of a long visible line is needed to fill the viewport
+        WrapLayoutSlice(&cache->text, layout, i);
+    }
+}
+
+// Background worker: lays out every remaining line slice by slice, checking for cancellation
+static DWORD WINAPI WrapWorker(LPVOID param) {
+    WrapCache* cache = (WrapCache*)param;
+    WrapLayout* layout = cache->workerLayout;
+
+    for (size_t i = 0; i < cache->text.lineCount; i++) {
+        while (!WrapLayoutSlice(&cache->text, layout, i)) {
+            if (cache->cancel) {
+                return 0;
+            }
+        }
+        if ((i & 1023) == 0 && cache->cancel) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+void WrapStartBackground(WrapCache* cache, WrapLayout* layout) {
+    WrapCancelBackground(cache);
+    if (layout == NULL || WrapIsComplete(cache, layout)) {
+        return;
+    }
+
+    cache->cancel = 0;
+    cache->workerLayout = layout;
+    cache->worker = CreateThread(NULL, 0, WrapWorker, cache, 0, NULL);
+    if (cache->worker == NULL) {
+        // No thread available: finish the layout on the calling thread
+        cache->workerLayout = NULL;
+        for (size_t i = 0; i < cache->text.lineCount; i++) {
+            while (!WrapLayoutSlice(&cache->text, layout, i)) {
+            }
+        }
+    }
+}
+
+void WrapCancelBackground(WrapCache* cache) {
+    if (cache->worker == NULL) {
+        return;
+    }
+
+    InterlockedExchange(&cache->cancel, 1);
+    WaitForSingleObject(cache->worker, INFINITE);
+    CloseHandle(cache->worker);
+    cache->worker = NULL;
+    cache->workerLayout = NULL;
+}
+
+BOOL WrapIsComplete(const WrapCache* cache, const WrapLayout* layout) {
+    return layout != NULL && !layout->failed && (size_t)layout->linesDone >= cache->text.lineCount;
+}
+
+BOOL WrapLayoutsEqual(const WrapCache* cache, const WrapLayout* a, const WrapLayout* b) {
+    if (!WrapIsComplete(cache, a) || !WrapIsComplete(cache, b)) {
+        return FALSE;
+    }
+
+    for (size_t i = 0; i < cache->text.lineCount; i++) {
+        const WrapLine* lineA = &a->lines[i];
+        const WrapLine* lineB = &b->lines[i];
+        if (lineA->breakCount != lineB->breakCount) {
+            return FALSE;
+        }
+        if (lineA->breakCount > 0 && memcmp(lineA->breaks, lineB->breaks, lineA->breakCount * sizeof(size_t)) != 0) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+size_t WrapGetRowCount(const WrapLayout* layout, size_t line) {
+    if (layout == NULL || !layout->lines[line].done) {
+        return 1;
+    }
+    return layout->lines[line].breakCount + 1;
+}
@@ -0,0 +1,88 @@
+// CyCharm : Word-wrap layout engine with a per-line break cache
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_WRAP_H
+#define CYCHARM_WRAP_H
+
+#include <windows.h>
+
+// Number of layouts (width/font combinations) kept so resize and zoom can switch back instantly
+#define WRAP_MAX_LAYOUTS 4
+
+// Long lines are laid out in slices of this many UTF-16 units so one huge line cannot stall layout
+#define WRAP_CHUNK_SIZE 65536
+
+// Resumable greedy-wrap state for a line that has only been partly laid out
+typedef struct WrapResume {
+    size_t position;
+    size_t rowStart;
+    size_t lastBreak;
+    size_t column;
+    size_t lastBreakColumn;
+} WrapResume;
+
+// Visual-line breaks of one logical line
+typedef struct WrapLine {
+    size_t* breaks;      // Offsets within the line where each continuation row starts
+    size_t breakCount;
+    size_t breakCapacity;
+    WrapResume* resume;  // Non-NULL while the line is partly laid out
+    BOOL done;
+} WrapLine;
+
+// Text the layouts are computed from, with its logical line index
+typedef struct WrapText {
+    WCHAR* text;
+    size_t length;
+    size_t* lineStarts;
+    size_t lineCount;
+} WrapText;
+
+// Visual-line breaks for every logical line at one width and font
+typedef struct WrapLayout {
+    int columns;
+    int charWidth;
+    int fontHeight;
+    WrapLine* lines;
+    volatile LONG linesDone;
+    volatile LONG failed;  // Set if a break could not be recorded; the layout is then never complete
+    DWORD lastUsed;  // Selection it was last returned by, counted per cache
+} WrapLayout;
+
+typedef struct WrapCache {
+    WrapText text;
+    WrapLayout* layouts[WRAP_MAX_LAYOUTS];
+    HANDLE worker;
+    WrapLayout* workerLayout;
+    volatile LONG cancel;
+    DWORD selections;  // Calls to WrapCacheSelect so far, so the last layout selected is never the oldest
+} WrapCache;
+
+void WrapCacheInit(WrapCache* cache);
+void WrapCacheFree(WrapCache* cache);
+
+// Replace the text the layouts are computed from and drop every cached layout
+// Takes ownership of a buffer allocated with MemAlloc
+BOOL WrapCacheSetText(WrapCache* cache, WCHAR* text, size_t length);
+
+// Find the layout for a width and font, or create an empty one (evicting the least recently used)
+// The layout returned by the previous call is never the one evicted
+WrapLayout* WrapCacheSelect(WrapCache* cache, int columns, int charWidth, int fontHeight);
+
+// Lay out a range of logical lines right away on the calling thread
+void WrapLayoutLines(WrapCache* cache, WrapLayout* layout, size_t firstLine, size_t lastLine);
+
+// Finish the remaining lines of a layout on a background thread
+void WrapStartBackground(WrapCache* cache, WrapLayout* layout);
+void WrapCancelBackground(WrapCache* cache);
+
+// TRUE once every line is laid out, and never for a layout that failed to record a break
+BOOL WrapIsComplete(const WrapCache* cache, const WrapLayout* layout);
+
+// TRUE if two complete layouts place every visual-line break at the same offset
+BOOL WrapLayoutsEqual(const WrapCache* cache, const WrapLayout* a, const WrapLayout* b);
+
+// Number of visual rows a logical line occupies (1 if the line is not laid out yet)
+size_t WrapGetRowCount(const WrapLayout* layout, size_t line);
+
+#endif
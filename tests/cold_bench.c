@@ -0,0 +1,156 @@
+// CyCharm : Benchmark for cold chunk storage - resident memory against scroll latency per budget
+// Copyright 2023-2025 Cyril John Magayaga
+//
+// Build and run on Linux from the repository root:
+//   gcc -O2 -fshort-wchar -pthread -Itests/win32 -Isrc -o cold_bench tests/cold_bench.c tests/win32/win32.c
+//       src/document.c src/memory.c src/compress.c src/hash.c src/structure.c
+//   ./cold_bench [megabytes of text] [jumps per budget]
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "document.h"
+#include "memory.h"
+
+// Lines in one screenful, read on every jump
+#define BENCH_SCREEN_LINES 60
+
+// Text appended to the document at a time while it is built
+#define BENCH_PIECE_UNITS (1024 * 1024)
+
+// Resident budgets tried, in megabytes, smallest first so freed memory is not counted for the next;
+// 0 keeps every chunk resident
+static const int g_budgets[] = { 4, 16, 64, 0 };
+
+// Function to read the resident set size of this process
+static size_t BenchResident(void) {
+    long pages = 0;
+    long resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) {
+        return 0;
+    }
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static double BenchNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static int BenchCompare(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Function to build a log-like document a piece at a time, so the whole text is never held at once
+static BOOL BenchBuildDocument(Document* doc, size_t length) {
+    WCHAR* piece = (WCHAR*)malloc(BENCH_PIECE_UNITS * sizeof(WCHAR));
+    if (piece == NULL) {
+        return FALSE;
+    }
+    static const char* levels[] = { "INFO", "WARN", "DEBUG", "ERROR" };
+    unsigned seed = 12345;
+    unsigned long line = 0;
+    char row[160];
+    while (DocLength(doc) < length) {
+        size_t used = 0;
+        while (used + sizeof(row) < BENCH_PIECE_UNITS) {
+            seed = seed * 1103515245u + 12345u;
+            int rowLength = snprintf(row, sizeof(row), "2025-03-%02lu %02lu:%02lu:%02lu.%03u [%s] worker-%u request %u took %u ms\r",
+                1 + line / 8640000 % 28, line / 360000 % 24, line / 6000 % 60, line / 100 % 60, seed % 1000,
+                levels[(seed >> 8) % 4], (seed >> 12) % 16, seed >> 4, (seed >> 20) % 5000);
+            for (int i = 0; i < rowLength; i++) {
+                piece[used++] = (WCHAR)row[i];
+            }
+            line++;
+        }
+        if (!DocReplace(doc, DocLength(doc), DocLength(doc), piece, used)) {
+            free(piece);
+            return FALSE;
+        }
+    }
+    free(piece);
+    return TRUE;
+}
+
+// Function to jump to random lines and read a screenful at each, as scrolling with the thumb does,
+// and report the latency percentiles in microseconds
+static BOOL BenchJumps(const Document* doc, int jumps, double* p50, double* p99, double* worst) {
+    double* times = (double*)malloc((size_t)jumps * sizeof(double));
+    WCHAR* screen = (WCHAR*)malloc(BENCH_SCREEN_LINES * 256 * sizeof(WCHAR));
+    if (times == NULL || screen == NULL) {
+        free(times);
+        free(screen);
+        return FALSE;
+    }
+    size_t lines = DocLineCount(doc);
+    unsigned seed = 42;
+    for (int i = 0; i < jumps; i++) {
+        seed = seed * 1103515245u + 12345u;
+        size_t first = (size_t)(((unsigned long long)seed << 16 ^ seed) % (lines - BENCH_SCREEN_LINES));
+
+        double start = BenchNow();
+        size_t from = DocLineStart(doc, first);
+        size_t to = DocLineStart(doc, first + BENCH_SCREEN_LINES);
+        if (to - from > BENCH_SCREEN_LINES * 256) {
+            to = from + BENCH_SCREEN_LINES * 256;
+        }
+        DocGetText(doc, from, to, screen);
+        times[i] = BenchNow() - start;
+    }
+    qsort(times, (size_t)jumps, sizeof(double), BenchCompare);
+    *p50 = times[jumps / 2];
+    *p99 = times[jumps - 1 - jumps / 100];
+    *worst = times[jumps - 1];
+    free(times);
+    free(screen);
+    return TRUE;
+}
+
+int main(int argc, char** argv) {
+    int megabytes = argc > 1 ? atoi(argv[1]) : 256;
+    int jumps = argc > 2 ? atoi(argv[2]) : 2000;
+    if (megabytes < 1 || jumps < 100) {
+        fprintf(stderr, "usage: cold_bench [megabytes of text] [jumps per budget (at least 100)]\n");
+        return 2;
+    }
+    size_t length = (size_t)megabytes * 1024 * 1024 / sizeof(WCHAR);
+
+    printf("%8s %12s %12s %12s %10s %10s %10s\n", "budget", "text", "accounted", "resident", "p50 us", "p99 us", "max us");
+    for (size_t i = 0; i < sizeof(g_budgets) / sizeof(g_budgets[0]); i++) {
+        DocSetResidentLimit((size_t)g_budgets[i] * 1024 * 1024);
+        Document doc;
+        DocInit(&doc);
+        if (!BenchBuildDocument(&doc, length)) {
+            fprintf(stderr, "FAILED: could not build the document\n");
+            return 1;
+        }
+
+        double p50, p99, worst;
+        if (!BenchJumps(&doc, jumps, &p50, &p99, &worst)) {
+            fprintf(stderr, "FAILED: out of memory\n");
+            return 1;
+        }
+        char budget[16];
+        snprintf(budget, sizeof(budget), g_budgets[i] > 0 ? "%d MB" : "none", g_budgets[i]);
+        printf("%8s %12zu %12zu %12zu %10.1f %10.1f %10.1f\n", budget, DocLength(&doc) * sizeof(WCHAR),
+            MemGetUsage(MEM_DOCUMENT) + MemGetUsage(MEM_CACHE), BenchResident(), p50, p99, worst);
+        DocFree(&doc);
+    }
+
+    if (MemGetUsage(MEM_DOCUMENT) != 0 || MemGetUsage(MEM_CACHE) != 0) {
+        fprintf(stderr, "FAILED: document memory was left after DocFree\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,134 @@
+// CyCharm : Test for numbers in sorts - the line sort and the table's numeric columns read them alike
+// Copyright 2023-2025 Cyril John Magayaga
+//
+// Build and run on Linux from the repository root:
+//   gcc -O2 -fshort-wchar -pthread -Itests/win32 -Isrc -o numeric_sort tests/numeric_sort.c tests/win32/win32.c
+//       src/lines.c src/table.c src/document.c src/memory.c src/compress.c src/hash.c src/structure.c
+//   ./numeric_sort
+
+#include <windows.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include "document.h"
+#include "lines.h"
+#include "memory.h"
+#include "table.h"
+
+static int g_failures = 0;
+
+static void TestFail(const char* what, const char* text) {
+    fprintf(stderr, "FAILED: %s: \"%s\"\n", what, text);
+    g_failures++;
+}
+
+// Function to widen ASCII text into a WCHAR buffer, returning its length
+static size_t TestWiden(const char* text, WCHAR* out) {
+    size_t length = 0;
+    while (text[length] != '\0') {
+        out[length] = (WCHAR)(unsigned char)text[length];
+        length++;
+    }
+    return length;
+}
+
+typedef struct ParseCase {
+    const char* text;
+    size_t read;     // Units LinesParseNumber should read, 0 for no number
+    double value;
+} ParseCase;
+
+static const ParseCase g_parseCases[] = {
+    { "42", 2, 42 },
+    { "  -7.5 apples", 6, -7.5 },
+    { ".25", 3, 0.25 },
+    { "1e5", 3, 1e5 },
+    { "2.5E-3", 6, 2.5e-3 },
+    { "+3e+2", 5, 3e2 },
+    { "6e", 1, 6 },
+    { "8e+x", 1, 8 },
+    { "1e999", 5, HUGE_VAL },
+    { "1e-999", 6, 0 },
+    { "e5", 0, 0 },
+    { "-", 0, 0 },
+    { ".", 0, 0 },
+    { "abc", 0, 0 },
+};
+
+// Function to check the shared parser on its own
+static void TestParse(void) {
+    WCHAR text[64];
+    for (size_t i = 0; i < sizeof(g_parseCases) / sizeof(g_parseCases[0]); i++) {
+        const ParseCase* test = &g_parseCases[i];
+        size_t length = TestWiden(test->text, text);
+        double value = 0;
+        size_t read = LinesParseNumber(text, length, &value);
+        if (read != test->read) {
+            TestFail("LinesParseNumber read the wrong number of units", test->text);
+        } else if (read > 0 && value != test->value &&
+                (value - test->value > test->value * 1e-12 || test->value - value > test->value * 1e-12)) {
+            TestFail("LinesParseNumber read the wrong value", test->text);
+        }
+    }
+}
+
+// Function to check that a numeric line sort orders exponents by value
+static void TestLineSort(void) {
+    static const char* lines = "1e5\r-3e2\r42\r2.5E-3\rnone\r7e1\r1E2";
+    static const char* sorted = "none\r-3e2\r2.5E-3\r42\r7e1\r1E2\r1e5";
+    WCHAR text[64];
+    size_t length = TestWiden(lines, text);
+
+    LineSet set;
+    if (!LineSetInit(&set, text, length) || !LineSetSort(&set, LINES_SORT_NUMERIC)) {
+        TestFail("the line sort ran out of memory", lines);
+        return;
+    }
+    size_t joinedLength = 0;
+    WCHAR* joined = LineSetJoin(&set, &joinedLength);
+    WCHAR expected[64];
+    size_t expectedLength = TestWiden(sorted, expected);
+    if (joined == NULL || joinedLength != expectedLength || memcmp(joined, expected, expectedLength * sizeof(WCHAR)) != 0) {
+        TestFail("numeric line sort is out of order", sorted);
+    }
+    MemFree(joined);
+    LineSetFree(&set);
+}
+
+// Function to check that a table column of exponents is numeric and sorts by value, while a column
+// that only starts with numbers is not numeric
+static void TestTable(void) {
+    static const char* csv = "name,value,code\ra,1e5,1.2.3\rb,2.5E-3,4e\rc,-3e2,7\rd,42,8";
+    static const size_t sortedRows[] = { 0, 3, 2, 4, 1 };
+    WCHAR text[128];
+    size_t length = TestWiden(csv, text);
+
+    Document doc;
+    DocInit(&doc);
+    TableIndex table;
+    TableInit(&table);
+    if (!DocSetText(&doc, text, length) || !TableBuild(&table, &doc, L',')) {
+        TestFail("the table ran out of memory", csv);
+    } else if (!table.numeric[1]) {
+        TestFail("a column of exponents is not numeric", csv);
+    } else if (table.numeric[2]) {
+        TestFail("a column of values that only start with numbers is numeric", csv);
+    } else if (!TableSort(&table, &doc, 1, FALSE) || table.order == NULL) {
+        TestFail("the table sort ran out of memory", csv);
+    } else if (memcmp(table.order, sortedRows, sizeof(sortedRows)) != 0) {
+        TestFail("the numeric column is sorted out of order", csv);
+    }
+    TableFree(&table);
+    DocFree(&doc);
+}
+
+int main(void) {
+    TestParse();
+    TestLineSort();
+    TestTable();
+    if (g_failures > 0) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,151 @@
+// CyCharm : Benchmark for repeated saves - the save pipeline's stages should stop touching the heap
+// Copyright 2023-2025 Cyril John Magayaga
+//
+// Build and run on Linux from the repository root:
+//   gcc -O2 -fshort-wchar -pthread -Itests/win32 -Isrc -o save_bench tests/save_bench.c tests/win32/win32.c
+//       src/document.c src/memory.c src/compress.c src/hash.c src/structure.c src/eol.c src/gzip.c
+//   ./save_bench [megabytes of text] [saves]
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "document.h"
+#include "eol.h"
+#include "gzip.h"
+#include "memory.h"
+
+// Saves before the arena has settled on one block of the right size
+#define BENCH_WARMUP_SAVES 2
+
+// Resident growth allowed after the warm-up, for the C library's own buffers
+#define BENCH_RSS_SLACK (1024 * 1024)
+
+// Function to read the resident set size of this process
+static size_t BenchResident(void) {
+    long pages = 0;
+    long resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) {
+        return 0;
+    }
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// Function to fill a document with lines of varying length, broken by '\r' as the edit control holds them
+static BOOL BenchBuildDocument(Document* doc, size_t length) {
+    WCHAR* text = (WCHAR*)malloc((length + 1) * sizeof(WCHAR));
+    if (text == NULL) {
+        return FALSE;
+    }
+    size_t at = 0;
+    for (unsigned line = 0; at < length; line++) {
+        size_t lineLength = 20 + (line * 7919u) % 100;
+        for (size_t i = 0; i < lineLength && at < length; i++) {
+            text[at++] = (WCHAR)(L'a' + (line + i) % 26);
+        }
+        if (at < length) {
+            text[at++] = L'\r';
+        }
+    }
+    BOOL ok = DocSetText(doc, text, length);
+    free(text);
+    return ok;
+}
+
+// Function to run the save pipeline's stages on the document, as Save does for a .gz path in UTF-16LE:
+// copy the text out, expand line breaks while encoding, wrap it in gzip and write it
+static BOOL BenchSave(Arena* arena, const Document* doc, FILE* file) {
+    size_t length = DocLength(doc);
+    WCHAR* text = (WCHAR*)ArenaAlloc(arena, (length + 1) * sizeof(WCHAR));
+    if (text == NULL) {
+        return FALSE;
+    }
+    length = DocGetText(doc, 0, length, text);
+
+    size_t expandedLength = EolExpandedLength(text, length, EOL_CRLF);
+    unsigned char* encoded = (unsigned char*)ArenaAlloc(arena, expandedLength * sizeof(WCHAR) + 2);
+    if (encoded == NULL) {
+        return FALSE;
+    }
+    encoded[0] = 0xFF;
+    encoded[1] = 0xFE;
+    size_t encodedSize = 2 + EolExpand(text, length, EOL_CRLF, (WCHAR*)(encoded + 2)) * sizeof(WCHAR);
+
+    unsigned char* packed = (unsigned char*)ArenaAlloc(arena, GzipStoredSize(encodedSize));
+    if (packed == NULL) {
+        return FALSE;
+    }
+    size_t packedSize = GzipStore(encoded, encodedSize, packed);
+
+    rewind(file);
+    return fwrite(packed, 1, packedSize, file) == packedSize;
+}
+
+int main(int argc, char** argv) {
+    int megabytes = argc > 1 ? atoi(argv[1]) : 64;
+    int saves = argc > 2 ? atoi(argv[2]) : 20;
+    if (megabytes < 1 || saves <= BENCH_WARMUP_SAVES) {
+        fprintf(stderr, "usage: save_bench [megabytes of text] [saves (more than %d)]\n", BENCH_WARMUP_SAVES);
+        return 2;
+    }
+
+    Document doc;
+    DocInit(&doc);
+    if (!BenchBuildDocument(&doc, (size_t)megabytes * 1024 * 1024 / sizeof(WCHAR))) {
+        fprintf(stderr, "FAILED: could not build the document\n");
+        return 1;
+    }
+    FILE* file = tmpfile();
+    if (file == NULL) {
+        fprintf(stderr, "FAILED: could not create a file to save to\n");
+        return 1;
+    }
+
+    Arena arena;
+    ArenaInit(&arena, MEM_SCRATCH, 0);
+    size_t settledTotal = 0;
+    size_t settledPeak = 0;
+    size_t settledResident = 0;
+    BOOL grew = FALSE;
+
+    printf("%5s %12s %12s %12s %12s %8s\n", "save", "accounted", "peak", "scratch", "resident", "ms");
+    for (int i = 1; i <= saves; i++) {
+        DWORD start = GetTickCount();
+        if (!BenchSave(&arena, &doc, file)) {
+            fprintf(stderr, "FAILED: save %d ran out of memory\n", i);
+            return 1;
+        }
+        ArenaReset(&arena);
+        DWORD elapsed = GetTickCount() - start;
+
+        size_t total = MemGetTotalUsage();
+        size_t peak = MemGetPeakUsage();
+        size_t resident = BenchResident();
+        printf("%5d %12zu %12zu %12zu %12zu %8lu\n", i, total, peak, MemGetUsage(MEM_SCRATCH), resident, (unsigned long)elapsed);
+
+        // Once the arena has its block, another save of the same text must not take any more memory
+        if (i == BENCH_WARMUP_SAVES) {
+            settledTotal = total;
+            settledPeak = peak;
+            settledResident = resident;
+        } else if (i > BENCH_WARMUP_SAVES &&
+                (total > settledTotal || peak > settledPeak || resident > settledResident + BENCH_RSS_SLACK)) {
+            grew = TRUE;
+        }
+    }
+
+    fclose(file);
+    ArenaRelease(&arena);
+    DocFree(&doc);
+    if (grew) {
+        fprintf(stderr, "FAILED: memory grew after the first %d saves\n", BENCH_WARMUP_SAVES);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
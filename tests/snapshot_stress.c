@@ -0,0 +1,145 @@
+// CyCharm : Stress test for document snapshots - writers publish while readers pin and read
+// Copyright 2023-2025 Cyril John Magayaga
+//
+// Build and run on Linux from the repository root (add -fsanitize=thread or address to check races):
+//   gcc -O2 -fshort-wchar -pthread -Itests/win32 -Isrc -o snapshot_stress tests/snapshot_stress.c
+//       tests/win32/win32.c src/snapshot.c src/document.c src/memory.c src/compress.c src/hash.c src/structure.c
+//   ./snapshot_stress [writers] [readers] [versions per writer]
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "document.h"
+#include "memory.h"
+#include "snapshot.h"
+
+#define STRESS_MAX_LENGTH 5000
+
+static SnapshotChannel g_channel;
+static volatile LONG g_stop = 0;
+static volatile LONG g_failures = 0;
+static volatile LONG64 g_reads = 0;
+static int g_versions = 20000;
+
+static void StressFail(const char* message) {
+    if (InterlockedIncrement(&g_failures) == 1) {
+        fprintf(stderr, "FAILED: %s\n", message);
+    }
+}
+
+// Function to tell whether text is one character repeated, as every published version is
+static BOOL StressIsUniform(const WCHAR* text, size_t length) {
+    for (size_t i = 1; i < length; i++) {
+        if (text[i] != text[0]) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// Each writer keeps its own document and publishes every version of it; a version is one
+// character repeated, a different character and length each time
+static DWORD WINAPI StressWriter(LPVOID param) {
+    int id = (int)(intptr_t)param;
+    WCHAR* text = (WCHAR*)malloc(STRESS_MAX_LENGTH * sizeof(WCHAR));
+    Document doc;
+    DocInit(&doc);
+
+    for (int i = 0; i < g_versions && g_failures == 0; i++) {
+        size_t length = 1 + (size_t)(i * 37 + id * 101) % (STRESS_MAX_LENGTH - 1);
+        WCHAR c = (WCHAR)(L'A' + (id * 7 + i) % 26);
+        for (size_t j = 0; j < length; j++) {
+            text[j] = c;
+        }
+        if (!DocReplace(&doc, 0, DocLength(&doc), text, length)) {
+            StressFail("DocReplace ran out of memory");
+        } else if (!SnapshotPublish(&g_channel, &doc)) {
+            StressFail("SnapshotPublish ran out of memory");
+        }
+    }
+
+    DocFree(&doc);
+    free(text);
+    return 0;
+}
+
+// Readers pin whatever is current and check it stays the same text however much is published meanwhile
+static DWORD WINAPI StressReader(LPVOID param) {
+    int slot = SnapshotRegister(&g_channel);
+    if (slot < 0) {
+        StressFail("no reader slot");
+        return 0;
+    }
+    WCHAR* text = (WCHAR*)malloc(STRESS_MAX_LENGTH * sizeof(WCHAR));
+
+    while (InterlockedCompareExchange(&g_stop, 0, 0) == 0 && g_failures == 0) {
+        const SnapshotVersion* version = SnapshotPin(&g_channel, slot);
+        size_t length = DocLength(&version->doc);
+        ContentHash hash = DocHash(&version->doc);
+        if (DocGetText(&version->doc, 0, length, text) != length || !StressIsUniform(text, length)) {
+            StressFail("a pinned version was not a text that was published");
+        }
+
+        Sleep(0); // Let the writers publish and reclaim while the version is pinned
+        if (DocLength(&version->doc) != length || !HashEqual(DocHash(&version->doc), hash) ||
+            DocGetText(&version->doc, 0, length, text) != length || !StressIsUniform(text, length)) {
+            StressFail("a pinned version changed");
+        }
+        SnapshotUnpin(&g_channel, slot);
+        InterlockedIncrement64(&g_reads);
+    }
+
+    SnapshotUnregister(&g_channel, slot);
+    free(text);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int writers = argc > 1 ? atoi(argv[1]) : 4;
+    int readers = argc > 2 ? atoi(argv[2]) : 8;
+    g_versions = argc > 3 ? atoi(argv[3]) : g_versions;
+    if (writers < 1 || readers < 1 || readers > SNAPSHOT_MAX_READERS || writers + readers > 256 || g_versions < 1) {
+        fprintf(stderr, "usage: snapshot_stress [writers] [readers (at most %d)] [versions per writer]\n", SNAPSHOT_MAX_READERS);
+        return 2;
+    }
+    if (!SnapshotInit(&g_channel)) {
+        fprintf(stderr, "FAILED: SnapshotInit ran out of memory\n");
+        return 1;
+    }
+
+    HANDLE threads[256];
+    DWORD start = GetTickCount();
+    for (int i = 0; i < readers; i++) {
+        threads[i] = CreateThread(NULL, 0, StressReader, NULL, 0, NULL);
+    }
+    for (int i = 0; i < writers; i++) {
+        threads[readers + i] = CreateThread(NULL, 0, StressWriter, (LPVOID)(intptr_t)i, 0, NULL);
+    }
+    for (int i = 0; i < writers; i++) {
+        WaitForSingleObject(threads[readers + i], INFINITE);
+        CloseHandle(threads[readers + i]);
+    }
+    InterlockedExchange(&g_stop, 1);
+    for (int i = 0; i < readers; i++) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+
+    // With no reader left, one more pass frees everything retired; only the current version remains
+    SnapshotReclaim(&g_channel);
+    if (g_channel.retired != NULL) {
+        StressFail("retired versions were left with no reader pinning them");
+    }
+    SnapshotFree(&g_channel);
+    if (MemGetUsage(MEM_DOCUMENT) != 0) {
+        StressFail("document memory was left after SnapshotFree");
+    }
+
+    printf("%d writers, %d readers: %d versions published, %lld reads in %lu ms\n", writers, readers,
+        writers * g_versions, (long long)g_reads, (unsigned long)(GetTickCount() - start));
+    if (g_failures != 0) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,147 @@
+// CyCharm : The Win32 calls in tests/win32/windows.h, made from GCC atomics and pthreads
+// Copyright 2023-2025 Cyril John Magayaga
+
+#include <windows.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+LONG InterlockedIncrement(volatile LONG* value) {
+    return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+LONG InterlockedDecrement(volatile LONG* value) {
+    return __atomic_sub_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+LONG InterlockedExchange(volatile LONG* value, LONG exchange) {
+    return __atomic_exchange_n(value, exchange, __ATOMIC_SEQ_CST);
+}
+
+LONG InterlockedExchangeAdd(volatile LONG* value, LONG add) {
+    return __atomic_fetch_add(value, add, __ATOMIC_SEQ_CST);
+}
+
+LONG InterlockedCompareExchange(volatile LONG* value, LONG exchange, LONG comparand) {
+    __atomic_compare_exchange_n(value, &comparand, exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+LONG64 InterlockedIncrement64(volatile LONG64* value) {
+    return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+LONG64 InterlockedExchange64(volatile LONG64* value, LONG64 exchange) {
+    return __atomic_exchange_n(value, exchange, __ATOMIC_SEQ_CST);
+}
+
+LONG64 InterlockedExchangeAdd64(volatile LONG64* value, LONG64 add) {
+    return __atomic_fetch_add(value, add, __ATOMIC_SEQ_CST);
+}
+
+LONG64 InterlockedCompareExchange64(volatile LONG64* value, LONG64 exchange, LONG64 comparand) {
+    __atomic_compare_exchange_n(value, &comparand, exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+PVOID InterlockedExchangePointer(PVOID volatile* value, PVOID exchange) {
+    return __atomic_exchange_n(value, exchange, __ATOMIC_SEQ_CST);
+}
+
+PVOID InterlockedCompareExchangePointer(PVOID volatile* value, PVOID exchange, PVOID comparand) {
+    __atomic_compare_exchange_n(value, &comparand, exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+// Critical sections are recursive on Windows
+void InitializeCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    section->mutex = malloc(sizeof(pthread_mutex_t));
+    pthread_mutex_init((pthread_mutex_t*)section->mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+}
+
+void DeleteCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutex_destroy((pthread_mutex_t*)section->mutex);
+    free(section->mutex);
+}
+
+void EnterCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutex_lock((pthread_mutex_t*)section->mutex);
+}
+
+void LeaveCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutex_unlock((pthread_mutex_t*)section->mutex);
+}
+
+typedef struct Win32Thread {
+    pthread_t thread;
+    LPTHREAD_START_ROUTINE start;
+    LPVOID param;
+    BOOL joined;
+} Win32Thread;
+
+static void* Win32ThreadMain(void* param) {
+    Win32Thread* thread = (Win32Thread*)param;
+    thread->start(thread->param);
+    return NULL;
+}
+
+HANDLE CreateThread(void* attributes, SIZE_T stackSize, LPTHREAD_START_ROUTINE start, LPVOID param, DWORD flags, LPDWORD id) {
+    Win32Thread* thread = (Win32Thread*)calloc(1, sizeof(Win32Thread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->start = start;
+    thread->param = param;
+    if (pthread_create(&thread->thread, NULL, Win32ThreadMain, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+// Only thread handles are waited on; the wait is always until the thread ends
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds) {
+    Win32Thread* thread = (Win32Thread*)handle;
+    if (!thread->joined) {
+        pthread_join(thread->thread, NULL);
+        thread->joined = TRUE;
+    }
+    return 0;
+}
+
+// Always waits for every thread
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD milliseconds) {
+    for (DWORD i = 0; i < count; i++) {
+        WaitForSingleObject(handles[i], milliseconds);
+    }
+    return 0;
+}
+
+BOOL CloseHandle(HANDLE handle) {
+    Win32Thread* thread = (Win32Thread*)handle;
+    if (!thread->joined) {
+        pthread_detach(thread->thread);
+    }
+    free(thread);
+    return TRUE;
+}
+
+void Sleep(DWORD milliseconds) {
+    usleep(milliseconds * 1000);
+}
+
+DWORD GetTickCount(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (DWORD)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+void GetSystemInfo(SYSTEM_INFO* info) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    info->dwNumberOfProcessors = processors > 0 ? (DWORD)processors : 1;
+}
@@ -0,0 +1,74 @@
+// CyCharm : Just enough of the Win32 API for the model modules to build on Linux (tests only)
+// Copyright 2023-2025 Cyril John Magayaga
+
+#ifndef CYCHARM_TESTS_WINDOWS_H
+#define CYCHARM_TESTS_WINDOWS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+
+// Build with -fshort-wchar so WCHAR is 16 bits, as on Windows
+typedef wchar_t WCHAR;
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned int DWORD;
+typedef unsigned int UINT;
+typedef int LONG;
+typedef long long LONG64;
+typedef unsigned long long ULONGLONG;
+typedef uintptr_t ULONG_PTR;
+typedef uintptr_t SIZE_T;
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef void* HANDLE;
+typedef DWORD* LPDWORD;
+
+#define WINAPI
+#define TRUE 1
+#define FALSE 0
+#define INFINITE 0xFFFFFFFF
+#define MAX_PATH 260
+
+#define ZeroMemory(p, n) memset((p), 0, (n))
+#define CopyMemory(d, s, n) memcpy((d), (s), (n))
+
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+
+// Only the processor count is filled in
+typedef struct SYSTEM_INFO {
+    DWORD dwNumberOfProcessors;
+} SYSTEM_INFO;
+
+typedef struct CRITICAL_SECTION {
+    void* mutex;
+} CRITICAL_SECTION;
+
+LONG InterlockedIncrement(volatile LONG* value);
+LONG InterlockedDecrement(volatile LONG* value);
+LONG InterlockedExchange(volatile LONG* value, LONG exchange);
+LONG InterlockedExchangeAdd(volatile LONG* value, LONG add);
+LONG InterlockedCompareExchange(volatile LONG* value, LONG exchange, LONG comparand);
+LONG64 InterlockedIncrement64(volatile LONG64* value);
+LONG64 InterlockedExchange64(volatile LONG64* value, LONG64 exchange);
+LONG64 InterlockedExchangeAdd64(volatile LONG64* value, LONG64 add);
+LONG64 InterlockedCompareExchange64(volatile LONG64* value, LONG64 exchange, LONG64 comparand);
+PVOID InterlockedExchangePointer(PVOID volatile* value, PVOID exchange);
+PVOID InterlockedCompareExchangePointer(PVOID volatile* value, PVOID exchange, PVOID comparand);
+
+void InitializeCriticalSection(CRITICAL_SECTION* section);
+void DeleteCriticalSection(CRITICAL_SECTION* section);
+void EnterCriticalSection(CRITICAL_SECTION* section);
+void LeaveCriticalSection(CRITICAL_SECTION* section);
+
+HANDLE CreateThread(void* attributes, SIZE_T stackSize, LPTHREAD_START_ROUTINE start, LPVOID param, DWORD flags, LPDWORD id);
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD milliseconds);
+BOOL CloseHandle(HANDLE handle);
+void Sleep(DWORD milliseconds);
+DWORD GetTickCount(void);
+void GetSystemInfo(SYSTEM_INFO* info);
+
+#endif